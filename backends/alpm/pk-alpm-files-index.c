@@ -0,0 +1,287 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * The files index maps the basename of every file shipped by a package to
+ * "repo/pkgname".
+ *
+ * The on-disk layout is a header, an array of PkAlpmFilesEntry sorted by
+ * (basename, path) and a pool of NUL-terminated strings that the entries
+ * point into. It is written at refresh time and mapped read-only, so a
+ * lookup is a binary search and never touches libalpm.
+ */
+
+#include <string.h>
+
+#include "pk-alpm-files-index.h"
+
+#define PK_ALPM_FILES_MAGIC	"PKALPMFI"
+#define PK_ALPM_FILES_VERSION	1
+
+typedef struct {
+	gchar		 magic[8];
+	guint32		 version;
+	guint32		 n_entries;
+	guint32		 strings_size;
+	guint32		 reserved;
+	gint64		 local_mtime;
+} PkAlpmFilesHeader;
+
+typedef struct {
+	guint32		 basename;
+	guint32		 path;
+	guint32		 package;
+} PkAlpmFilesEntry;
+
+struct _PkAlpmFilesBuilder {
+	GString		*strings;
+	GHashTable	*offsets;
+	GArray		*entries;
+};
+
+PkAlpmFilesBuilder *
+pk_alpm_files_builder_new (void)
+{
+	PkAlpmFilesBuilder *builder = g_new0 (PkAlpmFilesBuilder, 1);
+	builder->strings = g_string_new (NULL);
+	builder->offsets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	builder->entries = g_array_new (FALSE, FALSE, sizeof (PkAlpmFilesEntry));
+	return builder;
+}
+
+void
+pk_alpm_files_builder_free (PkAlpmFilesBuilder *builder)
+{
+	g_string_free (builder->strings, TRUE);
+	g_hash_table_unref (builder->offsets);
+	g_array_unref (builder->entries);
+	g_free (builder);
+}
+
+static guint32
+pk_alpm_files_builder_intern (PkAlpmFilesBuilder *builder, const gchar *str)
+{
+	gpointer value;
+	guint32 offset;
+
+	/* offsets are stored plus one so that zero means missing */
+	value = g_hash_table_lookup (builder->offsets, str);
+	if (value != NULL)
+		return GPOINTER_TO_UINT (value) - 1;
+
+	offset = builder->strings->len;
+	g_string_append_len (builder->strings, str, strlen (str) + 1);
+	g_hash_table_insert (builder->offsets, g_strdup (str),
+			     GUINT_TO_POINTER (offset + 1));
+	return offset;
+}
+
+/* returns the handle to add the files of @package with */
+guint32
+pk_alpm_files_builder_add_package (PkAlpmFilesBuilder *builder, const gchar *package)
+{
+	return pk_alpm_files_builder_intern (builder, package);
+}
+
+void
+pk_alpm_files_builder_add_file (PkAlpmFilesBuilder *builder, guint32 package,
+				const gchar *file)
+{
+	const gchar *name;
+	gsize len = strlen (file);
+	PkAlpmFilesEntry entry;
+
+	/* directories are never interesting */
+	if (len == 0 || file[len - 1] == '/')
+		return;
+
+	entry.path = pk_alpm_files_builder_intern (builder, file);
+	name = strrchr (file, '/');
+	entry.basename = entry.path + (name != NULL ? name + 1 - file : 0);
+	entry.package = package;
+	g_array_append_val (builder->entries, entry);
+}
+
+guint
+pk_alpm_files_builder_get_size (PkAlpmFilesBuilder *builder)
+{
+	return builder->entries->len;
+}
+
+static gint
+pk_alpm_files_entry_compare (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const PkAlpmFilesEntry *entry_a = a;
+	const PkAlpmFilesEntry *entry_b = b;
+	const gchar *strings = user_data;
+	gint rc;
+
+	rc = strcmp (strings + entry_a->basename, strings + entry_b->basename);
+	if (rc != 0)
+		return rc;
+	return strcmp (strings + entry_a->path, strings + entry_b->path);
+}
+
+gboolean
+pk_alpm_files_builder_write (PkAlpmFilesBuilder *builder, const gchar *filename,
+			     gint64 local_mtime, GError **error)
+{
+	PkAlpmFilesHeader header;
+	g_autoptr(GString) data = NULL;
+
+	if (builder->strings->len > G_MAXUINT32 ||
+	    builder->entries->len > G_MAXUINT32 / sizeof (PkAlpmFilesEntry)) {
+		g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+				     "files index is too large");
+		return FALSE;
+	}
+
+	g_array_sort_with_data (builder->entries, pk_alpm_files_entry_compare,
+				builder->strings->str);
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, PK_ALPM_FILES_MAGIC, sizeof (header.magic));
+	header.version = PK_ALPM_FILES_VERSION;
+	header.n_entries = builder->entries->len;
+	header.strings_size = builder->strings->len;
+	header.local_mtime = local_mtime;
+
+	data = g_string_sized_new (sizeof (header) +
+				   builder->entries->len * sizeof (PkAlpmFilesEntry) +
+				   builder->strings->len);
+	g_string_append_len (data, (const gchar *) &header, sizeof (header));
+	g_string_append_len (data, builder->entries->data,
+			     builder->entries->len * sizeof (PkAlpmFilesEntry));
+	g_string_append_len (data, builder->strings->str, builder->strings->len);
+
+	/* written to a temporary file and renamed into place */
+	return g_file_set_contents (filename, data->str, data->len, error);
+}
+
+static const PkAlpmFilesHeader *
+pk_alpm_files_validate (GMappedFile *mapped)
+{
+	const PkAlpmFilesHeader *header;
+	const PkAlpmFilesEntry *entries;
+	gsize length = g_mapped_file_get_length (mapped);
+	guint32 i;
+
+	if (length < sizeof (PkAlpmFilesHeader))
+		return NULL;
+	header = (const PkAlpmFilesHeader *) g_mapped_file_get_contents (mapped);
+	if (memcmp (header->magic, PK_ALPM_FILES_MAGIC, sizeof (header->magic)) != 0)
+		return NULL;
+	if (header->version != PK_ALPM_FILES_VERSION)
+		return NULL;
+	if (length != sizeof (PkAlpmFilesHeader) +
+		      (gsize) header->n_entries * sizeof (PkAlpmFilesEntry) +
+		      header->strings_size)
+		return NULL;
+	if (header->strings_size == 0 ||
+	    ((const gchar *) header)[length - 1] != '\0')
+		return NULL;
+
+	/* make sure no entry points outside of the string pool */
+	entries = (const PkAlpmFilesEntry *) (header + 1);
+	for (i = 0; i < header->n_entries; i++) {
+		if (entries[i].basename >= header->strings_size ||
+		    entries[i].path >= header->strings_size ||
+		    entries[i].package >= header->strings_size)
+			return NULL;
+	}
+	return header;
+}
+
+GMappedFile *
+pk_alpm_files_index_open (const gchar *filename, GError **error)
+{
+	GMappedFile *mapped;
+
+	mapped = g_mapped_file_new (filename, FALSE, error);
+	if (mapped == NULL)
+		return NULL;
+	if (pk_alpm_files_validate (mapped) == NULL) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+			     "invalid files index %s", filename);
+		g_mapped_file_unref (mapped);
+		return NULL;
+	}
+	return mapped;
+}
+
+gint64
+pk_alpm_files_index_get_local_mtime (GMappedFile *index)
+{
+	const PkAlpmFilesHeader *header;
+
+	header = (const PkAlpmFilesHeader *) g_mapped_file_get_contents (index);
+	return header->local_mtime;
+}
+
+/* returns a set of "repo/pkgname" strings that are only valid for as long
+ * as the caller holds a reference on @index */
+GHashTable *
+pk_alpm_files_index_lookup (GMappedFile *index, const gchar *needle)
+{
+	const PkAlpmFilesHeader *header;
+	const PkAlpmFilesEntry *entries;
+	const gchar *strings;
+	const gchar *path = NULL;
+	const gchar *name = needle;
+	GHashTable *result;
+	guint32 lo, hi;
+
+	g_return_val_if_fail (index != NULL, NULL);
+	g_return_val_if_fail (needle != NULL, NULL);
+
+	header = (const PkAlpmFilesHeader *) g_mapped_file_get_contents (index);
+	entries = (const PkAlpmFilesEntry *) (header + 1);
+	strings = (const gchar *) (entries + header->n_entries);
+
+	/* full paths are matched on their basename first */
+	if (G_IS_DIR_SEPARATOR (*needle)) {
+		path = needle + 1;
+		name = strrchr (path, G_DIR_SEPARATOR);
+		name = (name != NULL) ? name + 1 : path;
+	}
+
+	/* find the first entry with this basename */
+	lo = 0;
+	hi = header->n_entries;
+	while (lo < hi) {
+		guint32 mid = lo + (hi - lo) / 2;
+		if (strcmp (strings + entries[mid].basename, name) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	result = g_hash_table_new (g_str_hash, g_str_equal);
+	for (; lo < header->n_entries; lo++) {
+		const PkAlpmFilesEntry *entry = &entries[lo];
+		if (strcmp (strings + entry->basename, name) != 0)
+			break;
+		if (path != NULL && strcmp (strings + entry->path, path) != 0)
+			continue;
+		g_hash_table_add (result, (gpointer) (strings + entry->package));
+	}
+	return result;
+}
@@ -0,0 +1,50 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <glib.h>
+
+typedef struct _PkAlpmFilesBuilder PkAlpmFilesBuilder;
+
+PkAlpmFilesBuilder *pk_alpm_files_builder_new		(void);
+
+void		 pk_alpm_files_builder_free		(PkAlpmFilesBuilder *builder);
+
+guint32		 pk_alpm_files_builder_add_package	(PkAlpmFilesBuilder *builder,
+							 const gchar *package);
+
+void		 pk_alpm_files_builder_add_file		(PkAlpmFilesBuilder *builder,
+							 guint32 package,
+							 const gchar *file);
+
+guint		 pk_alpm_files_builder_get_size		(PkAlpmFilesBuilder *builder);
+
+gboolean	 pk_alpm_files_builder_write		(PkAlpmFilesBuilder *builder,
+							 const gchar *filename,
+							 gint64 local_mtime,
+							 GError **error);
+
+GMappedFile	*pk_alpm_files_index_open		(const gchar *filename,
+							 GError **error);
+
+gint64		 pk_alpm_files_index_get_local_mtime	(GMappedFile *index);
+
+GHashTable	*pk_alpm_files_index_lookup		(GMappedFile *index,
+							 const gchar *needle);
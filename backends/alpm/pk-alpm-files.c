@@ -0,0 +1,257 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * The files index is built from the local database and the sync .files
+ * databases when the cache is refreshed, see pk-alpm-files-index.c for the
+ * format. SearchFiles threads hold a reference on the mapping they use, so
+ * a refresh can replace it under them.
+ */
+
+#include <glib/gstdio.h>
+
+#include "pk-backend-alpm.h"
+#include "pk-alpm-config.h"
+#include "pk-alpm-error.h"
+#include "pk-alpm-files.h"
+#include "pk-alpm-files-index.h"
+
+static gchar *
+pk_alpm_files_get_filename (PkBackend *backend)
+{
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
+	return g_build_filename (alpm_option_get_root (priv->alpm),
+				 "var", "lib", "PackageKit", "alpm",
+				 "files.idx", NULL);
+}
+
+static gint64
+pk_alpm_files_get_local_mtime (PkBackend *backend)
+{
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
+	GStatBuf buf;
+	g_autofree gchar *path = NULL;
+
+	/* any install or removal adds or removes a directory in here */
+	path = g_build_filename (alpm_option_get_dbpath (priv->alpm), "local", NULL);
+	if (g_stat (path, &buf) < 0)
+		return -1;
+	return (gint64) buf.st_mtime;
+}
+
+static void
+pk_alpm_files_builder_add_db (PkAlpmFilesBuilder *builder, alpm_db_t *db,
+			      const gchar *db_name)
+{
+	const alpm_list_t *i;
+
+	for (i = alpm_db_get_pkgcache (db); i != NULL; i = i->next) {
+		alpm_pkg_t *pkg = i->data;
+		alpm_filelist_t *files = alpm_pkg_get_files (pkg);
+		g_autofree gchar *key = NULL;
+		guint32 package;
+		gsize j;
+
+		if (files == NULL || files->count == 0)
+			continue;
+
+		key = g_strdup_printf ("%s/%s", db_name, alpm_pkg_get_name (pkg));
+		package = pk_alpm_files_builder_add_package (builder, key);
+		for (j = 0; j < files->count; ++j)
+			pk_alpm_files_builder_add_file (builder, package,
+							files->files[j].name);
+	}
+}
+
+static void
+pk_alpm_files_load (PkBackend *backend)
+{
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
+	g_autofree gchar *filename = pk_alpm_files_get_filename (backend);
+	g_autoptr(GError) error = NULL;
+	GMappedFile *mapped;
+
+	mapped = pk_alpm_files_index_open (filename, &error);
+	if (mapped == NULL) {
+		if (g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_INVAL))
+			g_warning ("ignoring %s", error->message);
+		else
+			g_debug ("no files index: %s", error->message);
+	}
+
+	/* running searches keep their reference on the old one */
+	g_mutex_lock (&priv->files_mutex);
+	g_clear_pointer (&priv->files_index, g_mapped_file_unref);
+	priv->files_index = mapped;
+	g_mutex_unlock (&priv->files_mutex);
+}
+
+gboolean
+pk_alpm_files_initialize (PkBackend *backend)
+{
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
+	g_mutex_init (&priv->files_mutex);
+	pk_alpm_files_load (backend);
+	return priv->files_index != NULL;
+}
+
+void
+pk_alpm_files_destroy (PkBackend *backend)
+{
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
+	g_clear_pointer (&priv->files_index, g_mapped_file_unref);
+	g_mutex_clear (&priv->files_mutex);
+}
+
+/* returns the current files index, or NULL if there is none */
+GMappedFile *
+pk_alpm_files_ref_index (PkBackend *backend)
+{
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
+	GMappedFile *mapped = NULL;
+
+	g_mutex_lock (&priv->files_mutex);
+	if (priv->files_index != NULL)
+		mapped = g_mapped_file_ref (priv->files_index);
+	g_mutex_unlock (&priv->files_mutex);
+	return mapped;
+}
+
+typedef struct {
+	gchar		*name;
+	alpm_list_t	*servers;
+	int		 level;
+} PkAlpmFilesRepo;
+
+static gboolean
+pk_alpm_files_use_files_dbs (alpm_handle_t *handle, GError **error)
+{
+	const alpm_list_t *i;
+	alpm_list_t *repos = NULL, *j;
+	gboolean ret = TRUE;
+
+	/* the database path is resolved on registration, so the repos
+	 * have to be registered again after switching the extension */
+	for (i = alpm_get_syncdbs (handle); i != NULL; i = i->next) {
+		PkAlpmFilesRepo *repo = g_new0 (PkAlpmFilesRepo, 1);
+		repo->name = g_strdup (alpm_db_get_name (i->data));
+		repo->servers = alpm_list_strdup (alpm_db_get_servers (i->data));
+		repo->level = alpm_db_get_siglevel (i->data);
+		repos = alpm_list_add (repos, repo);
+	}
+
+	if (alpm_unregister_all_syncdbs (handle) < 0 ||
+	    alpm_option_set_dbext (handle, ".files") < 0) {
+		alpm_errno_t alpm_err = alpm_errno (handle);
+		g_set_error_literal (error, PK_ALPM_ERROR, alpm_err,
+				     alpm_strerror (alpm_err));
+		ret = FALSE;
+	}
+
+	for (j = repos; j != NULL; j = j->next) {
+		PkAlpmFilesRepo *repo = j->data;
+
+		if (ret) {
+			alpm_db_t *db = alpm_register_syncdb (handle, repo->name,
+							      repo->level);
+			if (db == NULL) {
+				alpm_errno_t alpm_err = alpm_errno (handle);
+				g_set_error (error, PK_ALPM_ERROR, alpm_err, "[%s]: %s",
+					     repo->name, alpm_strerror (alpm_err));
+				ret = FALSE;
+			} else {
+				/* alpm takes ownership */
+				alpm_db_set_servers (db, repo->servers);
+				repo->servers = NULL;
+			}
+		}
+		FREELIST (repo->servers);
+		g_free (repo->name);
+		g_free (repo);
+	}
+	alpm_list_free (repos);
+	return ret;
+}
+
+gboolean
+pk_alpm_files_refresh (PkBackendJob *job, gint force, GError **error)
+{
+	PkBackend *backend = pk_backend_job_get_backend (job);
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
+	PkAlpmFilesBuilder *builder;
+	alpm_handle_t *handle;
+	alpm_list_t *syncdbs;
+	const alpm_list_t *i;
+	gint64 local_mtime;
+	gboolean ret = FALSE;
+	g_autofree gchar *filename = NULL;
+
+	/* the .files databases live next to the ones used for GetUpdates */
+	handle = pk_alpm_configure (backend, PK_BACKEND_CONFIG_FILE, TRUE, error);
+	if (handle == NULL)
+		return FALSE;
+	if (!pk_alpm_files_use_files_dbs (handle, error))
+		goto out;
+
+	syncdbs = alpm_get_syncdbs (handle);
+	if (syncdbs != NULL && alpm_db_update (handle, syncdbs, force) < 0) {
+		alpm_errno_t alpm_err = alpm_errno (handle);
+		g_set_error (error, PK_ALPM_ERROR, alpm_err,
+			     "failed to update files database: %s",
+			     alpm_strerror (alpm_err));
+		goto out;
+	}
+
+	builder = pk_alpm_files_builder_new ();
+	local_mtime = pk_alpm_files_get_local_mtime (backend);
+	pk_alpm_files_builder_add_db (builder, priv->localdb, "local");
+	for (i = syncdbs; i != NULL; i = i->next) {
+		if (pk_backend_job_is_cancelled (job))
+			break;
+		pk_alpm_files_builder_add_db (builder, i->data,
+					      alpm_db_get_name (i->data));
+	}
+
+	filename = pk_alpm_files_get_filename (backend);
+	if (i == NULL) {
+		g_debug ("writing %u files to %s",
+			 pk_alpm_files_builder_get_size (builder), filename);
+		ret = pk_alpm_files_builder_write (builder, filename,
+						   local_mtime, error);
+	} else {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+				     "files index update was cancelled");
+	}
+	pk_alpm_files_builder_free (builder);
+
+	if (ret)
+		pk_alpm_files_load (backend);
+out:
+	alpm_release (handle);
+	return ret;
+}
+
+gboolean
+pk_alpm_files_is_local_current (PkBackend *backend, GMappedFile *index)
+{
+	return pk_alpm_files_index_get_local_mtime (index) ==
+	       pk_alpm_files_get_local_mtime (backend);
+}
@@ -0,0 +1,36 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <alpm.h>
+#include <pk-backend.h>
+
+gboolean	 pk_alpm_files_initialize	(PkBackend *backend);
+
+void		 pk_alpm_files_destroy		(PkBackend *backend);
+
+gboolean	 pk_alpm_files_refresh		(PkBackendJob *job,
+						 gint force,
+						 GError **error);
+
+GMappedFile	*pk_alpm_files_ref_index	(PkBackend *backend);
+
+gboolean	 pk_alpm_files_is_local_current	(PkBackend *backend,
+						 GMappedFile *index);
@@ -26,6 +26,8 @@
 #include <string.h>
 
 #include "pk-backend-alpm.h"
+#include "pk-alpm-files.h"
+#include "pk-alpm-files-index.h"
 #include "pk-alpm-groups.h"
 #include "pk-alpm-packages.h"
 
@@ -122,29 +124,24 @@ pk_backend_match_file (alpm_pkg_t *pkg, const gchar *needle)
 
 	files = alpm_pkg_get_files (pkg);
 
+	/* match the full path of file, the list is sorted */
+	if (G_IS_DIR_SEPARATOR (*needle))
+		return alpm_filelist_contains (files, needle + 1) != NULL;
+
 	/* match any file the package contains */
-	if (G_IS_DIR_SEPARATOR (*needle)) {
-		for (i = 0; i < files->count; ++i) {
-			const gchar *file = files->files[i].name;
-			/* match the full path of file */
-			if (g_strcmp0 (file, needle + 1) == 0)
-				return TRUE;
+	for (i = 0; i < files->count; ++i) {
+		const gchar *file = files->files[i].name;
+		const gchar *name = strrchr (file, G_DIR_SEPARATOR);
+
+		if (name == NULL) {
+			name = file;
+		} else {
+			++name;
 		}
-	} else {
-		for (i = 0; i < files->count; ++i) {
-			const gchar *file = files->files[i].name;
-			const gchar *name = strrchr (file, G_DIR_SEPARATOR);
-
-			if (name == NULL) {
-				name = file;
-			} else {
-				++name;
-			}
 
-			/* match the basename of file */
-			if (g_strcmp0 (name, needle) == 0)
-				return TRUE;
-		}
+		/* match the basename of file */
+		if (g_strcmp0 (name, needle) == 0)
+			return TRUE;
 	}
 
 	return FALSE;
@@ -283,11 +280,41 @@ pk_alpm_search_is_application (alpm_pkg_t *pkg) {
 }
 
 static void
-pk_backend_search_db (PkBackendJob *job, alpm_db_t *db, MatchFunc match,
-		      const alpm_list_t *patterns, PkBitfield filters)
+pk_backend_search_emit (PkBackendJob *job, alpm_db_t *db, alpm_pkg_t *pkg,
+			PkBitfield filters)
 {
 	PkBackend *backend = pk_backend_job_get_backend (job);
 	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
+
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_APPLICATION) ||
+	    pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_APPLICATION)) {
+		gboolean is_application;
+
+		/* the daemon only knows the desktop files of installed packages */
+		if (db != priv->localdb ||
+		    !pk_backend_lookup_application (backend, alpm_pkg_get_name (pkg), &is_application))
+			is_application = pk_alpm_search_is_application (pkg);
+
+		/* want applications */
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_APPLICATION) && !is_application)
+			return;
+
+		/* don't want applications */
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_APPLICATION) && is_application)
+			return;
+	}
+
+	if (db == priv->localdb) {
+		pk_alpm_pkg_emit (job, pkg, PK_INFO_ENUM_INSTALLED);
+	} else if (!pk_alpm_pkg_is_local (job, pkg)) {
+		pk_alpm_pkg_emit (job, pkg, PK_INFO_ENUM_AVAILABLE);
+	}
+}
+
+static void
+pk_backend_search_db (PkBackendJob *job, alpm_db_t *db, MatchFunc match,
+		      const alpm_list_t *patterns, PkBitfield filters)
+{
 	const alpm_list_t *i, *j;
 
 	g_return_if_fail (db != NULL);
@@ -307,20 +334,96 @@ pk_backend_search_db (PkBackendJob *job, alpm_db_t *db, MatchFunc match,
 		if (j != NULL)
 			continue;
 
-		/* want applications */
-		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_APPLICATION) && !pk_alpm_search_is_application (i->data))
+		pk_backend_search_emit (job, db, i->data, filters);
+	}
+}
+
+static void
+pk_backend_search_index_db (PkBackendJob *job, alpm_db_t *db, const gchar *db_name,
+			    GHashTable *matches, PkBitfield filters)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gsize len = strlen (db_name);
+
+	g_return_if_fail (db != NULL);
+
+	g_hash_table_iter_init (&iter, matches);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		const gchar *id = key;
+		alpm_pkg_t *pkg;
+
+		if (pk_backend_job_is_cancelled (job))
+			break;
+
+		/* keys are "repo/pkgname" */
+		if (strncmp (id, db_name, len) != 0 || id[len] != '/')
 			continue;
 
-		/* don't want applications */
-		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_APPLICATION) && pk_alpm_search_is_application (i->data))
+		pkg = alpm_db_get_pkg (db, id + len + 1);
+		if (pkg != NULL)
+			pk_backend_search_emit (job, db, pkg, filters);
+	}
+}
+
+static gboolean
+pk_backend_search_files_index (PkBackendJob *job, const alpm_list_t *patterns,
+			       PkBitfield filters, gboolean skip_local,
+			       gboolean skip_remote)
+{
+	PkBackend *backend = pk_backend_job_get_backend (job);
+	PkBackendAlpmPrivate *priv = pk_backend_get_user_data (backend);
+	g_autoptr(GMappedFile) index = NULL;
+	g_autoptr(GHashTable) matches = NULL;
+	const alpm_list_t *i;
+
+	/* the matches point into the index, so keep it mapped */
+	index = pk_alpm_files_ref_index (backend);
+	if (index == NULL)
+		return FALSE;
+
+	/* packages that contain a file for every search term */
+	for (i = patterns; i != NULL; i = i->next) {
+		g_autoptr(GHashTable) found = pk_alpm_files_index_lookup (index, i->data);
+		GHashTableIter iter;
+		gpointer key;
+
+		if (matches == NULL) {
+			matches = g_steal_pointer (&found);
 			continue;
+		}
+		g_hash_table_iter_init (&iter, matches);
+		while (g_hash_table_iter_next (&iter, &key, NULL)) {
+			if (!g_hash_table_contains (found, key))
+				g_hash_table_iter_remove (&iter);
+		}
+	}
+	if (matches == NULL)
+		return TRUE;
 
-		if (db == priv->localdb) {
-			pk_alpm_pkg_emit (job, i->data, PK_INFO_ENUM_INSTALLED);
-		} else if (!pk_alpm_pkg_is_local (job, i->data)) {
-			pk_alpm_pkg_emit (job, i->data, PK_INFO_ENUM_AVAILABLE);
+	/* the local part is only as fresh as the last refresh */
+	if (!skip_local) {
+		if (pk_alpm_files_is_local_current (backend, index)) {
+			pk_backend_search_index_db (job, priv->localdb, "local",
+						    matches, filters);
+		} else {
+			pk_backend_search_db (job, priv->localdb,
+					      (MatchFunc) pk_backend_match_file,
+					      patterns, filters);
 		}
 	}
+
+	if (skip_remote)
+		return TRUE;
+
+	for (i = alpm_get_syncdbs (priv->alpm_check ? priv->alpm_check : priv->alpm); i != NULL; i = i->next) {
+		if (pk_backend_job_is_cancelled (job))
+			break;
+
+		pk_backend_search_index_db (job, i->data, alpm_db_get_name (i->data),
+					    matches, filters);
+	}
+	return TRUE;
 }
 
 static void
@@ -407,6 +510,12 @@ pk_backend_search_thread (PkBackendJob *job, GVariant* params, gpointer p)
 		}
 	}
 
+	/* use the files index when the last refresh created one */
+	if (type == SEARCH_TYPE_FILES &&
+	    pk_backend_search_files_index (job, patterns, filters,
+					   skip_local, skip_remote))
+		goto out;
+
 	/* find installed packages first */
 	if (!skip_local)
 		pk_backend_search_db (job, priv->localdb, match_func, patterns, filters);
@@ -35,6 +35,7 @@
 #include "pk-backend-alpm.h"
 #include "pk-alpm-config.h"
 #include "pk-alpm-error.h"
+#include "pk-alpm-files.h"
 #include "pk-alpm-packages.h"
 #include "pk-alpm-transaction.h"
 #include "pk-alpm-update.h"
@@ -513,7 +514,13 @@ pk_backend_refresh_cache_thread (PkBackendJob *job, GVariant* params, gpointer p
 	/* download databases even if they are older than current */
 	g_variant_get (params, "(b)", &force);
 
-	pk_alpm_update_databases (job, force, &error);
+	if (pk_alpm_update_databases (job, force, &error)) {
+		g_autoptr(GError) error_local = NULL;
+
+		/* a stale files index is not worth failing the refresh for */
+		if (!pk_alpm_files_refresh (job, force, &error_local))
+			g_warning ("failed to update files index: %s", error_local->message);
+	}
 	pk_alpm_finish (job, error);
 }
 
@@ -32,6 +32,7 @@
 #include "pk-alpm-config.h"
 #include "pk-alpm-databases.h"
 #include "pk-alpm-error.h"
+#include "pk-alpm-files.h"
 #include "pk-alpm-groups.h"
 #include "pk-alpm-transaction.h"
 #include "pk-alpm-environment.h"
@@ -155,6 +156,9 @@ pk_backend_initialize (GKeyFile *conf, PkBackend *backend)
 	if (!pk_alpm_initialize_monitor (backend, &error))
 		g_error ("Failed to initialize monitor: %s", error->message);
 
+	/* not fatal, SearchFiles falls back to scanning the local db */
+	pk_alpm_files_initialize (backend);
+
 	priv->localdb_changed = FALSE;
 }
 
@@ -165,6 +169,7 @@ pk_backend_destroy (PkBackend *backend)
 	pk_alpm_groups_destroy (backend);
 	pk_alpm_destroy_databases (backend);
 	pk_alpm_destroy_monitor (backend);
+	pk_alpm_files_destroy (backend);
 
 	if (priv->alpm != NULL) {
 		if (alpm_trans_get_flags (priv->alpm) < 0)
@@ -33,6 +33,8 @@ typedef struct {
 	alpm_handle_t	*alpm_check;
 	GFileMonitor    *monitor;
 	alpm_list_t     *configured_repos; /* list of configured repos */
+	GMappedFile	*files_index;	/* basename index, see pk-alpm-files.c */
+	GMutex		 files_mutex;
 	gboolean	localdb_changed;
 } PkBackendAlpmPrivate;
 
@@ -0,0 +1,175 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <glib/gstdio.h>
+
+#include "pk-alpm-files-index.h"
+
+static gchar *
+pk_alpm_test_write_index (const gchar *tmp_dir, gint64 local_mtime)
+{
+	PkAlpmFilesBuilder *builder = pk_alpm_files_builder_new ();
+	gchar *filename = g_build_filename (tmp_dir, "files.idx", NULL);
+	g_autoptr(GError) error = NULL;
+	guint32 package;
+
+	package = pk_alpm_files_builder_add_package (builder, "local/bash");
+	pk_alpm_files_builder_add_file (builder, package, "usr/");
+	pk_alpm_files_builder_add_file (builder, package, "usr/bin/");
+	pk_alpm_files_builder_add_file (builder, package, "usr/bin/bash");
+	pk_alpm_files_builder_add_file (builder, package, "usr/share/man/man1/bash.1.gz");
+	package = pk_alpm_files_builder_add_package (builder, "core/coreutils");
+	pk_alpm_files_builder_add_file (builder, package, "usr/bin/ls");
+	pk_alpm_files_builder_add_file (builder, package, "usr/bin/cat");
+	package = pk_alpm_files_builder_add_package (builder, "extra/busybox");
+	pk_alpm_files_builder_add_file (builder, package, "usr/lib/busybox/bin/ls");
+	g_assert_cmpuint (pk_alpm_files_builder_get_size (builder), ==, 5);
+
+	g_assert_true (pk_alpm_files_builder_write (builder, filename, local_mtime, &error));
+	g_assert_no_error (error);
+	pk_alpm_files_builder_free (builder);
+	return filename;
+}
+
+static void
+pk_alpm_test_files_index_lookup_func (void)
+{
+	g_autofree gchar *tmp_dir = g_dir_make_tmp ("pk-alpm-test-XXXXXX", NULL);
+	g_autofree gchar *filename = pk_alpm_test_write_index (tmp_dir, 1234);
+	g_autoptr(GMappedFile) index = NULL;
+	g_autoptr(GError) error = NULL;
+	GHashTable *found;
+
+	index = pk_alpm_files_index_open (filename, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (index);
+	g_assert_cmpint (pk_alpm_files_index_get_local_mtime (index), ==, 1234);
+
+	/* a basename matches in every package */
+	found = pk_alpm_files_index_lookup (index, "ls");
+	g_assert_cmpuint (g_hash_table_size (found), ==, 2);
+	g_assert_true (g_hash_table_contains (found, "core/coreutils"));
+	g_assert_true (g_hash_table_contains (found, "extra/busybox"));
+	g_hash_table_unref (found);
+
+	/* a full path only matches the one file */
+	found = pk_alpm_files_index_lookup (index, "/usr/bin/ls");
+	g_assert_cmpuint (g_hash_table_size (found), ==, 1);
+	g_assert_true (g_hash_table_contains (found, "core/coreutils"));
+	g_hash_table_unref (found);
+	found = pk_alpm_files_index_lookup (index, "/bin/bash");
+	g_assert_cmpuint (g_hash_table_size (found), ==, 0);
+	g_hash_table_unref (found);
+
+	/* neighbours in the sort order don't match */
+	found = pk_alpm_files_index_lookup (index, "bas");
+	g_assert_cmpuint (g_hash_table_size (found), ==, 0);
+	g_hash_table_unref (found);
+	found = pk_alpm_files_index_lookup (index, "bash");
+	g_assert_cmpuint (g_hash_table_size (found), ==, 1);
+	g_assert_true (g_hash_table_contains (found, "local/bash"));
+	g_hash_table_unref (found);
+	found = pk_alpm_files_index_lookup (index, "zsh");
+	g_assert_cmpuint (g_hash_table_size (found), ==, 0);
+	g_hash_table_unref (found);
+
+	/* directories are not indexed */
+	found = pk_alpm_files_index_lookup (index, "bin");
+	g_assert_cmpuint (g_hash_table_size (found), ==, 0);
+	g_hash_table_unref (found);
+
+	g_unlink (filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+pk_alpm_test_files_index_replace_func (void)
+{
+	g_autofree gchar *tmp_dir = g_dir_make_tmp ("pk-alpm-test-XXXXXX", NULL);
+	g_autofree gchar *filename = pk_alpm_test_write_index (tmp_dir, 1);
+	g_autofree gchar *filename2 = NULL;
+	g_autoptr(GMappedFile) index = NULL;
+	g_autoptr(GMappedFile) index2 = NULL;
+	g_autoptr(GHashTable) found = NULL;
+
+	/* a search keeps using the mapping it started with */
+	index = pk_alpm_files_index_open (filename, NULL);
+	g_assert_nonnull (index);
+	found = pk_alpm_files_index_lookup (index, "cat");
+	filename2 = pk_alpm_test_write_index (tmp_dir, 2);
+	g_assert_cmpstr (filename, ==, filename2);
+	index2 = pk_alpm_files_index_open (filename2, NULL);
+	g_assert_nonnull (index2);
+	g_assert_cmpint (pk_alpm_files_index_get_local_mtime (index), ==, 1);
+	g_assert_cmpint (pk_alpm_files_index_get_local_mtime (index2), ==, 2);
+	g_assert_cmpuint (g_hash_table_size (found), ==, 1);
+	g_assert_true (g_hash_table_contains (found, "core/coreutils"));
+
+	g_unlink (filename);
+	g_rmdir (tmp_dir);
+}
+
+static void
+pk_alpm_test_files_index_invalid_func (void)
+{
+	g_autofree gchar *tmp_dir = g_dir_make_tmp ("pk-alpm-test-XXXXXX", NULL);
+	g_autofree gchar *filename = pk_alpm_test_write_index (tmp_dir, 1);
+	g_autofree gchar *contents = NULL;
+	g_autoptr(GMappedFile) index = NULL;
+	g_autoptr(GError) error = NULL;
+	gsize length;
+
+	/* truncated */
+	g_assert_true (g_file_get_contents (filename, &contents, &length, NULL));
+	g_assert_true (g_file_set_contents (filename, contents, length - 1, NULL));
+	index = pk_alpm_files_index_open (filename, &error);
+	g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL);
+	g_assert_null (index);
+	g_clear_error (&error);
+
+	/* wrong magic */
+	contents[0] = 'X';
+	g_assert_true (g_file_set_contents (filename, contents, length, NULL));
+	index = pk_alpm_files_index_open (filename, &error);
+	g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL);
+	g_assert_null (index);
+	g_clear_error (&error);
+
+	/* missing */
+	g_unlink (filename);
+	index = pk_alpm_files_index_open (filename, &error);
+	g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+	g_assert_null (index);
+
+	g_rmdir (tmp_dir);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/alpm/files-index/lookup", pk_alpm_test_files_index_lookup_func);
+	g_test_add_func ("/alpm/files-index/replace", pk_alpm_test_files_index_replace_func);
+	g_test_add_func ("/alpm/files-index/invalid", pk_alpm_test_files_index_invalid_func);
+
+	return g_test_run ();
+}
@@ -0,0 +1,208 @@
+/* apt-appstream.cpp
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include "apt-appstream.h"
+
+#include <apt-pkg/configuration.h>
+#include <sys/stat.h>
+#include <fnmatch.h>
+#include <mutex>
+
+using namespace std;
+
+static std::mutex s_poolLock;
+static std::shared_ptr<AptAppStream> s_pool;
+
+// where AppStream reads catalog data from, the apt lists hold the DEP-11
+// files the /var/lib ones link to
+static const char *s_systemCatalogDirs[] = {
+    "/usr/share/swcatalog",
+    "/usr/share/app-info",
+    "/var/lib/swcatalog",
+    "/var/lib/app-info",
+    "/var/cache/swcatalog",
+    "/var/cache/app-info",
+};
+
+// replaces the system locations if not empty
+static vector<string> s_catalogDirs;
+
+// the bucket a modalias glob or query goes into, "*" if the bus is a glob
+static string modaliasBus(const string &modalias)
+{
+    size_t colon = modalias.find(':');
+    if (colon == string::npos)
+        return "*";
+    string bus = modalias.substr(0, colon);
+    if (bus.find_first_of("*?[") != string::npos)
+        return "*";
+    return bus;
+}
+
+static void appendMtime(string &signature, const string &path)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        signature += "-;";
+        return;
+    }
+    signature += to_string(st.st_mtim.tv_sec) + "." + to_string(st.st_mtim.tv_nsec) + ";";
+}
+
+string AptAppStream::catalogSignature()
+{
+    string signature;
+    if (!s_catalogDirs.empty()) {
+        for (const string &dir : s_catalogDirs) {
+            appendMtime(signature, dir);
+            appendMtime(signature, dir + "/xml");
+            appendMtime(signature, dir + "/yaml");
+        }
+        return signature;
+    }
+    for (const char *dir : s_systemCatalogDirs) {
+        appendMtime(signature, dir);
+        appendMtime(signature, string(dir) + "/xml");
+        appendMtime(signature, string(dir) + "/yaml");
+    }
+    appendMtime(signature, _config->FindDir("Dir::State::lists"));
+    return signature;
+}
+
+void AptAppStream::setCatalogDirs(const vector<string> &dirs)
+{
+    lock_guard<mutex> lock(s_poolLock);
+    s_catalogDirs = dirs;
+    s_pool.reset();
+}
+
+shared_ptr<AptAppStream> AptAppStream::get()
+{
+    const string signature = catalogSignature();
+
+    lock_guard<mutex> lock(s_poolLock);
+    if (!s_pool || s_pool->m_signature != signature) {
+        auto appstream = make_shared<AptAppStream>();
+        appstream->load(signature);
+        s_pool = appstream;
+    }
+    return s_pool;
+}
+
+void AptAppStream::load(const string &signature)
+{
+    g_autoptr(AsPool) pool = as_pool_new();
+    g_autoptr(GError) error = NULL;
+
+    m_signature = signature;
+
+    /* don't monitor cache locations or load Flatpak data */
+    as_pool_remove_flags(pool, AS_POOL_FLAG_MONITOR);
+    as_pool_remove_flags(pool, AS_POOL_FLAG_LOAD_FLATPAK);
+
+    if (!s_catalogDirs.empty()) {
+        as_pool_set_load_std_data_locations(pool, FALSE);
+        for (const string &dir : s_catalogDirs) {
+#if AS_CHECK_VERSION(1,0,0)
+            as_pool_add_extra_data_location(pool, dir.c_str(), AS_FORMAT_STYLE_CATALOG);
+#else
+            as_pool_add_extra_data_location(pool, dir.c_str(), AS_FORMAT_STYLE_COLLECTION);
+#endif
+        }
+    }
+
+    if (!as_pool_load(pool, NULL, &error)) {
+        m_error = error->message;
+        return;
+    }
+
+#if AS_CHECK_VERSION(1,0,0)
+    g_autoptr(AsComponentBox) cpts = as_pool_get_components(pool);
+    for (guint i = 0; i < as_component_box_len(cpts); i++)
+        addComponent(as_component_box_index(cpts, i));
+#else
+    g_autoptr(GPtrArray) cpts = as_pool_get_components(pool);
+    for (guint i = 0; i < cpts->len; i++)
+        addComponent(AS_COMPONENT(g_ptr_array_index(cpts, i)));
+#endif
+
+    g_debug("indexed %zu mime types and %zu modaliases",
+            m_mimeTypes.size(), m_modaliases.size());
+}
+
+void AptAppStream::addComponent(AsComponent *cpt)
+{
+    const gchar *pkgname = as_component_get_pkgname(cpt);
+    if (pkgname == NULL) {
+        return;
+    }
+
+    AsProvided *prov = as_component_get_provided_for_kind(cpt, AS_PROVIDED_KIND_MEDIATYPE);
+    if (prov != NULL) {
+        GPtrArray *items = as_provided_get_items(prov);
+        for (guint j = 0; j < items->len; j++) {
+            m_mimeTypes.emplace((const gchar *) g_ptr_array_index(items, j), pkgname);
+        }
+    }
+
+    prov = as_component_get_provided_for_kind(cpt, AS_PROVIDED_KIND_MODALIAS);
+    if (prov != NULL) {
+        GPtrArray *items = as_provided_get_items(prov);
+        for (guint j = 0; j < items->len; j++) {
+            const string glob = (const gchar *) g_ptr_array_index(items, j);
+            m_modaliases.emplace(modaliasBus(glob), make_pair(glob, string(pkgname)));
+        }
+    }
+}
+
+vector<string> AptAppStream::mimeTypes(gchar **values) const
+{
+    vector<string> ret;
+    for (guint i = 0; values[i] != NULL; i++) {
+        auto range = m_mimeTypes.equal_range(values[i]);
+        for (auto it = range.first; it != range.second; ++it)
+            ret.push_back(it->second);
+    }
+    return ret;
+}
+
+vector<string> AptAppStream::modaliases(gchar **values) const
+{
+    vector<string> ret;
+    for (guint i = 0; values[i] != NULL; i++) {
+        string modalias = values[i];
+
+        // both "modalias(usb:v…)" and the plain modalias are accepted
+        if (g_str_has_prefix(values[i], "modalias(") && g_str_has_suffix(values[i], ")"))
+            modalias = modalias.substr(9, modalias.size() - 10);
+        if (modalias.find(':') == string::npos)
+            continue;
+
+        for (const string &bus : { modaliasBus(modalias), string("*") }) {
+            auto range = m_modaliases.equal_range(bus);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (fnmatch(it->second.first.c_str(), modalias.c_str(), 0) == 0)
+                    ret.push_back(it->second.second);
+            }
+            if (bus == "*")
+                break;
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,94 @@
+/* apt-appstream.h
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#ifndef APT_APPSTREAM_H
+#define APT_APPSTREAM_H
+
+#include <appstream.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * The mime type and modalias tables of the AppStream catalog, kept for
+ * the lifetime of the backend.
+ *
+ * Loading parses the whole catalog, so it is done on first use and
+ * again only after the catalog directories changed. The pool is dropped
+ * once the tables are built. Each load is an immutable snapshot: jobs
+ * keep the one they got for as long as they query it, while a reload
+ * replaces it for later callers.
+ */
+class AptAppStream
+{
+public:
+    /**
+     * Returns the current snapshot, loading the catalog if it is the
+     * first call or the catalog changed since the last load
+     */
+    static std::shared_ptr<AptAppStream> get();
+
+    /**
+     * Reads the catalog from @dirs instead of the system locations,
+     * for the tests
+     */
+    static void setCatalogDirs(const std::vector<std::string> &dirs);
+
+    AptAppStream() = default;
+
+    /**
+     * Loads the catalog and indexes all of its components
+     */
+    void load(const std::string &signature);
+
+    /**
+     * Indexes the mime types and modaliases the component provides
+     */
+    void addComponent(AsComponent *cpt);
+
+    /**
+     * The error loading the metadata, empty if it loaded
+     */
+    const std::string &error() const { return m_error; }
+
+    /**
+     * Package names of the components providing the mime types
+     */
+    std::vector<std::string> mimeTypes(gchar **values) const;
+
+    /**
+     * Package names of the components providing the modalias(...) values
+     */
+    std::vector<std::string> modaliases(gchar **values) const;
+
+private:
+    static std::string catalogSignature();
+
+    std::string m_signature;
+    std::string m_error;
+
+    std::unordered_multimap<std::string, std::string> m_mimeTypes;
+
+    // bus ("usb", "pci", …) to modalias globs and packages
+    std::unordered_multimap<std::string, std::pair<std::string, std::string>> m_modaliases;
+};
+
+#endif // APT_APPSTREAM_H
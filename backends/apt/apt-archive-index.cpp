@@ -0,0 +1,188 @@
+/* apt-archive-index.cpp
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include "apt-archive-index.h"
+
+#include <apt-pkg/configuration.h>
+#include <apt-pkg/strutl.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+using namespace std;
+
+AptArchiveIndex *AptArchiveIndex::instance()
+{
+    static AptArchiveIndex index;
+    return &index;
+}
+
+string AptArchiveIndex::stem(const pkgCache::VerIterator &ver)
+{
+    // Same as the file name pkgAcqArchive stores the package under
+    return QuoteString(ver.ParentPkg().Name(), "_:") + '_' +
+            QuoteString(ver.VerStr(), "_:") + '_' +
+            QuoteString(ver.Arch(), "_:.");
+}
+
+void AptArchiveIndex::watch()
+{
+    lock_guard<mutex> lock(m_lock);
+    if (m_monitor != nullptr)
+        return;
+
+    m_directory = _config->FindDir("Dir::Cache::archives");
+    m_loaded = false;
+
+    g_autoptr(GError) error = nullptr;
+    g_autoptr(GFile) file = g_file_new_for_path(m_directory.c_str());
+    m_monitor = g_file_monitor_directory(file, G_FILE_MONITOR_WATCH_MOVES, nullptr, &error);
+    if (m_monitor == nullptr) {
+        // we fall back to rescanning when the directory mtime changes
+        g_warning("failed to monitor %s: %s", m_directory.c_str(), error->message);
+        return;
+    }
+    g_signal_connect(m_monitor, "changed", G_CALLBACK(changedCb), this);
+}
+
+void AptArchiveIndex::changedCb(GFileMonitor *monitor,
+                                GFile *file,
+                                GFile *otherFile,
+                                GFileMonitorEvent eventType,
+                                gpointer userData)
+{
+    auto index = static_cast<AptArchiveIndex*>(userData);
+
+    // wait for the write to finish rather than restat on every chunk
+    if (eventType == G_FILE_MONITOR_EVENT_CHANGED ||
+            eventType == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED) {
+        return;
+    }
+
+    g_autofree gchar *baseName = g_file_get_basename(file);
+    index->update(baseName);
+    if (otherFile != nullptr) {
+        g_autofree gchar *otherBaseName = g_file_get_basename(otherFile);
+        index->update(otherBaseName);
+    }
+}
+
+void AptArchiveIndex::update(const string &baseName)
+{
+    if (!g_str_has_suffix(baseName.c_str(), ".deb"))
+        return;
+
+    lock_guard<mutex> lock(m_lock);
+    if (!m_loaded)
+        return;
+
+    const string key = baseName.substr(0, baseName.size() - 4);
+    struct stat st;
+    if (stat((m_directory + baseName).c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        m_archives[key] = Entry{ baseName, (unsigned long long) st.st_size };
+    } else {
+        m_archives.erase(key);
+    }
+}
+
+void AptArchiveIndex::scan()
+{
+    m_archives.clear();
+
+    DIR *dir = opendir(m_directory.c_str());
+    if (dir == nullptr) {
+        g_debug("failed to open %s", m_directory.c_str());
+        return;
+    }
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != nullptr) {
+        if (!g_str_has_suffix(ent->d_name, ".deb"))
+            continue;
+
+        struct stat st;
+        const string baseName = ent->d_name;
+        if (stat((m_directory + baseName).c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+
+        m_archives[baseName.substr(0, baseName.size() - 4)] =
+                Entry{ baseName, (unsigned long long) st.st_size };
+    }
+    closedir(dir);
+
+    g_debug("indexed %zu cached archives in %s", m_archives.size(), m_directory.c_str());
+}
+
+void AptArchiveIndex::ensureLoaded()
+{
+    const string directory = _config->FindDir("Dir::Cache::archives");
+    const bool moved = directory != m_directory;
+    if (moved) {
+        m_directory = directory;
+        m_loaded = false;
+    }
+
+    // without a monitor we can only notice changes from the directory mtime
+    if (m_monitor == nullptr || moved) {
+        struct stat st;
+        if (stat(m_directory.c_str(), &st) == 0 &&
+                (st.st_mtim.tv_sec != m_directoryMtime.tv_sec ||
+                 st.st_mtim.tv_nsec != m_directoryMtime.tv_nsec)) {
+            m_directoryMtime = st.st_mtim;
+            m_loaded = false;
+        }
+    }
+
+    if (!m_loaded) {
+        scan();
+        m_loaded = true;
+    }
+}
+
+bool AptArchiveIndex::contains(const pkgCache::VerIterator &ver)
+{
+    return !fileName(ver).empty();
+}
+
+string AptArchiveIndex::fileName(const pkgCache::VerIterator &ver)
+{
+    if (ver.end())
+        return string();
+
+    const string key = stem(ver);
+
+    lock_guard<mutex> lock(m_lock);
+    ensureLoaded();
+
+    auto it = m_archives.find(key);
+    if (it == m_archives.end())
+        return string();
+
+    // a partial or stale download is not something we can install from
+    if (ver->Size != 0 && it->second.size != ver->Size)
+        return string();
+
+    return m_directory + it->second.baseName;
+}
+
+unsigned long long AptArchiveIndex::downloadSize(const pkgCache::VerIterator &ver)
+{
+    if (ver.end() || contains(ver))
+        return 0;
+    return ver->Size;
+}
@@ -0,0 +1,92 @@
+/* apt-archive-index.h
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#ifndef APT_ARCHIVE_INDEX_H
+#define APT_ARCHIVE_INDEX_H
+
+#include <apt-pkg/pkgcache.h>
+#include <gio/gio.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * The .deb files in Dir::Cache::archives, keyed by the
+ * name_version_arch stem apt stores them under.
+ *
+ * The directory is scanned once and then kept up to date with a
+ * GFileMonitor, so asking if a version was already downloaded does not
+ * need an install plan or a fetcher.
+ */
+class AptArchiveIndex
+{
+public:
+    static AptArchiveIndex *instance();
+
+    /**
+     * Starts monitoring the archive directory, must be called from
+     * the thread running the main loop
+     */
+    void watch();
+
+    /**
+     * Returns true if the archive of the version is in the cache
+     * and has the size the package index expects
+     */
+    bool contains(const pkgCache::VerIterator &ver);
+
+    /**
+     * Returns the full path of the cached archive, or an empty string
+     */
+    std::string fileName(const pkgCache::VerIterator &ver);
+
+    /**
+     * Returns the number of bytes that still need to be fetched
+     * to install the version
+     */
+    unsigned long long downloadSize(const pkgCache::VerIterator &ver);
+
+private:
+    AptArchiveIndex() = default;
+
+    void ensureLoaded();
+    void scan();
+    void update(const std::string &baseName);
+    static std::string stem(const pkgCache::VerIterator &ver);
+    static void changedCb(GFileMonitor *monitor,
+                          GFile *file,
+                          GFile *otherFile,
+                          GFileMonitorEvent eventType,
+                          gpointer userData);
+
+    std::mutex m_lock;
+    std::string m_directory;
+    bool m_loaded = false;
+    struct timespec m_directoryMtime = {};
+    GFileMonitor *m_monitor = nullptr;
+
+    struct Entry {
+        std::string baseName;
+        unsigned long long size;
+    };
+    std::unordered_map<std::string, Entry> m_archives;
+};
+
+#endif // APT_ARCHIVE_INDEX_H
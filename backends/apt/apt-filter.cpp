@@ -0,0 +1,217 @@
+/* apt-filter.cpp
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include "apt-filter.h"
+
+#include <apt-pkg/configuration.h>
+#include <apt-pkg/fileutl.h>
+#include <string.h>
+#include <fstream>
+
+#include "apt-utils.h"
+
+using namespace std;
+
+static std::mutex s_tableLock;
+static std::shared_ptr<AptFilterTable> s_table;
+
+static uint8_t filterAttributes(const pkgCache::VerIterator &ver, const string &arch)
+{
+    uint8_t attributes = 0;
+
+    if (strcmp(ver.Arch(), "all") == 0 || arch.compare(ver.Arch()) == 0)
+        attributes |= AptFilterTable::NativeArch;
+
+    const char *str = ver.Section() == NULL ? "" : ver.Section();
+    const char *slash = strrchr(str, '/');
+    const char *section = slash == NULL ? str : slash + 1;
+    string component = slash == NULL ? "main" : string(str, slash - str);
+
+    string pkgName = ver.ParentPkg().Name();
+    if (ends_with(pkgName, "-dev") ||
+            ends_with(pkgName, "-dbg") ||
+            strcmp(section, "devel") == 0 ||
+            strcmp(section, "libdevel") == 0) {
+        attributes |= AptFilterTable::Development;
+    }
+
+    if (strcmp(section, "x11") == 0 || strcmp(section, "gnome") == 0 ||
+            strcmp(section, "kde") == 0 || strcmp(section, "graphics") == 0) {
+        attributes |= AptFilterTable::Gui;
+    }
+
+    // Must be in main and universe to be free
+    if (component == "main" || component == "universe")
+        attributes |= AptFilterTable::Free;
+
+    // Officially supported by the current distribution
+    pkgCache::VerFileIterator vf = ver.FileList();
+    const char *origin = vf.end() ? NULL : vf.File().Origin();
+    if (origin != NULL &&
+            (strcmp(origin, "Debian") == 0 || strcmp(origin, "Ubuntu") == 0) &&
+            (component == "main" || component == "restricted" ||
+             component == "unstable" || component == "testing")) {
+        attributes |= AptFilterTable::Supported;
+    }
+
+    return attributes;
+}
+
+AptFilterTable::AptFilterTable(pkgCache *cache, const string &generation) :
+    m_generation(generation)
+{
+    const string arch = _config->Find("APT::Architecture");
+    const size_t count = cache->Head().VersionCount;
+
+    m_attributes.assign(count, 0);
+    m_applications.assign(count, -1);
+
+    for (pkgCache::PkgIterator pkg = cache->PkgBegin(); !pkg.end(); ++pkg) {
+        for (pkgCache::VerIterator ver = pkg.VersionList(); !ver.end(); ++ver) {
+            if (ver->ID < count)
+                m_attributes[ver->ID] = filterAttributes(ver, arch);
+        }
+    }
+}
+
+shared_ptr<AptFilterTable> AptFilterTable::get(pkgCache *cache)
+{
+    const string generation = utilCacheGeneration(cache);
+
+    lock_guard<mutex> lock(s_tableLock);
+    if (!s_table || s_table->m_generation != generation) {
+        g_debug("building filter table for %u versions", cache->Head().VersionCount);
+        s_table = make_shared<AptFilterTable>(cache, generation);
+    }
+    return s_table;
+}
+
+bool AptFilterTable::isApplication(const pkgCache::VerIterator &ver)
+{
+    if (ver->ID >= m_applications.size())
+        return false;
+
+    {
+        lock_guard<mutex> lock(m_applicationsLock);
+        if (m_applications[ver->ID] >= 0)
+            return m_applications[ver->ID];
+    }
+
+    bool ret = false;
+    string fileName = string("/var/lib/dpkg/info/") +
+                      ver.ParentPkg().Name() + ":" + ver.Arch() + ".list";
+    if (!FileExists(fileName)) {
+        // if the file was not found try without the arch field
+        fileName = string("/var/lib/dpkg/info/") + ver.ParentPkg().Name() + ".list";
+    }
+
+    ifstream in(fileName);
+    string line;
+    while (in && getline(in, line)) {
+        if (ends_with(line, ".desktop")) {
+            ret = true;
+            break;
+        }
+    }
+
+    lock_guard<mutex> lock(m_applicationsLock);
+    m_applications[ver->ID] = ret;
+    return ret;
+}
+
+AptFilter::AptFilter(pkgCache *cache, PkBitfield filters, bool multiArch, PkBackend *backend) :
+    m_backend(backend),
+    m_mask(0),
+    m_value(0),
+    m_application(-1)
+{
+    if (filters == 0)
+        return;
+
+    m_table = AptFilterTable::get(cache);
+
+    // if we are on multiarch check also the arch filter
+    if (multiArch && pk_bitfield_contain(filters, PK_FILTER_ENUM_ARCH)) {
+        m_mask |= AptFilterTable::NativeArch;
+        m_value |= AptFilterTable::NativeArch;
+    }
+
+    if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_INSTALLED)) {
+        m_mask |= AptFilterTable::Installed;
+    } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_INSTALLED)) {
+        m_mask |= AptFilterTable::Installed;
+        m_value |= AptFilterTable::Installed;
+    }
+
+    const struct {
+        PkFilterEnum filter;
+        PkFilterEnum notFilter;
+        uint8_t attribute;
+    } pairs[] = {
+        { PK_FILTER_ENUM_DEVELOPMENT, PK_FILTER_ENUM_NOT_DEVELOPMENT, AptFilterTable::Development },
+        { PK_FILTER_ENUM_GUI, PK_FILTER_ENUM_NOT_GUI, AptFilterTable::Gui },
+        { PK_FILTER_ENUM_FREE, PK_FILTER_ENUM_NOT_FREE, AptFilterTable::Free },
+        { PK_FILTER_ENUM_SUPPORTED, PK_FILTER_ENUM_NOT_SUPPORTED, AptFilterTable::Supported },
+    };
+    for (const auto &pair : pairs) {
+        if (pk_bitfield_contain(filters, pair.filter)) {
+            m_mask |= pair.attribute;
+            m_value |= pair.attribute;
+        } else if (pk_bitfield_contain(filters, pair.notFilter)) {
+            m_mask |= pair.attribute;
+        }
+    }
+
+    // We do not support checking if it is an Application if NOT installed,
+    // so both filters only let installed packages through
+    if (pk_bitfield_contain(filters, PK_FILTER_ENUM_APPLICATION))
+        m_application = 1;
+    else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_APPLICATION))
+        m_application = 0;
+    if (m_application >= 0) {
+        m_mask |= AptFilterTable::Installed;
+        m_value |= AptFilterTable::Installed;
+    }
+}
+
+bool AptFilter::matches(const pkgCache::VerIterator &ver) const
+{
+    if (m_mask == 0 && m_application < 0)
+        return true;
+
+    uint8_t attributes = m_table->attributes(ver);
+    const pkgCache::PkgIterator &pkg = ver.ParentPkg();
+    if (pkg->CurrentState == pkgCache::State::Installed && pkg.CurrentVer() == ver)
+        attributes |= AptFilterTable::Installed;
+
+    if ((attributes & m_mask) != m_value)
+        return false;
+
+    // Check for applications last, without a desktop file database it
+    // needs to read the dpkg file list
+    if (m_application >= 0) {
+        gboolean application;
+        if (!pk_backend_lookup_application(m_backend, pkg.Name(), &application))
+            application = m_table->isApplication(ver);
+        if (bool(application) != (m_application == 1))
+            return false;
+    }
+
+    return true;
+}
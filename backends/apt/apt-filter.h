@@ -0,0 +1,102 @@
+/* apt-filter.h
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#ifndef APT_FILTER_H
+#define APT_FILTER_H
+
+#include <apt-pkg/pkgcache.h>
+#include <pk-backend.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * The attributes of every version in the package cache that the filters
+ * look at, indexed by pkgCache::Version::ID.
+ *
+ * They only depend on the cache contents, so the table is built once per
+ * cache generation and shared by all jobs until the cache changes.
+ */
+class AptFilterTable
+{
+public:
+    enum Attribute : uint8_t {
+        NativeArch  = 1 << 0,
+        Development = 1 << 1,
+        Gui         = 1 << 2,
+        Free        = 1 << 3,
+        Supported   = 1 << 4,
+        Installed   = 1 << 5, // not stored, depends on the opened cache
+    };
+
+    /**
+     * Returns the table for the given cache, building it if the cache
+     * changed since the last call
+     */
+    static std::shared_ptr<AptFilterTable> get(pkgCache *cache);
+
+    inline uint8_t attributes(const pkgCache::VerIterator &ver) const {
+        return ver->ID < m_attributes.size() ? m_attributes[ver->ID] : 0;
+    }
+
+    /**
+     * Returns if the installed version ships a .desktop file, which
+     * is read from the dpkg file list the first time it is asked
+     */
+    bool isApplication(const pkgCache::VerIterator &ver);
+
+    explicit AptFilterTable(pkgCache *cache, const std::string &generation);
+
+private:
+    std::string m_generation;
+    std::vector<uint8_t> m_attributes;
+
+    std::mutex m_applicationsLock;
+    std::vector<int8_t> m_applications; // -1 while unknown
+};
+
+/**
+ * A PkBitfield of filters compiled into a mask test on the attributes
+ * of AptFilterTable.
+ */
+class AptFilter
+{
+public:
+    /**
+     * The APPLICATION filters are answered by the desktop file database
+     * of @backend when the daemon has one
+     */
+    AptFilter(pkgCache *cache, PkBitfield filters, bool multiArch, PkBackend *backend);
+
+    /**
+     * Returns true if the version passes all the filters
+     */
+    bool matches(const pkgCache::VerIterator &ver) const;
+
+private:
+    std::shared_ptr<AptFilterTable> m_table;
+    PkBackend *m_backend;
+    uint8_t m_mask;
+    uint8_t m_value;
+    int m_application; // -1 when not filtered on
+};
+
+#endif // APT_FILTER_H
@@ -35,7 +35,6 @@
 #include <apt-pkg/pkgsystem.h>
 #include <apt-pkg/version.h>
 
-#include <appstream.h>
 
 #include <sys/prctl.h>
 #include <sys/statvfs.h>
@@ -51,8 +50,11 @@
 #include <dirent.h>
 
 #include "apt-cache-file.h"
+#include "apt-filter.h"
+#include "apt-appstream.h"
+#include "apt-archive-index.h"
+#include "apt-provides-index.h"
 #include "apt-utils.h"
-#include "gst-matcher.h"
 #include "apt-messages.h"
 #include "acqpkitstatus.h"
 #include "deb-file.h"
@@ -234,136 +236,6 @@ PkBackendJob *AptJob::pkJob() const
     return m_job;
 }
 
-bool AptJob::matchPackage(const pkgCache::VerIterator &ver, PkBitfield filters)
-{
-    if (filters != 0) {
-        const pkgCache::PkgIterator &pkg = ver.ParentPkg();
-        bool installed = false;
-
-        // Check if the package is installed
-        if (pkg->CurrentState == pkgCache::State::Installed && pkg.CurrentVer() == ver)
-            installed = true;
-
-        // if we are on multiarch check also the arch filter
-        if (m_isMultiArch && pk_bitfield_contain(filters, PK_FILTER_ENUM_ARCH)/* && !installed*/) {
-            // don't emit the package if it does not match
-            // the native architecture
-            if (strcmp(ver.Arch(), "all") != 0 &&
-                    strcmp(ver.Arch(), _config->Find("APT::Architecture").c_str()) != 0) {
-                return false;
-            }
-        }
-
-        std::string str = ver.Section() == NULL ? "" : ver.Section();
-        std::string section, component;
-
-        size_t found;
-        found = str.find_last_of("/");
-        section = str.substr(found + 1);
-        if(found == str.npos) {
-            component = "main";
-        } else {
-            component = str.substr(0, found);
-        }
-
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_INSTALLED) && installed)
-            return false;
-        else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_INSTALLED) && !installed)
-            return false;
-
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_DEVELOPMENT)) {
-            // if ver.end() means unknow
-            // strcmp will be true when it's different than devel
-            std::string pkgName = pkg.Name();
-            if (!ends_with(pkgName, "-dev") &&
-                    !ends_with(pkgName, "-dbg") &&
-                    section.compare("devel") &&
-                    section.compare("libdevel")) {
-                return false;
-            }
-        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_DEVELOPMENT)) {
-            std::string pkgName = pkg.Name();
-            if (ends_with(pkgName, "-dev") ||
-                    ends_with(pkgName, "-dbg") ||
-                    !section.compare("devel") ||
-                    !section.compare("libdevel")) {
-                return false;
-            }
-        }
-
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_GUI)) {
-            // if ver.end() means unknow
-            // strcmp will be true when it's different than x11
-            if (section.compare("x11") && section.compare("gnome") &&
-                    section.compare("kde") && section.compare("graphics")) {
-                return false;
-            }
-        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_GUI)) {
-            if (!section.compare("x11") || !section.compare("gnome") ||
-                    !section.compare("kde") || !section.compare("graphics")) {
-                return false;
-            }
-        }
-
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_FREE)) {
-            if (component.compare("main") != 0 &&
-                    component.compare("universe") != 0) {
-                // Must be in main and universe to be free
-                return false;
-            }
-        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_FREE)) {
-            if (component.compare("main") == 0 ||
-                    component.compare("universe") == 0) {
-                // Must not be in main or universe to be free
-                return false;
-            }
-        }
-
-        // Check for supported packages
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_SUPPORTED)) {
-            if (!packageIsSupported(ver, component)) {
-                return false;
-            }
-        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_SUPPORTED)) {
-            if (packageIsSupported(ver, component)) {
-                return false;
-            }
-        }
-
-        // Check for applications, if they have files with .desktop
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_APPLICATION)) {
-            // We do not support checking if it is an Application
-            // if NOT installed
-            if (!installed || !isApplication(ver)) {
-                return false;
-            }
-        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_APPLICATION)) {
-            // We do not support checking if it is an Application
-            // if NOT installed
-            if (!installed || isApplication(ver)) {
-                return false;
-            }
-        }
-
-        // TODO test this one..
-#if 0
-        // I couldn'tfind any packages with the metapackages component, and I
-        // think the check is the wrong way around; PK_FILTER_ENUM_COLLECTIONS
-        // is for virtual group packages -- hughsie
-        if (pk_bitfield_contain(filters, PK_FILTER_ENUM_COLLECTIONS)) {
-            if (!component.compare("metapackages")) {
-                return false;
-            }
-        } else if (pk_bitfield_contain(filters, PK_FILTER_ENUM_NOT_COLLECTIONS)) {
-            if (component.compare("metapackages")) {
-                return false;
-            }
-        }
-#endif
-    }
-    return true;
-}
-
 PkgList AptJob::filterPackages(const PkgList &packages, PkBitfield filters)
 {
     if (filters == 0)
@@ -372,59 +244,20 @@ PkgList AptJob::filterPackages(const PkgList &packages, PkBitfield filters)
     PkgList ret;
     ret.reserve(packages.size());
 
+    AptFilter filter(m_cache->GetPkgCache(), filters, m_isMultiArch,
+                     PK_BACKEND(pk_backend_job_get_backend(m_job)));
     for (const PkgInfo &info : packages) {
-        if (matchPackage(info.ver, filters)) {
+        if (filter.matches(info.ver)) {
             ret.push_back(info);
         }
     }
 
-    // This filter is more complex so we filter it after the list has shrunk
+    // Answered from the index of the archive directory, not a download plan
     if (pk_bitfield_contain(filters, PK_FILTER_ENUM_DOWNLOADED) && ret.size() > 0) {
         PkgList downloaded;
-
-        pkgProblemResolver Fix(*m_cache);
-        {
-            pkgDepCache::ActionGroup group(*m_cache);
-            for (auto autoInst : { true, false }) {
-                for (const PkgInfo &pki : ret) {
-                    if (m_cancel)
-                        break;
-
-                    m_cache->tryToInstall(Fix, pki, autoInst, false);
-                }
-            }
-        }
-
-        // get a fetcher
-        pkgAcquire fetcher;
-
-        // Read the source list
-        if (m_cache->BuildSourceList() == false) {
-            return downloaded;
-        }
-
-        // Create the package manager and prepare to download
-        std::unique_ptr<pkgPackageManager> PM (_system->CreatePM(*m_cache));
-        if (!PM->GetArchives(&fetcher, m_cache->GetSourceList(), m_cache->GetPkgRecords()) ||
-                _error->PendingError() == true) {
-            return downloaded;
-        }
-
+        AptArchiveIndex *archives = AptArchiveIndex::instance();
         for (const PkgInfo &info : ret) {
-            bool found = false;
-            for (pkgAcquire::ItemIterator it = fetcher.ItemsBegin(); it < fetcher.ItemsEnd(); ++it) {
-                pkgAcqArchiveSane *archive = static_cast<pkgAcqArchiveSane*>(dynamic_cast<pkgAcqArchive*>(*it));
-                if (archive == nullptr) {
-                    continue;
-                }
-                const pkgCache::VerIterator ver = archive->version();
-                if ((*it)->Local && info.ver == ver) {
-                    found = true;
-                    break;
-                }
-            }
-
-            if (found)
+            if (archives->contains(info.ver))
                 downloaded.append(info);
         }
 
@@ -595,48 +428,19 @@ void AptJob::emitUpdates(PkgList &output, PkBitfield filters)
 // search packages which provide a codec (specified in "values")
 void AptJob::providesCodec(PkgList &output, gchar **values)
 {
-    string arch;
-    GstMatcher matcher(values);
-    if (!matcher.hasMatches()) {
-        return;
-    }
-
-    for (pkgCache::PkgIterator pkg = m_cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
-        if (m_cancel) {
+    auto index = AptProvidesIndex::get(m_cache);
+    for (const string &name : index->codecs(values)) {
+        if (m_cancel)
             break;
-        }
 
-        // Ignore packages that exist only due to dependencies.
-        if (pkg.VersionList().end() && pkg.ProvidesList().end()) {
+        const pkgCache::PkgIterator &pkg = (*m_cache)->FindPkg(name);
+        if (pkg.end())
             continue;
-        }
-
-        // Ignore debug packages - these aren't interesting as codec providers,
-        // but they do have apt GStreamer-* metadata.
-        if (ends_with (pkg.Name(), "-dbg") || ends_with (pkg.Name(), "-dbgsym")) {
-            continue;
-        }
-
-        // TODO search in updates packages
-        // Ignore virtual packages
-        pkgCache::VerIterator ver = m_cache->findVer(pkg);
-        if (ver.end() == true) {
-            ver = m_cache->findCandidateVer(pkg);
-        }
-        if (ver.end() == true) {
+        const pkgCache::VerIterator &ver = m_cache->findVer(pkg);
+        if (ver.end())
             continue;
-        }
 
-        arch = string(ver.Arch());
-
-        pkgCache::VerFileIterator vf = ver.FileList();
-        pkgRecords::Parser &rec = m_cache->GetPkgRecords()->Lookup(vf);
-        const char *start, *stop;
-        rec.GetRec(start, stop);
-        string record(start, stop - start);
-        if (matcher.matches(record, arch)) {
-            output.append(ver);
-        }
+        output.append(ver);
     }
 }
 
@@ -684,7 +488,15 @@ void AptJob::providesLibrary(PkgList &output, gchar **values)
 
             g_debug ("pkg-name: %s", libPkgName.c_str ());
 
-            for (pkgCache::PkgIterator pkg = m_cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
+            // Make everything lower-case
+            std::transform(libPkgName.begin(), libPkgName.end(), libPkgName.begin(), ::tolower);
+
+            // the group holds the package for every architecture
+            pkgCache::GrpIterator grp = (*m_cache)->FindGrp(libPkgName);
+            if (grp.end()) {
+                continue;
+            }
+            for (pkgCache::PkgIterator pkg = grp.PackageList(); !pkg.end(); pkg = grp.NextPkg(pkg)) {
                 // Ignore packages that exist only due to dependencies.
                 if (pkg.VersionList().end() && pkg.ProvidesList().end()) {
                     continue;
@@ -699,12 +511,7 @@ void AptJob::providesLibrary(PkgList &output, gchar **values)
                     }
                 }
 
-                // Make everything lower-case
-                std::transform(libPkgName.begin(), libPkgName.end(), libPkgName.begin(), ::tolower);
-
-                if (g_strcmp0 (pkg.Name (), libPkgName.c_str ()) == 0) {
-                    output.append(ver);
-                }
+                output.append(ver);
             }
         } else {
             g_debug("libmatcher: Did not match: %s", value);
@@ -801,8 +608,8 @@ AptCacheFile* AptJob::aptCacheFile() const
     return m_cache;
 }
 
-// used to emit packages it collects all the needed info
-void AptJob::emitPackageDetail(const pkgCache::VerIterator &ver)
+// helper for emitDetails() to collect the details of a package for emission
+void AptJob::stagePackageDetail(GPtrArray *detailsArray, const pkgCache::VerIterator &ver)
 {
     if (ver.end() == true) {
         return;
@@ -827,14 +634,17 @@ void AptJob::emitPackageDetail(const pkgCache::VerIterator &ver)
     }
 
     g_autofree gchar *package_id = m_cache->buildPackageId(ver);
-    pk_backend_job_details(m_job,
-                           package_id,
-                           m_cache->getShortDescription(ver).c_str(),
-                           "unknown",
-                           get_enum_group(section),
-                           m_cache->getLongDescriptionParsed(ver).c_str(),
-                           rec.Homepage().c_str(),
-                           size);
+    PkDetails *item = pk_details_new();
+    g_object_set(item,
+                 "package-id", package_id,
+                 "summary", m_cache->getShortDescription(ver).c_str(),
+                 "license", "unknown",
+                 "group", get_enum_group(section),
+                 "description", m_cache->getLongDescriptionParsed(ver).c_str(),
+                 "url", rec.Homepage().c_str(),
+                 "size", (guint64) size,
+                 NULL);
+    g_ptr_array_add(detailsArray, item);
 }
 
 void AptJob::emitDetails(PkgList &pkgs)
@@ -845,12 +655,16 @@ void AptJob::emitDetails(PkgList &pkgs)
     // Remove the duplicated entries
     pkgs.removeDuplicates();
 
+    g_autoptr(GPtrArray) detailsArray = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
     for (const PkgInfo &pkgInfo : pkgs) {
         if (m_cancel)
             break;
 
-        emitPackageDetail(pkgInfo.ver);
+        stagePackageDetail(detailsArray, pkgInfo.ver);
     }
+
+    // emit all data that we've just collected
+    pk_backend_job_details_list(m_job, detailsArray);
 }
 
 // helper for emitUpdateDetails() to create update items and add them to the final array for emission
@@ -1437,61 +1251,20 @@ PkgList AptJob::getUpdates(PkgList &blocked, PkgList &downgrades, PkgList &insta
     return updates;
 }
 
-// used to return files it reads, using the info from the files in /var/lib/dpkg/info/
+// search packages whose AppStream metadata provides the mime types in "values"
 void AptJob::providesMimeType(PkgList &output, gchar **values)
 {
-    g_autoptr(AsPool) pool = NULL;
-    g_autoptr(GError) error = NULL;
-    std::vector<string> pkg_names;
-
-    pool = as_pool_new ();
-
-    /* don't monitor cache locations or load Flatpak data */
-    as_pool_remove_flags (pool, AS_POOL_FLAG_MONITOR);
-    as_pool_remove_flags (pool, AS_POOL_FLAG_LOAD_FLATPAK);
-
-    /* try to load the metadata pool */
-    if (!as_pool_load (pool, NULL, &error)) {
+    auto appstream = AptAppStream::get();
+    if (!appstream->error().empty()) {
         pk_backend_job_error_code(m_job,
                                   PK_ERROR_ENUM_INTERNAL_ERROR,
-                                  "Failed to load AppStream metadata: %s", error->message);
+                                  "Failed to load AppStream metadata: %s",
+                                  appstream->error().c_str());
         return;
     }
 
-    /* search for mimetypes for all values */
-    for (guint i = 0; values[i] != NULL; i++) {
-#if AS_CHECK_VERSION(1,0,0)
-        g_autoptr(AsComponentBox) result = NULL;
-#else
-        g_autoptr(GPtrArray) result = NULL;
-#endif
-        if (m_cancel)
-            break;
-
-#if AS_CHECK_VERSION(1,0,0)
-        result = as_pool_get_components_by_provided_item (pool, AS_PROVIDED_KIND_MEDIATYPE, values[i]);
-        for (guint j = 0; j < as_component_box_len (result); j++) {
-            const gchar *pkgname;
-            AsComponent *cpt = as_component_box_index (result, j);
-#else
-        result = as_pool_get_components_by_provided_item (pool, AS_PROVIDED_KIND_MEDIATYPE, values[i]);
-        for (guint j = 0; j < result->len; j++) {
-            const gchar *pkgname;
-            AsComponent *cpt = AS_COMPONENT (g_ptr_array_index (result, j));
-#endif
-            /* sanity check */
-            pkgname = as_component_get_pkgname (cpt);
-            if (pkgname == NULL) {
-                g_warning ("Component %s has no package name (it was ignored in the search).", as_component_get_data_id (cpt));
-                continue;
-            }
-
-            pkg_names.push_back (pkgname);
-        }
-    }
-
     /* resolve the package names */
-    for (const std::string &package : pkg_names) {
+    for (const std::string &package : appstream->mimeTypes(values)) {
         if (m_cancel)
             break;
 
@@ -1506,44 +1279,27 @@ void AptJob::providesMimeType(PkgList &output, gchar **values)
     }
 }
 
-bool AptJob::isApplication(const pkgCache::VerIterator &ver)
+// search packages whose AppStream metadata provides the modaliases in "values"
+void AptJob::providesModalias(PkgList &output, gchar **values)
 {
-    bool ret = false;
-    gchar *fileName;
-    string line;
-
-    fileName = g_strdup_printf("/var/lib/dpkg/info/%s:%s.list",
-                               ver.ParentPkg().Name(),
-                               ver.Arch());
-    if (!FileExists(fileName)) {
-        g_free(fileName);
-        // if the file was not found try without the arch field
-        fileName = g_strdup_printf("/var/lib/dpkg/info/%s.list",
-                                   ver.ParentPkg().Name());
-    }
+    auto appstream = AptAppStream::get();
+    for (const std::string &package : appstream->modaliases(values)) {
+        if (m_cancel)
+            break;
 
-    if (FileExists(fileName)) {
-        ifstream in(fileName);
-        if (!in != 0) {
-            g_free(fileName);
-            return false;
-        }
+        const pkgCache::PkgIterator &pkg = (*m_cache)->FindPkg(package);
+        if (pkg.end() == true)
+            continue;
+        const pkgCache::VerIterator &ver = m_cache->findVer(pkg);
+        if (ver.end() == true)
+            continue;
 
-        while (in.eof() == false) {
-            getline(in, line);
-            if (ends_with(line, ".desktop")) {
-                ret = true;
-                break;
-            }
-        }
+        output.append(ver);
     }
-
-    g_free(fileName);
-    return ret;
 }
 
-// used to emit files it reads the info directly from the files
-void AptJob::emitPackageFiles(const gchar *pi)
+// used to collect files it reads the info directly from the files
+void AptJob::stagePackageFiles(GPtrArray *filesList, const gchar *pi)
 {
     GPtrArray *files;
     string line;
@@ -1578,13 +1334,18 @@ void AptJob::emitPackageFiles(const gchar *pi)
 
         if (files->len) {
             g_ptr_array_add(files, NULL);
-            pk_backend_job_files(m_job, pi, (gchar **) files->pdata);
+            PkFiles *item = pk_files_new();
+            g_object_set(item,
+                         "package-id", pi,
+                         "files", (gchar **) files->pdata,
+                         NULL);
+            g_ptr_array_add(filesList, item);
         }
         g_ptr_array_unref(files);
     }
 }
 
-void AptJob::emitPackageFilesLocal(const gchar *file)
+void AptJob::stagePackageFilesLocal(GPtrArray *filesList, const gchar *file)
 {
     DebFile deb(file);
     if (!deb.isValid()){
@@ -1601,42 +1362,12 @@ void AptJob::emitPackageFilesLocal(const gchar *file)
         g_ptr_array_add(files, g_canonicalize_filename(file.c_str(), "/"));
     }
     g_ptr_array_add(files, NULL);
-    pk_backend_job_files(m_job, package_id, (gchar **) files->pdata);
-}
-
-/**
-  * Check if package is officially supported by the current distribution
-  */
-bool AptJob::packageIsSupported(const pkgCache::VerIterator &verIter, string component)
-{
-    string origin;
-    if (!verIter.end()) {
-        pkgCache::VerFileIterator vf = verIter.FileList();
-        origin = vf.File().Origin() == NULL ? "" : vf.File().Origin();
-    }
-
-    if (component.empty()) {
-        component = "main";
-    }
-
-    // Get a fetcher
-    AcqPackageKitStatus Stat(this);
-    pkgAcquire fetcher;
-    fetcher.SetLog(&Stat);
-
-    PkBitfield flags = pk_backend_job_get_transaction_flags(m_job);
-    bool trusted = checkTrusted(fetcher, flags);
-
-    if ((origin.compare("Debian") == 0) || (origin.compare("Ubuntu") == 0))  {
-        if ((component.compare("main") == 0 ||
-             component.compare("restricted") == 0 ||
-             component.compare("unstable") == 0 ||
-             component.compare("testing") == 0) && trusted) {
-            return true;
-        }
-    }
-
-    return false;
+    PkFiles *item = pk_files_new();
+    g_object_set(item,
+                 "package-id", package_id,
+                 "files", (gchar **) files->pdata,
+                 NULL);
+    g_ptr_array_add(filesList, item);
 }
 
 bool AptJob::checkTrusted(pkgAcquire &fetcher, PkBitfield flags)
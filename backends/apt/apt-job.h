@@ -177,22 +177,11 @@ public:
       */
     void emitUpdates(PkgList &output, PkBitfield filters = PK_FILTER_ENUM_NONE);
 
-    /**
-      * Checks if a given package matches the filters
-      * @returns true if it passed the filters
-      */
-    bool matchPackage(const pkgCache::VerIterator &ver, PkBitfield filters);
-
     /**
       * Returns the list of packages with the ones that passed the given filters
       */
     PkgList filterPackages(const PkgList &packages, PkBitfield filters);
 
-    /**
-      * Emits details of the given package
-      */
-    void emitPackageDetail(const pkgCache::VerIterator &ver);
-
     /**
       * Emits details of the given package list
       */
@@ -204,14 +193,14 @@ public:
     void emitUpdateDetails(const PkgList &pkgs);
 
     /**
-      *  Emits the files of a package
+      *  Adds the files of a package to @filesList for pk_backend_job_files_list()
       */
-    void emitPackageFiles(const gchar *pi);
+    void stagePackageFiles(GPtrArray *filesList, const gchar *pi);
 
     /**
-      *  Emits the files of a package
+      *  Adds the files of a local package to @filesList for pk_backend_job_files_list()
       */
-    void emitPackageFilesLocal(const gchar *file);
+    void stagePackageFilesLocal(GPtrArray *filesList, const gchar *file);
 
     /**
       *  Download and install packages
@@ -233,6 +222,11 @@ public:
      */
     void providesMimeType(PkgList &output, gchar **values);
 
+    /**
+     *  Check which package provides a modalias
+     */
+    void providesModalias(PkgList &output, gchar **values);
+
     /** Like pkgAcqArchive, but uses generic File objects to download to
      *  the cwd (and copies from file:/ URLs).
      */
@@ -244,8 +238,6 @@ public:
 private:
     void setEnvLocaleFromJob();
     bool checkTrusted(pkgAcquire &fetcher, PkBitfield flags);
-    bool packageIsSupported(const pkgCache::VerIterator &verIter, string component);
-    bool isApplication(const pkgCache::VerIterator &verIter);
     bool matchesQueries(const vector<string> &queries, string s);
     bool dpkgHasForceConfFileSet();
     PkInfoEnum packageStateFromVer(const pkgCache::VerIterator &ver) const;
@@ -253,6 +245,7 @@ private:
                              PkInfoEnum state = PK_INFO_ENUM_UNKNOWN,
                              PkInfoEnum updateSeverity = PK_INFO_ENUM_UNKNOWN) const;
     void stageUpdateDetail(GPtrArray *updateArray, const pkgCache::VerIterator &candver);
+    void stagePackageDetail(GPtrArray *detailsArray, const pkgCache::VerIterator &ver);
 
     /**
      *  interprets dpkg status fd
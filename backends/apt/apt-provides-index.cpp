@@ -0,0 +1,166 @@
+/* apt-provides-index.cpp
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include "apt-provides-index.h"
+
+#include <apt-pkg/pkgrecords.h>
+#include <gst/gst.h>
+#include <mutex>
+#include <unordered_set>
+
+#include "apt-cache-file.h"
+#include "apt-utils.h"
+#include "gst-matcher.h"
+
+using namespace std;
+
+static std::mutex s_indexLock;
+static std::shared_ptr<AptProvidesIndex> s_index;
+
+static const char *s_gstFields[] = {
+    "Gstreamer-Encoders",
+    "Gstreamer-Decoders",
+    "Gstreamer-Uri-Sources",
+    "Gstreamer-Uri-Sinks",
+    "Gstreamer-Elements",
+};
+
+static const char s_gstVersionPrefix[] = "\nGstreamer-Version: ";
+
+AptProvidesIndex::AptProvidesIndex(AptCacheFile *cache, const string &generation) :
+    m_generation(generation)
+{
+    addCodecs(cache);
+}
+
+AptProvidesIndex::~AptProvidesIndex()
+{
+    for (const CodecEntry &entry : m_codecEntries) {
+        gst_caps_unref(static_cast<GstCaps*>(entry.caps));
+    }
+}
+
+shared_ptr<AptProvidesIndex> AptProvidesIndex::get(AptCacheFile *cache)
+{
+    const string generation = utilCacheGeneration(cache->GetPkgCache());
+
+    lock_guard<mutex> lock(s_indexLock);
+    if (!s_index || s_index->m_generation != generation) {
+        g_debug("building provides index");
+        s_index = make_shared<AptProvidesIndex>(cache, generation);
+    }
+    return s_index;
+}
+
+void AptProvidesIndex::addCodecs(AptCacheFile *cache)
+{
+    if (!gst_is_initialized())
+        gst_init(NULL, NULL);
+
+    for (pkgCache::PkgIterator pkg = cache->GetPkgCache()->PkgBegin(); !pkg.end(); ++pkg) {
+        // Ignore packages that exist only due to dependencies.
+        if (pkg.VersionList().end() && pkg.ProvidesList().end()) {
+            continue;
+        }
+
+        // Ignore debug packages - these aren't interesting as codec providers,
+        // but they do have apt GStreamer-* metadata.
+        if (ends_with(pkg.Name(), "-dbg") || ends_with(pkg.Name(), "-dbgsym")) {
+            continue;
+        }
+
+        const pkgCache::VerIterator &ver = cache->findVer(pkg);
+        if (ver.end() || ver.FileList().end()) {
+            continue;
+        }
+
+        pkgRecords::Parser &rec = cache->GetPkgRecords()->Lookup(ver.FileList());
+        const string gstVersion = rec.RecordField("Gstreamer-Version");
+        if (gstVersion.empty()) {
+            continue;
+        }
+
+        for (const char *field : s_gstFields) {
+            string value = rec.RecordField(field);
+            value = value.substr(0, value.find('\n'));
+            if (value.empty()) {
+                continue;
+            }
+
+            GstCaps *caps = gst_caps_from_string(value.c_str());
+            if (caps == NULL) {
+                continue;
+            }
+
+            const size_t idx = m_codecEntries.size();
+            m_codecEntries.push_back({ pkg.FullName(false), ver.Arch(), gstVersion, caps });
+
+            if (gst_caps_is_any(caps)) {
+                m_codecs.emplace(string(field) + "\n*", idx);
+                continue;
+            }
+            for (guint i = 0; i < gst_caps_get_size(caps); i++) {
+                const gchar *name = gst_structure_get_name(gst_caps_get_structure(caps, i));
+                m_codecs.emplace(string(field) + "\n" + name, idx);
+            }
+        }
+    }
+
+    g_debug("indexed %zu codec fields", m_codecEntries.size());
+}
+
+vector<string> AptProvidesIndex::codecs(gchar **values) const
+{
+    vector<string> ret;
+    unordered_set<size_t> seen;
+
+    GstMatcher matcher(values);
+    for (const Match &match : matcher.matchList()) {
+        // "Gstreamer-Decoders: " and "\nGstreamer-Version: 1.0"
+        const string field = match.type.substr(0, match.type.find(':'));
+        const string version = match.version.substr(sizeof(s_gstVersionPrefix) - 1);
+        GstCaps *caps = static_cast<GstCaps*>(match.caps);
+
+        vector<string> keys = { field + "\n*" };
+        for (guint i = 0; i < gst_caps_get_size(caps); i++) {
+            keys.push_back(field + "\n" + gst_structure_get_name(gst_caps_get_structure(caps, i)));
+        }
+
+        for (const string &key : keys) {
+            auto range = m_codecs.equal_range(key);
+            for (auto it = range.first; it != range.second; ++it) {
+                const CodecEntry &entry = m_codecEntries[it->second];
+                if (seen.count(it->second))
+                    continue;
+                if (!match.arch.empty() && entry.arch != match.arch)
+                    continue;
+                if (!starts_with(entry.gstVersion, version.c_str()))
+                    continue;
+
+                // if the record is capable of intersect them we found the package
+                if (gst_caps_can_intersect(caps, static_cast<GstCaps*>(entry.caps))) {
+                    seen.insert(it->second);
+                    ret.push_back(entry.package);
+                }
+            }
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,74 @@
+/* apt-provides-index.h
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#ifndef APT_PROVIDES_INDEX_H
+#define APT_PROVIDES_INDEX_H
+
+#include <glib.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class AptCacheFile;
+
+/**
+ * The codecs the packages in the cache provide, for WhatProvides.
+ *
+ * Building it reads the record of every package once per cache
+ * generation; queries are hash lookups that return full package names
+ * ("name:arch") to resolve against the cache of the job. Mime types and
+ * modaliases come from AptAppStream.
+ */
+class AptProvidesIndex
+{
+public:
+    /**
+     * Returns the index for the given cache, building it if the cache
+     * changed since the last call
+     */
+    static std::shared_ptr<AptProvidesIndex> get(AptCacheFile *cache);
+
+    explicit AptProvidesIndex(AptCacheFile *cache, const std::string &generation);
+    ~AptProvidesIndex();
+
+    /**
+     * Packages with Gstreamer-* fields matching the gstreamer(...) values
+     */
+    std::vector<std::string> codecs(gchar **values) const;
+
+private:
+    void addCodecs(AptCacheFile *cache);
+
+    typedef struct {
+        std::string package;
+        std::string arch;
+        std::string gstVersion;
+        void *caps;
+    } CodecEntry;
+
+    std::string m_generation;
+
+    // "<field>\n<structure name>" to entries, "*" for ANY caps
+    std::vector<CodecEntry> m_codecEntries;
+    std::unordered_multimap<std::string, size_t> m_codecs;
+};
+
+#endif // APT_PROVIDES_INDEX_H
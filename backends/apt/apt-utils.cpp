@@ -21,12 +21,14 @@
 
 #include "apt-utils.h"
 
+#include <apt-pkg/configuration.h>
 #include <apt-pkg/fileutl.h>
 #include <apt-pkg/error.h>
 #include <apt-pkg/pkgsystem.h>
 #include <apt-pkg/version.h>
 #include <apt-pkg/acquire-item.h>
 #include <glib/gstdio.h>
+#include <sys/stat.h>
 
 #include <fstream>
 #include <regex>
@@ -430,6 +432,31 @@ string utilBuildPackageOriginId(pkgCache::VerFileIterator vf)
     return res;
 }
 
+string utilCacheGeneration(pkgCache *cache)
+{
+    // the dpkg status and the binary cache are rewritten whenever
+    // a package is installed or the lists change
+    string generation = _config->Find("APT::Architecture");
+    const string files[] = {
+        _config->FindFile("Dir::State::status"),
+        _config->FindFile("Dir::Cache::pkgcache"),
+    };
+
+    for (const string &file : files) {
+        struct stat st;
+        if (file.empty() || stat(file.c_str(), &st) != 0) {
+            generation += ":-";
+            continue;
+        }
+        generation += ":" + to_string(st.st_mtim.tv_sec) +
+                      "." + to_string(st.st_mtim.tv_nsec) +
+                      ":" + to_string(st.st_size);
+    }
+
+    generation += ":" + to_string(cache->Head().VersionCount);
+    return generation;
+}
+
 const char *toUtf8(const char *str)
 {
     static __thread char *_str = NULL;
@@ -77,6 +77,12 @@ bool utilRestartRequired(const string &packageName);
  */
 string utilBuildPackageOriginId(pkgCache::VerFileIterator vf);
 
+/**
+ * Returns a key that changes whenever the package cache contents do,
+ * for data derived from the cache that is kept between jobs
+ */
+string utilCacheGeneration(pkgCache *cache);
+
 /**
   * Return an utf8 string
   */
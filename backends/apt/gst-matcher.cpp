@@ -173,3 +173,8 @@ bool GstMatcher::hasMatches() const
 {
     return !m_matches.empty();
 }
+
+const vector<Match> &GstMatcher::matchList() const
+{
+    return m_matches;
+}
@@ -45,6 +45,7 @@ public:
 
     bool matches(string record, string arch);
     bool hasMatches() const;
+    const vector<Match> &matchList() const;
 
 private:
     vector<Match> m_matches;
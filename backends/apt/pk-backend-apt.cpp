@@ -23,6 +23,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 
 #include <config.h>
 #include <pk-backend.h>
@@ -36,6 +37,7 @@
 
 #include "apt-job.h"
 #include "apt-cache-file.h"
+#include "apt-archive-index.h"
 #include "apt-messages.h"
 #include "acqpkitstatus.h"
 #include "apt-sourceslist.h"
@@ -85,6 +87,9 @@ void pk_backend_initialize(GKeyFile *conf, PkBackend *backend)
     if (!pkgInitSystem(*_config, _system)) {
         g_debug("ERROR initializing backend system");
     }
+
+    // keep the index of downloaded archives up to date
+    AptArchiveIndex::instance()->watch();
 }
 
 void pk_backend_destroy(PkBackend *backend)
@@ -148,6 +153,21 @@ gchar** pk_backend_get_mime_types(PkBackend *backend)
     return g_strdupv ((gchar **) mime_types);
 }
 
+gchar* pk_backend_get_installed_stamp(PkBackend *backend)
+{
+    // dpkg rewrites its status file whenever it changes a package,
+    // including when it was not run by us
+    struct stat st;
+    string status = _config->FindFile("Dir::State::status");
+    if (stat(status.c_str(), &st) != 0) {
+        return NULL;
+    }
+
+    return g_strdup_printf("%lld.%09ld",
+                           (long long) st.st_mtim.tv_sec,
+                           (long) st.st_mtim.tv_nsec);
+}
+
 void pk_backend_start_job(PkBackend *backend, PkBackendJob *job)
 {
     /* create private state for this job */
@@ -269,6 +289,7 @@ static void backend_get_files_thread(PkBackendJob *job, GVariant *params, gpoint
     }
 
     pk_backend_job_set_status(job, PK_STATUS_ENUM_QUERY);
+    g_autoptr(GPtrArray) filesList = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
     for (uint i = 0; i < g_strv_length(package_ids); ++i) {
         pi = package_ids[i];
         if (pk_package_id_check(pi) == false) {
@@ -288,8 +309,11 @@ static void backend_get_files_thread(PkBackendJob *job, GVariant *params, gpoint
             return;
         }
 
-        apt->emitPackageFiles(pi);
+        apt->stagePackageFiles(filesList, pi);
     }
+
+    // emit all the file lists together
+    pk_backend_job_files_list(job, filesList);
 }
 
 void pk_backend_get_files(PkBackend *backend, PkBackendJob *job, gchar **package_ids)
@@ -355,8 +379,10 @@ static void backend_get_files_local_thread(PkBackendJob *job, GVariant *params,
                   &files);
     auto apt = static_cast<AptJob*>(pk_backend_job_get_user_data(job));
 
+    g_autoptr(GPtrArray) filesList = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
     for (guint i = 0; files[i] != nullptr; ++i)
-        apt->emitPackageFilesLocal(files[i]);
+        apt->stagePackageFilesLocal(filesList, files[i]);
+    pk_backend_job_files_list(job, filesList);
 }
 
 void pk_backend_get_files_local(PkBackend *backend, PkBackendJob *job, gchar **files)
@@ -412,7 +438,7 @@ static void backend_what_provides_thread(PkBackendJob *job, GVariant *params, gp
 
     pk_backend_job_set_status(job, PK_STATUS_ENUM_QUERY);
 
-    // We can handle libraries, mimetypes and codecs
+    // We can handle libraries, mimetypes, modaliases and codecs
     if (!apt->init()) {
         g_debug("Failed to create apt cache");
         g_strfreev(values);
@@ -425,6 +451,7 @@ static void backend_what_provides_thread(PkBackendJob *job, GVariant *params, gp
     apt->providesLibrary(output, values);
     apt->providesCodec(output, values);
     apt->providesMimeType(output, values);
+    apt->providesModalias(output, values);
 
     // It's faster to emit the packages here rather than in the matching part
     apt->emitPackages(output, filters);
@@ -519,6 +546,14 @@ static void pk_backend_download_packages_thread(PkBackendJob *job, GVariant *par
                     continue;
                 }
 
+                // already in the archive cache, nothing to fetch
+                const string cached = AptArchiveIndex::instance()->fileName(pkInfo.ver);
+                if (!cached.empty()) {
+                    gchar *files[] = { (gchar *) cached.c_str(), NULL };
+                    pk_backend_job_files(job, pi, files);
+                    continue;
+                }
+
                 string storeFileName;
                 if (!apt->getArchive(&fetcher,
                                      pkInfo.ver,
@@ -866,6 +901,7 @@ static void backend_repo_manager_thread(PkBackendJob *job, GVariant *params, gpo
     gboolean enabled;
     gboolean autoremove;
     bool found = false;
+    g_autoptr(GPtrArray) repoDetails = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
     // generic
     PkRoleEnum role;
 
@@ -918,10 +954,13 @@ static void backend_repo_manager_thread(PkBackendJob *job, GVariant *params, gpo
                 continue;
             }
 
-            pk_backend_job_repo_detail(job,
-                                       repoId.c_str(),
-                                       souceRecord->niceName().c_str(),
-                                       !(souceRecord->Type & SourcesList::Disabled));
+            PkRepoDetail *item = pk_repo_detail_new();
+            g_object_set(item,
+                         "repo-id", repoId.c_str(),
+                         "description", souceRecord->niceName().c_str(),
+                         "enabled", (gboolean) !(souceRecord->Type & SourcesList::Disabled),
+                         NULL);
+            g_ptr_array_add(repoDetails, item);
         } else if (repoId.compare(repo_id) == 0) {
             // Found the repo to enable/disable
             found = true;
@@ -981,6 +1020,9 @@ static void backend_repo_manager_thread(PkBackendJob *job, GVariant *params, gpo
         }
     }
 
+    if (role == PK_ROLE_ENUM_GET_REPO_LIST)
+        pk_backend_job_repo_details(job, repoDetails);
+
     if ((role == PK_ROLE_ENUM_REPO_ENABLE || role == PK_ROLE_ENUM_REPO_REMOVE) &&
             !found) {
         _error->Error("Could not find the repository");
@@ -0,0 +1,184 @@
+/* appstream-test.cpp
+ *
+ * Copyright (c) 2026 PackageKit contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+#include "apt-appstream.h"
+
+#include <algorithm>
+#include <glib/gstdio.h>
+
+using namespace std;
+
+static void addComponent(AptAppStream &appstream,
+                         const gchar *pkgname,
+                         AsProvidedKind kind,
+                         const gchar *item)
+{
+    g_autoptr(AsComponent) cpt = as_component_new();
+    g_autoptr(AsProvided) prov = as_provided_new();
+
+    g_autofree gchar *id = g_strdup_printf("org.example.%s", pkgname);
+    as_component_set_id(cpt, id);
+    as_component_set_pkgname(cpt, pkgname);
+    as_provided_set_kind(prov, kind);
+    as_provided_add_item(prov, item);
+    as_component_add_provided(cpt, prov);
+    appstream.addComponent(cpt);
+}
+
+static void appstream_mime_types_func()
+{
+    AptAppStream appstream;
+    addComponent(appstream, "gimp", AS_PROVIDED_KIND_MEDIATYPE, "image/png");
+    addComponent(appstream, "eog", AS_PROVIDED_KIND_MEDIATYPE, "image/png");
+    addComponent(appstream, "evince", AS_PROVIDED_KIND_MEDIATYPE, "application/pdf");
+
+    const gchar *png[] = { "image/png", NULL };
+    vector<string> found = appstream.mimeTypes((gchar **) png);
+    sort(found.begin(), found.end());
+    g_assert_cmpuint(found.size(), ==, 2);
+    g_assert_cmpstr(found[0].c_str(), ==, "eog");
+    g_assert_cmpstr(found[1].c_str(), ==, "gimp");
+
+    const gchar *both[] = { "application/pdf", "text/plain", NULL };
+    found = appstream.mimeTypes((gchar **) both);
+    g_assert_cmpuint(found.size(), ==, 1);
+    g_assert_cmpstr(found[0].c_str(), ==, "evince");
+}
+
+static void appstream_modaliases_func()
+{
+    AptAppStream appstream;
+    addComponent(appstream, "firmware-usb", AS_PROVIDED_KIND_MODALIAS, "usb:v1234p*");
+    addComponent(appstream, "firmware-pci", AS_PROVIDED_KIND_MODALIAS, "pci:v00008086d*");
+    addComponent(appstream, "firmware-any", AS_PROVIDED_KIND_MODALIAS, "*:v5678*");
+
+    // both spellings are accepted
+    const gchar *usb[] = { "modalias(usb:v1234p0001)", "usb:v1234p0002", NULL };
+    vector<string> found = appstream.modaliases((gchar **) usb);
+    g_assert_cmpuint(found.size(), ==, 2);
+    g_assert_cmpstr(found[0].c_str(), ==, "firmware-usb");
+    g_assert_cmpstr(found[1].c_str(), ==, "firmware-usb");
+
+    // a glob on the bus matches on every bus
+    const gchar *any[] = { "pci:v5678d0001", NULL };
+    found = appstream.modaliases((gchar **) any);
+    g_assert_cmpuint(found.size(), ==, 1);
+    g_assert_cmpstr(found[0].c_str(), ==, "firmware-any");
+
+    // globs of another bus and values without a bus never match
+    const gchar *none[] = { "usb:v00008086d0001", "v1234p0001", NULL };
+    found = appstream.modaliases((gchar **) none);
+    g_assert_cmpuint(found.size(), ==, 0);
+}
+
+// a catalog of @size components, each with a mime type and a modalias
+static gchar *writeCatalog(guint size)
+{
+    g_autoptr(GError) error = NULL;
+    g_autoptr(GString) xml = g_string_new("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                                          "<components version=\"0.14\" origin=\"test\">\n");
+    gchar *dir = g_dir_make_tmp("pk-apt-test-XXXXXX", &error);
+    g_assert_no_error(error);
+
+    for (guint i = 0; i < size; i++) {
+        g_string_append_printf(xml,
+                               "  <component type=\"desktop-application\">\n"
+                               "    <id>org.example.package%u</id>\n"
+                               "    <pkgname>package%u</pkgname>\n"
+                               "    <name>Package %u</name>\n"
+                               "    <summary>A test package</summary>\n"
+                               "    <provides>\n"
+                               "      <mediatype>application/x-type%u</mediatype>\n"
+                               "      <modalias>%s:v%04Xp*</modalias>\n"
+                               "    </provides>\n"
+                               "  </component>\n",
+                               i, i, i, i, i % 2 == 0 ? "usb" : "pci", i);
+    }
+    g_string_append(xml, "</components>\n");
+
+    g_autofree gchar *xmldir = g_build_filename(dir, "xml", NULL);
+    g_autofree gchar *filename = g_build_filename(xmldir, "test.xml", NULL);
+    g_assert_cmpint(g_mkdir(xmldir, 0755), ==, 0);
+    g_file_set_contents(filename, xml->str, xml->len, &error);
+    g_assert_no_error(error);
+    return dir;
+}
+
+static void removeCatalog(const gchar *dir)
+{
+    g_autofree gchar *xmldir = g_build_filename(dir, "xml", NULL);
+    g_autofree gchar *filename = g_build_filename(xmldir, "test.xml", NULL);
+    g_unlink(filename);
+    g_rmdir(xmldir);
+    g_rmdir(dir);
+}
+
+static void appstream_benchmark_func()
+{
+    const guint size = 10000;
+    g_autoptr(GTimer) timer = g_timer_new();
+    g_autofree gchar *dir = writeCatalog(size);
+
+    // the first query loads and indexes the catalog
+    AptAppStream::setCatalogDirs({ dir });
+    g_timer_reset(timer);
+    shared_ptr<AptAppStream> cold = AptAppStream::get();
+    g_test_message("first query, loading %u components: %.3fms",
+                   size, g_timer_elapsed(timer, NULL) * 1000);
+    g_assert_cmpstr(cold->error().c_str(), ==, "");
+
+    // later ones only check that it did not change
+    g_timer_reset(timer);
+    for (guint i = 0; i < 100; i++)
+        g_assert_true(AptAppStream::get() == cold);
+    g_test_message("100 warm queries: %.3fms", g_timer_elapsed(timer, NULL) * 1000);
+
+    g_timer_reset(timer);
+    for (guint i = 0; i < size; i++) {
+        g_autofree gchar *mime = g_strdup_printf("application/x-type%u", i);
+        const gchar *values[] = { mime, NULL };
+        g_assert_cmpuint(AptAppStream::get()->mimeTypes((gchar **) values).size(), ==, 1);
+    }
+    g_test_message("%u warm mime type queries: %.3fms",
+                   size, g_timer_elapsed(timer, NULL) * 1000);
+
+    // every query only walks the globs of its own bus
+    g_timer_reset(timer);
+    for (guint i = 0; i < 100; i++) {
+        g_autofree gchar *modalias = g_strdup_printf("usb:v%04Xp0001", i * 2);
+        const gchar *values[] = { modalias, NULL };
+        g_assert_cmpuint(AptAppStream::get()->modaliases((gchar **) values).size(), ==, 1);
+    }
+    g_test_message("100 warm modalias queries over %u globs: %.3fms",
+                   size, g_timer_elapsed(timer, NULL) * 1000);
+
+    AptAppStream::setCatalogDirs({});
+    removeCatalog(dir);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/apt/appstream/mime-types", appstream_mime_types_func);
+    g_test_add_func("/apt/appstream/modaliases", appstream_modaliases_func);
+    g_test_add_func("/apt/appstream/benchmark", appstream_benchmark_func);
+
+    return g_test_run();
+}
@@ -0,0 +1,138 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "dnf-advisory-index.h"
+
+/* Maps name;evr;arch of every package in the updateinfo to its advisory.
+ * The keys point into the strings owned by the advisory packages, so a
+ * lookup only has to put three pointers on the stack. */
+typedef struct {
+	const gchar	*name;
+	const gchar	*evr;
+	const gchar	*arch;
+} DnfAdvisoryKey;
+
+struct _DnfAdvisoryIndex {
+	GPtrArray	*owner;		/* owns the key strings */
+	DnfAdvisoryKey	*keys;
+	guint		 n_keys;
+	guint		 size;
+	GHashTable	*hash;		/* of DnfAdvisoryKey:value */
+	gint		 refcount;
+};
+
+static guint
+dnf_advisory_key_hash (gconstpointer data)
+{
+	const DnfAdvisoryKey *key = data;
+	guint hash = g_str_hash (key->name);
+	hash = hash * 31 + g_str_hash (key->evr);
+	return hash * 31 + g_str_hash (key->arch);
+}
+
+static gboolean
+dnf_advisory_key_equal (gconstpointer a, gconstpointer b)
+{
+	const DnfAdvisoryKey *key_a = a;
+	const DnfAdvisoryKey *key_b = b;
+	return g_strcmp0 (key_a->name, key_b->name) == 0 &&
+	       g_strcmp0 (key_a->evr, key_b->evr) == 0 &&
+	       g_strcmp0 (key_a->arch, key_b->arch) == 0;
+}
+
+/**
+ * dnf_advisory_index_new:
+ * @owner: (transfer full): the array that keeps the key strings alive
+ * @size: the most entries that will be inserted
+ * @value_free: frees the values, or %NULL
+ *
+ * Returns: a new index, with one allocation for all the keys rather than
+ * one per entry
+ **/
+DnfAdvisoryIndex *
+dnf_advisory_index_new (GPtrArray *owner, guint size, GDestroyNotify value_free)
+{
+	DnfAdvisoryIndex *index = g_slice_new0 (DnfAdvisoryIndex);
+	index->refcount = 1;
+	index->owner = owner;
+	index->size = size;
+	index->keys = g_new (DnfAdvisoryKey, MAX (size, 1));
+	index->hash = g_hash_table_new_full (dnf_advisory_key_hash,
+					     dnf_advisory_key_equal,
+					     NULL,
+					     value_free);
+	return index;
+}
+
+DnfAdvisoryIndex *
+dnf_advisory_index_ref (DnfAdvisoryIndex *index)
+{
+	g_atomic_int_inc (&index->refcount);
+	return index;
+}
+
+void
+dnf_advisory_index_unref (DnfAdvisoryIndex *index)
+{
+	if (!g_atomic_int_dec_and_test (&index->refcount))
+		return;
+	g_hash_table_unref (index->hash);
+	g_free (index->keys);
+	if (index->owner != NULL)
+		g_ptr_array_unref (index->owner);
+	g_slice_free (DnfAdvisoryIndex, index);
+}
+
+/* the strings have to outlive the index, e.g. by being owned by @owner */
+void
+dnf_advisory_index_insert (DnfAdvisoryIndex *index,
+			   const gchar *name,
+			   const gchar *evr,
+			   const gchar *arch,
+			   gpointer value)
+{
+	DnfAdvisoryKey *key;
+
+	g_return_if_fail (index->n_keys < index->size);
+
+	key = &index->keys[index->n_keys++];
+	key->name = name;
+	key->evr = evr;
+	key->arch = arch;
+	g_hash_table_insert (index->hash, key, value);
+}
+
+gpointer
+dnf_advisory_index_lookup (DnfAdvisoryIndex *index,
+			   const gchar *name,
+			   const gchar *evr,
+			   const gchar *arch)
+{
+	DnfAdvisoryKey key = { name, evr, arch };
+	return g_hash_table_lookup (index->hash, &key);
+}
+
+guint
+dnf_advisory_index_get_size (DnfAdvisoryIndex *index)
+{
+	return g_hash_table_size (index->hash);
+}
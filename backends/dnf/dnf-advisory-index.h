@@ -0,0 +1,52 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __DNF_ADVISORY_INDEX_H
+#define __DNF_ADVISORY_INDEX_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _DnfAdvisoryIndex DnfAdvisoryIndex;
+
+DnfAdvisoryIndex	*dnf_advisory_index_new		(GPtrArray		*owner,
+							 guint			 size,
+							 GDestroyNotify		 value_free);
+DnfAdvisoryIndex	*dnf_advisory_index_ref		(DnfAdvisoryIndex	*index);
+void			 dnf_advisory_index_unref	(DnfAdvisoryIndex	*index);
+void			 dnf_advisory_index_insert	(DnfAdvisoryIndex	*index,
+							 const gchar		*name,
+							 const gchar		*evr,
+							 const gchar		*arch,
+							 gpointer		 value);
+gpointer		 dnf_advisory_index_lookup	(DnfAdvisoryIndex	*index,
+							 const gchar		*name,
+							 const gchar		*evr,
+							 const gchar		*arch);
+guint			 dnf_advisory_index_get_size	(DnfAdvisoryIndex	*index);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (DnfAdvisoryIndex, dnf_advisory_index_unref)
+
+G_END_DECLS
+
+#endif /* __DNF_ADVISORY_INDEX_H */
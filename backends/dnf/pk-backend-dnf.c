@@ -41,29 +41,64 @@
 #include <libdnf/hy-util.h>
 #include <librepo/librepo.h>
 #include <rpm/rpmlib.h>
+#include <rpm/rpmdb.h>
+#include <rpm/rpmts.h>
 
+#include "dnf-advisory-index.h"
 #include "dnf-backend-vendor.h"
 #include "dnf-backend.h"
 #include "pk-backend-dnf-common.h"
 
 #define DNF_SACK_MAX_AGE	600 /* seconds */
 
+/* A published sack is a snapshot that one job at a time leases out of the
+ * pool, as a libsolv pool changes during queries (tmpspace, lazily loaded
+ * repodata, the string cache) and so can't be read by several threads.
+ * Jobs that change the system either steal an unused snapshot out of the
+ * pool or build a private sack that is never published. */
 typedef struct {
 	DnfSack		*sack;
 	gchar		*key;
+	DnfSackAddFlags	 flags;
 	GTimer		*timer;
+	GMutex		 lock;		/* held by the job using the sack */
+	gboolean	 stale;		/* repos or rpmdb changed since it was built */
+	guint		 stale_seq;	/* the change it was last marked stale for */
+	gboolean	 stolen;	/* taken out of the pool by a transaction */
+	DnfAdvisoryIndex *advisories;	/* built on first use */
+	GMutex		 advisories_mutex;
+	gint		 refcount;
 } DnfSackCacheItem;
 
+typedef enum {
+	DNF_SACK_LEASE_POOLED,
+	DNF_SACK_LEASE_PRIVATE,
+	DNF_SACK_LEASE_LAST
+} DnfSackLease;
+
 typedef struct {
 	GKeyFile	*conf;
 	DnfContext	*context;
 	GHashTable	*sack_cache;	/* of DnfSackCacheItem */
 	GMutex		 sack_mutex;
+	GRecMutex	 sack_build_mutex;
+	GThread		*sack_rebuild_thread;
+	gboolean	 sack_rebuild_running;
+	GCancellable	*sack_rebuild_cancellable;
+	guint		 sack_generation;
+	guint		 sack_stale_seq;
 	GTimer		*repos_timer;
 	gchar		*release_ver;
 	guint		 sack_expire_id;
+	GThreadPool	*rpmdb_pool;	/* one scan at a time, in order */
+	GHashTable	*rpmdb_headers;	/* header instance : package-id */
 } PkBackendDnfPrivate;
 
+typedef struct {
+	gchar		*root;
+	gboolean	 report;
+} PkBackendRpmdbScan;
+
 typedef struct {
 	DnfContext	*context;
 	DnfTransaction	*transaction;
@@ -71,6 +106,8 @@ typedef struct {
 	PkBackend	*backend;
 	PkBitfield	 transaction_flags;
 	HyGoal		 goal;
+	DnfSackCacheItem *sack_lease;
+	PkBackendJobThreadFunc thread_func;
 } PkBackendDnfJobData;
 
 static GPtrArray * pk_backend_find_refresh_repos (PkBackendJob *job,
@@ -94,7 +131,138 @@ pk_backend_get_author (PkBackend *backend)
 gboolean
 pk_backend_supports_parallelization (PkBackend *backend)
 {
-	return FALSE;
+	return TRUE;
+}
+
+gboolean
+pk_backend_supports_search_index (PkBackend *backend)
+{
+	return TRUE;
+}
+
+gchar **
+pk_backend_get_native_arches (PkBackend *backend)
+{
+	PkBackendDnfPrivate *priv = pk_backend_get_user_data (backend);
+
+	/* the same as the arch filter of the queries */
+	if (priv->context == NULL)
+		return NULL;
+	return g_strdupv ((gchar **) dnf_context_get_native_arches (priv->context));
+}
+
+gboolean
+pk_backend_supports_command_index (PkBackend *backend)
+{
+	/* the sacks have the filelists of the remote repos */
+	return TRUE;
+}
+
+static gboolean
+pk_backend_dnf_role_is_read_only (PkRoleEnum role)
+{
+	switch (role) {
+	case PK_ROLE_ENUM_GET_DETAILS:
+	case PK_ROLE_ENUM_GET_DETAILS_LOCAL:
+	case PK_ROLE_ENUM_GET_FILES:
+	case PK_ROLE_ENUM_GET_FILES_LOCAL:
+	case PK_ROLE_ENUM_GET_PACKAGES:
+	case PK_ROLE_ENUM_GET_REPO_LIST:
+	case PK_ROLE_ENUM_GET_UPDATES:
+	case PK_ROLE_ENUM_GET_UPDATE_DETAIL:
+	case PK_ROLE_ENUM_RESOLVE:
+	case PK_ROLE_ENUM_SEARCH_DETAILS:
+	case PK_ROLE_ENUM_SEARCH_FILE:
+	case PK_ROLE_ENUM_SEARCH_GROUP:
+	case PK_ROLE_ENUM_SEARCH_NAME:
+	case PK_ROLE_ENUM_WHAT_PROVIDES:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static DnfSackLease
+pk_backend_dnf_role_get_sack_lease (PkRoleEnum role)
+{
+	switch (role) {
+	case PK_ROLE_ENUM_GET_DETAILS_LOCAL:
+	case PK_ROLE_ENUM_GET_FILES_LOCAL:
+	case PK_ROLE_ENUM_INSTALL_FILES:
+	case PK_ROLE_ENUM_INSTALL_PACKAGES:
+	case PK_ROLE_ENUM_REMOVE_PACKAGES:
+	case PK_ROLE_ENUM_REPAIR_SYSTEM:
+	case PK_ROLE_ENUM_REPO_REMOVE:
+	case PK_ROLE_ENUM_UPDATE_PACKAGES:
+	case PK_ROLE_ENUM_UPGRADE_SYSTEM:
+		/* adds command line packages or runs a transaction */
+		return DNF_SACK_LEASE_PRIVATE;
+	default:
+		return DNF_SACK_LEASE_POOLED;
+	}
+}
+
+#ifdef HAVE_HY_QUERY_GET_ADVISORY_PKGS
+static DnfAdvisoryIndex *
+pk_backend_dnf_advisory_index_new (DnfSack *sack)
+{
+	DnfAdvisoryIndex *index;
+	GPtrArray *advisory_pkgs;
+	HyQuery query;
+	guint ii;
+
+	query = hy_query_create (sack);
+	advisory_pkgs = hy_query_get_advisory_pkgs (query, HY_EQ);
+	hy_query_free (query);
+
+	/* the advisory packages own the strings of the keys */
+	index = dnf_advisory_index_new (advisory_pkgs, advisory_pkgs->len,
+					(GDestroyNotify) dnf_advisory_free);
+	for (ii = 0; ii < advisory_pkgs->len; ii++) {
+		DnfAdvisoryPkg *advpkg = g_ptr_array_index (advisory_pkgs, ii);
+		dnf_advisory_index_insert (index,
+					   dnf_advisorypkg_get_name (advpkg),
+					   dnf_advisorypkg_get_evr (advpkg),
+					   dnf_advisorypkg_get_arch (advpkg),
+					   dnf_advisorypkg_get_advisory (advpkg));
+	}
+	return index;
+}
+#endif
+
+static DnfSackCacheItem *
+dnf_sack_cache_item_new (const gchar *key, DnfSackAddFlags flags, DnfSack *sack)
+{
+	DnfSackCacheItem *cache_item = g_slice_new0 (DnfSackCacheItem);
+	cache_item->key = g_strdup (key);
+	cache_item->flags = flags;
+	cache_item->sack = g_object_ref (sack);
+	cache_item->timer = g_timer_new ();
+	cache_item->refcount = 1;
+	g_mutex_init (&cache_item->lock);
+	g_mutex_init (&cache_item->advisories_mutex);
+	return cache_item;
+}
+
+static DnfSackCacheItem *
+dnf_sack_cache_item_ref (DnfSackCacheItem *cache_item)
+{
+	g_atomic_int_inc (&cache_item->refcount);
+	return cache_item;
+}
+
+static void
+dnf_sack_cache_item_unref (DnfSackCacheItem *cache_item)
+{
+	if (!g_atomic_int_dec_and_test (&cache_item->refcount))
+		return;
+	g_clear_pointer (&cache_item->advisories, dnf_advisory_index_unref);
+	g_mutex_clear (&cache_item->advisories_mutex);
+	g_mutex_clear (&cache_item->lock);
+	g_timer_destroy (cache_item->timer);
+	g_object_unref (cache_item->sack);
+	g_free (cache_item->key);
+	g_slice_free (DnfSackCacheItem, cache_item);
 }
 
 static gboolean
@@ -125,25 +293,271 @@ pk_backend_sack_cache_invalidate (PkBackend *backend, const gchar *why)
 	PkBackendDnfPrivate *priv = pk_backend_get_user_data (backend);
 	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->sack_mutex);
 
-	/* remove all cached sacks */
-	g_debug ("removing all dnf sack caches");
+	/* remove all cached sacks, jobs still using one keep their ref */
+	g_debug ("removing all dnf sack caches: %s", why);
 	g_hash_table_remove_all (priv->sack_cache);
+	priv->sack_generation++;
+}
+
+static DnfSack *dnf_utils_create_sack (DnfContext *context,
+				       DnfSackAddFlags flags,
+				       PkBackendJob *job,
+				       DnfState *state,
+				       GError **error);
+
+static gpointer
+pk_backend_sack_rebuild_thread (gpointer user_data)
+{
+	PkBackend *backend = user_data;
+	PkBackendDnfPrivate *priv = pk_backend_get_user_data (backend);
+	/* key : the stale_seq it was rebuilt for */
+	g_autoptr(GHashTable) tried = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	while (!g_cancellable_is_cancelled (priv->sack_rebuild_cancellable)) {
+		DnfSackCacheItem *cache_item = NULL;
+		DnfSackAddFlags flags = DNF_SACK_ADD_FLAG_NONE;
+		GHashTableIter iter;
+		gpointer value;
+		gpointer seq;
+		guint generation;
+		guint stale_seq;
+		g_autofree gchar *key = NULL;
+		g_autoptr(DnfContext) context = NULL;
+		g_autoptr(DnfSack) sack = NULL;
+		g_autoptr(DnfState) state = NULL;
+		g_autoptr(GError) error = NULL;
+
+		/* find the next stale snapshot */
+		g_mutex_lock (&priv->sack_mutex);
+		g_hash_table_iter_init (&iter, priv->sack_cache);
+		while (g_hash_table_iter_next (&iter, NULL, &value)) {
+			DnfSackCacheItem *item = value;
+
+			/* marked again since the last attempt */
+			if (item->stale &&
+			    (!g_hash_table_lookup_extended (tried, item->key, NULL, &seq) ||
+			     GPOINTER_TO_UINT (seq) != item->stale_seq)) {
+				cache_item = item;
+				break;
+			}
+		}
+		if (cache_item == NULL || priv->context == NULL) {
+			priv->sack_rebuild_running = FALSE;
+			g_mutex_unlock (&priv->sack_mutex);
+			break;
+		}
+		key = g_strdup (cache_item->key);
+		flags = cache_item->flags;
+		generation = priv->sack_generation;
+		stale_seq = cache_item->stale_seq;
+		context = g_object_ref (priv->context);
+		g_hash_table_insert (tried, g_strdup (key), GUINT_TO_POINTER (stale_seq));
+		g_mutex_unlock (&priv->sack_mutex);
+
+		/* only uses the metadata already on disk */
+		g_debug ("rebuilding stale sack %s", key);
+		state = dnf_state_new ();
+		dnf_state_set_cancellable (state, priv->sack_rebuild_cancellable);
+		g_rec_mutex_lock (&priv->sack_build_mutex);
+		sack = dnf_utils_create_sack (context, flags, NULL, state, &error);
+		g_rec_mutex_unlock (&priv->sack_build_mutex);
+		if (sack == NULL) {
+			g_warning ("failed to rebuild sack %s: %s", key, error->message);
+			continue;
+		}
+
+		/* the stale snapshot keeps serving until this point, and
+		 * keeps being rebuilt if it changed again while loading */
+		g_mutex_lock (&priv->sack_mutex);
+		cache_item = g_hash_table_lookup (priv->sack_cache, key);
+		if (cache_item != NULL && cache_item->stale_seq != stale_seq) {
+			g_debug ("sack %s changed while rebuilding", key);
+		} else if (generation == priv->sack_generation) {
+			g_debug ("replacing stale sack %s", key);
+			g_hash_table_insert (priv->sack_cache, g_strdup (key),
+					     dnf_sack_cache_item_new (key, flags, sack));
+		}
+		g_mutex_unlock (&priv->sack_mutex);
+	}
+	return NULL;
 }
 
 static void
-pk_backend_yum_repos_changed_cb (DnfRepoLoader *repo_loader, PkBackend *backend)
+pk_backend_sack_cache_mark_stale (PkBackend *backend, const gchar *why)
 {
-	pk_backend_sack_cache_invalidate (backend, "yum.repos.d changed");
-	pk_backend_repo_list_changed (backend);
+	PkBackendDnfPrivate *priv = pk_backend_get_user_data (backend);
+	GHashTableIter iter;
+	gpointer value;
+	gboolean any_stale = FALSE;
+	GThread *old_thread;
+
+	g_mutex_lock (&priv->sack_mutex);
+	g_debug ("marking all dnf sack caches stale: %s", why);
+	priv->sack_stale_seq++;
+	g_hash_table_iter_init (&iter, priv->sack_cache);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		DnfSackCacheItem *cache_item = value;
+		cache_item->stale = TRUE;
+		cache_item->stale_seq = priv->sack_stale_seq;
+		any_stale = TRUE;
+	}
+	if (!any_stale || priv->sack_rebuild_running) {
+		g_mutex_unlock (&priv->sack_mutex);
+		return;
+	}
+	old_thread = g_steal_pointer (&priv->sack_rebuild_thread);
+	priv->sack_rebuild_running = TRUE;
+	priv->sack_rebuild_thread = g_thread_new ("PK-DnfSackRebuild",
+						  pk_backend_sack_rebuild_thread,
+						  backend);
+	g_mutex_unlock (&priv->sack_mutex);
+
+	/* the previous worker has already decided to exit */
+	if (old_thread != NULL)
+		g_thread_join (old_thread);
+}
+
+/* the installed packages by the instance of their rpmdb header, which is
+ * only ever reused by rpm --rebuilddb */
+static GHashTable *
+pk_backend_rpmdb_read (const gchar *root)
+{
+	Header h;
+	GHashTable *headers;
+	rpmdbMatchIterator mi;
+	rpmts ts = rpmtsCreate ();
+
+	rpmtsSetRootDir (ts, root);
+	mi = rpmtsInitIterator (ts, RPMDBI_PACKAGES, NULL, 0);
+	if (mi == NULL) {
+		rpmtsFree (ts);
+		return NULL;
+	}
+	headers = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+	while ((h = rpmdbNextIterator (mi)) != NULL) {
+		const gchar *name = headerGetString (h, RPMTAG_NAME);
+		guint64 epoch = headerGetNumber (h, RPMTAG_EPOCH);
+		g_autofree gchar *evr = NULL;
+
+		/* not a package */
+		if (g_strcmp0 (name, "gpg-pubkey") == 0)
+			continue;
+
+		/* the same as dnf_package_get_evr() */
+		if (epoch > 0) {
+			evr = g_strdup_printf ("%" G_GUINT64_FORMAT ":%s-%s", epoch,
+					       headerGetString (h, RPMTAG_VERSION),
+					       headerGetString (h, RPMTAG_RELEASE));
+		} else {
+			evr = g_strdup_printf ("%s-%s",
+					       headerGetString (h, RPMTAG_VERSION),
+					       headerGetString (h, RPMTAG_RELEASE));
+		}
+		g_hash_table_insert (headers,
+				     GUINT_TO_POINTER (headerGetInstance (h)),
+				     pk_package_id_build (name, evr,
+							  headerGetString (h, RPMTAG_ARCH),
+							  "installed"));
+	}
+	rpmdbFreeIterator (mi);
+	rpmtsFree (ts);
+	return headers;
 }
 
 static void
-dnf_sack_cache_item_free (DnfSackCacheItem *cache_item)
+pk_backend_rpmdb_scan_free (PkBackendRpmdbScan *scan)
 {
-	g_timer_destroy (cache_item->timer);
-	g_object_unref (cache_item->sack);
-	g_free (cache_item->key);
-	g_slice_free (DnfSackCacheItem, cache_item);
+	g_free (scan->root);
+	g_free (scan);
+}
+
+static void
+pk_backend_rpmdb_scan_func (gpointer data, gpointer user_data)
+{
+	PkBackend *backend = PK_BACKEND (user_data);
+	PkBackendDnfPrivate *priv = pk_backend_get_user_data (backend);
+	PkBackendRpmdbScan *scan = data;
+	GHashTableIter iter;
+	gpointer key, value;
+	guint n_changes = 0;
+	g_autoptr(GHashTable) headers = NULL;
+	g_autoptr(GHashTable) old_headers = NULL;
+
+	headers = pk_backend_rpmdb_read (scan->root);
+	old_headers = g_steal_pointer (&priv->rpmdb_headers);
+	if (headers != NULL)
+		priv->rpmdb_headers = g_hash_table_ref (headers);
+	if (!scan->report)
+		goto out;
+
+	/* nothing to compare with */
+	if (headers == NULL || old_headers == NULL) {
+		pk_backend_installed_db_changed (backend);
+		goto out;
+	}
+
+	g_hash_table_iter_init (&iter, headers);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		if (!g_hash_table_contains (old_headers, key))
+			n_changes++;
+	}
+	g_hash_table_iter_init (&iter, old_headers);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		if (!g_hash_table_contains (headers, key))
+			n_changes++;
+	}
+	if (n_changes == 0)
+		goto out;
+
+	/* the rpmdb was rebuilt and every header has a new instance */
+	if (n_changes > g_hash_table_size (headers) / 2) {
+		g_debug ("%u rpmdb headers changed, invalidating", n_changes);
+		pk_backend_installed_db_changed (backend);
+		goto out;
+	}
+
+	/* removals first, so a reinstall ends up installed */
+	g_debug ("%u rpmdb headers changed", n_changes);
+	g_hash_table_iter_init (&iter, old_headers);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		if (!g_hash_table_contains (headers, key))
+			pk_backend_installed_db_package_changed (backend, value,
+								 PK_INFO_ENUM_AVAILABLE);
+	}
+	g_hash_table_iter_init (&iter, headers);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		if (!g_hash_table_contains (old_headers, key))
+			pk_backend_installed_db_package_changed (backend, value,
+								 PK_INFO_ENUM_INSTALLED);
+	}
+out:
+	pk_backend_rpmdb_scan_free (scan);
+}
+
+/* diff the rpmdb against the last scan, so the daemon only has to update
+ * the packages that changed rather than throwing all its caches away */
+static void
+pk_backend_rpmdb_scan (PkBackend *backend, gboolean report)
+{
+	PkBackendDnfPrivate *priv = pk_backend_get_user_data (backend);
+	PkBackendRpmdbScan *scan;
+
+	if (priv->context == NULL) {
+		if (report)
+			pk_backend_installed_db_changed (backend);
+		return;
+	}
+	scan = g_new0 (PkBackendRpmdbScan, 1);
+	scan->root = g_strdup (dnf_context_get_install_root (priv->context));
+	scan->report = report;
+	g_thread_pool_push (priv->rpmdb_pool, scan, NULL);
+}
+
+static void
+pk_backend_yum_repos_changed_cb (DnfRepoLoader *repo_loader, PkBackend *backend)
+{
+	pk_backend_sack_cache_mark_stale (backend, "yum.repos.d changed");
+	pk_backend_repo_list_changed (backend);
 }
 
 static void
@@ -151,8 +565,8 @@ pk_backend_context_invalidate_cb (DnfContext *context,
 				 const gchar *message,
 				 PkBackend *backend)
 {
-	pk_backend_sack_cache_invalidate (backend, message);
-	pk_backend_installed_db_changed (backend);
+	pk_backend_sack_cache_mark_stale (backend, message);
+	pk_backend_rpmdb_scan (backend, TRUE);
 }
 
 static void
@@ -229,6 +643,7 @@ pk_backend_ensure_default_dnf_context (PkBackend *backend, GError **error)
 			  G_CALLBACK (pk_backend_context_invalidate_cb), backend);
 	g_signal_connect (dnf_context_get_repo_loader (priv->context), "changed",
 			  G_CALLBACK (pk_backend_yum_repos_changed_cb), backend);
+	pk_backend_rpmdb_scan (backend, FALSE);
 
 	return TRUE;
 }
@@ -269,19 +684,27 @@ pk_backend_initialize (GKeyFile *conf, PkBackend *backend)
 	 *
 	 * notes:
 	 * - this deals with deallocating the sack when the backend is unloaded
-	 * - all the cached sacks are dropped on any transaction that can
-	 *   modify state or if the repos or rpmdb are changed
+	 * - all the cached sacks are dropped after any transaction that can
+	 *   modify state
+	 * - if the repos or rpmdb are changed behind our back the sacks are
+	 *   rebuilt in a thread, and the stale ones are used until then
 	 */
 	g_mutex_init (&priv->sack_mutex);
+	g_rec_mutex_init (&priv->sack_build_mutex);
+	priv->sack_rebuild_cancellable = g_cancellable_new ();
 	priv->sack_cache = g_hash_table_new_full (g_str_hash,
 						  g_str_equal,
 						  g_free,
-						  (GDestroyNotify) dnf_sack_cache_item_free);
+						  (GDestroyNotify) dnf_sack_cache_item_unref);
 
 	priv->sack_expire_id = g_timeout_add_seconds (DNF_SACK_MAX_AGE / 2,
 						      pk_backend_sack_expire,
 						      priv);
 
+	/* what the rpmdb looked like, to tell what changed behind our back */
+	priv->rpmdb_pool = g_thread_pool_new (pk_backend_rpmdb_scan_func,
+					      backend, 1, FALSE, NULL);
+
 	if (!pk_backend_ensure_default_dnf_context (backend, &error))
 		g_warning ("failed to setup context: %s", error->message);
 }
@@ -290,6 +713,18 @@ void
 pk_backend_destroy (PkBackend *backend)
 {
 	PkBackendDnfPrivate *priv = pk_backend_get_user_data (backend);
+
+	/* wait for any sack being rebuilt */
+	g_cancellable_cancel (priv->sack_rebuild_cancellable);
+	if (priv->sack_rebuild_thread != NULL)
+		g_thread_join (priv->sack_rebuild_thread);
+	g_object_unref (priv->sack_rebuild_cancellable);
+
+	/* wait for the queued rpmdb scans */
+	g_thread_pool_free (priv->rpmdb_pool, FALSE, TRUE);
+	if (priv->rpmdb_headers != NULL)
+		g_hash_table_unref (priv->rpmdb_headers);
+
 	if (priv->conf != NULL)
 		g_key_file_unref (priv->conf);
 	if (priv->context != NULL)
@@ -297,8 +732,9 @@ pk_backend_destroy (PkBackend *backend)
 	if (priv->sack_expire_id > 0)
 		g_source_remove (priv->sack_expire_id);
 	g_timer_destroy (priv->repos_timer);
-	g_mutex_clear (&priv->sack_mutex);
 	g_hash_table_unref (priv->sack_cache);
+	g_mutex_clear (&priv->sack_mutex);
+	g_rec_mutex_clear (&priv->sack_build_mutex);
 	g_free (priv->release_ver);
 	g_free (priv);
 }
@@ -478,6 +914,16 @@ void
 pk_backend_stop_job (PkBackend *backend, PkBackendJob *job)
 {
 	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
+	PkRoleEnum role = pk_backend_job_get_role (job);
+	PkBitfield transaction_flags = pk_backend_job_get_transaction_flags (job);
+
+	/* the snapshots are useless once packages or repos have changed */
+	if (!pk_backend_dnf_role_is_read_only (role) &&
+	    role != PK_ROLE_ENUM_REFRESH_CACHE &&
+	    role != PK_ROLE_ENUM_DOWNLOAD_PACKAGES &&
+	    !pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_SIMULATE) &&
+	    !pk_bitfield_contain (transaction_flags, PK_TRANSACTION_FLAG_ENUM_ONLY_DOWNLOAD))
+		pk_backend_sack_cache_invalidate (backend, "transaction finished");
 
 	if (job_data->state != NULL) {
 		dnf_state_release_locks (job_data->state);
@@ -493,15 +939,50 @@ pk_backend_stop_job (PkBackend *backend, PkBackendJob *job)
 	pk_backend_job_set_user_data (job, NULL);
 }
 
+static void dnf_utils_release_sack (PkBackendJob *job);
+
+static void
+pk_backend_dnf_job_thread (PkBackendJob *job, GVariant *params, gpointer user_data)
+{
+	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
+	PkBackendDnfPrivate *priv = pk_backend_get_user_data (job_data->backend);
+	gboolean read_only = pk_backend_dnf_role_is_read_only (pk_backend_job_get_role (job));
+
+	/* jobs that change repos or packages run one at a time, and never
+	 * while a sack is being loaded; queries run in parallel, taking
+	 * turns on the sack they lease */
+	if (!read_only)
+		g_rec_mutex_lock (&priv->sack_build_mutex);
+	job_data->thread_func (job, params, user_data);
+
+	/* the goal references the pool of the leased sack */
+	if (job_data->sack_lease != NULL && job_data->goal != NULL) {
+		hy_goal_free (job_data->goal);
+		job_data->goal = NULL;
+	}
+	dnf_utils_release_sack (job);
+	if (!read_only)
+		g_rec_mutex_unlock (&priv->sack_build_mutex);
+}
+
+static void
+pk_backend_dnf_job_thread_create (PkBackendJob *job, PkBackendJobThreadFunc func)
+{
+	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
+	job_data->thread_func = func;
+	pk_backend_job_thread_create (job, pk_backend_dnf_job_thread, NULL, NULL);
+}
+
 static gboolean
-dnf_utils_add_remote (PkBackendJob *job,
+dnf_utils_add_remote (DnfContext *context,
+		      PkBackendJob *job,
 		      DnfSack *sack,
 		      DnfSackAddFlags flags,
 		      DnfState *state,
 		      GError **error)
 {
-	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
 	gboolean ret;
+	guint cache_age = G_MAXUINT;
 	DnfState *state_local;
 	g_autoptr(GPtrArray) repos = NULL;
 	g_autoptr(GPtrArray) refresh_repos = NULL;
@@ -516,7 +997,7 @@ dnf_utils_add_remote (PkBackendJob *job,
 		return FALSE;
 
 	/* ask the context's repo loader for new repos, forcing it to reload them */
-	repos = dnf_repo_loader_get_repos (dnf_context_get_repo_loader (job_data->context), error);
+	repos = dnf_repo_loader_get_repos (dnf_context_get_repo_loader (context), error);
 	if (repos == NULL)
 		return FALSE;
 
@@ -529,27 +1010,35 @@ dnf_utils_add_remote (PkBackendJob *job,
 	 * repo metadata could expire between the call to dnf_repo_check() at this point, and
 	 * the call to dnf_repo_check() inside dnf_sack_add_repos() - in this case we'll end up
 	 * with stale appstream data until the next metadata refresh.
+	 *
+	 * Sacks rebuilt in the background have no job and only use the
+	 * metadata that is already on disk.
 	 */
-	refresh_repos = pk_backend_find_refresh_repos (job,
-						       state,
-						       repos,
-						       FALSE /* !force */,
-						       error);
-	if (refresh_repos == NULL)
+	if (job != NULL) {
+		cache_age = pk_backend_job_get_cache_age (job);
+		refresh_repos = pk_backend_find_refresh_repos (job,
+							       state,
+							       repos,
+							       FALSE /* !force */,
+							       error);
+		if (refresh_repos == NULL)
+			return FALSE;
+	} else if (!dnf_state_done (state, error)) {
 		return FALSE;
+	}
 
 	/* add each repo */
 	state_local = dnf_state_get_child (state);
 	ret = dnf_sack_add_repos (sack,
 	                          repos,
-	                          pk_backend_job_get_cache_age (job),
+	                          cache_age,
 	                          flags,
 	                          state_local,
 	                          error);
 	if (!ret)
 		return FALSE;
 
-	for (guint i = 0; i < refresh_repos->len; i++) {
+	for (guint i = 0; refresh_repos != NULL && i < refresh_repos->len; i++) {
 		DnfRepo *repo = g_ptr_array_index (refresh_repos, i);
 		if (!dnf_utils_refresh_repo_appstream (repo, error))
 			return FALSE;
@@ -610,6 +1099,163 @@ dnf_utils_real_path (const gchar *path)
 	return real;
 }
 
+static void
+dnf_utils_prepare_sack (DnfSack *sack)
+{
+	HyQuery query;
+	GPtrArray *results;
+
+	/* build the lazily created provides index while loading, rather than
+	 * in the first query of every job that leases the sack */
+	query = hy_query_create (sack);
+	hy_query_filter_provides (query, HY_EQ, "rpmlib(CompressedFileNames)", NULL);
+	results = hy_query_run (query);
+	g_ptr_array_unref (results);
+	hy_query_free (query);
+}
+
+static DnfSack *
+dnf_utils_create_sack (DnfContext *context,
+		       DnfSackAddFlags flags,
+		       PkBackendJob *job,
+		       DnfState *state,
+		       GError **error)
+{
+	gboolean ret;
+	DnfState *state_local;
+	g_autofree gchar *install_root = NULL;
+	g_autofree gchar *solv_dir = NULL;
+	g_autoptr(DnfSack) sack = NULL;
+
+	/* update status */
+	dnf_state_action_start (state, DNF_STATE_ACTION_QUERY, NULL);
+
+	/* set state */
+	if ((flags & DNF_SACK_ADD_FLAG_REMOTE) > 0) {
+		ret = dnf_state_set_steps (state, error,
+					   8, /* add installed */
+					   92, /* add remote */
+					   -1);
+		if (!ret)
+			return NULL;
+	} else {
+		dnf_state_set_number_steps (state, 1);
+	}
+
+	/* create empty sack */
+	solv_dir = dnf_utils_real_path (dnf_context_get_solv_dir (context));
+	install_root = dnf_utils_real_path (dnf_context_get_install_root (context));
+	sack = dnf_sack_new ();
+	dnf_sack_set_cachedir (sack, solv_dir);
+	dnf_sack_set_rootdir (sack, install_root);
+	ret = dnf_sack_setup (sack, DNF_SACK_SETUP_FLAG_MAKE_CACHE_DIR, error);
+	if (!ret) {
+		g_prefix_error (error, "failed to create sack in %s for %s: ",
+				dnf_context_get_solv_dir (context),
+				dnf_context_get_install_root (context));
+		return NULL;
+	}
+
+	/* add installed packages */
+	ret = dnf_sack_load_system_repo (sack, NULL, DNF_SACK_LOAD_FLAG_BUILD_CACHE, error);
+	if (!ret) {
+		g_prefix_error (error, "Failed to load system repo: ");
+		return NULL;
+	}
+
+	/* done */
+	ret = dnf_state_done (state, error);
+	if (!ret)
+		return NULL;
+
+	/* add remote packages */
+	if ((flags & DNF_SACK_ADD_FLAG_REMOTE) > 0) {
+		state_local = dnf_state_get_child (state);
+		ret = dnf_utils_add_remote (context, job, sack, flags,
+					    state_local, error);
+		if (!ret)
+			return NULL;
+
+		/* done */
+		ret = dnf_state_done (state, error);
+		if (!ret)
+			return NULL;
+	}
+
+	dnf_sack_filter_modules (sack, dnf_context_get_repos (context), install_root, NULL);
+	dnf_utils_prepare_sack (sack);
+
+	return g_steal_pointer (&sack);
+}
+
+/* returns a new ref of the pooled sack, and takes the lease for the job */
+static DnfSack *
+dnf_utils_lease_sack (PkBackendJob *job,
+		      const gchar *cache_key,
+		      DnfSackLease lease)
+{
+	PkBackend *backend = pk_backend_job_get_backend (job);
+	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
+	PkBackendDnfPrivate *priv = pk_backend_get_user_data (backend);
+	DnfSackCacheItem *cache_item;
+	DnfSack *sack;
+
+	g_mutex_lock (&priv->sack_mutex);
+	cache_item = g_hash_table_lookup (priv->sack_cache, cache_key);
+	if (cache_item == NULL) {
+		g_mutex_unlock (&priv->sack_mutex);
+		return NULL;
+	}
+
+	/* take an unused snapshot out of the pool, it is going to be
+	 * modified and dropped when the transaction is done */
+	if (lease == DNF_SACK_LEASE_PRIVATE) {
+		if (!g_mutex_trylock (&cache_item->lock)) {
+			g_mutex_unlock (&priv->sack_mutex);
+			g_debug ("not stealing sack %s as it is in use", cache_key);
+			return NULL;
+		}
+		g_debug ("stealing cached sack %s", cache_key);
+		cache_item->stolen = TRUE;
+		sack = g_object_ref (cache_item->sack);
+		g_mutex_unlock (&cache_item->lock);
+		g_hash_table_remove (priv->sack_cache, cache_key);
+		g_mutex_unlock (&priv->sack_mutex);
+		return sack;
+	}
+
+	/* wait for the lock without holding up the pool */
+	dnf_sack_cache_item_ref (cache_item);
+	g_timer_start (cache_item->timer);
+	g_mutex_unlock (&priv->sack_mutex);
+	g_mutex_lock (&cache_item->lock);
+
+	/* a transaction got in first */
+	g_mutex_lock (&priv->sack_mutex);
+	if (cache_item->stolen) {
+		g_mutex_unlock (&priv->sack_mutex);
+		g_mutex_unlock (&cache_item->lock);
+		dnf_sack_cache_item_unref (cache_item);
+		return NULL;
+	}
+	g_mutex_unlock (&priv->sack_mutex);
+
+	g_debug ("using %scached sack %s", cache_item->stale ? "stale " : "", cache_key);
+	job_data->sack_lease = cache_item;
+	return g_object_ref (cache_item->sack);
+}
+
+static void
+dnf_utils_release_sack (PkBackendJob *job)
+{
+	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
+
+	if (job_data->sack_lease == NULL)
+		return;
+	g_mutex_unlock (&job_data->sack_lease->lock);
+	g_clear_pointer (&job_data->sack_lease, dnf_sack_cache_item_unref);
+}
+
 static DnfSack *
 dnf_utils_create_sack_for_filters (PkBackendJob *job,
 				   PkBitfield filters,
@@ -617,16 +1263,14 @@ dnf_utils_create_sack_for_filters (PkBackendJob *job,
 				   DnfState *state,
 				   GError **error)
 {
-	gboolean ret;
 	DnfSackAddFlags flags = DNF_SACK_ADD_FLAG_FILELISTS;
 	DnfSackCacheItem *cache_item = NULL;
-	DnfState *state_local;
+	DnfSackLease lease;
 	PkBackend *backend = pk_backend_job_get_backend (job);
 	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
 	PkBackendDnfPrivate *priv = pk_backend_get_user_data (backend);
+	guint generation;
 	g_autofree gchar *cache_key = NULL;
-	g_autofree gchar *install_root = NULL;
-	g_autofree gchar *solv_dir = NULL;
 	g_autoptr(DnfSack) sack = NULL;
 
 	/* don't add if we're going to filter out anyway */
@@ -668,83 +1312,45 @@ dnf_utils_create_sack_for_filters (PkBackendJob *job,
 		create_flags &= ~DNF_CREATE_SACK_FLAG_USE_CACHE;
 	}
 
+	/* only one lease per job */
+	dnf_utils_release_sack (job);
+
 	/* do we have anything in the cache */
+	lease = pk_backend_dnf_role_get_sack_lease (pk_backend_job_get_role (job));
 	cache_key = dnf_utils_create_cache_key (dnf_context_get_release_ver (job_data->context), flags);
 	if ((create_flags & DNF_CREATE_SACK_FLAG_USE_CACHE) > 0) {
-		g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->sack_mutex);
-		cache_item = g_hash_table_lookup (priv->sack_cache, cache_key);
-		if (cache_item != NULL && cache_item->sack != NULL) {
-			g_debug ("using cached sack %s", cache_key);
-			g_timer_start (cache_item->timer);
-			return g_object_ref (cache_item->sack);
-		}
-	}
-
-	/* update status */
-	dnf_state_action_start (state, DNF_STATE_ACTION_QUERY, NULL);
-
-	/* set state */
-	if ((flags & DNF_SACK_ADD_FLAG_REMOTE) > 0) {
-		ret = dnf_state_set_steps (state, error,
-					   8, /* add installed */
-					   92, /* add remote */
-					   -1);
-		if (!ret)
-			return NULL;
-	} else {
-		dnf_state_set_number_steps (state, 1);
-	}
-
-	/* create empty sack */
-	solv_dir = dnf_utils_real_path (dnf_context_get_solv_dir (job_data->context));
-	install_root = dnf_utils_real_path (dnf_context_get_install_root (job_data->context));
-	sack = dnf_sack_new ();
-	dnf_sack_set_cachedir (sack, solv_dir);
-	dnf_sack_set_rootdir (sack, install_root);
-	ret = dnf_sack_setup (sack, DNF_SACK_SETUP_FLAG_MAKE_CACHE_DIR, error);
-	if (!ret) {
-		g_prefix_error (error, "failed to create sack in %s for %s: ",
-				dnf_context_get_solv_dir (job_data->context),
-				dnf_context_get_install_root (job_data->context));
-		return NULL;
-	}
-
-	/* add installed packages */
-	ret = dnf_sack_load_system_repo (sack, NULL, DNF_SACK_LOAD_FLAG_BUILD_CACHE, error);
-	if (!ret) {
-		g_prefix_error (error, "Failed to load system repo: ");
-		return NULL;
+		sack = dnf_utils_lease_sack (job, cache_key, lease);
+		pk_backend_add_cache_lookup (backend, "dnf-sack", sack != NULL);
+		if (sack != NULL)
+			return g_steal_pointer (&sack);
 	}
 
-	/* done */
-	ret = dnf_state_done (state, error);
-	if (!ret)
+	/* only one sack is loaded at a time */
+	g_mutex_lock (&priv->sack_mutex);
+	generation = priv->sack_generation;
+	g_mutex_unlock (&priv->sack_mutex);
+	g_rec_mutex_lock (&priv->sack_build_mutex);
+	sack = dnf_utils_create_sack (job_data->context, flags, job, state, error);
+	g_rec_mutex_unlock (&priv->sack_build_mutex);
+	if (sack == NULL)
 		return NULL;
 
-	/* add remote packages */
-	if ((flags & DNF_SACK_ADD_FLAG_REMOTE) > 0) {
-		state_local = dnf_state_get_child (state);
-		ret = dnf_utils_add_remote (job, sack, flags,
-					    state_local, error);
-		if (!ret)
-			return NULL;
-
-		/* done */
-		ret = dnf_state_done (state, error);
-		if (!ret)
-			return NULL;
-	}
+	/* a private sack is never shared with other jobs */
+	if (lease == DNF_SACK_LEASE_PRIVATE)
+		return g_steal_pointer (&sack);
 
-	dnf_sack_filter_modules (sack, dnf_context_get_repos (job_data->context), install_root, NULL);
+	/* take the lease before other jobs can see the new snapshot */
+	cache_item = dnf_sack_cache_item_new (cache_key, flags, sack);
+	g_mutex_lock (&cache_item->lock);
+	job_data->sack_lease = cache_item;
 
-	/* save in cache */
+	/* save in cache, unless the rpmdb changed while loading */
 	g_mutex_lock (&priv->sack_mutex);
-	cache_item = g_slice_new (DnfSackCacheItem);
-	cache_item->key = g_strdup (cache_key);
-	cache_item->sack = g_object_ref (sack);
-	cache_item->timer = g_timer_new ();
-	g_debug ("created cached sack %s", cache_item->key);
-	g_hash_table_insert (priv->sack_cache, g_strdup (cache_key), cache_item);
+	if (generation == priv->sack_generation) {
+		g_debug ("created cached sack %s", cache_item->key);
+		g_hash_table_insert (priv->sack_cache, g_strdup (cache_key),
+				     dnf_sack_cache_item_ref (cache_item));
+	}
 	g_mutex_unlock (&priv->sack_mutex);
 
 	return g_steal_pointer (&sack);
@@ -878,54 +1484,50 @@ pk_backend_what_provides_decompose (gchar **values, GError **error)
 	return (gchar **) g_ptr_array_free (array, FALSE);
 }
 
-static GHashTable *
-pk_backend_dnf_cache_advisories (DnfSack *sack)
+/* returns the advisory index of the leased snapshot, building it the first
+ * time any job asks; private sacks get a throwaway index */
+static DnfAdvisoryIndex *
+pk_backend_dnf_cache_advisories (PkBackendJob *job, DnfSack *sack)
 {
 #ifdef HAVE_HY_QUERY_GET_ADVISORY_PKGS
-	g_autoptr(GPtrArray) array = NULL;
-	GHashTable *hash;
-	HyQuery query;
-	guint ii;
-
-	hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) dnf_advisory_free);
-	query = hy_query_create (sack);
-	array = hy_query_get_advisory_pkgs (query, HY_EQ);
-
-	for (ii = 0; ii < array->len; ii++) {
-		DnfAdvisoryPkg *advpkg = g_ptr_array_index (array, ii);
-		gchar *id;
-
-		id = g_strdup_printf ("%s;%s;%s",
-			dnf_advisorypkg_get_name (advpkg),
-			dnf_advisorypkg_get_evr (advpkg),
-			dnf_advisorypkg_get_arch (advpkg));
+	DnfAdvisoryIndex *index;
+	DnfSackCacheItem *cache_item;
+	PkBackend *backend = pk_backend_job_get_backend (job);
+	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
 
-		g_hash_table_insert (hash, id, dnf_advisorypkg_get_advisory (advpkg));
+	cache_item = job_data->sack_lease;
+	if (cache_item == NULL || cache_item->sack != sack) {
+		pk_backend_add_cache_lookup (backend, "dnf-advisories", FALSE);
+		return pk_backend_dnf_advisory_index_new (sack);
 	}
 
-	hy_query_free (query);
-	return hash;
+	g_mutex_lock (&cache_item->advisories_mutex);
+	pk_backend_add_cache_lookup (backend, "dnf-advisories",
+				     cache_item->advisories != NULL);
+	if (cache_item->advisories == NULL)
+		cache_item->advisories = pk_backend_dnf_advisory_index_new (sack);
+	else
+		g_debug ("reusing advisory index for %s", cache_item->key);
+	index = dnf_advisory_index_ref (cache_item->advisories);
+	g_mutex_unlock (&cache_item->advisories_mutex);
+	return index;
 #else
 	return NULL;
 #endif
 }
 
 static DnfAdvisory *
-pk_backend_dnf_get_advisory (GHashTable *advisories_hash,
+pk_backend_dnf_get_advisory (DnfAdvisoryIndex *advisories,
 			     DnfPackage *pkg)
 {
 #ifdef HAVE_HY_QUERY_GET_ADVISORY_PKGS
-	g_autofree gchar *id = NULL;
-
 	if (pkg == NULL)
 		return NULL;
 
-	id = g_strdup_printf ("%s;%s;%s",
-		dnf_package_get_name (pkg),
-		dnf_package_get_evr (pkg),
-		dnf_package_get_arch (pkg));
-
-	return g_hash_table_lookup (advisories_hash, id);
+	return dnf_advisory_index_lookup (advisories,
+					  dnf_package_get_name (pkg),
+					  dnf_package_get_evr (pkg),
+					  dnf_package_get_arch (pkg));
 #else
 	GPtrArray *advisorylist;
 	DnfAdvisory *advisory = NULL;
@@ -1105,10 +1707,10 @@ pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 		DnfAdvisory *advisory;
 		DnfAdvisoryKind kind;
 		PkInfoEnum info_enum;
-		g_autoptr(GHashTable) advisories_hash = pk_backend_dnf_cache_advisories (sack);
+		g_autoptr(DnfAdvisoryIndex) advisories = pk_backend_dnf_cache_advisories (job, sack);
 		for (i = 0; i < pkglist->len; i++) {
 			pkg = g_ptr_array_index (pkglist, i);
-			advisory = pk_backend_dnf_get_advisory (advisories_hash, pkg);
+			advisory = pk_backend_dnf_get_advisory (advisories, pkg);
 			if (advisory != NULL) {
 				kind = dnf_advisory_get_kind (advisory);
 				g_object_set_data (G_OBJECT (pkg), PK_DNF_UPDATE_SEVERITY_KEY,
@@ -1152,7 +1754,7 @@ pk_backend_get_packages (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_search_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_search_thread);
 }
 
 void
@@ -1170,7 +1772,7 @@ pk_backend_resolve (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_search_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_search_thread);
 }
 
 void
@@ -1188,7 +1790,7 @@ pk_backend_search_names (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_search_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_search_thread);
 }
 
 void
@@ -1206,7 +1808,7 @@ pk_backend_search_details (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_search_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_search_thread);
 }
 
 void
@@ -1224,7 +1826,7 @@ pk_backend_search_files (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_search_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_search_thread);
 }
 
 void
@@ -1242,7 +1844,7 @@ pk_backend_what_provides (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_search_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_search_thread);
 }
 
 void
@@ -1259,7 +1861,7 @@ pk_backend_get_updates (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_search_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_search_thread);
 }
 
 /* Obviously hardcoded based on the repository ID labels.
@@ -1323,6 +1925,7 @@ pk_backend_get_repo_list_thread (PkBackendJob *job,
 	PkBitfield filters;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GPtrArray) repos = NULL;
+	g_autoptr(GPtrArray) repo_details = NULL;
 
 	g_variant_get (params, "(t)", &filters);
 
@@ -1338,18 +1941,25 @@ pk_backend_get_repo_list_thread (PkBackendJob *job,
 		return;
 	}
 
-	/* emit each repo */
+	/* emit all the repos together */
+	repo_details = g_ptr_array_new_with_free_func (g_object_unref);
 	for (i = 0; i < repos->len; i++) {
 		g_autofree gchar *description = NULL;
+		PkRepoDetail *item;
 		repo = g_ptr_array_index (repos, i);
 		if (!pk_backend_repo_filter (repo, filters))
 			continue;
 		description = dnf_repo_get_description (repo);
 		enabled = (dnf_repo_get_enabled (repo) & DNF_REPO_ENABLED_PACKAGES) > 0;
-		pk_backend_job_repo_detail (job,
-					    dnf_repo_get_id (repo),
-					    description, enabled);
+		item = pk_repo_detail_new ();
+		g_object_set (item,
+			      "repo-id", dnf_repo_get_id (repo),
+			      "description", description,
+			      "enabled", enabled,
+			      NULL);
+		g_ptr_array_add (repo_details, item);
 	}
+	pk_backend_job_repo_details (job, repo_details);
 }
 
 void
@@ -1366,7 +1976,7 @@ pk_backend_get_repo_list (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_get_repo_list_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_get_repo_list_thread);
 }
 
 static void
@@ -1485,7 +2095,7 @@ pk_backend_repo_set_data (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_repo_set_data_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_repo_set_data_thread);
 }
 
 void
@@ -1503,7 +2113,7 @@ pk_backend_repo_enable (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_repo_set_data_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_repo_set_data_thread);
 }
 
 PkBitfield
@@ -1548,7 +2158,7 @@ pk_backend_refresh_subman (PkBackendJob *job)
 		return;
 	}
 
-	pk_backend_sack_cache_invalidate (backend, "subscription-manager ran");
+	pk_backend_sack_cache_mark_stale (backend, "subscription-manager ran");
 	pk_backend_repo_list_changed (backend);
 }
 
@@ -1720,8 +2330,8 @@ pk_backend_refresh_cache_thread (PkBackendJob *job,
 		return;
 	}
 
-	/* invalidate the sack cache after downloading new metadata */
-	pk_backend_sack_cache_invalidate (backend, "downloaded new metadata");
+	/* rebuild the sack cache after downloading new metadata */
+	pk_backend_sack_cache_mark_stale (backend, "downloaded new metadata");
 
 	/* We just downloaded our cache, avoid doing so again */
 	pk_backend_job_set_cache_age(job, G_MAXUINT);
@@ -1758,7 +2368,7 @@ pk_backend_refresh_cache (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_refresh_cache_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_refresh_cache_thread);
 }
 
 /**
@@ -1853,6 +2463,7 @@ backend_get_details_thread (PkBackendJob *job, GVariant *params, gpointer user_d
 	g_autoptr(DnfSack) sack = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GHashTable) hash = NULL;
+	g_autoptr(GPtrArray) details = NULL;
 
 	g_variant_get (params, "(^a&s)", &package_ids);
 
@@ -1897,8 +2508,10 @@ backend_get_details_thread (PkBackendJob *job, GVariant *params, gpointer user_d
 	}
 
 	/* emit details */
+	details = g_ptr_array_new_with_free_func (g_object_unref);
 	for (i = 0; package_ids[i] != NULL; i++) {
 		guint64 download_size;
+		PkDetails *item;
 		pkg = g_hash_table_lookup (hash, package_ids[i]);
 		if (pkg == NULL)
 			continue;
@@ -1924,16 +2537,20 @@ backend_get_details_thread (PkBackendJob *job, GVariant *params, gpointer user_d
 			}
 		}
 
-		pk_backend_job_details_full (job,
-					     package_ids[i],
-					     dnf_package_get_summary (pkg),
-					     dnf_package_get_license (pkg),
-					     PK_GROUP_ENUM_UNKNOWN,
-					     dnf_package_get_description (pkg),
-					     dnf_package_get_url (pkg),
-					     (gulong) dnf_package_get_installsize (pkg),
-					     download_size);
+		item = pk_details_new ();
+		g_object_set (item,
+			      "package-id", package_ids[i],
+			      "summary", dnf_package_get_summary (pkg),
+			      "license", dnf_package_get_license (pkg),
+			      "group", PK_GROUP_ENUM_UNKNOWN,
+			      "description", dnf_package_get_description (pkg),
+			      "url", dnf_package_get_url (pkg),
+			      "size", dnf_package_get_installsize (pkg),
+			      "download-size", download_size,
+			      NULL);
+		g_ptr_array_add (details, item);
 	}
+	pk_backend_job_details_list (job, details);
 
 	/* done */
 	if (!dnf_state_done (job_data->state, &error)) {
@@ -1954,7 +2571,7 @@ pk_backend_get_details (PkBackend *backend, PkBackendJob *job, gchar **package_i
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, backend_get_details_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, backend_get_details_thread);
 }
 
 static void
@@ -2044,7 +2661,7 @@ pk_backend_get_details_local (PkBackend *backend, PkBackendJob *job, gchar **pac
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, backend_get_details_local_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, backend_get_details_local_thread);
 }
 
 static void
@@ -2129,7 +2746,7 @@ pk_backend_get_files_local (PkBackend *backend, PkBackendJob *job, gchar **files
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, backend_get_files_local_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, backend_get_files_local_thread);
 }
 
 static void
@@ -2285,7 +2902,7 @@ pk_backend_download_packages (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_download_packages_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_download_packages_thread);
 }
 
 void
@@ -2843,7 +3460,7 @@ pk_backend_repo_remove (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_repo_remove_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_repo_remove_thread);
 }
 
 static gboolean
@@ -3020,7 +3637,7 @@ pk_backend_remove_packages (PkBackend *backend, PkBackendJob *job,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_remove_packages_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_remove_packages_thread);
 }
 
 static void
@@ -3209,7 +3826,7 @@ pk_backend_install_packages (PkBackend *backend, PkBackendJob *job,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_install_packages_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_install_packages_thread);
 }
 
 static void
@@ -3321,7 +3938,7 @@ pk_backend_install_files (PkBackend *backend, PkBackendJob *job,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_install_files_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_install_files_thread);
 }
 
 static void
@@ -3435,7 +4052,7 @@ pk_backend_update_packages (PkBackend *backend, PkBackendJob *job,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_update_packages_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_update_packages_thread);
 }
 
 static void
@@ -3540,7 +4157,7 @@ pk_backend_upgrade_system (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_upgrade_system_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_upgrade_system_thread);
 }
 
 PkBitfield
@@ -3589,10 +4206,12 @@ pk_backend_get_files_thread (PkBackendJob *job, GVariant *params, gpointer user_
 	DnfPackage *pkg;
 	PkBackendDnfJobData *job_data = pk_backend_job_get_user_data (job);
 	PkBitfield filters;
+	PkFiles *item;
 	g_autofree gchar **package_ids = NULL;
 	g_autoptr(DnfSack) sack = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GHashTable) hash = NULL;
+	g_autoptr(GPtrArray) files_list = NULL;
 
 	/* set state */
 	ret = dnf_state_set_steps (job_data->state, NULL,
@@ -3635,7 +4254,8 @@ pk_backend_get_files_thread (PkBackendJob *job, GVariant *params, gpointer user_
 		return;
 	}
 
-	/* emit details */
+	/* emit files */
+	files_list = g_ptr_array_new_with_free_func (g_object_unref);
 	for (i = 0; package_ids[i] != NULL; i++) {
 		pkg = g_hash_table_lookup (hash, package_ids[i]);
 		if (pkg == NULL) {
@@ -3647,6 +4267,7 @@ pk_backend_get_files_thread (PkBackendJob *job, GVariant *params, gpointer user_
 
 		/* sort and list according to name */
 		files_array = dnf_package_get_files (pkg);
+		item = pk_files_new ();
 		if (FALSE) {
 			g_autoptr(GPtrArray) files = NULL;
 			files = g_ptr_array_new ();
@@ -3655,16 +4276,20 @@ pk_backend_get_files_thread (PkBackendJob *job, GVariant *params, gpointer user_
 			g_ptr_array_sort (files,
 					  (GCompareFunc) pk_backend_sort_string_cb);
 			g_ptr_array_add (files, NULL);
-			pk_backend_job_files (job,
-					      package_ids[i],
-					      (gchar **) files->pdata);
+			g_object_set (item,
+				      "package-id", package_ids[i],
+				      "files", (gchar **) files->pdata,
+				      NULL);
 		} else {
-			pk_backend_job_files (job,
-					      package_ids[i],
-					      files_array);
+			g_object_set (item,
+				      "package-id", package_ids[i],
+				      "files", files_array,
+				      NULL);
 		}
+		g_ptr_array_add (files_list, item);
 		g_strfreev (files_array);
 	}
+	pk_backend_job_files_list (job, files_list);
 
 	/* done */
 	if (!dnf_state_done (job_data->state, &error)) {
@@ -3687,7 +4312,7 @@ pk_backend_get_files (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_get_files_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_get_files_thread);
 }
 
 static void
@@ -3706,7 +4331,7 @@ pk_backend_get_update_detail_thread (PkBackendJob *job, GVariant *params, gpoint
 	g_autoptr(DnfSack) sack = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GHashTable) hash = NULL;
-	g_autoptr(GHashTable) advisories_hash = NULL;
+	g_autoptr(DnfAdvisoryIndex) advisories = NULL;
 	g_autoptr(GPtrArray) update_details_array = NULL;
 
 	/* set state */
@@ -3750,7 +4375,7 @@ pk_backend_get_update_detail_thread (PkBackendJob *job, GVariant *params, gpoint
 		return;
 	}
 
-	advisories_hash = pk_backend_dnf_cache_advisories (sack);
+	advisories = pk_backend_dnf_cache_advisories (job, sack);
 	update_details_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 
 	/* Build array of details for each */
@@ -3763,7 +4388,7 @@ pk_backend_get_update_detail_thread (PkBackendJob *job, GVariant *params, gpoint
 		pkg = g_hash_table_lookup (hash, package_ids[i]);
 		if (pkg == NULL)
 			continue;
-		advisory = pk_backend_dnf_get_advisory (advisories_hash, pkg);
+		advisory = pk_backend_dnf_get_advisory (advisories, pkg);
 		if (advisory == NULL)
 			continue;
 
@@ -3848,7 +4473,7 @@ pk_backend_get_update_detail (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_get_update_detail_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_get_update_detail_thread);
 }
 
 static gboolean
@@ -3918,5 +4543,5 @@ pk_backend_repair_system (PkBackend *backend,
 		return;
 	}
 	pk_backend_job_set_context (job, priv->context);
-	pk_backend_job_thread_create (job, pk_backend_repair_system_thread, NULL, NULL);
+	pk_backend_dnf_job_thread_create (job, pk_backend_repair_system_thread);
 }
@@ -0,0 +1,151 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#include "dnf-advisory-index.h"
+
+/* what an updateinfo with this many packages would give us */
+#define PK_DNF_TEST_ADVISORY_PKGS	20000
+#define PK_DNF_TEST_UPDATES		2000
+
+static GPtrArray *
+pk_dnf_test_advisory_strings_new (void)
+{
+	GPtrArray *strings = g_ptr_array_new_with_free_func (g_free);
+
+	for (guint i = 0; i < PK_DNF_TEST_ADVISORY_PKGS; i++) {
+		g_ptr_array_add (strings, g_strdup_printf ("package%u", i / 2));
+		g_ptr_array_add (strings, g_strdup_printf ("1.%u-1.fc40", i % 2));
+		g_ptr_array_add (strings, g_strdup (i % 4 < 2 ? "x86_64" : "noarch"));
+	}
+	return strings;
+}
+
+static DnfAdvisoryIndex *
+pk_dnf_test_advisory_index_new (void)
+{
+	GPtrArray *strings = pk_dnf_test_advisory_strings_new ();
+	DnfAdvisoryIndex *index;
+
+	index = dnf_advisory_index_new (strings, strings->len / 3, g_free);
+	for (guint i = 0; i < strings->len; i += 3) {
+		dnf_advisory_index_insert (index,
+					   g_ptr_array_index (strings, i),
+					   g_ptr_array_index (strings, i + 1),
+					   g_ptr_array_index (strings, i + 2),
+					   g_strdup_printf ("FEDORA-2026-%u", i / 3));
+	}
+	return index;
+}
+
+static guint
+pk_dnf_test_advisory_index_resolve (DnfAdvisoryIndex *index)
+{
+	guint found = 0;
+
+	/* the strings of a DnfPackage are not the ones of the updateinfo */
+	for (guint i = 0; i < PK_DNF_TEST_UPDATES; i++) {
+		g_autofree gchar *name = g_strdup_printf ("package%u", i);
+		g_autofree gchar *evr = g_strdup ("1.1-1.fc40");
+		if (dnf_advisory_index_lookup (index, name, evr, "x86_64") != NULL)
+			found++;
+	}
+	return found;
+}
+
+static void
+pk_dnf_test_advisory_index_func (void)
+{
+	g_autoptr(DnfAdvisoryIndex) index = pk_dnf_test_advisory_index_new ();
+
+	g_assert_cmpuint (dnf_advisory_index_get_size (index), ==, PK_DNF_TEST_ADVISORY_PKGS);
+	g_assert_cmpstr (dnf_advisory_index_lookup (index, "package0", "1.0-1.fc40", "x86_64"),
+			 ==, "FEDORA-2026-0");
+	g_assert_cmpstr (dnf_advisory_index_lookup (index, "package1", "1.1-1.fc40", "noarch"),
+			 ==, "FEDORA-2026-3");
+	g_assert_null (dnf_advisory_index_lookup (index, "package1", "1.1-1.fc40", "x86_64"));
+	g_assert_null (dnf_advisory_index_lookup (index, "package0", "1.2-1.fc40", "x86_64"));
+	g_assert_null (dnf_advisory_index_lookup (index, "package", "1.0-1.fc40", "x86_64"));
+}
+
+static void
+pk_dnf_test_advisory_index_bench_func (void)
+{
+	gdouble elapsed;
+	guint found;
+	g_autoptr(GTimer) timer = g_timer_new ();
+	g_autoptr(DnfAdvisoryIndex) index = NULL;
+
+	/* what GetUpdates did on every call before the index was cached */
+	{
+		g_autoptr(GPtrArray) strings = pk_dnf_test_advisory_strings_new ();
+		g_autoptr(GHashTable) hash = NULL;
+
+		g_timer_reset (timer);
+		hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+		for (guint i = 0; i < strings->len; i += 3) {
+			g_hash_table_insert (hash,
+					     g_strdup_printf ("%s;%s;%s",
+							      (gchar *) g_ptr_array_index (strings, i),
+							      (gchar *) g_ptr_array_index (strings, i + 1),
+							      (gchar *) g_ptr_array_index (strings, i + 2)),
+					     g_strdup_printf ("FEDORA-2026-%u", i / 3));
+		}
+		found = 0;
+		for (guint i = 0; i < PK_DNF_TEST_UPDATES; i++) {
+			g_autofree gchar *key = g_strdup_printf ("package%u;1.1-1.fc40;x86_64", i);
+			if (g_hash_table_lookup (hash, key) != NULL)
+				found++;
+		}
+		elapsed = g_timer_elapsed (timer, NULL);
+		g_assert_cmpuint (found, ==, PK_DNF_TEST_UPDATES / 2);
+		g_test_message ("uncached, %u advisory packages: %.3fms",
+				PK_DNF_TEST_ADVISORY_PKGS, elapsed * 1000);
+	}
+
+	/* the first GetUpdates on a snapshot builds the index */
+	g_timer_reset (timer);
+	index = pk_dnf_test_advisory_index_new ();
+	found = pk_dnf_test_advisory_index_resolve (index);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_assert_cmpuint (found, ==, PK_DNF_TEST_UPDATES / 2);
+	g_test_message ("cold index, %u advisory packages: %.3fms",
+			PK_DNF_TEST_ADVISORY_PKGS, elapsed * 1000);
+
+	/* and the later ones only look up their updates */
+	g_timer_reset (timer);
+	found = pk_dnf_test_advisory_index_resolve (index);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_assert_cmpuint (found, ==, PK_DNF_TEST_UPDATES / 2);
+	g_test_message ("warm index, %u updates: %.3fms",
+			PK_DNF_TEST_UPDATES, elapsed * 1000);
+}
+
+int
+main (int argc, char **argv)
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_func ("/dnf/advisory-index", pk_dnf_test_advisory_index_func);
+	g_test_add_func ("/dnf/advisory-index/bench", pk_dnf_test_advisory_index_bench_func);
+
+	return g_test_run ();
+}
@@ -0,0 +1,259 @@
+/* -*- Mode: C; tab-width: 8; indent-tab-modes: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+#include <regex>
+#include <string.h>
+
+#include "nix-package-index.hh"
+
+#define NIX_PACKAGE_INDEX_MAGIC		"PKNIX"
+#define NIX_PACKAGE_INDEX_VERSION	"1"
+#define NIX_PACKAGE_INDEX_FIELDS	6
+
+/* a search term that is either a plain substring or an extended regex */
+class NixPackageMatcher
+{
+public:
+	explicit NixPackageMatcher (const gchar *value)
+	{
+		literal = strpbrk (value, "^$.[]|()*+?{}\\") == NULL;
+		if (literal)
+			needle = lower (value);
+		else
+			regex = std::regex (value, std::regex::extended | std::regex::icase);
+	}
+
+	bool matches (const std::string & lowerHaystack) const
+	{
+		if (literal)
+			return lowerHaystack.find (needle) != std::string::npos;
+		return std::regex_search (lowerHaystack, regex);
+	}
+
+	static std::string lower (const std::string & str)
+	{
+		std::string result (str);
+		std::transform (result.begin (), result.end (), result.begin (),
+				[] (char c) { return g_ascii_tolower (c); });
+		return result;
+	}
+
+private:
+	bool literal;
+	std::string needle;
+	std::regex regex;
+};
+
+static std::string
+nix_package_index_sanitize (std::string str)
+{
+	std::replace (str.begin (), str.end (), '\n', ' ');
+	std::replace (str.begin (), str.end (), '\t', ' ');
+	return str;
+}
+
+NixPackageIndex::NixPackageIndex (const std::string & fingerprint)
+	: fingerprint (fingerprint)
+{
+}
+
+void
+NixPackageIndex::add (NixPackageEntry && entry)
+{
+	entry.attrPath = nix_package_index_sanitize (std::move (entry.attrPath));
+	entry.pname = nix_package_index_sanitize (std::move (entry.pname));
+	entry.version = nix_package_index_sanitize (std::move (entry.version));
+	entry.system = nix_package_index_sanitize (std::move (entry.system));
+	entry.description = nix_package_index_sanitize (std::move (entry.description));
+	entries.push_back (std::move (entry));
+}
+
+void
+NixPackageIndex::finalize ()
+{
+	lowerPnames.clear ();
+	lowerAttrPaths.clear ();
+	lowerDescriptions.clear ();
+	byName.clear ();
+
+	lowerPnames.reserve (entries.size ());
+	lowerAttrPaths.reserve (entries.size ());
+	lowerDescriptions.reserve (entries.size ());
+	byName.reserve (entries.size () * 2);
+
+	for (size_t i = 0; i < entries.size (); i++) {
+		const auto & entry = entries[i];
+
+		lowerPnames.push_back (NixPackageMatcher::lower (entry.pname));
+		lowerAttrPaths.push_back (NixPackageMatcher::lower (entry.attrPath));
+		lowerDescriptions.push_back (NixPackageMatcher::lower (entry.description));
+
+		byName.emplace (entry.attrPath, i);
+		if (entry.pname != entry.attrPath)
+			byName.emplace (entry.pname, i);
+	}
+}
+
+std::vector<size_t>
+NixPackageIndex::search (PkRoleEnum role, const gchar * const *values) const
+{
+	std::vector<size_t> results;
+
+	/* resolve wants exact names, which the hash answers directly */
+	if (role == PK_ROLE_ENUM_RESOLVE) {
+		for (size_t i = 0; values != NULL && values[i] != NULL; i++) {
+			auto range = byName.equal_range (values[i]);
+			for (auto it = range.first; it != range.second; ++it)
+				results.push_back (it->second);
+		}
+		std::sort (results.begin (), results.end ());
+		results.erase (std::unique (results.begin (), results.end ()), results.end ());
+		return results;
+	}
+
+	std::vector<NixPackageMatcher> matchers;
+	for (size_t i = 0; values != NULL && values[i] != NULL; i++)
+		matchers.emplace_back (values[i]);
+
+	for (size_t i = 0; i < entries.size (); i++) {
+		bool found = true;
+
+		for (const auto & matcher : matchers) {
+			switch (role) {
+			case PK_ROLE_ENUM_SEARCH_NAME:
+				found = matcher.matches (lowerPnames[i]) ||
+					matcher.matches (lowerAttrPaths[i]);
+				break;
+			case PK_ROLE_ENUM_SEARCH_DETAILS:
+				found = matcher.matches (lowerDescriptions[i]);
+				break;
+			default:
+				break;
+			}
+			if (!found)
+				break;
+		}
+
+		if (found)
+			results.push_back (i);
+	}
+
+	return results;
+}
+
+bool
+NixPackageIndex::save (const std::string & filename, GError **error) const
+{
+	std::string data;
+
+	data += NIX_PACKAGE_INDEX_MAGIC "\t" NIX_PACKAGE_INDEX_VERSION "\t";
+	data += fingerprint;
+	data += '\n';
+
+	for (const auto & entry : entries) {
+		data += entry.attrPath;
+		data += '\t';
+		data += entry.pname;
+		data += '\t';
+		data += entry.version;
+		data += '\t';
+		data += entry.system;
+		data += '\t';
+		data += entry.supported ? '1' : '0';
+		data += '\t';
+		data += entry.description;
+		data += '\n';
+	}
+
+	return g_file_set_contents (filename.c_str (), data.data (), data.size (), error);
+}
+
+std::shared_ptr<NixPackageIndex>
+NixPackageIndex::load (const std::string & filename, const std::string & fingerprint)
+{
+	gchar *contents = NULL;
+	gsize length = 0;
+	g_autoptr(GError) error = NULL;
+
+	if (!g_file_get_contents (filename.c_str (), &contents, &length, &error)) {
+		if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			g_warning ("failed to read %s: %s", filename.c_str (), error->message);
+		return nullptr;
+	}
+
+	auto index = std::make_shared<NixPackageIndex> (fingerprint);
+	std::string header = NIX_PACKAGE_INDEX_MAGIC "\t" NIX_PACKAGE_INDEX_VERSION "\t" + fingerprint;
+	const gchar *end = contents + length;
+	const gchar *line = contents;
+	bool valid = true;
+
+	const gchar *eol = (const gchar *) memchr (line, '\n', end - line);
+	if (eol == NULL || header.compare (0, std::string::npos, line, eol - line) != 0) {
+		g_free (contents);
+		g_debug ("ignoring stale package index %s", filename.c_str ());
+		return nullptr;
+	}
+
+	for (line = eol + 1; line < end; line = eol + 1) {
+		const gchar *fields[NIX_PACKAGE_INDEX_FIELDS + 1];
+		const gchar *p = line;
+		size_t n = 0;
+
+		eol = (const gchar *) memchr (line, '\n', end - line);
+		if (eol == NULL) {
+			valid = false;
+			break;
+		}
+
+		fields[n++] = p;
+		while (n < NIX_PACKAGE_INDEX_FIELDS) {
+			p = (const gchar *) memchr (p, '\t', eol - p);
+			if (p == NULL)
+				break;
+			fields[n++] = ++p;
+		}
+		if (n != NIX_PACKAGE_INDEX_FIELDS) {
+			valid = false;
+			break;
+		}
+		fields[n] = eol + 1;
+
+		NixPackageEntry entry;
+		entry.attrPath.assign (fields[0], fields[1] - fields[0] - 1);
+		entry.pname.assign (fields[1], fields[2] - fields[1] - 1);
+		entry.version.assign (fields[2], fields[3] - fields[2] - 1);
+		entry.system.assign (fields[3], fields[4] - fields[3] - 1);
+		entry.supported = fields[4][0] == '1';
+		entry.description.assign (fields[5], fields[6] - fields[5] - 1);
+		index->entries.push_back (std::move (entry));
+	}
+
+	g_free (contents);
+
+	if (!valid) {
+		g_warning ("package index %s is truncated, rebuilding", filename.c_str ());
+		return nullptr;
+	}
+
+	index->finalize ();
+	return index;
+}
@@ -0,0 +1,77 @@
+/* -*- Mode: C; tab-width: 8; indent-tab-modes: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <pk-backend.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+typedef struct {
+	std::string attrPath;
+	std::string pname;
+	std::string version;
+	std::string system;
+	std::string description;
+	bool supported;
+} NixPackageEntry;
+
+/*
+ * The evaluated contents of legacyPackages.<system> of one locked flake.
+ *
+ * Evaluating the whole package set takes tens of seconds, but its result only
+ * depends on the lock revision, so it is stored on disk under the flake
+ * fingerprint and searched from memory afterwards.
+ */
+class NixPackageIndex
+{
+public:
+	explicit NixPackageIndex (const std::string & fingerprint);
+
+	static std::shared_ptr<NixPackageIndex> load (const std::string & filename,
+						      const std::string & fingerprint);
+	bool save (const std::string & filename, GError **error) const;
+
+	void add (NixPackageEntry && entry);
+	void finalize ();
+
+	const std::string & getFingerprint () const { return fingerprint; }
+	const NixPackageEntry & get (size_t i) const { return entries[i]; }
+	size_t size () const { return entries.size (); }
+
+	/* returns the matching entry indexes, throws std::regex_error */
+	std::vector<size_t> search (PkRoleEnum role, const gchar * const *values) const;
+
+private:
+	std::string fingerprint;
+	std::vector<NixPackageEntry> entries;
+
+	/* lowercase copies so literal terms can be matched with find() */
+	std::vector<std::string> lowerPnames;
+	std::vector<std::string> lowerAttrPaths;
+	std::vector<std::string> lowerDescriptions;
+
+	/* attr path and pname to entry, for resolve */
+	std::unordered_multimap<std::string, size_t> byName;
+};
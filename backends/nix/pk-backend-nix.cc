@@ -35,10 +35,16 @@
 #include <nix/experimental-features.hh>
 #include <nix/installables.hh>
 
+#include <errno.h>
+#include <glib/gstdio.h>
 #include <pwd.h>
+#include <map>
+#include <mutex>
 #include <regex>
+#include <set>
 
 #include "nix-lib-plus.hh"
+#include "nix-package-index.hh"
 
 typedef struct {
 	nix::ref<nix::EvalState> state;
@@ -46,6 +52,15 @@ typedef struct {
 } PkBackendNixPrivate;
 static PkBackendNixPrivate* priv;
 
+/* pname and version of every element of a profile generation */
+typedef std::set<std::pair<std::string, std::string>> NixInstalledSet;
+
+static std::mutex nix_index_mutex;
+static std::shared_ptr<const NixPackageIndex> nix_index;
+
+static std::mutex nix_installed_mutex;
+static std::map<nix::Path, std::pair<nix::Path, NixInstalledSet>> nix_installed_cache;
+
 void
 pk_backend_initialize (GKeyFile* conf, PkBackend* backend)
 {
@@ -69,6 +84,8 @@ pk_backend_initialize (GKeyFile* conf, PkBackend* backend)
 void
 pk_backend_destroy (PkBackend* backend)
 {
+	nix_index.reset ();
+	nix_installed_cache.clear ();
 	g_free (priv);
 }
 
@@ -134,11 +151,17 @@ pk_backend_get_mime_types (PkBackend* backend)
 	return g_strdupv ((gchar **) mime_types);
 }
 
+static std::shared_ptr<nix::flake::LockedFlake>
+nix_lock_flake (nix::EvalState & state, std::string flake)
+{
+	nix::flake::LockFlags lockFlags;
+	return std::make_shared<nix::flake::LockedFlake> (nix::flake::lockFlake (state, nix::parseFlakeRef(flake), lockFlags));
+}
+
 static nix::OrSuggestions<nix::ref<nix::eval_cache::AttrCursor>>
 nix_get_attr_or_suggestions (nix::EvalState & state, std::string flake, std::string attrPath)
 {
-	nix::flake::LockFlags lockFlags;
-	auto lockedFlake = std::make_shared<nix::flake::LockedFlake> (nix::flake::lockFlake (state, nix::parseFlakeRef(flake), lockFlags));
+	auto lockedFlake = nix_lock_flake (state, flake);
 
 	auto evalCache = nix::openEvalCache (state, lockedFlake);
 
@@ -225,64 +248,20 @@ nix_get_user_profile (PkBackendJob* job)
 	return std::string(uid_ent->pw_dir) + "/.nix-profile";
 }
 
-static void
-nix_search_thread (PkBackendJob* job, GVariant* params, gpointer p)
+static std::shared_ptr<NixPackageIndex>
+nix_build_package_index (PkBackendJob* job,
+			 std::shared_ptr<nix::flake::LockedFlake> lockedFlake,
+			 const std::string & fingerprint)
 {
-	const gchar **search;
-	PkBitfield filters;
-
-	PkRoleEnum role = pk_backend_job_get_role (job);
-
-	switch(role) {
-	case PK_ROLE_ENUM_GET_PACKAGES:
-		g_variant_get (params, "(t)", &filters);
-		break;
-	case PK_ROLE_ENUM_SEARCH_NAME:
-	case PK_ROLE_ENUM_SEARCH_DETAILS:
-	case PK_ROLE_ENUM_RESOLVE:
-		g_variant_get (params, "(t^a&s)", &filters, &search);
-		break;
-	default:
-		break;
-	}
-
-	std::string attrPath = "legacyPackages." + nix::settings.thisSystem.get () + ".";
-	auto attrOrSuggestions = nix_get_attr_or_suggestions (*priv->state, priv->defaultFlake, attrPath);
+	std::string system = nix::settings.thisSystem.get ();
+	auto evalCache = nix::openEvalCache (*priv->state, lockedFlake);
+	auto attrOrSuggestions = evalCache->getRoot ()->findAlongAttrPath (nix::parseAttrPath (*priv->state, "legacyPackages." + system));
+	if (!attrOrSuggestions)
+		throw nix::Error ("flake '%s' does not provide legacyPackages.%s", priv->defaultFlake, system);
 	auto cursor = *attrOrSuggestions;
 
-	if (pk_backend_job_is_cancelled (job))
-		return;
-
-	std::vector<std::regex> regexes;
-	if (search)
-		for (; *search != NULL; search++)
-			regexes.push_back (std::regex (*search, std::regex::extended | std::regex::icase));
-
-	nix::DrvInfos installedDrvs;
-
-	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED)
-		|| pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED)) {
-		std::optional<nix::PathSet> oldAllowedPaths = priv->state->allowedPaths;
-		priv->state->allowedPaths = std::nullopt;
-
-		std::string userProfile = nix_get_user_profile (job);
-		if (nix::pathExists (userProfile + "/manifest.nix")) {
-			nix::Value v;
-			priv->state->evalFile (userProfile + "/manifest.nix", v);
-			nix::Bindings & bindings (*priv->state->allocBindings(0));
-			nix::getDerivations (*priv->state, v, "", bindings, installedDrvs, false);
-		}
-
-		std::string defaultProfile = nix::settings.nixStateDir + "/profiles/default";
-		if (nix::pathExists (defaultProfile + "/manifest.nix")) {
-			nix::Value v;
-			priv->state->evalFile (defaultProfile + "/manifest.nix", v);
-			nix::Bindings & bindings (*priv->state->allocBindings(0));
-			nix::getDerivations (*priv->state, v, "", bindings, installedDrvs, false);
-		}
-
-		priv->state->allowedPaths = oldAllowedPaths;
-	}
+	auto index = std::make_shared<NixPackageIndex> (fingerprint);
+	gint64 start = g_get_monotonic_time ();
 
 	int totalDrvs = 0;
 	int foundDrvs = 0;
@@ -290,8 +269,8 @@ nix_search_thread (PkBackendJob* job, GVariant* params, gpointer p)
 	std::function<void(nix::eval_cache::AttrCursor & cursor, const std::vector<nix::Symbol> & attrPath)> visit;
 	visit = [&](nix::eval_cache::AttrCursor & cursor, const std::vector<nix::Symbol> & attrPath) {
 		try {
-		     if (pk_backend_job_is_cancelled (job))
-			     return;
+			if (pk_backend_job_is_cancelled (job))
+				return;
 
 			auto recurse = [&] () {
 				auto attrs = cursor.getAttrs ();
@@ -311,84 +290,20 @@ nix_search_thread (PkBackendJob* job, GVariant* params, gpointer p)
 			if (cursor.isDerivation ()) {
 				foundDrvs++;
 
-				size_t found = 0;
-
 				nix::DrvName name (cursor.getAttr ("name")->getString());
 
 				auto aMeta = cursor.maybeGetAttr ("meta");
 				auto aDescription = aMeta ? aMeta->maybeGetAttr ("description") : NULL;
-
-				auto description = aDescription ? aDescription->getString() : "";
-				std::replace (description.begin (), description.end (), '\n', ' ');
-
-				auto attrPath2 = concatStringsSep (".", priv->state->symbols.resolve(attrPath));
-
-				for (auto & regex : regexes) {
-					switch (role) {
-					case PK_ROLE_ENUM_SEARCH_NAME:
-					case PK_ROLE_ENUM_RESOLVE: {
-						std::smatch nameMatch;
-						std::regex_search (name.name, nameMatch, regex);
-						std::smatch attrMatch;
-						std::regex_search (attrPath2, attrMatch, regex);
-						if (!nameMatch.empty () || !attrMatch.empty())
-							found++;
-						break;
-					}
-					case PK_ROLE_ENUM_SEARCH_DETAILS: {
-						std::smatch descriptionMatch;
-						std::regex_search (description, descriptionMatch, regex);
-						if (!descriptionMatch.empty ())
-							found++;
-						break;
-					}
-					default:
-						found++;
-						break;
-					}
-				}
-
-				if (found == regexes.size () || regexes.empty ()) {
-					bool isInstalled = false;
-					for (auto drv : installedDrvs) {
-						if (nix::DrvName (drv.queryName ()).matches(name)) {
-							isInstalled = true;
-							break;
-						}
-					}
-
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) && isInstalled)
-						return;
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) && !isInstalled)
-						return;
-
-					auto available = aMeta ? aMeta->maybeGetAttr ("available") : NULL;
-					bool isSupported = available ? available->getBool () : true;
-
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_SUPPORTED) && !isSupported)
-						return;
-					if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_SUPPORTED) && isSupported)
-						return;
-
-					std::string system = cursor.getAttr ("system")->getString();
-
-					PkInfoEnum info = PK_INFO_ENUM_UNKNOWN;
-					if (isSupported)
-						info = PK_INFO_ENUM_AVAILABLE;
-					if (isInstalled)
-						info = PK_INFO_ENUM_INSTALLED;
-
-					if (totalDrvs > 0)
-						pk_backend_job_set_percentage (job, 100 * foundDrvs / totalDrvs);
-
-					pk_backend_job_package (job,
-								info,
-								pk_package_id_build (attrPath2.c_str (),
-										     name.version.c_str (),
-										     system.c_str (),
-										     priv->defaultFlake.c_str ()),
-								description.c_str());
-				}
+				auto available = aMeta ? aMeta->maybeGetAttr ("available") : NULL;
+
+				NixPackageEntry entry;
+				entry.attrPath = concatStringsSep (".", priv->state->symbols.resolve(attrPath));
+				entry.pname = name.name;
+				entry.version = name.version;
+				entry.system = cursor.getAttr ("system")->getString();
+				entry.description = aDescription ? aDescription->getString() : "";
+				entry.supported = available ? available->getBool () : true;
+				index->add (std::move (entry));
 			}
 
 			else if (attrPath.size() == 0)
@@ -401,8 +316,211 @@ nix_search_thread (PkBackendJob* job, GVariant* params, gpointer p)
 			}
 		} catch (nix::EvalError & e) {
 		}
-        };
+	};
 	visit(*cursor, {});
+
+	if (pk_backend_job_is_cancelled (job))
+		return nullptr;
+
+	index->finalize ();
+	g_debug ("evaluated %zu packages of %s in %.1fs",
+		 index->size (), priv->defaultFlake.c_str (),
+		 (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC);
+	return index;
+}
+
+static void
+nix_prune_package_indexes (const gchar* cache_dir, const gchar* keep)
+{
+	const gchar* name;
+	g_autoptr(GDir) dir = g_dir_open (cache_dir, 0, NULL);
+
+	if (dir == NULL)
+		return;
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		g_autofree gchar* path = NULL;
+
+		if (!g_str_has_prefix (name, "packages-") || g_strcmp0 (name, keep) == 0)
+			continue;
+		path = g_build_filename (cache_dir, name, NULL);
+		g_unlink (path);
+	}
+}
+
+/*
+ * Returns the package index of the current lock revision of the default
+ * flake, loading it from disk or evaluating it once if there is none yet.
+ * Returns NULL if the job was cancelled while evaluating.
+ */
+static std::shared_ptr<const NixPackageIndex>
+nix_get_package_index (PkBackendJob* job)
+{
+	auto lockedFlake = nix_lock_flake (*priv->state, priv->defaultFlake);
+	std::string fingerprint = nix::settings.thisSystem.get () + "-" +
+		lockedFlake->getFingerprint ().to_string (nix::Base16, false);
+
+	std::lock_guard<std::mutex> lock (nix_index_mutex);
+	if (nix_index && nix_index->getFingerprint () == fingerprint)
+		return nix_index;
+
+	g_autofree gchar* cache_dir = g_build_filename (LOCALSTATEDIR, "cache", "PackageKit", "nix", NULL);
+	g_autofree gchar* basename = g_strdup_printf ("packages-%s.idx", fingerprint.c_str ());
+	g_autofree gchar* filename = g_build_filename (cache_dir, basename, NULL);
+
+	auto index = NixPackageIndex::load (filename, fingerprint);
+	if (index == nullptr) {
+		g_autoptr(GError) error = NULL;
+
+		pk_backend_job_set_status (job, PK_STATUS_ENUM_GENERATE_PACKAGE_LIST);
+		index = nix_build_package_index (job, lockedFlake, fingerprint);
+		if (index == nullptr)
+			return nullptr;
+
+		if (g_mkdir_with_parents (cache_dir, 0755) != 0) {
+			g_warning ("failed to create %s: %s", cache_dir, g_strerror (errno));
+		} else if (!index->save (filename, &error)) {
+			g_warning ("failed to save package index: %s", error->message);
+		} else {
+			nix_prune_package_indexes (cache_dir, basename);
+		}
+	}
+
+	nix_index = index;
+	return nix_index;
+}
+
+/*
+ * Returns what is installed in the user and default profiles. Every switch
+ * points a profile at a new generation, so the manifest is only evaluated
+ * again when the resolved link has changed.
+ */
+static NixInstalledSet
+nix_get_installed (PkBackendJob* job)
+{
+	NixInstalledSet installed;
+	nix::Path profiles[] = {
+		nix_get_user_profile (job),
+		nix::settings.nixStateDir + "/profiles/default",
+	};
+
+	std::lock_guard<std::mutex> lock (nix_installed_mutex);
+	for (const auto & profile : profiles) {
+		if (!nix::pathExists (profile + "/manifest.nix")) {
+			nix_installed_cache.erase (profile);
+			continue;
+		}
+
+		nix::Path generation = nix::canonPath (profile, true);
+		auto it = nix_installed_cache.find (profile);
+		if (it == nix_installed_cache.end () || it->second.first != generation) {
+			NixInstalledSet elems;
+			nix::DrvInfos drvs;
+
+			std::optional<nix::PathSet> oldAllowedPaths = priv->state->allowedPaths;
+			priv->state->allowedPaths = std::nullopt;
+			try {
+				nix::Value v;
+				priv->state->evalFile (profile + "/manifest.nix", v);
+				nix::Bindings & bindings (*priv->state->allocBindings(0));
+				nix::getDerivations (*priv->state, v, "", bindings, drvs, false);
+			} catch (...) {
+				priv->state->allowedPaths = oldAllowedPaths;
+				throw;
+			}
+			priv->state->allowedPaths = oldAllowedPaths;
+
+			for (auto & drv : drvs) {
+				nix::DrvName name (drv.queryName ());
+				elems.emplace (name.name, name.version);
+			}
+			it = nix_installed_cache.insert_or_assign (profile, std::make_pair (generation, std::move (elems))).first;
+		}
+
+		installed.insert (it->second.second.begin (), it->second.second.end ());
+	}
+
+	return installed;
+}
+
+static void
+nix_search_thread (PkBackendJob* job, GVariant* params, gpointer p)
+{
+	const gchar **search = NULL;
+	PkBitfield filters = 0;
+	std::shared_ptr<const NixPackageIndex> index;
+	NixInstalledSet installedDrvs;
+	std::vector<size_t> matches;
+
+	PkRoleEnum role = pk_backend_job_get_role (job);
+
+	switch(role) {
+	case PK_ROLE_ENUM_GET_PACKAGES:
+		g_variant_get (params, "(t)", &filters);
+		break;
+	case PK_ROLE_ENUM_SEARCH_NAME:
+	case PK_ROLE_ENUM_SEARCH_DETAILS:
+	case PK_ROLE_ENUM_RESOLVE:
+		g_variant_get (params, "(t^a&s)", &filters, &search);
+		break;
+	default:
+		break;
+	}
+
+	try {
+		index = nix_get_package_index (job);
+		if (index == nullptr)
+			return;
+		installedDrvs = nix_get_installed (job);
+		matches = index->search (role, search);
+	} catch (std::regex_error & e) {
+		g_free (search);
+		pk_backend_job_error_code (job,
+					   PK_ERROR_ENUM_UNKNOWN,
+					   "invalid search term: %s", e.what ());
+		return;
+	} catch (nix::Error & e) {
+		g_free (search);
+		pk_backend_job_error_code (job,
+					   PK_ERROR_ENUM_UNKNOWN,
+					   "failed to evaluate packages: %s", e.what ());
+		return;
+	}
+	g_free (search);
+
+	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
+
+	for (size_t i = 0; i < matches.size (); i++) {
+		const NixPackageEntry & entry = index->get (matches[i]);
+		g_autofree gchar* package_id = NULL;
+
+		if (pk_backend_job_is_cancelled (job))
+			return;
+
+		bool isInstalled = installedDrvs.count (std::make_pair (entry.pname, entry.version)) > 0;
+
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) && isInstalled)
+			continue;
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) && !isInstalled)
+			continue;
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_SUPPORTED) && !entry.supported)
+			continue;
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_SUPPORTED) && entry.supported)
+			continue;
+
+		PkInfoEnum info = PK_INFO_ENUM_UNKNOWN;
+		if (entry.supported)
+			info = PK_INFO_ENUM_AVAILABLE;
+		if (isInstalled)
+			info = PK_INFO_ENUM_INSTALLED;
+
+		package_id = pk_package_id_build (entry.attrPath.c_str (),
+						  entry.version.c_str (),
+						  entry.system.c_str (),
+						  priv->defaultFlake.c_str ());
+		pk_backend_job_package (job, info, package_id, entry.description.c_str ());
+	}
+
 	pk_backend_job_set_percentage (job, 100);
 }
 
@@ -436,8 +554,18 @@ pk_backend_resolve(PkBackend* self, PkBackendJob* job, PkBitfield filters, gchar
 static void
 nix_refresh_thread (PkBackendJob* job, GVariant* params, gpointer p)
 {
+	/* relocking with a zero TTL picks up a new nixpkgs revision, and a
+	 * revision that has not been seen before gets its index evaluated */
 	nix::settings.tarballTtl = 0;
-	nix_search_thread (job, params, p);
+	try {
+		nix_get_package_index (job);
+	} catch (nix::Error & e) {
+		nix::settings.tarballTtl = 60 * 60;
+		pk_backend_job_error_code (job,
+					   PK_ERROR_ENUM_UNKNOWN,
+					   "failed to refresh packages: %s", e.what ());
+		return;
+	}
 	nix::settings.tarballTtl = 60 * 60;
 
 	pk_backend_job_set_percentage (job, 100);
@@ -1,5 +1,5 @@
 #include <sqlite3.h>
-#include <stdlib.h>
+#include <string.h>
 #include "dl.h"
 #include "utils.h"
 
@@ -17,7 +17,7 @@ namespace slack {
 GSList *
 Dl::collect_cache_info (const gchar *tmpl) noexcept
 {
-	CURL *curl = NULL;
+	Downloader downloader;
 	GSList *file_list = NULL;
 	GFile *tmp_dir, *repo_tmp_dir;
 
@@ -35,7 +35,8 @@ Dl::collect_cache_info (const gchar *tmpl) noexcept
 	                                  NULL);
 	source_dest[2] = NULL;
 	/* Check if the remote file can be found */
-	if (get_file(&curl, source_dest[0], NULL))
+	downloader.add (source_dest[0], NULL, this->get_max_connections ());
+	if (!downloader.run (NULL))
 	{
 		g_strfreev(source_dest);
 	}
@@ -46,57 +47,75 @@ Dl::collect_cache_info (const gchar *tmpl) noexcept
 	g_object_unref(repo_tmp_dir);
 	g_object_unref(tmp_dir);
 
-	if (curl)
+	return file_list;
+}
+
+/* Splits an index file line into its first fields without copying */
+static guint
+split_fields (const gchar *line, gsize len,
+		const gchar **fields, gsize *lens, guint n_fields)
+{
+	const gchar *colon, *end = line + len;
+	guint n = 0;
+
+	while (n < n_fields)
 	{
-		curl_easy_cleanup(curl);
+		colon = static_cast<const gchar *> (memchr(line, ':', end - line));
+		fields[n] = line;
+		lens[n++] = (colon ? colon : end) - line;
+
+		if (!colon)
+		{
+			break;
+		}
+		line = colon + 1;
 	}
-	return file_list;
+	return n;
 }
 
 /**
  * slack::Dl::generate_cache:
- * @job: A #PkBackendJob.
+ * @db: The database to write to.
  * @tmpl: temporary directory for downloading the files.
  *
- * Download files needed to get the information like the list of packages
- * in available repositories, updates, package descriptions and so on.
- *
- * Returns: List of files needed for building the cache.
+ * Reads the downloaded index file into the package list. The statements
+ * are bound to the mapped file, it isn't copied line by line.
  **/
 void
-Dl::generate_cache(PkBackendJob *job, const gchar *tmpl) noexcept
+Dl::generate_cache (sqlite3 *db, const gchar *tmpl) noexcept
 {
-	gchar **line_tokens, **pkg_tokens, *line, *collection_name = NULL, *list_filename;
-	gboolean skip = FALSE;
-	GFile *list_file;
-	GFileInputStream *fin;
-	GDataInputStream *data_in = NULL;
+	const gchar *contents, *end, *pos, *line, *fields[7], *collection_name = NULL;
+	gsize len, lens[7], collection_name_len = 0;
+	gchar *list_filename;
+	GMappedFile *list_file;
+	PackageName pkg;
 	sqlite3_stmt *stmt = NULL;
-	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
 	/* Check if the temporary directory for this repository exists. If so the file metadata have to be generated */
 	list_filename = g_build_filename(tmpl,
 	                                 this->get_name (),
 	                                 "IndexFile",
 	                                 NULL);
-	list_file = g_file_new_for_path(list_filename);
-	if (!(fin = g_file_read(list_file, NULL, NULL)))
+	list_file = g_mapped_file_new(list_filename, FALSE, NULL);
+	g_free(list_filename);
+	if (!list_file)
 	{
-		goto out;
+		return;
 	}
-	data_in = g_data_input_stream_new(G_INPUT_STREAM(fin));
+	contents = g_mapped_file_get_contents(list_file);
+	end = contents + g_mapped_file_get_length(list_file);
 
 	/* Remove the old entries from this repository */
-	if (sqlite3_prepare_v2(job_data->db,
-						   "DELETE FROM repos WHERE repo LIKE @repo",
+	if (sqlite3_prepare_v2(db,
+						   "DELETE FROM repos WHERE repo = @repo",
 						   -1,
 						   &stmt,
 						   NULL) == SQLITE_OK) {
-		sqlite3_bind_text(stmt, 1, this->get_name (), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_text(stmt, 1, this->get_name (), -1, SQLITE_STATIC);
 		sqlite3_step(stmt);
 		sqlite3_finalize(stmt);
 	}
-	if (sqlite3_prepare_v2(job_data->db,
+	if (sqlite3_prepare_v2(db,
 	                       "INSERT INTO repos (repo_order, repo) VALUES (@repo_order, @repo)",
 	                       -1,
 	                       &stmt,
@@ -105,15 +124,16 @@ Dl::generate_cache(PkBackendJob *job, const gchar *tmpl) noexcept
 		goto out;
 	}
 	sqlite3_bind_int(stmt, 1, this->get_order ());
-	sqlite3_bind_text(stmt, 2, this->get_name (), -1, SQLITE_TRANSIENT);
+	sqlite3_bind_text(stmt, 2, this->get_name (), -1, SQLITE_STATIC);
 	sqlite3_step(stmt);
 	if (sqlite3_finalize(stmt) != SQLITE_OK)
 	{
+		stmt = NULL;
 		goto out;
 	}
 
 	/* Insert new records */
-	if ((sqlite3_prepare_v2(job_data->db,
+	if ((sqlite3_prepare_v2(db,
 	                        "INSERT INTO pkglist (full_name, name, ver, arch, "
 	                        "summary, desc, compressed, uncompressed, cat, repo_order, ext) "
 	                        "VALUES (@full_name, @name, @ver, @arch, @summary, "
@@ -124,116 +144,93 @@ Dl::generate_cache(PkBackendJob *job, const gchar *tmpl) noexcept
 	{
 		goto out;
 	}
-	sqlite3_exec(job_data->db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+	sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, NULL);
 
-	while ((line = g_data_input_stream_read_line(data_in, NULL, NULL, NULL)))
+	for (pos = contents; next_line(&pos, end, &line, &len); )
 	{
-		line_tokens = g_strsplit(line, ":", 0);
-		if ((g_strv_length(line_tokens) > 6)
-		 && !this->is_blacklisted (line_tokens[0]))
+		if ((split_fields(line, len, fields, lens, 7) < 7)
+		 || this->is_blacklisted (fields[0], lens[0])
+		 || !parse_package_name(fields[0], lens[0], &pkg))
 		{
-			pkg_tokens = split_package_name(line_tokens[0]);
+			continue;
+		}
 
-			/* If the split_package_name doesn't return a full name and an
-			 * extension, it is a collection. We save its name in this case */
-			if (pkg_tokens[3])
-			{
-				sqlite3_bind_text(stmt, 1, pkg_tokens[3], -1, SQLITE_TRANSIENT);
-				sqlite3_bind_text(stmt, 9, "desktop-gnome", -1, SQLITE_STATIC);
-				if (g_strcmp0(line_tokens[1], "obsolete"))
-				{
-					sqlite3_bind_text(stmt, 11, pkg_tokens[4], -1, SQLITE_TRANSIENT);
-				}
-				else
-				{
-					sqlite3_bind_text(stmt, 11, "obsolete", -1, SQLITE_STATIC);
-				}
-			}
-			else if (!collection_name)
-			{
-				collection_name = g_strdup(pkg_tokens[0]);
-				sqlite3_bind_text(stmt, 1, line_tokens[0], -1, SQLITE_TRANSIENT);
-				sqlite3_bind_text(stmt, 9, "collections", -1, SQLITE_STATIC);
-				sqlite3_bind_null(stmt, 11);
-			}
-			else
-			{
-				skip = TRUE; /* Skip other candidates for collections */
-			}
-			if (skip)
+		/* If the package name has no extension, it is a collection.
+		 * We save the name of the first one */
+		if (pkg.full_name)
+		{
+			sqlite3_bind_text(stmt, 1, pkg.full_name, pkg.full_name_len, SQLITE_STATIC);
+			sqlite3_bind_text(stmt, 9, "desktop-gnome", -1, SQLITE_STATIC);
+			if (lens[1] == 8 && !strncmp(fields[1], "obsolete", 8))
 			{
-				skip = FALSE;
+				sqlite3_bind_text(stmt, 11, "obsolete", -1, SQLITE_STATIC);
 			}
 			else
 			{
-				sqlite3_bind_text(stmt, 2, pkg_tokens[0], -1, SQLITE_TRANSIENT);
-				sqlite3_bind_text(stmt, 3, pkg_tokens[1], -1, SQLITE_TRANSIENT);
-				sqlite3_bind_text(stmt, 4, pkg_tokens[2], -1, SQLITE_TRANSIENT);
-				sqlite3_bind_text(stmt, 5, line_tokens[2], -1, SQLITE_TRANSIENT);
-				sqlite3_bind_text(stmt, 6, line_tokens[2], -1, SQLITE_TRANSIENT);
-				sqlite3_bind_int(stmt, 7, atoi(line_tokens[5]));
-				sqlite3_bind_int(stmt, 8, atoi(line_tokens[5]));
-				sqlite3_bind_int(stmt, 10, this->get_order ());
-
-				sqlite3_step(stmt);
-				sqlite3_clear_bindings(stmt);
-				sqlite3_reset(stmt);
+				sqlite3_bind_text(stmt, 11, pkg.ext, pkg.ext_len, SQLITE_STATIC);
 			}
-			g_strfreev(pkg_tokens);
 		}
-		g_strfreev(line_tokens);
-		g_free(line);
+		else if (!collection_name)
+		{
+			collection_name = pkg.name;
+			collection_name_len = pkg.name_len;
+			sqlite3_bind_text(stmt, 1, fields[0], lens[0], SQLITE_STATIC);
+			sqlite3_bind_text(stmt, 9, "collections", -1, SQLITE_STATIC);
+			sqlite3_bind_null(stmt, 11);
+		}
+		else
+		{
+			continue; /* Skip other candidates for collections */
+		}
+
+		sqlite3_bind_text(stmt, 2, pkg.name, pkg.name_len, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 3, pkg.ver, pkg.ver_len, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 4, pkg.arch, pkg.arch_len, SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 5, fields[2], lens[2], SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 6, fields[2], lens[2], SQLITE_STATIC);
+		sqlite3_bind_int64(stmt, 7, g_ascii_strtoll(fields[5], NULL, 10));
+		sqlite3_bind_int64(stmt, 8, g_ascii_strtoll(fields[5], NULL, 10));
+		sqlite3_bind_int(stmt, 10, this->get_order ());
+
+		sqlite3_step(stmt);
+		sqlite3_clear_bindings(stmt);
+		sqlite3_reset(stmt);
 	}
+	sqlite3_finalize(stmt);
+	stmt = NULL;
 
 	/* Create a collection entry */
-	if (collection_name && g_seekable_seek(G_SEEKABLE(data_in), 0, G_SEEK_SET, NULL, NULL)
-	 && (sqlite3_prepare_v2(job_data->db,
+	if (collection_name
+	 && (sqlite3_prepare_v2(db,
 	                        "INSERT INTO collections (name, repo_order, collection_pkg) "
 	                        "VALUES (@name, @repo_order, @collection_pkg)",
 	                        -1,
 	                        &stmt,
 	                        NULL) == SQLITE_OK))
 	{
-		while ((line = g_data_input_stream_read_line(data_in, NULL, NULL, NULL)))
+		for (pos = contents; next_line(&pos, end, &line, &len); )
 		{
-			line_tokens = g_strsplit(line, ":", 0);
-			if ((g_strv_length(line_tokens) > 6)
-			 && !this->is_blacklisted (line_tokens[0]))
+			/* Save every package, that isn't a collection itself, as a part of the collection */
+			if ((split_fields(line, len, fields, lens, 7) == 7)
+			 && !this->is_blacklisted (fields[0], lens[0])
+			 && parse_package_name(fields[0], lens[0], &pkg)
+			 && pkg.full_name)
 			{
-				pkg_tokens = split_package_name(line_tokens[0]);
-
-				/* If not a collection itself */
-				if (pkg_tokens[3]) /* Save this package as a part of the collection */
-				{
-					sqlite3_bind_text(stmt, 1, collection_name, -1, SQLITE_TRANSIENT);
-					sqlite3_bind_int(stmt, 2, this->get_order ());
-					sqlite3_bind_text(stmt, 3, pkg_tokens[0], -1, SQLITE_TRANSIENT);
-					sqlite3_step(stmt);
-					sqlite3_clear_bindings(stmt);
-					sqlite3_reset(stmt);
-				}
-				g_strfreev(pkg_tokens);
+				sqlite3_bind_text(stmt, 1, collection_name, collection_name_len, SQLITE_STATIC);
+				sqlite3_bind_int(stmt, 2, this->get_order ());
+				sqlite3_bind_text(stmt, 3, pkg.name, pkg.name_len, SQLITE_STATIC);
+				sqlite3_step(stmt);
+				sqlite3_clear_bindings(stmt);
+				sqlite3_reset(stmt);
 			}
-			g_strfreev(line_tokens);
-			g_free(line);
 		}
-		sqlite3_finalize(stmt);
 	}
-	g_free(collection_name);
 
-	sqlite3_exec(job_data->db, "END TRANSACTION", NULL, NULL, NULL);
+	sqlite3_exec(db, "END TRANSACTION", NULL, NULL, NULL);
 
 out:
-	if (data_in)
-	{
-		g_object_unref(data_in);
-	}
-	if (fin)
-	{
-		g_object_unref(fin);
-	}
-	g_object_unref(list_file);
-	g_free(list_filename);
+	sqlite3_finalize(stmt);
+	g_mapped_file_unref(list_file);
 }
 
 Dl::~Dl () noexcept
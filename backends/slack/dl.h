@@ -13,7 +13,7 @@ public:
 	~Dl () noexcept;
 
 	GSList *collect_cache_info (const gchar *tmpl) noexcept;
-	void generate_cache (PkBackendJob *job, const gchar *tmpl) noexcept;
+	void generate_cache (sqlite3 *db, const gchar *tmpl) noexcept;
 
 private:
 	gchar *index_file;
@@ -0,0 +1,399 @@
+#include <glib/gstdio.h>
+#include <string.h>
+#include "downloader.h"
+
+namespace slack {
+
+/* Scheme and authority of the URL. Transfers to the same one share the
+ * keep-alive connections cached by the multi handle. */
+static gchar *
+url_host (const gchar *url)
+{
+	const gchar *authority = strstr (url, "://");
+	const gchar *path;
+
+	if (authority == NULL)
+	{
+		return g_strdup (url);
+	}
+	path = strchr (authority + 3, '/');
+
+	return path ? g_strndup (url, path - url) : g_strdup (url);
+}
+
+/**
+ * slack::Downloader::add:
+ * @source_url: Source URL.
+ * @dest: Destination file or directory, %NULL to only check that the
+ * remote file exists.
+ * @max_connections: Most connections to open to the host of @source_url.
+ *
+ * Queues a transfer. The file is written to "@dest.part" first and renamed
+ * when complete, so an interrupted download is resumed by the next one.
+ * A server that can't resume sends the whole file again.
+ * Files that already exist are not downloaded again.
+ *
+ * Returns: The transfer, for slack::Downloader::get_result().
+ **/
+guint
+Downloader::add (const gchar *source_url, const gchar *dest,
+		guint max_connections) noexcept
+{
+	auto transfer = g_new0 (Transfer, 1);
+
+	transfer->source_url = g_strdup (source_url);
+	transfer->host = url_host (source_url);
+	transfer->max_connections = MAX (max_connections, 1);
+	transfer->result = CURLE_OK;
+
+	if (dest != NULL)
+	{
+		if (g_file_test (dest, G_FILE_TEST_IS_DIR))
+		{
+			transfer->dest = g_strconcat (dest, g_strrstr (source_url, "/"), NULL);
+		}
+		else
+		{
+			transfer->dest = g_strdup (dest);
+		}
+		transfer->part = g_strconcat (transfer->dest, ".part", NULL);
+		transfer->done = g_file_test (transfer->dest, G_FILE_TEST_EXISTS);
+	}
+	g_ptr_array_add (this->transfers, transfer);
+
+	return this->transfers->len - 1;
+}
+
+/**
+ * slack::Downloader::run:
+ * @job: A #PkBackendJob, or %NULL.
+ * @max_percentage: The percentage of @job when all transfers are done.
+ *
+ * Runs the queued transfers, as many at the same time as their hosts
+ * allow. The percentage and speed of @job are those of all transfers.
+ *
+ * Returns: %TRUE if all transfers succeeded, %FALSE otherwise.
+ **/
+gboolean
+Downloader::run (PkBackendJob *job, guint max_percentage) noexcept
+{
+	CURLMsg *msg;
+	gint running = 0, queued;
+	guint pending;
+	gboolean ret = TRUE;
+	gdouble last_report = 0;
+	curl_off_t last_bytes = 0;
+	GTimer *timer = g_timer_new ();
+
+	do
+	{
+		/* Use the free connections of every host */
+		pending = 0;
+		for (guint i = 0; i < this->transfers->len; i++)
+		{
+			auto transfer = static_cast<Transfer *> (g_ptr_array_index (this->transfers, i));
+
+			if (!transfer->started && !transfer->done &&
+				GPOINTER_TO_UINT (g_hash_table_lookup (this->connections, transfer->host))
+					< transfer->max_connections)
+			{
+				this->start (transfer);
+			}
+			if (!transfer->done)
+			{
+				pending++;
+			}
+		}
+
+		if (curl_multi_perform (this->multi, &running) != CURLM_OK)
+		{
+			break;
+		}
+		while ((msg = curl_multi_info_read (this->multi, &queued)))
+		{
+			char *data;
+			Transfer *transfer;
+
+			if (msg->msg != CURLMSG_DONE)
+			{
+				continue;
+			}
+			curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, &data);
+			transfer = static_cast<Transfer *> (static_cast<void *> (data));
+			this->finish (transfer, msg->data.result);
+			if (transfer->done)
+			{
+				pending--;
+			}
+		}
+
+		if (job != NULL && pk_backend_job_is_cancelled (job))
+		{
+			break;
+		}
+
+		/* Aggregate the progress of all transfers */
+		if (job != NULL && (g_timer_elapsed (timer, NULL) - last_report >= 0.25 || pending == 0))
+		{
+			gdouble fraction = 0, elapsed = g_timer_elapsed (timer, NULL);
+			curl_off_t bytes = 0;
+
+			for (guint i = 0; i < this->transfers->len; i++)
+			{
+				auto transfer = static_cast<Transfer *> (g_ptr_array_index (this->transfers, i));
+
+				if (transfer->done)
+				{
+					fraction += 1;
+				}
+				else if (transfer->total > 0)
+				{
+					fraction += (gdouble) transfer->now / transfer->total;
+				}
+				bytes += transfer->now;
+			}
+			pk_backend_job_set_percentage (job,
+					fraction / this->transfers->len * max_percentage);
+			if (elapsed > last_report)
+			{
+				pk_backend_job_set_speed (job,
+						(bytes - last_bytes) * 8 / (elapsed - last_report));
+			}
+			last_bytes = bytes;
+			last_report = elapsed;
+		}
+
+		if (pending > 0 && running > 0)
+		{
+			curl_multi_wait (this->multi, NULL, 0, 250, NULL);
+		}
+	}
+	while (pending > 0);
+
+	/* Cancelled, or the multi handle failed */
+	for (guint i = 0; i < this->transfers->len; i++)
+	{
+		auto transfer = static_cast<Transfer *> (g_ptr_array_index (this->transfers, i));
+
+		if (transfer->started && !transfer->done)
+		{
+			this->finish (transfer, CURLE_ABORTED_BY_CALLBACK);
+		}
+		else if (!transfer->done)
+		{
+			transfer->result = CURLE_ABORTED_BY_CALLBACK;
+			transfer->done = TRUE;
+		}
+		if (transfer->result != CURLE_OK)
+		{
+			ret = FALSE;
+		}
+	}
+	if (job != NULL)
+	{
+		pk_backend_job_set_speed (job, 0);
+	}
+	g_timer_destroy (timer);
+
+	return ret;
+}
+
+/**
+ * slack::Downloader::get_result:
+ * @transfer: A transfer returned by slack::Downloader::add().
+ *
+ * Returns: CURLE_OK (zero) if the file was downloaded or exists,
+ *          CURLE_REMOTE_FILE_NOT_FOUND if it could not be found.
+ **/
+CURLcode
+Downloader::get_result (guint transfer) const noexcept
+{
+	g_return_val_if_fail (transfer < this->transfers->len, CURLE_BAD_FUNCTION_ARGUMENT);
+
+	return static_cast<Transfer *> (g_ptr_array_index (this->transfers, transfer))->result;
+}
+
+void
+Downloader::start (Transfer *transfer) noexcept
+{
+	GStatBuf st;
+	CURL *curl;
+	guint connections;
+
+	transfer->started = TRUE;
+
+	/* Easy handles are reused, the connections live in the multi handle */
+	if (this->handles != NULL)
+	{
+		curl = static_cast<CURL *> (this->handles->data);
+		this->handles = g_slist_delete_link (this->handles, this->handles);
+	}
+	else if (!(curl = curl_easy_init ()))
+	{
+		transfer->result = CURLE_FAILED_INIT;
+		transfer->done = TRUE;
+		return;
+	}
+
+	if (transfer->dest == NULL)
+	{
+		curl_easy_setopt (curl, CURLOPT_NOBODY, 1L);
+	}
+	else
+	{
+		if (g_stat (transfer->part, &st) == 0)
+		{
+			transfer->offset = st.st_size;
+		}
+		if ((transfer->fout = fopen (transfer->part, "ab")) == NULL)
+		{
+			this->handles = g_slist_prepend (this->handles, curl);
+			transfer->result = CURLE_WRITE_ERROR;
+			transfer->done = TRUE;
+			return;
+		}
+		curl_easy_setopt (curl, CURLOPT_WRITEFUNCTION, write_cb);
+		curl_easy_setopt (curl, CURLOPT_WRITEDATA, transfer);
+		curl_easy_setopt (curl, CURLOPT_RESUME_FROM_LARGE, transfer->offset);
+	}
+	curl_easy_setopt (curl, CURLOPT_URL, transfer->source_url);
+	curl_easy_setopt (curl, CURLOPT_FOLLOWLOCATION, 1L);
+	curl_easy_setopt (curl, CURLOPT_FAILONERROR, 1L);
+	curl_easy_setopt (curl, CURLOPT_PRIVATE, transfer);
+	curl_easy_setopt (curl, CURLOPT_NOPROGRESS, 0L);
+	curl_easy_setopt (curl, CURLOPT_XFERINFOFUNCTION, progress_cb);
+	curl_easy_setopt (curl, CURLOPT_XFERINFODATA, transfer);
+	transfer->curl = curl;
+
+	connections = GPOINTER_TO_UINT (g_hash_table_lookup (this->connections, transfer->host));
+	g_hash_table_insert (this->connections,
+			g_strdup (transfer->host), GUINT_TO_POINTER (connections + 1));
+	curl_multi_add_handle (this->multi, curl);
+}
+
+void
+Downloader::finish (Transfer *transfer, CURLcode result) noexcept
+{
+	glong response_code = 0;
+	guint connections;
+
+	curl_easy_getinfo (transfer->curl, CURLINFO_RESPONSE_CODE, &response_code);
+	curl_multi_remove_handle (this->multi, transfer->curl);
+	curl_easy_reset (transfer->curl);
+	this->handles = g_slist_prepend (this->handles, transfer->curl);
+	transfer->curl = NULL;
+
+	connections = GPOINTER_TO_UINT (g_hash_table_lookup (this->connections, transfer->host));
+	g_hash_table_insert (this->connections,
+			g_strdup (transfer->host), GUINT_TO_POINTER (connections - 1));
+
+	if (transfer->dest == NULL)
+	{
+		if (result == CURLE_HTTP_RETURNED_ERROR)
+		{
+			result = CURLE_REMOTE_FILE_NOT_FOUND;
+		}
+	}
+	else
+	{
+		fclose (transfer->fout);
+		transfer->fout = NULL;
+
+		if (result == CURLE_RANGE_ERROR && transfer->offset > 0 && !transfer->restarted)
+		{
+			/* The server can't resume, download the whole file instead */
+			g_unlink (transfer->part);
+			transfer->offset = 0;
+			transfer->now = 0;
+			transfer->total = 0;
+			transfer->started = FALSE;
+			transfer->restarted = TRUE;
+			return;
+		}
+		if (result == CURLE_OK && g_rename (transfer->part, transfer->dest) != 0)
+		{
+			result = CURLE_WRITE_ERROR;
+		}
+		else if (result == CURLE_HTTP_RETURNED_ERROR && response_code == 416)
+		{
+			/* Nothing left to resume, start over the next time */
+			g_unlink (transfer->part);
+		}
+		else if (result != CURLE_OK && transfer->offset == 0 && transfer->now == 0)
+		{
+			/* Keep only partial files there is something to resume from */
+			g_unlink (transfer->part);
+		}
+	}
+	transfer->result = result;
+	transfer->done = TRUE;
+}
+
+size_t
+Downloader::write_cb (char *data, size_t size, size_t nmemb, void *user_data) noexcept
+{
+	auto transfer = static_cast<Transfer *> (user_data);
+
+	return fwrite (data, size, nmemb, transfer->fout) * size;
+}
+
+int
+Downloader::progress_cb (void *user_data,
+		curl_off_t dltotal, curl_off_t dlnow,
+		curl_off_t ultotal, curl_off_t ulnow) noexcept
+{
+	auto transfer = static_cast<Transfer *> (user_data);
+
+	transfer->now = dlnow;
+	transfer->total = dltotal;
+
+	return 0;
+}
+
+void
+Downloader::transfer_free (Transfer *transfer) noexcept
+{
+	if (transfer->fout != NULL)
+	{
+		fclose (transfer->fout);
+	}
+	g_free (transfer->source_url);
+	g_free (transfer->dest);
+	g_free (transfer->part);
+	g_free (transfer->host);
+	g_free (transfer);
+}
+
+/**
+ * slack::Downloader::Downloader:
+ *
+ * Constructor.
+ *
+ * Return value: New #slack::Downloader.
+ **/
+Downloader::Downloader () noexcept
+{
+	this->multi = curl_multi_init ();
+	this->transfers = g_ptr_array_new_with_free_func ((GDestroyNotify) transfer_free);
+	this->connections = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+}
+
+Downloader::~Downloader () noexcept
+{
+	for (guint i = 0; i < this->transfers->len; i++)
+	{
+		auto transfer = static_cast<Transfer *> (g_ptr_array_index (this->transfers, i));
+
+		if (transfer->curl != NULL)
+		{
+			curl_multi_remove_handle (this->multi, transfer->curl);
+			curl_easy_cleanup (transfer->curl);
+		}
+	}
+	g_slist_free_full (this->handles, (GDestroyNotify) curl_easy_cleanup);
+	g_ptr_array_unref (this->transfers);
+	g_hash_table_unref (this->connections);
+	curl_multi_cleanup (this->multi);
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef __SLACK_DOWNLOADER_H
+#define __SLACK_DOWNLOADER_H
+
+#include <curl/curl.h>
+#include <pk-backend.h>
+#include <pk-backend-job.h>
+
+namespace slack {
+
+class Downloader final
+{
+public:
+	Downloader () noexcept;
+	~Downloader () noexcept;
+
+	guint add (const gchar *source_url, const gchar *dest,
+			guint max_connections) noexcept;
+	gboolean run (PkBackendJob *job, guint max_percentage = 100) noexcept;
+	CURLcode get_result (guint transfer) const noexcept;
+
+private:
+	struct Transfer
+	{
+		gchar *source_url;
+		gchar *dest;
+		gchar *part;
+		gchar *host;
+		guint max_connections;
+		CURL *curl;
+		FILE *fout;
+		curl_off_t offset;
+		curl_off_t now;
+		curl_off_t total;
+		gboolean started;
+		gboolean done;
+		gboolean restarted;
+		CURLcode result;
+	};
+
+	CURLM *multi;
+	GPtrArray *transfers;
+	GHashTable *connections;
+	GSList *handles = NULL;
+
+	static void transfer_free (Transfer *transfer) noexcept;
+	static size_t write_cb (char *data, size_t size, size_t nmemb,
+			void *user_data) noexcept;
+	static int progress_cb (void *user_data,
+			curl_off_t dltotal, curl_off_t dlnow,
+			curl_off_t ultotal, curl_off_t ulnow) noexcept;
+
+	void start (Transfer *transfer) noexcept;
+	void finish (Transfer *transfer, CURLcode result) noexcept;
+};
+
+}
+
+#endif /* __SLACK_DOWNLOADER_H */
@@ -1,5 +1,6 @@
 #include "job.h"
 
+#include <string.h>
 #include <string>
 #include "utils.h"
 
@@ -26,7 +27,7 @@ generate_query(PkBitfield filters)
 	std::string query(
 			"SELECT (p1.name || ';' || p1.ver || ';' || p1.arch || ';' || r.repo), p1.summary, "
 			"p1.full_name FROM pkglist AS p1 NATURAL JOIN repos AS r "
-			"WHERE p1.%s LIKE '%%%q%%' AND p1.ext NOT LIKE 'obsolete' AND p1.repo_order = "
+			"WHERE p1.%s LIKE '%%%q%%' AND p1.ext != 'obsolete' AND p1.repo_order = "
 			"(SELECT MIN(p2.repo_order) FROM pkglist AS p2 WHERE p2.name = p1.name GROUP BY p2.name)");
 
 	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_APPLICATION))
@@ -35,7 +36,9 @@ generate_query(PkBitfield filters)
 				" AND EXISTS (SELECT filelist.full_name "
 				"FROM filelist "
 				"WHERE filelist.full_name = p1.full_name "
-				"AND filelist.filename LIKE 'usr/share/applications/%%.desktop')");
+				"AND filelist.filename > 'usr/share/applications/' "
+				"AND filelist.filename < 'usr/share/applications0' "
+				"AND filelist.filename LIKE '%%.desktop')");
 	}
 	else if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_APPLICATION))
 	{
@@ -43,11 +46,94 @@ generate_query(PkBitfield filters)
 				" AND NOT EXISTS (SELECT filelist.full_name "
 				"FROM filelist "
 				"WHERE filelist.full_name = p1.full_name "
-				"AND filelist.filename LIKE 'usr/share/applications/%%.desktop')");
+				"AND filelist.filename > 'usr/share/applications/' "
+				"AND filelist.filename < 'usr/share/applications0' "
+				"AND filelist.filename LIKE '%%.desktop')");
 	}
 	return query;
 }
 
+/**
+ * Prepares the search for packages containing any of the files. Absolute
+ * paths match whole file names, other values any part of a file name. The
+ * trigram index can't serve values shorter than three characters, so they
+ * are always matched with LIKE.
+ * Returns the statement with the values bound, or NULL on error.
+ */
+sqlite3_stmt *
+prepare_file_search (JobData *job_data, gchar **vals)
+{
+	bool full_text = prepare_statement (job_data, "SELECT rowid FROM filelist_fts WHERE 0") != NULL;
+	const gchar *op = " WHERE ";
+	std::string query(
+			"SELECT (p.name || ';' || p.ver || ';' || p.arch || ';' || r.repo), p.summary, "
+			"p.full_name FROM filelist AS f NATURAL JOIN pkglist AS p NATURAL JOIN repos AS r");
+
+	if (*vals == NULL)
+	{
+		query.append (" WHERE 0");
+	}
+	for (gchar **val = vals; *val; val++, op = " OR ")
+	{
+		query.append (op);
+		if (**val == '/')
+		{
+			query.append ("f.filename = ?");
+		}
+		else if (full_text && strlen (*val) >= 3) /* Not shorter than a trigram */
+		{
+			query.append ("f.rowid IN (SELECT rowid FROM filelist_fts WHERE filelist_fts MATCH ?)");
+		}
+		else
+		{
+			query.append ("f.filename LIKE ? ESCAPE '\\'");
+		}
+	}
+	query.append (" GROUP BY f.full_name");
+
+	sqlite3_stmt *stmt = prepare_statement (job_data, query.c_str ());
+	if (stmt == NULL)
+	{
+		return NULL;
+	}
+
+	int i = 1;
+	for (gchar **val = vals; *val; val++, i++)
+	{
+		if (**val == '/')
+		{
+			/* The file lists have no leading slash */
+			sqlite3_bind_text (stmt, i, *val + 1, -1, SQLITE_TRANSIENT);
+		}
+		else if (full_text && strlen (*val) >= 3)
+		{
+			/* An FTS5 string, quotes are doubled */
+			gchar **parts = g_strsplit (*val, "\"", -1);
+			gchar *joined = g_strjoinv ("\"\"", parts);
+
+			sqlite3_bind_text (stmt, i, g_strconcat ("\"", joined, "\"", NULL), -1, g_free);
+			g_free (joined);
+			g_strfreev (parts);
+		}
+		else
+		{
+			GString *pattern = g_string_new ("%");
+
+			for (const gchar *c = *val; *c; c++)
+			{
+				if (*c == '%' || *c == '_' || *c == '\\')
+				{
+					g_string_append_c (pattern, '\\');
+				}
+				g_string_append_c (pattern, *c);
+			}
+			g_string_append_c (pattern, '%');
+			sqlite3_bind_text (stmt, i, g_string_free (pattern, FALSE), -1, g_free);
+		}
+	}
+	return stmt;
+}
+
 }
 
 void
@@ -67,7 +153,7 @@ pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 			user_data, search);
 
 	sqlite3_stmt *stmt;
-	if ((sqlite3_prepare_v2 (job_data->db, query, -1, &stmt, NULL) == SQLITE_OK))
+	if ((stmt = slack::prepare_statement (job_data, query)))
 	{
 		/* Now we're ready to output all packages */
 		while (sqlite3_step (stmt) == SQLITE_ROW)
@@ -89,7 +175,7 @@ pk_backend_search_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 						reinterpret_cast<const gchar *> (sqlite3_column_text (stmt, 1)));
 			}
 		}
-		sqlite3_finalize (stmt);
+		sqlite3_reset (stmt);
 	}
 	else
 	{
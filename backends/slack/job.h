@@ -6,8 +6,12 @@
 
 namespace slack {
 
+struct JobData;
+
 bool filter_package (PkBitfield filters, bool is_installed);
 
+sqlite3_stmt *prepare_file_search (JobData *job_data, gchar **vals);
+
 }
 
 extern "C" {
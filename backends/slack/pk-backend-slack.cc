@@ -1,4 +1,5 @@
 #include <dirent.h>
+#include <errno.h>
 #include <glib/gstdio.h>
 #include <packagekit-glib2/pk-debug.h>
 #include <stdlib.h>
@@ -64,7 +65,7 @@ void pk_backend_initialize(GKeyFile *conf, PkBackend *backend)
 	}
 
 	if ((ret = sqlite3_prepare_v2(db,
-					"UPDATE cache_info SET value = ? WHERE key LIKE 'last_modification'",
+					"UPDATE cache_info SET value = ? WHERE key = 'last_modification'",
 					-1,
 					&stmt,
 					NULL)) == SQLITE_OK) {
@@ -86,6 +87,7 @@ void pk_backend_initialize(GKeyFile *conf, PkBackend *backend)
 
 	g_object_unref(file_info);
 	g_object_unref(conf_file);
+	update_schema(db);
 	sqlite3_close_v2(db);
 	g_free(path);
 
@@ -109,6 +111,11 @@ void pk_backend_initialize(GKeyFile *conf, PkBackend *backend)
 
 		if (repo)
 		{
+			if (g_key_file_has_key(key_conf, groups[i], "MaxConnections", NULL))
+			{
+				static_cast<Pkgtools *> (repo)->set_max_connections (
+						g_key_file_get_integer(key_conf, groups[i], "MaxConnections", NULL));
+			}
 			repos = g_slist_append(repos, repo);
 		}
 		else
@@ -224,11 +231,10 @@ pk_backend_stop_job(PkBackend *backend, PkBackendJob *job)
 {
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
-	if (job_data->curl)
+	if (job_data->statements)
 	{
-		curl_easy_cleanup(job_data->curl);
+		g_hash_table_unref(job_data->statements);
 	}
-
 	sqlite3_close(job_data->db);
 	g_free(job_data);
 	pk_backend_job_set_user_data(job, NULL);
@@ -255,8 +261,7 @@ pk_backend_search_groups(PkBackend *backend, PkBackendJob *job, PkBitfield filte
 static void
 pk_backend_search_files_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
 {
-	gchar **vals, *search;
-	gchar *query;
+	gchar **vals;
 	sqlite3_stmt *stmt;
 	PkInfoEnum ret;
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
@@ -265,13 +270,8 @@ pk_backend_search_files_thread(PkBackendJob *job, GVariant *params, gpointer use
 	pk_backend_job_set_percentage(job, 0);
 
 	g_variant_get(params, "(t^a&s)", NULL, &vals);
-	search = g_strjoinv("%", vals);
 
-	query = sqlite3_mprintf("SELECT (p.name || ';' || p.ver || ';' || p.arch || ';' || r.repo), p.summary, "
-							"p.full_name FROM filelist AS f NATURAL JOIN pkglist AS p NATURAL JOIN repos AS r "
-							"WHERE f.filename LIKE '%%%q%%' GROUP BY f.full_name", search);
-
-	if ((sqlite3_prepare_v2(job_data->db, query, -1, &stmt, NULL) == SQLITE_OK))
+	if ((stmt = prepare_file_search(job_data, vals)))
 	{
 		/* Now we're ready to output all packages */
 		while (sqlite3_step(stmt) == SQLITE_ROW)
@@ -290,14 +290,12 @@ pk_backend_search_files_thread(PkBackendJob *job, GVariant *params, gpointer use
 				                       (gchar*) sqlite3_column_text(stmt, 1));
 			}
 		}
-		sqlite3_finalize(stmt);
+		sqlite3_reset(stmt);
 	}
 	else
 	{
 		pk_backend_job_error_code(job, PK_ERROR_ENUM_CANNOT_GET_FILELIST, "%s", sqlite3_errmsg(job_data->db));
 	}
-	sqlite3_free(query);
-	g_free(search);
 
 	pk_backend_job_set_percentage(job, 100);
 }
@@ -325,12 +323,9 @@ pk_backend_get_details_thread(PkBackendJob *job, GVariant *params, gpointer user
 
 	g_variant_get(params, "(^a&s)", &pkg_ids);
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if (!(stmt = prepare_statement(job_data,
 							"SELECT p.desc, p.cat, p.uncompressed FROM pkglist AS p NATURAL JOIN repos AS r "
-							"WHERE name LIKE @name AND r.repo LIKE @repo AND ext NOT LIKE 'obsolete'",
-							-1,
-							&stmt,
-							NULL) != SQLITE_OK)) {
+							"WHERE name = @name AND r.repo = @repo AND ext != 'obsolete'"))) {
 		pk_backend_job_error_code(job, PK_ERROR_ENUM_CANNOT_GET_FILELIST, "%s", sqlite3_errmsg(job_data->db));
 		goto out;
 	}
@@ -388,7 +383,7 @@ pk_backend_get_details_thread(PkBackendJob *job, GVariant *params, gpointer user
 	}
 
 out:
-	sqlite3_finalize(stmt);
+	sqlite3_reset(stmt);
 }
 
 void
@@ -410,14 +405,11 @@ pk_backend_resolve_thread(PkBackendJob *job, GVariant *params, gpointer user_dat
 
 	g_variant_get(params, "(t^a&s)", NULL, &vals);
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if ((stmt = prepare_statement(job_data,
 							"SELECT (p1.name || ';' || p1.ver || ';' || p1.arch || ';' || r.repo), p1.summary, "
 						   	"p1.full_name FROM pkglist AS p1 NATURAL JOIN repos AS r "
-							"WHERE p1.name LIKE @search AND p1.repo_order = "
-							"(SELECT MIN(p2.repo_order) FROM pkglist AS p2 WHERE p2.name = p1.name GROUP BY p2.name)",
-							-1,
-							&stmt,
-							NULL) == SQLITE_OK)) {
+							"WHERE p1.name = @search AND p1.repo_order = "
+							"(SELECT MIN(p2.repo_order) FROM pkglist AS p2 WHERE p2.name = p1.name GROUP BY p2.name)"))) {
 		/* Output packages matching each pattern */
 		for (val = vals; *val; val++)
 		{
@@ -443,7 +435,6 @@ pk_backend_resolve_thread(PkBackendJob *job, GVariant *params, gpointer user_dat
 			sqlite3_clear_bindings(stmt);
 			sqlite3_reset(stmt);
 		}
-		sqlite3_finalize(stmt);
 	} else {
 		pk_backend_job_error_code(job, PK_ERROR_ENUM_CANNOT_GET_FILELIST, "%s", sqlite3_errmsg(job_data->db));
 	}
@@ -460,25 +451,26 @@ pk_backend_resolve(PkBackend *backend, PkBackendJob *job, PkBitfield filters, gc
 static void
 pk_backend_download_packages_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
 {
-	gchar *dir_path, *path, **pkg_ids, *to_strv[] = {NULL, NULL};
+	gchar *dir_path, **pkg_ids, *to_strv[] = {NULL, NULL};
 	guint i;
+	gint transfer;
 	sqlite3_stmt *stmt;
+	Downloader downloader;
+	GPtrArray *paths = g_ptr_array_new_with_free_func(g_free);
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
 	g_variant_get(params, "(^a&ss)", &pkg_ids, &dir_path);
 	pk_backend_job_set_status (job, PK_STATUS_ENUM_DOWNLOAD);
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if (!(stmt = prepare_statement(job_data,
 							"SELECT summary, (full_name || '.' || ext) FROM pkglist NATURAL JOIN repos "
-							"WHERE name LIKE @name AND ver LIKE @ver AND arch LIKE @arch AND repo LIKE @repo",
-							-1,
-							&stmt,
-							NULL) != SQLITE_OK))
+							"WHERE name = @name AND ver = @ver AND arch = @arch AND repo = @repo")))
 	{
 		pk_backend_job_error_code(job, PK_ERROR_ENUM_CANNOT_GET_FILELIST, "%s", sqlite3_errmsg(job_data->db));
 		goto out;
 	}
 
+	/* Queue all packages, so they are downloaded in parallel */
 	for (i = 0; pkg_ids[i]; ++i)
 	{
 		gchar **tokens = pk_package_id_split(pkg_ids[i]);
@@ -495,12 +487,13 @@ pk_backend_download_packages_thread(PkBackendJob *job, GVariant *params, gpointe
 				pk_backend_job_package(job, PK_INFO_ENUM_DOWNLOADING,
 									   pkg_ids[i],
 									   (gchar *) sqlite3_column_text(stmt, 0));
-				static_cast<Pkgtools *> (repo->data)->download (job,
-						dir_path, tokens[PK_PACKAGE_ID_NAME]);
-				path = g_build_filename(dir_path, (gchar *) sqlite3_column_text(stmt, 1), NULL);
-				to_strv[0] = path;
-				pk_backend_job_files(job, NULL, to_strv);
-				g_free(path);
+				transfer = static_cast<Pkgtools *> (repo->data)->download (job,
+						downloader, dir_path, tokens[PK_PACKAGE_ID_NAME]);
+				if (transfer >= 0)
+				{
+					g_ptr_array_insert(paths, transfer,
+							g_build_filename(dir_path, (gchar *) sqlite3_column_text(stmt, 1), NULL));
+				}
 			}
 		}
 		sqlite3_clear_bindings(stmt);
@@ -508,8 +501,23 @@ pk_backend_download_packages_thread(PkBackendJob *job, GVariant *params, gpointe
 		g_strfreev(tokens);
 	}
 
+	if (!downloader.run (job))
+	{
+		pk_backend_job_error_code(job, PK_ERROR_ENUM_PACKAGE_DOWNLOAD_FAILED,
+				"Some packages could not be downloaded");
+	}
+	for (i = 0; i < paths->len; i++)
+	{
+		if (downloader.get_result (i) == CURLE_OK)
+		{
+			to_strv[0] = static_cast<gchar *> (g_ptr_array_index(paths, i));
+			pk_backend_job_files(job, NULL, to_strv);
+		}
+	}
+
 out:
-	sqlite3_finalize(stmt);
+	g_ptr_array_unref(paths);
+	sqlite3_reset(stmt);
 }
 
 void
@@ -529,26 +537,21 @@ pk_backend_install_packages_thread(PkBackendJob *job, GVariant *params, gpointer
 	sqlite3_stmt *pkglist_stmt = NULL, *collection_stmt = NULL;
     PkBitfield transaction_flags = 0;
 	PkInfoEnum ret;
+	Downloader downloader;
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
 	g_variant_get(params, "(t^a&s)", &transaction_flags, &pkg_ids);
 	pk_backend_job_set_status(job, PK_STATUS_ENUM_DEP_RESOLVE);
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if (!(pkglist_stmt = prepare_statement(job_data,
 							"SELECT summary, cat FROM pkglist NATURAL JOIN repos "
-							"WHERE name LIKE @name AND ver LIKE @ver AND arch LIKE @arch AND repo LIKE @repo",
-							-1,
-							&pkglist_stmt,
-							NULL) != SQLITE_OK) ||
-		(sqlite3_prepare_v2(job_data->db,
+							"WHERE name = @name AND ver = @ver AND arch = @arch AND repo = @repo")) ||
+		!(collection_stmt = prepare_statement(job_data,
 						   "SELECT (c.collection_pkg || ';' || p.ver || ';' || p.arch || ';' || r.repo), p.summary, "
 						   "p.full_name, p.ext FROM collections AS c "
 						   "JOIN pkglist AS p ON c.collection_pkg = p.name "
 						   "JOIN repos AS r ON p.repo_order = r.repo_order "
-						   "WHERE c.name LIKE @name AND r.repo LIKE @repo",
-						   -1,
-						   &collection_stmt,
-						   NULL) != SQLITE_OK))
+						   "WHERE c.name = @name AND r.repo = @repo")))
 	{
 		pk_backend_job_error_code(job, PK_ERROR_ENUM_CANNOT_GET_FILELIST, "%s", sqlite3_errmsg(job_data->db));
 		goto out;
@@ -629,19 +632,26 @@ pk_backend_install_packages_thread(PkBackendJob *job, GVariant *params, gpointer
 			gchar **tokens;
 			GSList *repo;
 
-			pk_backend_job_set_percentage(job, percent_step * i);
 			tokens = pk_package_id_split((gchar *)(l->data));
 			repo = g_slist_find_custom(repos, tokens[PK_PACKAGE_ID_DATA], cmp_repo);
 
 			if (repo)
 			{
 				static_cast<Pkgtools *> (repo->data)->download (job,
-						dest_dir_name, tokens[PK_PACKAGE_ID_NAME]);
+						downloader, dest_dir_name, tokens[PK_PACKAGE_ID_NAME]);
 			}
 			g_strfreev(tokens);
 		}
 		g_free(dest_dir_name);
 
+		if (!downloader.run (job, 50))
+		{
+			pk_backend_job_error_code(job, PK_ERROR_ENUM_PACKAGE_DOWNLOAD_FAILED,
+					"Some packages could not be downloaded");
+			g_slist_free_full(install_list, g_free);
+			goto out;
+		}
+
 		/* Install the packages */
 		pk_backend_job_set_status(job, PK_STATUS_ENUM_INSTALL);
 		for (l = install_list; l; l = g_slist_next(l), i++)
@@ -663,8 +673,8 @@ pk_backend_install_packages_thread(PkBackendJob *job, GVariant *params, gpointer
 	g_slist_free_full(install_list, g_free);
 
 out:
-	sqlite3_finalize(pkglist_stmt);
-	sqlite3_finalize(collection_stmt);
+	sqlite3_reset(pkglist_stmt);
+	sqlite3_reset(collection_stmt);
 }
 
 void
@@ -750,14 +760,11 @@ pk_backend_get_updates_thread(PkBackendJob *job, GVariant *params, gpointer user
 
 	pk_backend_job_set_status(job, PK_STATUS_ENUM_QUERY);
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if (!(stmt = prepare_statement(job_data,
 							"SELECT p1.full_name, p1.name, p1.ver, p1.arch, r.repo, p1.summary, p1.ext "
 							"FROM pkglist AS p1 NATURAL JOIN repos AS r "
-							"WHERE p1.name LIKE @name AND p1.repo_order = "
-							"(SELECT MIN(p2.repo_order) FROM pkglist AS p2 WHERE p2.name = p1.name GROUP BY p2.name)",
-							-1,
-							&stmt,
-							NULL) != SQLITE_OK))
+							"WHERE p1.name = @name AND p1.repo_order = "
+							"(SELECT MIN(p2.repo_order) FROM pkglist AS p2 WHERE p2.name = p1.name GROUP BY p2.name)")))
 	{
 		pk_backend_job_error_code(job, PK_ERROR_ENUM_CANNOT_GET_FILELIST, "%s", sqlite3_errmsg(job_data->db));
 		goto out;
@@ -837,7 +844,7 @@ pk_backend_get_updates_thread(PkBackendJob *job, GVariant *params, gpointer user
 	g_object_unref(pkg_metadata_enumerator);
 
 out:
-	sqlite3_finalize(stmt);
+	sqlite3_reset(stmt);
 }
 
 void
@@ -850,8 +857,9 @@ static void
 pk_backend_update_packages_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
 {
 	gchar *dest_dir_name, *cmd_line, **pkg_ids;
-	guint i;
+	guint i, n_pkgs;
     PkBitfield transaction_flags = 0;
+	Downloader downloader;
 
 	g_variant_get(params, "(t^a&s)", &transaction_flags, &pkg_ids);
 
@@ -871,7 +879,7 @@ pk_backend_update_packages_thread(PkBackendJob *job, GVariant *params, gpointer
 				if (repo)
 				{
 					static_cast<Pkgtools *> (repo->data)->download (job,
-							dest_dir_name, tokens[PK_PACKAGE_ID_NAME]);
+							downloader, dest_dir_name, tokens[PK_PACKAGE_ID_NAME]);
 				}
 			}
 
@@ -879,12 +887,23 @@ pk_backend_update_packages_thread(PkBackendJob *job, GVariant *params, gpointer
 		}
 		g_free(dest_dir_name);
 
+		/* The first half of the percentage is for downloading */
+		if (!downloader.run (job, 50))
+		{
+			pk_backend_job_error_code(job, PK_ERROR_ENUM_PACKAGE_DOWNLOAD_FAILED,
+					"Some packages could not be downloaded");
+			return;
+		}
+
 		/* Install the packages */
 		pk_backend_job_set_status(job, PK_STATUS_ENUM_UPDATE);
+		n_pkgs = g_strv_length(pkg_ids);
 		for (i = 0; pkg_ids[i]; i++)
 		{
 			gchar **tokens = pk_package_id_split(pkg_ids[i]);
 
+			pk_backend_job_set_percentage(job, 50 + 50 * i / n_pkgs);
+
 			if (g_strcmp0(tokens[PK_PACKAGE_ID_DATA], "obsolete"))
 			{
 				GSList *repo = g_slist_find_custom(repos, tokens[PK_PACKAGE_ID_DATA], cmp_repo);
@@ -920,14 +939,16 @@ pk_backend_update_packages(PkBackend *backend,
 static void
 pk_backend_refresh_cache_thread(PkBackendJob *job, GVariant *params, gpointer user_data)
 {
-	gchar *tmp_dir_name, *db_err, *path = NULL;
+	gchar *tmp_dir_name, *db_err, *path = NULL, *db_filename, *staging_filename;
 	gint ret;
 	gboolean force;
 	GSList *file_list = NULL;
 	GFile *db_file = NULL;
 	GFileInfo *file_info = NULL;
 	GError *err = NULL;
+	sqlite3 *staging;
 	sqlite3_stmt *stmt = NULL;
+	Downloader downloader;
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
 	pk_backend_job_set_status(job, PK_STATUS_ENUM_DOWNLOAD_CHANGELOG);
@@ -943,6 +964,12 @@ pk_backend_refresh_cache_thread(PkBackendJob *job, GVariant *params, gpointer us
 
 	g_variant_get(params, "(b)", &force);
 
+	/* The cache is generated in a copy of the database, that replaces it at the end.
+	 * Other jobs read the old database in the meantime */
+	db_filename = g_build_filename(LOCALSTATEDIR, "cache", "PackageKit", "metadata", "metadata.db", NULL);
+	staging_filename = g_strconcat(db_filename, ".new", NULL);
+	staging = NULL;
+
 	/* Force the complete cache refresh if the read configuration file is newer than the metadata cache */
 	if (!force)
 	{
@@ -956,7 +983,7 @@ pk_backend_refresh_cache_thread(PkBackendJob *job, GVariant *params, gpointer us
 			goto out;
 		}
 		ret = sqlite3_prepare_v2(job_data->db,
-								 "SELECT value FROM cache_info WHERE key LIKE 'last_modification'",
+								 "SELECT value FROM cache_info WHERE key = 'last_modification'",
 								 -1,
 								 &stmt,
 								 NULL);
@@ -974,9 +1001,19 @@ pk_backend_refresh_cache_thread(PkBackendJob *job, GVariant *params, gpointer us
 			force = TRUE;
 		}
 	}
+	sqlite3_reset(stmt);
+	if (!(staging = begin_staging(job_data->db, staging_filename)))
+	{
+		pk_backend_job_error_code(job,
+		                          PK_ERROR_ENUM_INTERNAL_ERROR,
+		                          "%s: %s",
+		                          staging_filename,
+		                          g_strerror(errno));
+		goto out;
+	}
 	if (force) /* It should empty all tables */
 	{
-		if (sqlite3_exec(job_data->db, "DELETE FROM repos", NULL, 0, &db_err) != SQLITE_OK)
+		if (sqlite3_exec(staging, "DELETE FROM repos", NULL, 0, &db_err) != SQLITE_OK)
 		{
 			pk_backend_job_error_code(job, PK_ERROR_ENUM_INTERNAL_ERROR, "%s", db_err);
 			sqlite3_free(db_err);
@@ -987,29 +1024,50 @@ pk_backend_refresh_cache_thread(PkBackendJob *job, GVariant *params, gpointer us
 	// Get list of files that should be downloaded.
 	for (GSList *l = repos; l; l = g_slist_next(l))
 	{
-		file_list = g_slist_concat(file_list,
-				static_cast<Pkgtools *> (l->data)->collect_cache_info (tmp_dir_name));
+		auto repo = static_cast<Pkgtools *> (l->data);
+
+		file_list = repo->collect_cache_info (tmp_dir_name);
+		for (GSList *f = file_list; f; f = g_slist_next(f))
+		{
+			downloader.add (static_cast<gchar **> (f->data)[0],
+					static_cast<gchar **> (f->data)[1], repo->get_max_connections ());
+		}
+		g_slist_free_full(file_list, (GDestroyNotify)g_strfreev);
 	}
 
 	/* Download repository */
 	pk_backend_job_set_status(job, PK_STATUS_ENUM_DOWNLOAD_REPOSITORY);
-
-	for (GSList *l = file_list; l; l = g_slist_next(l))
-	{
-		get_file(&job_data->curl, static_cast<gchar **> (l->data)[0],
-				static_cast<gchar **> (l->data)[1]);
-	}
-	g_slist_free_full(file_list, (GDestroyNotify)g_strfreev);
+	downloader.run (job);
 
 	/* Refresh cache */
 	pk_backend_job_set_status(job, PK_STATUS_ENUM_REFRESH_CACHE);
 
 	for (GSList *l = repos; l; l = g_slist_next(l))
 	{
-		static_cast<Pkgtools *> (l->data)->generate_cache (job, tmp_dir_name);
+		static_cast<Pkgtools *> (l->data)->generate_cache (staging, tmp_dir_name);
+	}
+	ret = finish_staging(staging, staging_filename, db_filename);
+	staging = NULL;
+	if (!ret)
+	{
+		pk_backend_job_error_code(job,
+		                          PK_ERROR_ENUM_INTERNAL_ERROR,
+		                          "%s: %s",
+		                          db_filename,
+		                          g_strerror(errno));
 	}
 
 out:
+	if (staging)
+	{
+		sqlite3_close(staging);
+	}
+	if (g_file_test(staging_filename, G_FILE_TEST_EXISTS))
+	{
+		g_unlink(staging_filename);
+	}
+	g_free(staging_filename);
+	g_free(db_filename);
 	sqlite3_finalize(stmt);
 	if (file_info)
 	{
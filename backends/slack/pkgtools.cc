@@ -1,4 +1,3 @@
-#include <curl/curl.h>
 #include <sqlite3.h>
 #include "pkgtools.h"
 #include "utils.h"
@@ -8,30 +7,27 @@ namespace slack {
 /**
  * slack::Pkgtools::download:
  * @job: A #PkBackendJob.
+ * @downloader: The #slack::Downloader to queue the package in.
  * @dest_dir_name: Destination directory.
  * @pkg_name: Package name.
  *
- * Download a package.
+ * Queue a package for download.
  *
- * Returns: %TRUE on success, %FALSE otherwise.
+ * Returns: The transfer of @downloader, -1 if the package is unknown.
  **/
-gboolean
-Pkgtools::download (PkBackendJob *job,
+gint
+Pkgtools::download (PkBackendJob *job, Downloader &downloader,
 		gchar *dest_dir_name, gchar *pkg_name) noexcept
 {
 	gchar *dest_filename, *source_url;
-	gboolean ret = FALSE;
-	sqlite3_stmt *statement = NULL;
-	CURL *curl = NULL;
+	gint ret = -1;
+	sqlite3_stmt *statement;
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if (!(statement = prepare_statement(job_data,
 							"SELECT location, (full_name || '.' || ext) FROM pkglist "
-							"WHERE name LIKE @name AND repo_order = @repo_order",
-							-1,
-							&statement,
-							NULL) != SQLITE_OK))
-		return FALSE;
+							"WHERE name = @name AND repo_order = @repo_order")))
+		return -1;
 
 	sqlite3_bind_text(statement, 1, pkg_name, -1, SQLITE_TRANSIENT);
 	sqlite3_bind_int(statement, 2, this->get_order ());
@@ -45,26 +41,12 @@ Pkgtools::download (PkBackendJob *job,
 								 sqlite3_column_text(statement, 1),
 								 NULL);
 
-		if (!g_file_test(dest_filename, G_FILE_TEST_EXISTS))
-		{
-			if (get_file(&curl, source_url, dest_filename) == CURLE_OK)
-			{
-				ret = TRUE;
-			}
-		}
-		else
-		{
-			ret = TRUE;
-		}
-
-		if (curl)
-		{
-			curl_easy_cleanup(curl);
-		}
+		ret = downloader.add (source_url, dest_filename, this->get_max_connections ());
+
 		g_free(source_url);
 		g_free(dest_filename);
 	}
-	sqlite3_finalize(statement);
+	sqlite3_reset(statement);
 
 	return ret;
 }
@@ -80,15 +62,12 @@ void
 Pkgtools::install (PkBackendJob *job, gchar *pkg_name) noexcept
 {
 	gchar *pkg_filename, *cmd_line;
-	sqlite3_stmt *statement = NULL;
+	sqlite3_stmt *statement;
 	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
-	if ((sqlite3_prepare_v2(job_data->db,
+	if (!(statement = prepare_statement(job_data,
 							"SELECT (full_name || '.' || ext) FROM pkglist "
-							"WHERE name LIKE @name AND repo_order = @repo_order",
-							-1,
-							&statement,
-							NULL) != SQLITE_OK))
+							"WHERE name = @name AND repo_order = @repo_order")))
 	{
 		return;
 	}
@@ -110,7 +89,7 @@ Pkgtools::install (PkBackendJob *job, gchar *pkg_name) noexcept
 
 		g_free(pkg_filename);
 	}
-	sqlite3_finalize(statement);
+	sqlite3_reset(statement);
 }
 
 Pkgtools::~Pkgtools () noexcept
@@ -156,20 +135,47 @@ Pkgtools::get_order () const noexcept
 	return this->order;
 }
 
+/**
+ * slack::Pkgtools::get_max_connections:
+ *
+ * Retrieves the most connections opened to the repository mirror at
+ * the same time.
+ *
+ * Returns: Connection limit.
+ **/
+guint
+Pkgtools::get_max_connections () const noexcept
+{
+	return this->max_connections;
+}
+
+/**
+ * slack::Pkgtools::set_max_connections:
+ * @max_connections: Connection limit.
+ *
+ * Sets the most connections opened to the repository mirror at the same time.
+ **/
+void
+Pkgtools::set_max_connections (guint max_connections) noexcept
+{
+	this->max_connections = MAX (max_connections, 1);
+}
+
 /**
  * slack::Pkgtools:is_blacklisted:
  * @pkg: Package name to check for.
+ * @len: Length of @pkg, or -1 if it is nul-terminated.
  *
  * Checks whether a package is blacklisted.
  *
  * Returns: %TRUE if the package is blacklisted, %FALSE otherwise.
  **/
 gboolean
-Pkgtools::is_blacklisted (const gchar *pkg) const noexcept
+Pkgtools::is_blacklisted (const gchar *pkg, gssize len) const noexcept
 {
 	return this->blacklist
-		&& g_regex_match (this->blacklist,
-				pkg, static_cast<GRegexMatchFlags> (0), NULL);
+		&& g_regex_match_full (this->blacklist,
+				pkg, len, 0, static_cast<GRegexMatchFlags> (0), NULL, NULL);
 }
 
 }
@@ -3,6 +3,8 @@
 
 #include <glib-object.h>
 #include <pk-backend.h>
+#include <sqlite3.h>
+#include "downloader.h"
 
 namespace slack {
 
@@ -12,22 +14,25 @@ public:
 	const gchar *get_name () const noexcept;
 	const gchar *get_mirror () const noexcept;
 	guint8 get_order () const noexcept;
-	gboolean is_blacklisted (const gchar *pkg) const noexcept;
+	guint get_max_connections () const noexcept;
+	void set_max_connections (guint max_connections) noexcept;
+	gboolean is_blacklisted (const gchar *pkg, gssize len = -1) const noexcept;
 
 	virtual ~Pkgtools () noexcept;
 
-	gboolean download (PkBackendJob *job,
+	gint download (PkBackendJob *job, Downloader &downloader,
 			gchar *dest_dir_name, gchar *pkg_name) noexcept;
 	void install (PkBackendJob *job, gchar *pkg_name) noexcept;
 
 	virtual GSList *collect_cache_info (const gchar *tmpl) noexcept = 0;
-	virtual void generate_cache (PkBackendJob *job,
+	virtual void generate_cache (sqlite3 *db,
 			const gchar *tmpl) noexcept = 0;
 
 protected:
 	gchar *name = NULL;
 	gchar *mirror = NULL;
 	guint8 order;
+	guint max_connections = 4;
 	GRegex *blacklist = NULL;
 };
 
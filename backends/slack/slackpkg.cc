@@ -1,6 +1,5 @@
 #include <bzlib.h>
 #include <sqlite3.h>
-#include <stdlib.h>
 #include <string.h>
 #include "slackpkg.h"
 #include "utils.h"
@@ -9,29 +8,127 @@ namespace slack {
 
 GHashTable *Slackpkg::cat_map = NULL;
 
+/* Checks whether a line, that isn't nul-terminated, begins with @prefix */
+static gboolean
+line_has_prefix (const gchar *line, gsize len, const gchar *prefix)
+{
+	gsize prefix_len = strlen(prefix);
+
+	return len >= prefix_len && !memcmp(line, prefix, prefix_len);
+}
+
+/* Skips @n blank separated fields at the beginning of a line */
+static const gchar *
+skip_fields (const gchar *pos, const gchar *end, guint n)
+{
+	for (; n > 0; n--)
+	{
+		while (pos < end && g_ascii_isspace(*pos))
+		{
+			pos++;
+		}
+		while (pos < end && !g_ascii_isspace(*pos))
+		{
+			pos++;
+		}
+	}
+	if (pos < end) /* One space before the rest of the line */
+	{
+		pos++;
+	}
+	return pos;
+}
+
+/*
+ * slack::Slackpkg::manifest_line:
+ * @statement: filelist insert statement.
+ * @line:      a line of the manifest.
+ * @len:       length of @line.
+ * @full_name: buffer for the package the following lines belong to.
+ * @full_name_len: length of @full_name, 0 if the files are skipped.
+ *
+ * Parses a line of a manifest. The bound values point into @line.
+ */
+void
+Slackpkg::manifest_line (sqlite3_stmt *statement, const gchar *line, gsize len,
+		gchar *full_name, gsize *full_name_len) noexcept
+{
+	const gchar *end = line + len, *path, *base, *ext;
+	gsize path_len, base_len;
+
+	/* ||   Package:  ./a/aaa_base-14.2-x86_64-2.txz */
+	if (line_has_prefix(line, len, "||"))
+	{
+		path = line + 2;
+		while (path < end && (*path == ' ' || *path == '\t'))
+		{
+			path++;
+		}
+		if (line_has_prefix(path, end - path, "Package:"))
+		{
+			*full_name_len = 0;
+
+			/* File name without the extension, t[blxg]z */
+			for (base = end; base > path && base[-1] != '/'; base--);
+			ext = end - 4;
+			if (base > path && ext > base && !memcmp(ext, ".t", 2)
+			 && ext[2] && strchr("blxg", ext[2]) && ext[3] == 'z'
+			 && static_cast<gsize> (ext - base) < max_name_size)
+			{
+				*full_name_len = ext - base;
+				memcpy(full_name, base, *full_name_len);
+			}
+		}
+		return;
+	}
+
+	/* drwxr-xr-x root/root         0 2016-06-30 21:04 usr/ */
+	if (*full_name_len == 0 || len < 11 || !line[0]
+	 || !strchr("-bcdlps", line[0]) || line[10] != ' ')
+	{
+		return;
+	}
+	/* Owner, size, date and time */
+	path = skip_fields(line + 10, end, 4);
+	path_len = end - path;
+	if (path_len == 0 || *path == '.' || line_has_prefix(path, path_len, "install/"))
+	{
+		return;
+	}
+	for (base_len = path_len; base_len > 1 && path[base_len - 1] == '/'; base_len--);
+	for (base = path + base_len; base > path && base[-1] != '/'; base--);
+	base_len -= base - path;
+
+	sqlite3_bind_text(statement, 1, full_name, *full_name_len, SQLITE_STATIC);
+	sqlite3_bind_text(statement, 2, path, path_len, SQLITE_STATIC);
+	sqlite3_bind_text(statement, 3, base, base_len, SQLITE_STATIC);
+	sqlite3_step(statement);
+	sqlite3_clear_bindings(statement);
+	sqlite3_reset(statement);
+}
+
 /*
  * slack::Slackpkg::manifest:
- * @job:      a #PkBackendJob.
+ * @db:       the database to write to.
  * @tmpl:     temporary directory.
  * @filename: manifest filename
  *
  * Parse the manifest file and save the file list in the database.
+ * The file is decompressed into a buffer and only complete lines are parsed.
  */
 void
-Slackpkg::manifest (PkBackendJob *job,
+Slackpkg::manifest (sqlite3 *db,
 		const gchar *tmpl, gchar *filename) noexcept
 {
 	FILE *manifest;
-	gint err, read_len;
-	guint pos;
-	gchar buf[max_buf_size], *path, *pkg_filename, *rest = NULL, *start;
-	gchar *full_name = NULL;
-	gchar **line, **lines;
+	gint err = BZ_OK, read_len;
+	guint buf_len;
+	gchar *path, full_name[max_name_size];
+	gsize full_name_len = 0, len;
+	const gchar *pos, *end, *line;
+	GByteArray *buf;
 	BZFILE *manifest_bz2;
-	GRegex *pkg_expr = NULL, *file_expr = NULL;
-	GMatchInfo *match_info;
 	sqlite3_stmt *statement = NULL;
-	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
 	path = g_build_filename(tmpl,
 	                        this->get_name (),
@@ -49,103 +146,54 @@ Slackpkg::manifest (PkBackendJob *job,
 		goto out;
 	}
 
-	/* Prepare regular expressions */
-	pkg_expr = g_regex_new("^\\|\\|[[:blank:]]+Package:[[:blank:]]+.+\\/(.+)\\.(t[blxg]z$)?",
-	                       static_cast<GRegexCompileFlags> (G_REGEX_OPTIMIZE | G_REGEX_DUPNAMES),
-	                       static_cast<GRegexMatchFlags> (0),
-	                       NULL);
-	file_expr = g_regex_new("^[-bcdlps][-r][-w][-xsS][-r][-w][-xsS][-r][-w]"
-	                        "[-xtT][[:space:]][^[:space:]]+[[:space:]]+"
-	                        "[[:digit:]]+[[:space:]][[:digit:]-]+[[:space:]]"
-	                        "[[:digit:]:]+[[:space:]](?!install\\/|\\.)(.*)",
-	                        static_cast<GRegexCompileFlags> (G_REGEX_OPTIMIZE | G_REGEX_DUPNAMES),
-	                        static_cast<GRegexMatchFlags> (0),
-	                        NULL);
-	if (!(file_expr) || !(pkg_expr))
-	{
-		goto out;
-	}
-
 	/* Prepare SQL statements */
-	if (sqlite3_prepare_v2(job_data->db,
-						   "INSERT INTO filelist (full_name, filename) VALUES (@full_name, @filename)",
+	if (sqlite3_prepare_v2(db,
+						   "INSERT INTO filelist (full_name, filename, basename) "
+						   "VALUES (@full_name, @filename, @basename)",
 						   -1,
 						   &statement,
 						   NULL) != SQLITE_OK)
 	{
+		BZ2_bzReadClose(&err, manifest_bz2);
 		goto out;
 	}
+	buf = g_byte_array_sized_new(max_buf_size * 2);
 
-	sqlite3_exec(job_data->db, "BEGIN TRANSACTION", NULL, NULL, NULL);
-	while ((read_len = BZ2_bzRead(&err, manifest_bz2, buf, max_buf_size - 1)))
+	sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+	while (err == BZ_OK)
 	{
+		buf_len = buf->len;
+		g_byte_array_set_size(buf, buf_len + max_buf_size);
+		read_len = BZ2_bzRead(&err, manifest_bz2, buf->data + buf_len, max_buf_size);
 		if ((err != BZ_OK) && (err != BZ_STREAM_END))
 		{
 			break;
 		}
-		buf[read_len] = '\0';
-
-		/* Split the read text into lines */
-		lines = g_strsplit(buf, "\n", 0);
-		if (rest)
-		{ /* Add to the first line rest characters from the previous read operation */
-			start = lines[0];
-			lines[0] = g_strconcat(rest, lines[0], NULL);
-			g_free(start);
-			g_free(rest);
-		}
+		g_byte_array_set_size(buf, buf_len + read_len);
+
+		pos = reinterpret_cast<const gchar *> (buf->data);
+		end = pos + buf->len;
 		if (err != BZ_STREAM_END) /* The last line can be incomplete */
 		{
-			pos = g_strv_length(lines) - 1;
-			rest = lines[pos];
-			lines[pos] = NULL;
-		}
-		for (line = lines; *line; line++)
-		{
-			if (g_regex_match(pkg_expr, *line, static_cast<GRegexMatchFlags> (0), &match_info))
-			{
-				if (g_match_info_get_match_count(match_info) > 2)
-				{ /* If the extension matches */
-					g_free(full_name);
-					full_name = g_match_info_fetch(match_info, 1);
-				}
-				else
-				{
-					full_name = NULL;
-				}
-			}
-			g_match_info_free(match_info);
-
-			match_info = NULL;
-			if (full_name && g_regex_match(file_expr, *line, static_cast<GRegexMatchFlags> (0), &match_info))
+			while (end > pos && end[-1] != '\n')
 			{
-				pkg_filename = g_match_info_fetch(match_info, 1);
-				sqlite3_bind_text(statement, 1, full_name, -1, SQLITE_TRANSIENT);
-				sqlite3_bind_text(statement, 2, pkg_filename, -1, SQLITE_TRANSIENT);
-				sqlite3_step(statement);
-				sqlite3_clear_bindings(statement);
-				sqlite3_reset(statement);
-				g_free(pkg_filename);
+				end--;
 			}
-			g_match_info_free(match_info);
 		}
-		g_strfreev(lines);
+		while (next_line(&pos, end, &line, &len))
+		{
+			manifest_line(statement, line, len, full_name, &full_name_len);
+		}
+		/* Keep the incomplete line for the next read */
+		g_byte_array_remove_range(buf, 0, end - reinterpret_cast<const gchar *> (buf->data));
 	}
+	sqlite3_exec(db, "END TRANSACTION", NULL, NULL, NULL);
 
-	sqlite3_exec(job_data->db, "END TRANSACTION", NULL, NULL, NULL);
-	g_free(full_name);
+	g_byte_array_unref(buf);
 	BZ2_bzReadClose(&err, manifest_bz2);
 
 out:
 	sqlite3_finalize(statement);
-	if (file_expr)
-	{
-		g_regex_unref(file_expr);
-	}
-	if (pkg_expr)
-	{
-		g_regex_unref(pkg_expr);
-	}
 	fclose(manifest);
 }
 
@@ -161,9 +209,9 @@ out:
 GSList *
 Slackpkg::collect_cache_info (const gchar *tmpl) noexcept
 {
-	CURL *curl = NULL;
+	Downloader downloader;
 	gchar **source_dest;
-	GSList *file_list = NULL;
+	GSList *file_list = NULL, *l;
 	GFile *tmp_dir, *repo_tmp_dir;
 
 	/* Create the temporary directory for the repository */
@@ -171,32 +219,24 @@ Slackpkg::collect_cache_info (const gchar *tmpl) noexcept
 	repo_tmp_dir = g_file_get_child(tmp_dir, this->get_name ());
 	g_file_make_directory(repo_tmp_dir, NULL, NULL);
 
-	/* Download PACKAGES.TXT. These files are most important, break if some of them couldn't be found */
+	/* Check all remote files at once, the list is in reverse order of the transfers */
 	for (gchar **cur_priority = this->priority; *cur_priority; cur_priority++)
 	{
+		/* PACKAGES.TXT of every priority, generate_cache () joins them */
 		source_dest = static_cast<gchar **> (g_malloc_n(3, sizeof(gchar *)));
 		source_dest[0] = g_strconcat(this->get_mirror (),
 									 *cur_priority,
 									 "/PACKAGES.TXT",
 									 NULL);
-		source_dest[1] = g_build_filename(tmpl,
-		                                  this->get_name (),
-		                                  "PACKAGES.TXT",
-		                                  NULL);
+		source_dest[1] = g_strconcat(tmpl,
+		                             "/", this->get_name (),
+		                             "/", *cur_priority, "-PACKAGES.TXT",
+		                             NULL);
 		source_dest[2] = NULL;
+		downloader.add (source_dest[0], NULL, this->get_max_connections ());
+		file_list = g_slist_prepend(file_list, source_dest);
 
-		if (get_file(&curl, source_dest[0], NULL) == CURLE_OK)
-		{
-			file_list = g_slist_prepend(file_list, source_dest);
-		}
-		else
-		{
-			g_strfreev(source_dest);
-			g_slist_free_full(file_list, (GDestroyNotify)g_strfreev);
-			goto out;
-		}
-
-		/* Download file lists if available */
+		/* File lists */
 		source_dest = static_cast<gchar **> (g_malloc_n(3, sizeof(gchar *)));
 		source_dest[0] = g_strconcat(this->get_mirror (),
 		                             *cur_priority,
@@ -207,66 +247,79 @@ Slackpkg::collect_cache_info (const gchar *tmpl) noexcept
 		                             "/", *cur_priority, "-MANIFEST.bz2",
 		                             NULL);
 		source_dest[2] = NULL;
-		if (get_file(&curl, source_dest[0], NULL) == CURLE_OK)
-		{
-			file_list = g_slist_prepend(file_list, source_dest);
-		}
-		else
+		downloader.add (source_dest[0], NULL, this->get_max_connections ());
+		file_list = g_slist_prepend(file_list, source_dest);
+	}
+	downloader.run (NULL);
+
+	l = file_list = g_slist_reverse(file_list);
+	for (guint i = 0; l; i++)
+	{
+		GSList *next = l->next;
+
+		if (downloader.get_result (i) != CURLE_OK)
 		{
-			g_strfreev(source_dest);
+			/* PACKAGES.TXT are most important, break if some of them couldn't be found */
+			if (i % 2 == 0)
+			{
+				g_slist_free_full(file_list, (GDestroyNotify)g_strfreev);
+				file_list = NULL;
+				break;
+			}
+			/* Download file lists if available */
+			g_strfreev(static_cast<gchar **> (l->data));
+			file_list = g_slist_delete_link(file_list, l);
 		}
+		l = next;
 	}
-out:
 	g_object_unref(repo_tmp_dir);
 	g_object_unref(tmp_dir);
 
-	if (curl)
-	{
-		curl_easy_cleanup(curl);
-	}
 	return file_list;
 }
 
 /**
  * slack::Slackpkg::generate_cache:
- * @job: A #PkBackendJob.
+ * @db: The database to write to.
  * @tmpl: temporary directory for downloading the files.
  *
- * Download files needed to get the information like the list of packages
- * in available repositories, updates, package descriptions and so on.
- *
- * Returns: List of files needed for building the cache.
+ * Reads the downloaded PACKAGES.TXT and MANIFEST.bz2 of every priority
+ * into the database. The package information is bound to the mapped
+ * files, it isn't copied line by line.
  **/
 void
-Slackpkg::generate_cache (PkBackendJob *job, const gchar *tmpl) noexcept
+Slackpkg::generate_cache (sqlite3 *db, const gchar *tmpl) noexcept
 {
-	gchar **pkg_tokens = NULL;
-	gchar *query = NULL, *filename = NULL, *location = NULL, *summary = NULL, *line, *packages_txt;
-	guint pkg_compressed = 0, pkg_uncompressed = 0;
-	gushort pkg_name_len;
+	const gchar *pos, *end, *line, *summary = NULL, *location = NULL, *filename = NULL;
+	gsize len, summary_len = 0, location_len = 0, filename_len = 0;
+	gchar *query = NULL, *path, cat_name[max_name_size];
+	guint64 pkg_compressed = 0, pkg_uncompressed = 0;
 	GString *desc;
-	GFile *list_file;
-	GFileInputStream *fin = NULL;
-	GDataInputStream *data_in = NULL;
+	GPtrArray *packages_txt;
+	GMappedFile *list_file;
+	PackageName pkg;
 	sqlite3_stmt *insert_statement = NULL, *update_statement = NULL, *insert_default_statement = NULL, *statement;
-	auto job_data = static_cast<JobData *> (pk_backend_job_get_user_data(job));
 
 	/* Check if the temporary directory for this repository exists, then the file metadata have to be generated */
-	packages_txt = g_build_filename(tmpl,
-	                                this->get_name (),
-	                                "PACKAGES.TXT",
-	                                NULL);
-	list_file = g_file_new_for_path(packages_txt);
-	fin = g_file_read(list_file, NULL, NULL);
-	g_object_unref(list_file);
-	g_free(packages_txt);
-	if (!fin)
+	packages_txt = g_ptr_array_new_with_free_func((GDestroyNotify) g_mapped_file_unref);
+	for (gchar **p = this->priority; p && *p; p++)
 	{
-		goto out;
+		path = g_strconcat(tmpl,
+		                   "/", this->get_name (),
+		                   "/", *p, "-PACKAGES.TXT",
+		                   NULL);
+		list_file = g_mapped_file_new(path, FALSE, NULL);
+		g_free(path);
+		if (!list_file)
+		{
+			goto out;
+		}
+		g_ptr_array_add(packages_txt, list_file);
 	}
+
 	/* Remove the old entries from this repository */
-	if (sqlite3_prepare_v2(job_data->db,
-	                       "DELETE FROM repos WHERE repo LIKE @repo",
+	if (sqlite3_prepare_v2(db,
+	                       "DELETE FROM repos WHERE repo = @repo",
 	                       -1,
 	                       &statement,
 	                       NULL) == SQLITE_OK)
@@ -275,11 +328,11 @@ Slackpkg::generate_cache (PkBackendJob *job, const gchar *tmpl) noexcept
 		                  1,
 		                  this->get_name (),
 		                  -1,
-		                  SQLITE_TRANSIENT);
+		                  SQLITE_STATIC);
 		sqlite3_step(statement);
 		sqlite3_finalize(statement);
 	}
-	if (sqlite3_prepare_v2(job_data->db,
+	if (sqlite3_prepare_v2(db,
 	                       "INSERT INTO repos (repo_order, repo) VALUES (@repo_order, @repo)",
 	                       -1,
 	                       &statement,
@@ -292,12 +345,12 @@ Slackpkg::generate_cache (PkBackendJob *job, const gchar *tmpl) noexcept
 	                  2,
 	                  this->get_name (),
 	                  -1,
-	                  SQLITE_TRANSIENT);
+	                  SQLITE_STATIC);
 	sqlite3_step(statement);
 	sqlite3_finalize(statement);
 
 	/* Insert new records */
-	if ((sqlite3_prepare_v2(job_data->db,
+	if ((sqlite3_prepare_v2(db,
 	                        "INSERT OR REPLACE INTO pkglist (full_name, ver, arch, ext, location, "
 	                        "summary, desc, compressed, uncompressed, name, repo_order, cat) "
 	                        "VALUES (@full_name, @ver, @arch, @ext, @location, @summary, "
@@ -305,7 +358,7 @@ Slackpkg::generate_cache (PkBackendJob *job, const gchar *tmpl) noexcept
 	                        -1,
 	                        &insert_statement,
 	                        NULL) != SQLITE_OK)
-	 || (sqlite3_prepare_v2(job_data->db,
+	 || (sqlite3_prepare_v2(db,
 	                    "INSERT OR REPLACE INTO pkglist (full_name, ver, arch, ext, location, "
 	                    "summary, desc, compressed, uncompressed, name, repo_order) "
 	                    "VALUES (@full_name, @ver, @arch, @ext, @location, @summary, "
@@ -319,122 +372,134 @@ Slackpkg::generate_cache (PkBackendJob *job, const gchar *tmpl) noexcept
 	query = sqlite3_mprintf("UPDATE pkglist SET full_name = @full_name, ver = @ver, arch = @arch, "
 	                        "ext = @ext, location = @location, summary = @summary, "
 	                        "desc = @desc, compressed = @compressed, uncompressed = @uncompressed "
-	                        "WHERE name LIKE @name AND repo_order = %u",
+	                        "WHERE name = @name AND repo_order = %u",
 	                        this->get_order ());
-	if (sqlite3_prepare_v2(job_data->db, query, -1, &update_statement, NULL) != SQLITE_OK)
+	if (sqlite3_prepare_v2(db, query, -1, &update_statement, NULL) != SQLITE_OK)
 	{
 		goto out;
 	}
 
-	data_in = g_data_input_stream_new(G_INPUT_STREAM(fin));
 	desc = g_string_new("");
 
-	sqlite3_exec(job_data->db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+	sqlite3_exec(db, "BEGIN TRANSACTION", NULL, NULL, NULL);
 
-	while ((line = g_data_input_stream_read_line(data_in, NULL, NULL, NULL)))
+	/* The priorities are read in their order */
+	for (guint i = 0; i < packages_txt->len; i++)
 	{
-		if (!strncmp(line, "PACKAGE NAME:  ", 15))
+		list_file = static_cast<GMappedFile *> (g_ptr_array_index(packages_txt, i));
+		pos = g_mapped_file_get_contents(list_file);
+		end = pos + g_mapped_file_get_length(list_file);
+		filename = NULL;
+
+		while (next_line(&pos, end, &line, &len))
 		{
-			filename = g_strdup(line + 15);
-			if (this->is_blacklisted (filename))
+			if (line_has_prefix(line, len, "PACKAGE NAME:  "))
 			{
-				g_free(filename);
-				filename = NULL;
+				filename = line + 15;
+				filename_len = len - 15;
+				if (this->is_blacklisted (filename, filename_len)
+				 || !parse_package_name(filename, filename_len, &pkg))
+				{
+					filename = NULL;
+				}
+				location = summary = NULL;
+				location_len = summary_len = 0;
+				g_string_truncate(desc, 0);
+				pkg_compressed = pkg_uncompressed = 0;
 			}
-		}
-		else if (filename && !strncmp(line, "PACKAGE LOCATION:  ", 19))
-		{
-			location = g_strdup(line + 21); /* Exclude ./ at the path beginning */
-		}
-		else if (filename && !strncmp(line, "PACKAGE SIZE (compressed):  ", 28))
-		{
-			/* Remove the unit (kilobytes) */
-			pkg_compressed = atoi(g_strndup(line + 28, strlen(line + 28) - 2)) * 1024;
-		}
-		else if (filename && !strncmp(line, "PACKAGE SIZE (uncompressed):  ", 30))
-		{
-			/* Remove the unit (kilobytes) */
-			pkg_uncompressed = atoi(g_strndup(line + 30, strlen(line + 30) - 2)) * 1024;
-		}
-		else if (filename && !g_strcmp0(line, "PACKAGE DESCRIPTION:"))
-		{
-			g_free(line);
-			line = g_data_input_stream_read_line(data_in, NULL, NULL, NULL); /* Short description */
-
-			summary = g_strstr_len(line, -1, "(");
-			if (summary) /* Else summary = NULL */
+			else if (filename && line_has_prefix(line, len, "PACKAGE LOCATION:  ./"))
 			{
-				summary = g_strndup(summary + 1, strlen(summary) - 2); /* Without ( ) */
+				location = line + 21; /* Exclude ./ at the path beginning */
+				location_len = len - 21;
 			}
-			pkg_tokens = split_package_name(filename);
-			pkg_name_len = strlen(pkg_tokens[0]); /* Description begins with pkg_name: */
-		}
-		else if (filename && !strncmp(line, pkg_tokens[0], pkg_name_len))
-		{
-			g_string_append(desc, line + pkg_name_len + 1);
-		}
-		else if (filename && !g_strcmp0(line, ""))
-		{
-			if (g_strcmp0(location, "patches/packages")) /* Insert a new package */
+			else if (filename && line_has_prefix(line, len, "PACKAGE SIZE (compressed):  "))
+			{
+				/* The unit is kilobytes */
+				pkg_compressed = g_ascii_strtoull(line + 28, NULL, 10) * 1024;
+			}
+			else if (filename && line_has_prefix(line, len, "PACKAGE SIZE (uncompressed):  "))
 			{
-				/* Get the package group based on its location */
-				const char *cat = g_strrstr(location, "/");
-				if (cat) /* Else cat = NULL */
+				/* The unit is kilobytes */
+				pkg_uncompressed = g_ascii_strtoull(line + 30, NULL, 10) * 1024;
+			}
+			else if (filename && len == 20 && line_has_prefix(line, len, "PACKAGE DESCRIPTION:"))
+			{
+				/* Short description */
+				if (next_line(&pos, end, &line, &len)
+				 && (summary = static_cast<const gchar *> (memchr(line, '(', len))))
 				{
-					cat = static_cast<const char *> (g_hash_table_lookup(cat_map, cat + 1));
+					summary++;
+					summary_len = line + len - summary;
+					summary_len = summary_len ? summary_len - 1 : 0; /* Without ( ) */
 				}
-				if (cat)
+			}
+			else if (filename && len > pkg.name_len
+			      && !memcmp(line, pkg.name, pkg.name_len)) /* Description begins with pkg_name: */
+			{
+				g_string_append_len(desc, line + pkg.name_len + 1, len - pkg.name_len - 1);
+			}
+			else if (filename && len == 0)
+			{
+				if (location_len != 16 || memcmp(location, "patches/packages", 16)) /* Insert a new package */
 				{
-					statement = insert_statement;
-					sqlite3_bind_text(insert_statement, 12, cat, -1, SQLITE_TRANSIENT);
+					/* Get the package group based on its location */
+					const gchar *cat = NULL, *slash;
+
+					for (slash = location ? location + location_len : NULL;
+					     slash && slash > location && slash[-1] != '/';
+					     slash--);
+					if (slash && slash > location
+					 && static_cast<gsize> (location + location_len - slash) < max_name_size)
+					{
+						memcpy(cat_name, slash, location + location_len - slash);
+						cat_name[location + location_len - slash] = '\0';
+						cat = static_cast<const gchar *> (g_hash_table_lookup(cat_map, cat_name));
+					}
+					if (cat)
+					{
+						statement = insert_statement;
+						sqlite3_bind_text(insert_statement, 12, cat, -1, SQLITE_STATIC);
+					}
+					else
+					{
+						statement = insert_default_statement;
+					}
+					sqlite3_bind_int(statement, 11, this->get_order ());
 				}
-				else
+				else /* Update package information if it is a patch */
 				{
-					statement = insert_default_statement;
+					statement = update_statement;
 				}
-				sqlite3_bind_int(statement, 11, this->get_order ());
-			}
-			else /* Update package information if it is a patch */
-			{
-				statement = update_statement;
+				sqlite3_bind_text(statement, 1, pkg.full_name, pkg.full_name_len, SQLITE_STATIC);
+				sqlite3_bind_text(statement, 2, pkg.ver, pkg.ver_len, SQLITE_STATIC);
+				sqlite3_bind_text(statement, 3, pkg.arch, pkg.arch_len, SQLITE_STATIC);
+				sqlite3_bind_text(statement, 4, pkg.ext, pkg.ext_len, SQLITE_STATIC);
+				sqlite3_bind_text(statement, 5, location, location_len, SQLITE_STATIC);
+				sqlite3_bind_text(statement, 6, summary, summary_len, SQLITE_STATIC);
+				sqlite3_bind_text(statement, 7, desc->str, desc->len, SQLITE_STATIC);
+				sqlite3_bind_int64(statement, 8, pkg_compressed);
+				sqlite3_bind_int64(statement, 9, pkg_uncompressed);
+				sqlite3_bind_text(statement, 10, pkg.name, pkg.name_len, SQLITE_STATIC);
+
+				sqlite3_step(statement);
+				sqlite3_clear_bindings(statement);
+				sqlite3_reset(statement);
+
+				/* Reset for the next package */
+				filename = NULL;
 			}
-			sqlite3_bind_text(statement, 1, pkg_tokens[3], -1, SQLITE_TRANSIENT);
-			sqlite3_bind_text(statement, 2, pkg_tokens[1], -1, SQLITE_TRANSIENT);
-			sqlite3_bind_text(statement, 3, pkg_tokens[2], -1, SQLITE_TRANSIENT);
-			sqlite3_bind_text(statement, 4, pkg_tokens[4], -1, SQLITE_TRANSIENT);
-			sqlite3_bind_text(statement, 5, location, -1, SQLITE_TRANSIENT);
-			sqlite3_bind_text(statement, 6, summary, -1, SQLITE_TRANSIENT);
-			sqlite3_bind_text(statement, 7, desc->str, -1, SQLITE_TRANSIENT);
-			sqlite3_bind_int(statement, 8, pkg_compressed);
-			sqlite3_bind_int(statement, 9, pkg_uncompressed);
-			sqlite3_bind_text(statement, 10, pkg_tokens[0], -1, SQLITE_TRANSIENT);
-
-			sqlite3_step(statement);
-			sqlite3_clear_bindings(statement);
-			sqlite3_reset(statement);
-
-			/* Reset for the next package */
-			g_strfreev(pkg_tokens);
-			g_free(filename);
-			g_free(location);
-			g_free(summary);
-			filename = location = summary = NULL;
-			g_string_assign(desc, "");
-			pkg_compressed = pkg_uncompressed = 0;
 		}
-		g_free(line);
 	}
-	sqlite3_exec(job_data->db, "END TRANSACTION", NULL, NULL, NULL);
+	sqlite3_exec(db, "END TRANSACTION", NULL, NULL, NULL);
 
 	g_string_free(desc, TRUE);
-	g_object_unref(data_in);
 
 	/* Parse MANIFEST.bz2 */
 	for (gchar **p = this->priority; *p; p++)
 	{
-		filename = g_strconcat(*p, "-MANIFEST.bz2", NULL);
-		manifest (job, tmpl, filename);
-		g_free(filename);
+		path = g_strconcat(*p, "-MANIFEST.bz2", NULL);
+		manifest (db, tmpl, path);
+		g_free(path);
 	}
 out:
 	sqlite3_finalize(update_statement);
@@ -442,10 +507,7 @@ out:
 	sqlite3_finalize(insert_default_statement);
 	sqlite3_finalize(insert_statement);
 
-	if (fin)
-	{
-		g_object_unref(fin);
-	}
+	g_ptr_array_unref(packages_txt);
 }
 
 Slackpkg::~Slackpkg () noexcept
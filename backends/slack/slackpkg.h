@@ -14,15 +14,18 @@ public:
 	~Slackpkg () noexcept;
 
 	GSList *collect_cache_info (const gchar *tmpl) noexcept;
-	void generate_cache (PkBackendJob *job, const gchar *tmpl) noexcept;
+	void generate_cache (sqlite3 *db, const gchar *tmpl) noexcept;
 
 private:
 	static GHashTable *cat_map;
 	static const std::size_t max_buf_size = 8192;
+	static const std::size_t max_name_size = 256;
 	gchar **priority = NULL;
 
-	void manifest (PkBackendJob *job,
+	void manifest (sqlite3 *db,
 			const gchar *tmpl, gchar *filename) noexcept;
+	static void manifest_line (sqlite3_stmt *statement, const gchar *line,
+			gsize len, gchar *full_name, gsize *full_name_len) noexcept;
 };
 
 }
@@ -89,3 +89,14 @@ gboolean pk_directory_remove_contents (const gchar *directory)
 {
 	return TRUE;
 }
+
+void
+pk_backend_job_set_speed (PkBackendJob *job, guint speed)
+{
+}
+
+gboolean
+pk_backend_job_is_cancelled (PkBackendJob *job)
+{
+	return FALSE;
+}
@@ -1,4 +1,6 @@
+#include <glib/gstdio.h>
 #include "dl.h"
+#include "utils.h"
 
 using namespace slack;
 
@@ -15,11 +17,118 @@ slack_test_dl_construct()
 	delete dl;
 }
 
+static guint
+count_rows (sqlite3 *db, const gchar *sql)
+{
+	sqlite3_stmt *stmt;
+	guint rows = 0;
+
+	g_assert_cmpint (sqlite3_prepare_v2 (db, sql, -1, &stmt, NULL), ==, SQLITE_OK);
+	while (sqlite3_step (stmt) == SQLITE_ROW)
+	{
+		rows++;
+	}
+	sqlite3_finalize (stmt);
+
+	return rows;
+}
+
+static void
+slack_test_dl_generate_cache ()
+{
+	gchar *tmp_dir = g_dir_make_tmp ("pk-slack-test-XXXXXX", NULL);
+	gchar *repo_dir = g_build_filename (tmp_dir, "some", NULL);
+	gchar *index_file = g_build_filename (repo_dir, "IndexFile", NULL);
+	gchar *db_filename = g_build_filename (tmp_dir, "metadata.db", NULL);
+	gchar *staging_filename = g_build_filename (tmp_dir, "metadata.db.new", NULL);
+	sqlite3 *db, *staging;
+	auto dl = new Dl ("some", "mirror", 1, "^skipped", NULL);
+
+	g_assert_cmpint (g_mkdir (repo_dir, 0755), ==, 0);
+	g_assert_true (g_file_set_contents (index_file,
+			"foo-1.0-x86_64-1.txz::Foo package:a:b:100:c\n"
+			"bar-baz-2.1-noarch-3.tgz:obsolete:Bar package:a:b:200:c\n"
+			"skipped-1.0-x86_64-1.txz::Blacklisted:a:b:300:c\n"
+			"gnome-1-x86_64-1::Collection:a:b:0:c\n"
+			"kde-1-x86_64-1::Second collection:a:b:0:c\n"
+			"short:a:b",
+			-1, NULL));
+
+	g_assert_cmpint (sqlite3_open (db_filename, &db), ==, SQLITE_OK);
+	g_assert_cmpint (sqlite3_exec (db,
+			"CREATE TABLE repos (repo_order INTEGER PRIMARY KEY AUTOINCREMENT, repo VARCHAR NOT NULL);"
+			"CREATE TABLE pkglist (full_name VARCHAR NOT NULL UNIQUE, name VARCHAR NOT NULL, "
+			"ver VARCHAR NOT NULL, arch VARCHAR DEFAULT NULL, ext VARCHAR DEFAULT NULL, "
+			"location VARCHAR DEFAULT '.', summary VARCHAR DEFAULT '', desc TEXT DEFAULT '', "
+			"compressed INT DEFAULT 0, uncompressed INT DEFAULT 0, cat VARCHAR DEFAULT 'unknown', "
+			"repo_order INTEGER REFERENCES repos(repo_order) ON DELETE CASCADE, "
+			"PRIMARY KEY (name, repo_order));"
+			"CREATE TABLE collections (name VARCHAR NOT NULL, repo_order INTEGER NOT NULL, "
+			"collection_pkg VARCHAR NOT NULL, PRIMARY KEY (name, repo_order, collection_pkg));"
+			"CREATE TABLE filelist (full_name VARCHAR NOT NULL REFERENCES pkglist(full_name) "
+			"ON DELETE CASCADE, filename VARCHAR NOT NULL, PRIMARY KEY (full_name, filename));"
+			"INSERT INTO repos (repo_order, repo) VALUES (1, 'some');"
+			"INSERT INTO pkglist (full_name, name, ver, repo_order) VALUES ('old-1-x86_64-1', 'old', '1', 1)",
+			NULL, NULL, NULL), ==, SQLITE_OK);
+	update_schema (db);
+
+	staging = begin_staging (db, staging_filename);
+	g_assert_nonnull (staging);
+	sqlite3_exec (staging, "DELETE FROM repos", NULL, NULL, NULL);
+	dl->generate_cache (staging, tmp_dir);
+
+	/* The old database is unchanged until the staging database replaces it */
+	g_assert_cmpuint (count_rows (db, "SELECT * FROM pkglist WHERE name = 'old'"), ==, 1);
+	g_assert_true (finish_staging (staging, staging_filename, db_filename));
+	g_assert_false (g_file_test (staging_filename, G_FILE_TEST_EXISTS));
+	g_assert_cmpuint (count_rows (db, "SELECT * FROM pkglist WHERE name = 'old'"), ==, 1);
+	sqlite3_close (db);
+
+	g_assert_cmpint (sqlite3_open (db_filename, &db), ==, SQLITE_OK);
+	g_assert_cmpuint (count_rows (db, "SELECT * FROM pkglist"), ==, 3);
+	g_assert_cmpuint (count_rows (db,
+			"SELECT * FROM pkglist WHERE full_name = 'foo-1.0-x86_64-1' AND name = 'foo' "
+			"AND ver = '1.0' AND arch = 'x86_64' AND ext = 'txz' AND summary = 'Foo package' "
+			"AND compressed = 100 AND cat = 'desktop-gnome'"), ==, 1);
+	g_assert_cmpuint (count_rows (db,
+			"SELECT * FROM pkglist WHERE name = 'bar-baz' AND ext = 'obsolete'"), ==, 1);
+	g_assert_cmpuint (count_rows (db,
+			"SELECT * FROM pkglist WHERE full_name = 'gnome-1-x86_64-1' AND cat = 'collections' "
+			"AND ext IS NULL"), ==, 1);
+	g_assert_cmpuint (count_rows (db,
+			"SELECT * FROM collections WHERE name = 'gnome'"), ==, 2);
+
+	/* The file name indexes are created after the bulk load */
+	g_assert_cmpuint (count_rows (db,
+			"SELECT * FROM sqlite_master WHERE name IN "
+			"('filelist_basename', 'filelist_filename')"), ==, 2);
+
+	/* The trigram tokenizer is optional */
+	if (sqlite3_libversion_number () >= 3034000 && sqlite3_compileoption_used ("ENABLE_FTS5"))
+	{
+		g_assert_cmpuint (count_rows (db,
+				"SELECT * FROM sqlite_master WHERE name = 'filelist_fts'"), ==, 1);
+	}
+	sqlite3_close (db);
+
+	delete dl;
+	g_unlink (db_filename);
+	g_unlink (index_file);
+	g_rmdir (repo_dir);
+	g_rmdir (tmp_dir);
+	g_free (staging_filename);
+	g_free (db_filename);
+	g_free (index_file);
+	g_free (repo_dir);
+	g_free (tmp_dir);
+}
+
 int main(int argc, char *argv[])
 {
 	g_test_init(&argc, &argv, NULL);
 
 	g_test_add_func("/slack/dl/construct", slack_test_dl_construct);
+	g_test_add_func("/slack/dl/generate_cache", slack_test_dl_generate_cache);
 
 	return g_test_run();
 }
@@ -0,0 +1,322 @@
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include "downloader.h"
+
+using namespace slack;
+
+/* A minimal HTTP/1.1 server with keep-alive and range support */
+static GHashTable *files = NULL;
+static GMutex files_mutex;
+static guint16 port = 0;
+static gint connections = 0;
+static gint range_requests = 0;
+static gint ignore_range = 0;
+
+static gpointer
+serve_connection (gpointer user_data)
+{
+	auto connection = static_cast<GSocketConnection *> (user_data);
+	GInputStream *in = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+	GOutputStream *out = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+	GDataInputStream *data_in = g_data_input_stream_new (in);
+	gchar *line;
+
+	g_data_input_stream_set_newline_type (data_in, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+
+	while ((line = g_data_input_stream_read_line (data_in, NULL, NULL, NULL)))
+	{
+		gchar **request = g_strsplit (line, " ", 3);
+		gchar *header, *response;
+		gsize offset = 0;
+		gboolean range = FALSE;
+		GBytes *content;
+
+		g_free (line);
+		while ((header = g_data_input_stream_read_line (data_in, NULL, NULL, NULL)) && *header)
+		{
+			if (g_ascii_strncasecmp (header, "Range: bytes=", 13) == 0)
+			{
+				g_atomic_int_inc (&range_requests);
+				if (!g_atomic_int_get (&ignore_range))
+				{
+					offset = g_ascii_strtoull (header + 13, NULL, 10);
+					range = TRUE;
+				}
+			}
+			g_free (header);
+		}
+		g_free (header);
+
+		if (g_strv_length (request) < 2)
+		{
+			g_strfreev (request);
+			break;
+		}
+		g_mutex_lock (&files_mutex);
+		content = static_cast<GBytes *> (g_hash_table_lookup (files, request[1]));
+		g_mutex_unlock (&files_mutex);
+
+		if (content == NULL)
+		{
+			response = g_strdup ("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n");
+		}
+		else if (range && offset >= g_bytes_get_size (content))
+		{
+			response = g_strdup_printf ("HTTP/1.1 416 Range Not Satisfiable\r\n"
+					"Content-Range: bytes */%" G_GSIZE_FORMAT "\r\n"
+					"Content-Length: 0\r\n\r\n",
+					g_bytes_get_size (content));
+		}
+		else if (range)
+		{
+			response = g_strdup_printf ("HTTP/1.1 206 Partial Content\r\n"
+					"Content-Range: bytes %" G_GSIZE_FORMAT "-%" G_GSIZE_FORMAT "/%" G_GSIZE_FORMAT "\r\n"
+					"Content-Length: %" G_GSIZE_FORMAT "\r\n\r\n",
+					offset, g_bytes_get_size (content) - 1, g_bytes_get_size (content),
+					g_bytes_get_size (content) - offset);
+		}
+		else
+		{
+			response = g_strdup_printf ("HTTP/1.1 200 OK\r\n"
+					"Content-Length: %" G_GSIZE_FORMAT "\r\n\r\n",
+					g_bytes_get_size (content));
+		}
+		g_output_stream_write_all (out, response, strlen (response), NULL, NULL, NULL);
+		if (content != NULL && g_strcmp0 (request[0], "HEAD") != 0
+			&& offset < g_bytes_get_size (content))
+		{
+			g_output_stream_write_all (out,
+					static_cast<const gchar *> (g_bytes_get_data (content, NULL)) + offset,
+					g_bytes_get_size (content) - offset, NULL, NULL, NULL);
+		}
+		g_free (response);
+		g_strfreev (request);
+	}
+
+	g_object_unref (data_in);
+	g_object_unref (connection);
+
+	return NULL;
+}
+
+static gpointer
+serve (gpointer user_data)
+{
+	auto listener = static_cast<GSocketListener *> (user_data);
+	GSocketConnection *connection;
+
+	while ((connection = g_socket_listener_accept (listener, NULL, NULL, NULL)))
+	{
+		g_atomic_int_inc (&connections);
+		g_thread_unref (g_thread_new ("connection", serve_connection, connection));
+	}
+
+	return NULL;
+}
+
+static void
+add_file (const gchar *path, gsize size)
+{
+	auto data = static_cast<gchar *> (g_malloc (size));
+
+	for (gsize i = 0; i < size; i++)
+	{
+		data[i] = 'a' + (i + strlen (path)) % 26;
+	}
+	g_mutex_lock (&files_mutex);
+	g_hash_table_insert (files, g_strdup (path), g_bytes_new_take (data, size));
+	g_mutex_unlock (&files_mutex);
+}
+
+static gchar *
+url (const gchar *path)
+{
+	return g_strdup_printf ("http://127.0.0.1:%u%s", port, path);
+}
+
+static void
+assert_file (const gchar *filename, const gchar *path)
+{
+	gchar *contents;
+	gsize length;
+	auto content = static_cast<GBytes *> (g_hash_table_lookup (files, path));
+
+	g_assert_true (g_file_get_contents (filename, &contents, &length, NULL));
+	g_assert_cmpmem (contents, length,
+			g_bytes_get_data (content, NULL), g_bytes_get_size (content));
+	g_free (contents);
+}
+
+static void
+slack_test_downloader_parallel ()
+{
+	gchar *tmp_dir = g_dir_make_tmp ("pk-slack-test-XXXXXX", NULL);
+	Downloader downloader;
+	guint transfers[6];
+
+	g_atomic_int_set (&connections, 0);
+	for (guint i = 0; i < G_N_ELEMENTS (transfers); i++)
+	{
+		gchar *path = g_strdup_printf ("/parallel/pkg-%u.txz", i);
+		gchar *source_url = url (path);
+
+		add_file (path, 65536 + i);
+		transfers[i] = downloader.add (source_url, tmp_dir, 2);
+
+		g_free (source_url);
+		g_free (path);
+	}
+	g_assert_true (downloader.run (NULL));
+
+	for (guint i = 0; i < G_N_ELEMENTS (transfers); i++)
+	{
+		gchar *path = g_strdup_printf ("/parallel/pkg-%u.txz", i);
+		gchar *filename = g_strdup_printf ("%s/pkg-%u.txz", tmp_dir, i);
+
+		g_assert_cmpint (downloader.get_result (transfers[i]), ==, CURLE_OK);
+		assert_file (filename, path);
+		g_unlink (filename);
+
+		g_free (filename);
+		g_free (path);
+	}
+
+	/* The connections are kept alive and reused */
+	g_assert_cmpint (g_atomic_int_get (&connections), >, 0);
+	g_assert_cmpint (g_atomic_int_get (&connections), <=, 2);
+
+	g_rmdir (tmp_dir);
+	g_free (tmp_dir);
+}
+
+static void
+slack_test_downloader_resume ()
+{
+	gchar *tmp_dir = g_dir_make_tmp ("pk-slack-test-XXXXXX", NULL);
+	gchar *dest = g_build_filename (tmp_dir, "resume.txz", NULL);
+	gchar *part = g_strconcat (dest, ".part", NULL);
+	gchar *source_url = url ("/resume.txz");
+	Downloader downloader;
+
+	add_file ("/resume.txz", 100000);
+	g_assert_true (g_file_set_contents (part,
+			static_cast<const gchar *> (g_bytes_get_data (static_cast<GBytes *> (
+					g_hash_table_lookup (files, "/resume.txz")), NULL)),
+			40000, NULL));
+
+	g_atomic_int_set (&range_requests, 0);
+	downloader.add (source_url, dest, 4);
+	g_assert_true (downloader.run (NULL));
+
+	g_assert_cmpint (g_atomic_int_get (&range_requests), ==, 1);
+	g_assert_false (g_file_test (part, G_FILE_TEST_EXISTS));
+	assert_file (dest, "/resume.txz");
+
+	g_unlink (dest);
+	g_rmdir (tmp_dir);
+	g_free (source_url);
+	g_free (part);
+	g_free (dest);
+	g_free (tmp_dir);
+}
+
+static void
+slack_test_downloader_no_range ()
+{
+	gchar *tmp_dir = g_dir_make_tmp ("pk-slack-test-XXXXXX", NULL);
+	gchar *dest = g_build_filename (tmp_dir, "no-range.txz", NULL);
+	gchar *part = g_strconcat (dest, ".part", NULL);
+	gchar *source_url = url ("/no-range.txz");
+	Downloader downloader;
+	guint transfer;
+
+	/* The mirror answers a resume with the whole file */
+	add_file ("/no-range.txz", 100000);
+	g_assert_true (g_file_set_contents (part, "stale", -1, NULL));
+
+	g_atomic_int_set (&range_requests, 0);
+	g_atomic_int_set (&ignore_range, 1);
+	transfer = downloader.add (source_url, dest, 4);
+	g_assert_true (downloader.run (NULL));
+	g_atomic_int_set (&ignore_range, 0);
+
+	/* Only the first request asked for a range */
+	g_assert_cmpint (downloader.get_result (transfer), ==, CURLE_OK);
+	g_assert_cmpint (g_atomic_int_get (&range_requests), ==, 1);
+	g_assert_false (g_file_test (part, G_FILE_TEST_EXISTS));
+	assert_file (dest, "/no-range.txz");
+
+	g_unlink (dest);
+	g_rmdir (tmp_dir);
+	g_free (source_url);
+	g_free (part);
+	g_free (dest);
+	g_free (tmp_dir);
+}
+
+static void
+slack_test_downloader_not_found ()
+{
+	gchar *tmp_dir = g_dir_make_tmp ("pk-slack-test-XXXXXX", NULL);
+	gchar *dest = g_build_filename (tmp_dir, "missing.txz", NULL);
+	gchar *part = g_strconcat (dest, ".part", NULL);
+	gchar *source_url = url ("/missing.txz");
+	Downloader downloader;
+	guint transfer;
+
+	transfer = downloader.add (source_url, dest, 4);
+	g_assert_false (downloader.run (NULL));
+
+	g_assert_cmpint (downloader.get_result (transfer), !=, CURLE_OK);
+	g_assert_false (g_file_test (dest, G_FILE_TEST_EXISTS));
+	g_assert_false (g_file_test (part, G_FILE_TEST_EXISTS));
+
+	g_rmdir (tmp_dir);
+	g_free (source_url);
+	g_free (part);
+	g_free (dest);
+	g_free (tmp_dir);
+}
+
+static void
+slack_test_downloader_check ()
+{
+	gchar *found = url ("/check.txz"), *missing = url ("/missing.txz");
+	Downloader downloader;
+	guint found_transfer, missing_transfer;
+
+	add_file ("/check.txz", 1024);
+	found_transfer = downloader.add (found, NULL, 4);
+	missing_transfer = downloader.add (missing, NULL, 4);
+	g_assert_false (downloader.run (NULL));
+
+	g_assert_cmpint (downloader.get_result (found_transfer), ==, CURLE_OK);
+	g_assert_cmpint (downloader.get_result (missing_transfer), ==, CURLE_REMOTE_FILE_NOT_FOUND);
+
+	g_free (missing);
+	g_free (found);
+}
+
+int main(int argc, char *argv[])
+{
+	GSocketListener *listener;
+
+	g_test_init(&argc, &argv, NULL);
+	curl_global_init(CURL_GLOBAL_DEFAULT);
+
+	files = g_hash_table_new_full (g_str_hash, g_str_equal,
+			g_free, (GDestroyNotify) g_bytes_unref);
+	listener = g_socket_listener_new ();
+	port = g_socket_listener_add_any_inet_port (listener, NULL, NULL);
+	g_assert_cmpuint (port, >, 0);
+	g_thread_unref (g_thread_new ("server", serve, listener));
+
+	g_test_add_func("/slack/downloader/parallel", slack_test_downloader_parallel);
+	g_test_add_func("/slack/downloader/resume", slack_test_downloader_resume);
+	g_test_add_func("/slack/downloader/no_range", slack_test_downloader_no_range);
+	g_test_add_func("/slack/downloader/not_found", slack_test_downloader_not_found);
+	g_test_add_func("/slack/downloader/check", slack_test_downloader_check);
+
+	return g_test_run();
+}
@@ -1,4 +1,5 @@
 #include "job.h"
+#include "utils.h"
 
 using namespace slack;
 
@@ -26,6 +27,105 @@ test_filter_package_none ()
 	g_assert_true (filter_package (filters, true));
 }
 
+static guint
+count_rows (sqlite3_stmt *stmt)
+{
+	guint rows = 0;
+
+	while (sqlite3_step (stmt) == SQLITE_ROW)
+	{
+		rows++;
+	}
+	sqlite3_reset (stmt);
+
+	return rows;
+}
+
+static void
+test_search_files ()
+{
+	JobData job_data = {};
+	sqlite3_stmt *stmt;
+	gchar pkg[32];
+	gchar *full_text[] = { const_cast<gchar *> ("pkg50"), NULL };
+	gchar *path[] = { const_cast<gchar *> ("/usr/share/pkg7/data3.txt"), NULL };
+	gchar *short_text[] = { const_cast<gchar *> ("7/"), NULL };
+	gdouble indexed, scan;
+
+	g_assert_cmpint (sqlite3_open (":memory:", &job_data.db), ==, SQLITE_OK);
+	g_assert_cmpint (sqlite3_exec (job_data.db,
+			"CREATE TABLE repos (repo_order INTEGER PRIMARY KEY AUTOINCREMENT, repo VARCHAR NOT NULL);"
+			"CREATE TABLE pkglist (full_name VARCHAR NOT NULL UNIQUE, name VARCHAR NOT NULL, "
+			"ver VARCHAR NOT NULL, arch VARCHAR DEFAULT NULL, ext VARCHAR DEFAULT NULL, "
+			"location VARCHAR DEFAULT '.', summary VARCHAR DEFAULT '', desc TEXT DEFAULT '', "
+			"compressed INT DEFAULT 0, uncompressed INT DEFAULT 0, cat VARCHAR DEFAULT 'unknown', "
+			"repo_order INTEGER REFERENCES repos(repo_order) ON DELETE CASCADE, "
+			"PRIMARY KEY (name, repo_order));"
+			"CREATE TABLE filelist (full_name VARCHAR NOT NULL REFERENCES pkglist(full_name) "
+			"ON DELETE CASCADE, filename VARCHAR NOT NULL, PRIMARY KEY (full_name, filename));"
+			"INSERT INTO repos (repo_order, repo) VALUES (1, 'slackware')",
+			NULL, NULL, NULL), ==, SQLITE_OK);
+	update_schema (job_data.db);
+
+	/* 1000 packages with 100 files each */
+	sqlite3_exec (job_data.db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+	for (guint i = 0; i < 1000; i++)
+	{
+		g_snprintf (pkg, sizeof (pkg), "pkg%u", i);
+		stmt = prepare_statement (&job_data,
+				"INSERT INTO pkglist (full_name, name, ver, repo_order) "
+				"VALUES (@name || '-1.0-x86_64-1', @name, '1.0', 1)");
+		sqlite3_bind_text (stmt, 1, pkg, -1, SQLITE_TRANSIENT);
+		g_assert_cmpint (sqlite3_step (stmt), ==, SQLITE_DONE);
+
+		for (guint j = 0; j < 100; j++)
+		{
+			gchar *filename = g_strdup_printf ("usr/share/%s/data%u.txt", pkg, j);
+
+			stmt = prepare_statement (&job_data,
+					"INSERT INTO filelist (full_name, filename, basename) "
+					"VALUES (@name || '-1.0-x86_64-1', @filename, @basename)");
+			sqlite3_bind_text (stmt, 1, pkg, -1, SQLITE_TRANSIENT);
+			sqlite3_bind_text (stmt, 2, filename, -1, SQLITE_TRANSIENT);
+			sqlite3_bind_text (stmt, 3, g_path_get_basename (filename), -1, g_free);
+			g_assert_cmpint (sqlite3_step (stmt), ==, SQLITE_DONE);
+			g_free (filename);
+		}
+	}
+	sqlite3_exec (job_data.db, "END TRANSACTION", NULL, NULL, NULL);
+	index_files (job_data.db);
+
+	/* pkg50 and pkg500 up to pkg509 */
+	g_test_timer_start ();
+	g_assert_nonnull (stmt = prepare_file_search (&job_data, full_text));
+	g_assert_cmpuint (count_rows (stmt), ==, 11);
+	indexed = g_test_timer_elapsed ();
+
+	g_test_timer_start ();
+	g_assert_cmpint (sqlite3_prepare_v2 (job_data.db,
+			"SELECT p.full_name FROM filelist AS f NATURAL JOIN pkglist AS p "
+			"NATURAL JOIN repos AS r WHERE f.filename LIKE '%pkg50%' GROUP BY f.full_name",
+			-1, &stmt, NULL), ==, SQLITE_OK);
+	g_assert_cmpuint (count_rows (stmt), ==, 11);
+	sqlite3_finalize (stmt);
+	scan = g_test_timer_elapsed ();
+
+	g_test_message ("substring file search: %.3f ms indexed, %.3f ms full scan",
+			indexed * 1000, scan * 1000);
+
+	g_test_timer_start ();
+	g_assert_nonnull (stmt = prepare_file_search (&job_data, path));
+	g_assert_cmpuint (count_rows (stmt), ==, 1);
+	g_test_message ("absolute file search: %.3f ms", g_test_timer_elapsed () * 1000);
+
+	/* pkg7, pkg17 up to pkg997 */
+	g_assert_nonnull (stmt = prepare_file_search (&job_data, short_text));
+	g_assert_cmpuint (count_rows (stmt), ==, 100);
+
+	g_hash_table_unref (job_data.statements);
+	sqlite3_close (job_data.db);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -34,6 +134,7 @@ main (int argc, char *argv[])
 	g_test_add_func ("/slack/filter_package_installed", test_filter_package_installed);
 	g_test_add_func ("/slack/filter_package_not_installed", test_filter_package_not_installed);
 	g_test_add_func ("/slack/filter_package_none", test_filter_package_none);
+	g_test_add_func ("/slack/search_files", test_search_files);
 
 	return g_test_run ();
 }
@@ -1,4 +1,8 @@
+#include <bzlib.h>
+#include <glib/gstdio.h>
+#include <string.h>
 #include "slackpkg.h"
+#include "utils.h"
 
 using namespace slack;
 
@@ -15,11 +19,148 @@ slack_test_slackpkg_construct()
 	delete slackpkg;
 }
 
+static guint
+count_rows (sqlite3 *db, const gchar *sql)
+{
+	sqlite3_stmt *stmt;
+	guint rows = 0;
+
+	g_assert_cmpint (sqlite3_prepare_v2 (db, sql, -1, &stmt, NULL), ==, SQLITE_OK);
+	while (sqlite3_step (stmt) == SQLITE_ROW)
+	{
+		rows++;
+	}
+	sqlite3_finalize (stmt);
+
+	return rows;
+}
+
+static void
+write_bz2 (const gchar *filename, const gchar *contents)
+{
+	FILE *fout = fopen (filename, "wb");
+	BZFILE *bz;
+	gint err;
+
+	g_assert_nonnull (fout);
+	bz = BZ2_bzWriteOpen (&err, fout, 9, 0, 0);
+	g_assert_cmpint (err, ==, BZ_OK);
+	BZ2_bzWrite (&err, bz, (void *) contents, strlen (contents));
+	g_assert_cmpint (err, ==, BZ_OK);
+	BZ2_bzWriteClose (&err, bz, 0, NULL, NULL);
+	g_assert_cmpint (err, ==, BZ_OK);
+	fclose (fout);
+}
+
+static void
+slack_test_slackpkg_generate_cache ()
+{
+	gchar *tmp_dir = g_dir_make_tmp ("pk-slack-test-XXXXXX", NULL);
+	gchar *repo_dir = g_build_filename (tmp_dir, "some", NULL);
+	gchar *packages_txt = g_build_filename (repo_dir, "slackware64-PACKAGES.TXT", NULL);
+	gchar *manifest = g_build_filename (repo_dir, "slackware64-MANIFEST.bz2", NULL);
+	const gchar *priority[] = { "slackware64", NULL };
+	sqlite3 *db;
+	auto slackpkg = new Slackpkg ("some", "mirror", 1, "^skipped", g_strdupv (const_cast<gchar **> (priority)));
+
+	g_assert_cmpint (g_mkdir (repo_dir, 0755), ==, 0);
+	g_assert_true (g_file_set_contents (packages_txt,
+			"PACKAGES.TXT;  Mon Jan  1 00:00:00 UTC 2024\n"
+			"\n"
+			"PACKAGE NAME:  aaa_base-14.2-x86_64-2.txz\n"
+			"PACKAGE LOCATION:  ./slackware64/a\n"
+			"PACKAGE SIZE (compressed):  12 K\n"
+			"PACKAGE SIZE (uncompressed):  90 K\n"
+			"PACKAGE DESCRIPTION:\n"
+			"aaa_base: aaa_base (Basic Linux filesystem package)\n"
+			"aaa_base:\n"
+			"aaa_base: Sets up the directory tree.\n"
+			"\n"
+			"PACKAGE NAME:  foo-bar-1.0-noarch-1.tgz\n"
+			"PACKAGE LOCATION:  ./extra/foo\n"
+			"PACKAGE SIZE (compressed):  1 K\n"
+			"PACKAGE SIZE (uncompressed):  2 K\n"
+			"PACKAGE DESCRIPTION:\n"
+			"foo-bar: foo-bar (Foo)\n"
+			"\n"
+			"PACKAGE NAME:  skipped-1.0-x86_64-1.txz\n"
+			"PACKAGE LOCATION:  ./slackware64/a\n"
+			"PACKAGE DESCRIPTION:\n"
+			"skipped: skipped (Blacklisted)\n"
+			"\n",
+			-1, NULL));
+	write_bz2 (manifest,
+			"++========================================\n"
+			"||\n"
+			"||   Package:  ./a/aaa_base-14.2-x86_64-2.txz\n"
+			"||\n"
+			"++========================================\n"
+			"drwxr-xr-x root/root         0 2016-06-30 21:04 ./\n"
+			"drwxr-xr-x root/root         0 2016-06-30 21:04 etc/\n"
+			"-rw-r--r-- root/root       123 2016-06-30 21:04 etc/motd\n"
+			"drwxr-xr-x root/root         0 2016-06-30 21:04 install/\n"
+			"-rw-r--r-- root/root       456 2016-06-30 21:04 install/slack-desc\n"
+			"lrwxrwxrwx root/root         0 2016-06-30 21:04 usr/bin/with space\n"
+			"\n"
+			"++========================================\n"
+			"||\n"
+			"||   Package:  ./a/broken-1.0-x86_64-1.tar\n"
+			"||\n"
+			"++========================================\n"
+			"-rw-r--r-- root/root       123 2016-06-30 21:04 etc/broken\n");
+
+	g_assert_cmpint (sqlite3_open (":memory:", &db), ==, SQLITE_OK);
+	g_assert_cmpint (sqlite3_exec (db,
+			"CREATE TABLE repos (repo_order INTEGER PRIMARY KEY AUTOINCREMENT, repo VARCHAR NOT NULL);"
+			"CREATE TABLE pkglist (full_name VARCHAR NOT NULL UNIQUE, name VARCHAR NOT NULL, "
+			"ver VARCHAR NOT NULL, arch VARCHAR DEFAULT NULL, ext VARCHAR DEFAULT NULL, "
+			"location VARCHAR DEFAULT '.', summary VARCHAR DEFAULT '', desc TEXT DEFAULT '', "
+			"compressed INT DEFAULT 0, uncompressed INT DEFAULT 0, cat VARCHAR DEFAULT 'unknown', "
+			"repo_order INTEGER REFERENCES repos(repo_order) ON DELETE CASCADE, "
+			"PRIMARY KEY (name, repo_order));"
+			"CREATE TABLE filelist (full_name VARCHAR NOT NULL REFERENCES pkglist(full_name) "
+			"ON DELETE CASCADE, filename VARCHAR NOT NULL, PRIMARY KEY (full_name, filename))",
+			NULL, NULL, NULL), ==, SQLITE_OK);
+	update_schema (db);
+
+	slackpkg->generate_cache (db, tmp_dir);
+
+	/* PACKAGES.TXT */
+	g_assert_cmpuint (count_rows (db, "SELECT * FROM pkglist"), ==, 2);
+	g_assert_cmpuint (count_rows (db,
+			"SELECT * FROM pkglist WHERE full_name = 'aaa_base-14.2-x86_64-2' AND name = 'aaa_base' "
+			"AND ver = '14.2' AND arch = 'x86_64' AND ext = 'txz' AND location = 'slackware64/a' "
+			"AND summary = 'Basic Linux filesystem package' AND desc = ' Sets up the directory tree.' "
+			"AND compressed = 12288 AND uncompressed = 92160 AND cat = 'system' AND repo_order = 1"), ==, 1);
+	g_assert_cmpuint (count_rows (db,
+			"SELECT * FROM pkglist WHERE name = 'foo-bar' AND cat = 'unknown'"), ==, 1);
+
+	/* MANIFEST.bz2, without the install scripts and the files of broken names */
+	g_assert_cmpuint (count_rows (db, "SELECT * FROM filelist"), ==, 3);
+	g_assert_cmpuint (count_rows (db,
+			"SELECT * FROM filelist WHERE full_name = 'aaa_base-14.2-x86_64-2' AND "
+			"((filename = 'etc/' AND basename = 'etc') "
+			"OR (filename = 'etc/motd' AND basename = 'motd') "
+			"OR (filename = 'usr/bin/with space' AND basename = 'with space'))"), ==, 3);
+	sqlite3_close (db);
+
+	delete slackpkg;
+	g_unlink (manifest);
+	g_unlink (packages_txt);
+	g_rmdir (repo_dir);
+	g_rmdir (tmp_dir);
+	g_free (manifest);
+	g_free (packages_txt);
+	g_free (repo_dir);
+	g_free (tmp_dir);
+}
+
 int main(int argc, char *argv[])
 {
 	g_test_init(&argc, &argv, NULL);
 
 	g_test_add_func("/slack/slackpkg/construct", slack_test_slackpkg_construct);
+	g_test_add_func("/slack/slackpkg/generate_cache", slack_test_slackpkg_generate_cache);
 
 	return g_test_run();
 }
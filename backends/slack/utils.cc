@@ -1,69 +1,115 @@
+#include <fcntl.h>
+#include <glib/gstdio.h>
 #include <sqlite3.h>
 #include <string.h>
+#include <unistd.h>
 #include "utils.h"
 #include "pkgtools.h"
 
 namespace slack {
 
 /**
- * slack::get_file:
- * @curl: curl easy handle.
- * @source_url: source url.
- * @dest: destination.
+ * slack::prepare_statement:
+ * @job_data: Job data.
+ * @sql: SQL statement.
  *
- * Download the file.
+ * Prepares @sql once per job. Later calls return the same statement, reset
+ * and with cleared bindings. The statements are finalized with the job.
  *
- * Returns: CURLE_OK (zero) on success, non-zero otherwise.
+ * Returns: The statement, %NULL on error.
  **/
-CURLcode
-get_file (CURL **curl, gchar *source_url, gchar *dest)
+sqlite3_stmt *
+prepare_statement (JobData *job_data, const gchar *sql)
 {
-	gchar *dest_dir_name;
-	FILE *fout = NULL;
-	CURLcode ret;
-	glong response_code;
+	sqlite3_stmt *statement;
 
-	if ((*curl == NULL) && (!(*curl = curl_easy_init())))
+	if (job_data->statements == NULL)
 	{
-		return CURLE_BAD_FUNCTION_ARGUMENT;
+		job_data->statements = g_hash_table_new_full(g_str_hash, g_str_equal,
+				g_free, (GDestroyNotify) sqlite3_finalize);
 	}
 
-	curl_easy_setopt(*curl, CURLOPT_FOLLOWLOCATION, 1L);
-	curl_easy_setopt(*curl, CURLOPT_URL, source_url);
-
-	if (dest == NULL)
+	if ((statement = static_cast<sqlite3_stmt *> (g_hash_table_lookup(job_data->statements, sql))))
+	{
+		sqlite3_reset(statement);
+		sqlite3_clear_bindings(statement);
+	}
+	else if (sqlite3_prepare_v2(job_data->db, sql, -1, &statement, NULL) == SQLITE_OK)
 	{
-		curl_easy_setopt(*curl, CURLOPT_NOBODY, 1L);
-		curl_easy_setopt(*curl, CURLOPT_HEADER, 1L);
-		ret = curl_easy_perform(*curl);
-		curl_easy_getinfo(*curl, CURLINFO_RESPONSE_CODE, &response_code);
+		g_hash_table_insert(job_data->statements, g_strdup(sql), statement);
+	}
+	else
+	{
+		statement = NULL;
+	}
+	return statement;
+}
 
-		if (response_code != 200)
-		{
-			ret = CURLE_REMOTE_FILE_NOT_FOUND;
-		}
+static void
+sql_basename (sqlite3_context *context, int argc, sqlite3_value **argv)
+{
+	auto filename = reinterpret_cast<const gchar *> (sqlite3_value_text(argv[0]));
+
+	if (filename)
+	{
+		sqlite3_result_text(context, g_path_get_basename(filename), -1, g_free);
 	}
 	else
 	{
-		if (g_file_test(dest, G_FILE_TEST_IS_DIR))
-		{
-			dest_dir_name = dest;
-			dest = g_strconcat(dest_dir_name, g_strrstr(source_url, "/"), NULL);
-			g_free(dest_dir_name);
-		}
-		if ((fout = fopen(dest, "ab")) == NULL)
-		{
-			return CURLE_WRITE_ERROR;
-		}
-		curl_easy_setopt(*curl, CURLOPT_WRITEDATA, fout);
-		ret = curl_easy_perform(*curl);
+		sqlite3_result_null(context);
 	}
-	curl_easy_reset(*curl);
-	if (fout != NULL)
+}
+
+/**
+ * slack::update_schema:
+ * @db: Metadata database.
+ *
+ * Adds the file name indexes to a database created without them. The
+ * trigram index for substring searches needs SQLite 3.34 with FTS5, file
+ * searches scan the file lists without it.
+ **/
+void
+update_schema (sqlite3 *db)
+{
+	sqlite3_stmt *statement;
+	gboolean has_fts;
+
+	/* The base name of every file, filled in by the cache generation */
+	if (sqlite3_prepare_v2(db, "SELECT basename FROM filelist", -1, &statement, NULL) != SQLITE_OK)
 	{
-		fclose(fout);
+		sqlite3_create_function(db, "basename", 1, SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+				NULL, sql_basename, NULL, NULL);
+		sqlite3_exec(db, "ALTER TABLE filelist ADD COLUMN basename VARCHAR", NULL, NULL, NULL);
+		sqlite3_exec(db, "UPDATE filelist SET basename = basename(filename)", NULL, NULL, NULL);
+	}
+	sqlite3_finalize(statement);
+
+	sqlite3_exec(db,
+			"CREATE INDEX IF NOT EXISTS filelist_basename ON filelist (basename);"
+			"CREATE INDEX IF NOT EXISTS filelist_filename ON filelist (filename)",
+			NULL, NULL, NULL);
+
+	has_fts = sqlite3_prepare_v2(db, "SELECT rowid FROM filelist_fts", -1, &statement, NULL) == SQLITE_OK;
+	sqlite3_finalize(statement);
+	if (!has_fts && sqlite3_exec(db,
+				"CREATE VIRTUAL TABLE filelist_fts USING fts5 (filename, "
+				"content = 'filelist', content_rowid = 'rowid', tokenize = 'trigram')",
+				NULL, NULL, NULL) == SQLITE_OK)
+	{
+		index_files(db);
 	}
-	return ret;
+}
+
+/**
+ * slack::index_files:
+ * @db: Metadata database.
+ *
+ * Rebuilds the substring index after the file lists have been changed.
+ **/
+void
+index_files (sqlite3 *db)
+{
+	sqlite3_exec(db, "INSERT INTO filelist_fts (filelist_fts) VALUES ('rebuild')", NULL, NULL, NULL);
 }
 
 /**
@@ -118,6 +164,166 @@ split_package_name (const gchar *pkg_filename)
 	return pkg_tokens;
 }
 
+/**
+ * slack::parse_package_name:
+ * @pkg_filename: Package file name, or a collection name without extension.
+ * @len: Length of @pkg_filename.
+ * @pkg: The parts of @pkg_filename.
+ *
+ * Splits a package file name like split_package_name(), without copying.
+ *
+ * Returns: %TRUE on success, %FALSE if @pkg_filename is malformed.
+ **/
+gboolean
+parse_package_name (const gchar *pkg_filename, gsize len, PackageName *pkg)
+{
+	const gchar *dashes[3], *end = pkg_filename + len;
+	guint n_dashes = 0;
+
+	if (len >= 4 && pkg_filename[len - 4] == '.')
+	{
+		pkg->full_name = pkg_filename;
+		pkg->full_name_len = len - 4;
+		pkg->ext = pkg_filename + len - 3;
+		pkg->ext_len = 3;
+		end -= 4;
+	}
+	else
+	{
+		pkg->full_name = pkg->ext = NULL;
+		pkg->full_name_len = pkg->ext_len = 0;
+	}
+
+	/* The name can contain dashes, the version, architecture and build not */
+	for (const gchar *it = end; it != pkg_filename && n_dashes < 3; )
+	{
+		if (*--it == '-')
+		{
+			dashes[n_dashes++] = it;
+		}
+	}
+	if (n_dashes < 3)
+	{
+		return FALSE;
+	}
+	pkg->name = pkg_filename;
+	pkg->name_len = dashes[2] - pkg_filename;
+	pkg->ver = dashes[2] + 1;
+	pkg->ver_len = dashes[1] - pkg->ver;
+	pkg->arch = dashes[1] + 1;
+	pkg->arch_len = dashes[0] - pkg->arch;
+
+	return TRUE;
+}
+
+/**
+ * slack::next_line:
+ * @pos: Current position, moved to the beginning of the next line.
+ * @end: End of the text.
+ * @line: Beginning of the line.
+ * @len: Length of the line without the newline.
+ *
+ * Iterates over the lines of a text without copying them.
+ *
+ * Returns: %TRUE if there was a line, %FALSE at the end of the text.
+ **/
+gboolean
+next_line (const gchar **pos, const gchar *end, const gchar **line, gsize *len)
+{
+	const gchar *newline;
+
+	if (*pos >= end)
+	{
+		return FALSE;
+	}
+	newline = static_cast<const gchar *> (memchr(*pos, '\n', end - *pos));
+
+	*line = *pos;
+	*len = (newline ? newline : end) - *pos;
+	*pos = newline ? newline + 1 : end;
+
+	return TRUE;
+}
+
+/**
+ * slack::begin_staging:
+ * @db: Metadata database.
+ * @filename: Staging database file in the directory of @db.
+ *
+ * Copies @db to a staging database for a cache refresh. The staging
+ * database has no journal, since it is thrown away if the refresh fails,
+ * and no file name indexes, finish_staging() creates them after the bulk
+ * load.
+ *
+ * Returns: The staging database, %NULL on error.
+ **/
+sqlite3 *
+begin_staging (sqlite3 *db, const gchar *filename)
+{
+	sqlite3 *staging;
+	sqlite3_backup *backup;
+
+	g_unlink(filename);
+	if (sqlite3_open(filename, &staging) != SQLITE_OK)
+	{
+		sqlite3_close(staging);
+		return NULL;
+	}
+
+	if ((backup = sqlite3_backup_init(staging, "main", db, "main")))
+	{
+		sqlite3_backup_step(backup, -1);
+	}
+	if (!backup || sqlite3_backup_finish(backup) != SQLITE_OK)
+	{
+		sqlite3_close(staging);
+		g_unlink(filename);
+		return NULL;
+	}
+
+	sqlite3_exec(staging,
+			"PRAGMA journal_mode = OFF;"
+			"PRAGMA synchronous = OFF;"
+			"PRAGMA foreign_keys = ON;"
+			"DROP INDEX IF EXISTS filelist_basename;"
+			"DROP INDEX IF EXISTS filelist_filename;"
+			"DROP TABLE IF EXISTS filelist_fts",
+			NULL, NULL, NULL);
+
+	return staging;
+}
+
+/**
+ * slack::finish_staging:
+ * @staging: Database returned by begin_staging().
+ * @filename: Staging database file.
+ * @dest: Metadata database file to replace.
+ *
+ * Creates the file name indexes and replaces @dest with the staging
+ * database in one rename. Connections to the old database keep reading
+ * it until they are closed.
+ *
+ * Returns: %TRUE on success, %FALSE otherwise.
+ **/
+gboolean
+finish_staging (sqlite3 *staging, const gchar *filename, const gchar *dest)
+{
+	gint fd;
+
+	update_schema(staging);
+	sqlite3_close(staging);
+
+	/* The bulk load wasn't synced */
+	if ((fd = g_open(filename, O_RDONLY, 0)) < 0)
+	{
+		return FALSE;
+	}
+	g_fsync(fd);
+	close(fd);
+
+	return g_rename(filename, dest) == 0;
+}
+
 /**
  * slack::is_installed:
  * Checks if a package is already installed in the system.
@@ -1,7 +1,6 @@
 #ifndef __SLACK_UTILS_H
 #define __SLACK_UTILS_H
 
-#include <curl/curl.h>
 #include <pk-backend.h>
 #include <pk-backend-job.h>
 
@@ -12,13 +11,40 @@ struct JobData
 	GObjectClass parent_class;
 
 	sqlite3 *db;
-	CURL *curl;
+	GHashTable *statements;
 };
 
-CURLcode get_file (CURL **curl, gchar *source_url, gchar *dest);
+sqlite3_stmt *prepare_statement (JobData *job_data, const gchar *sql);
+
+void update_schema (sqlite3 *db);
+
+void index_files (sqlite3 *db);
 
 gchar **split_package_name (const gchar *pkg_filename);
 
+/* Parts of a package file name, pointing into the parsed string */
+struct PackageName
+{
+	const gchar *name;
+	gsize name_len;
+	const gchar *ver;
+	gsize ver_len;
+	const gchar *arch;
+	gsize arch_len;
+	const gchar *full_name; /* NULL for collections */
+	gsize full_name_len;
+	const gchar *ext;
+	gsize ext_len;
+};
+
+gboolean parse_package_name (const gchar *pkg_filename, gsize len, PackageName *pkg);
+
+gboolean next_line (const gchar **pos, const gchar *end, const gchar **line, gsize *len);
+
+sqlite3 *begin_staging (sqlite3 *db, const gchar *filename);
+
+gboolean finish_staging (sqlite3 *staging, const gchar *filename, const gchar *dest);
+
 PkInfoEnum is_installed (const gchar *pkg_fullname);
 
 extern "C" {
@@ -2162,12 +2162,21 @@ backend_get_details_thread (PkBackendJob *job, GVariant *params, gpointer user_d
 
 	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
 
+	g_autoptr(GPtrArray) details = g_ptr_array_new_with_free_func (g_object_unref);
 	for (uint i = 0; package_ids[i]; i++) {
 		MIL << package_ids[i] << endl;
 
 		if (zypp_package_is_local(package_ids[i])) {
-			pk_backend_job_details (job, package_ids[i], "", "", PK_GROUP_ENUM_UNKNOWN, "", "", (gulong)0);
-			return;
+			PkDetails *item = pk_details_new ();
+			g_object_set (item,
+				      "package-id", package_ids[i],
+				      "summary", "",
+				      "license", "",
+				      "description", "",
+				      "url", "",
+				      NULL);
+			g_ptr_array_add (details, item);
+			break;
 		}
 
 		sat::Solvable solv = zypp_get_package_by_id( package_ids[i] );
@@ -2201,20 +2210,25 @@ backend_get_details_thread (PkBackendJob *job, GVariant *params, gpointer user_d
 				size = obj->isSystem() ? obj->installSize() : obj->downloadSize();
 			}
 
-			pk_backend_job_details (job,
-				package_ids[i],				// package_id
-				(pkg ? pkg->summary().c_str() : "" ),   // Package summary
-				(pkg ? pkg->license().c_str() : "" ),	// license is Package attribute
-				get_enum_group(pkg ? pkg->group() : ""),// PkGroupEnum
-				obj->description().c_str(),		// description is common attibute
-				(pkg ? pkg->url().c_str() : "" ),	// url is Package attribute
-				(gulong)size);
+			PkDetails *item = pk_details_new ();
+			g_object_set (item,
+				"package-id", package_ids[i],
+				"summary", (pkg ? pkg->summary().c_str() : "" ),	// Package summary
+				"license", (pkg ? pkg->license().c_str() : "" ),	// license is Package attribute
+				"group", get_enum_group(pkg ? pkg->group() : ""),	// PkGroupEnum
+				"description", obj->description().c_str(),		// description is common attibute
+				"url", (pkg ? pkg->url().c_str() : "" ),		// url is Package attribute
+				"size", (guint64)(gulong)size,
+				NULL);
+			g_ptr_array_add (details, item);
 		} catch (const Exception &ex) {
 			zypp_backend_finished_error (
 				job, PK_ERROR_ENUM_INTERNAL_ERROR, ex.asUserString ().c_str ());
 			return;
 		}
 	}
+
+	pk_backend_job_details_list (job, details);
 }
 
 void
@@ -3283,17 +3297,22 @@ pk_backend_get_repo_list (PkBackend *backend, PkBackendJob *job, PkBitfield filt
 		return;
 	}
 
+	g_autoptr(GPtrArray) repo_details = g_ptr_array_new_with_free_func (g_object_unref);
 	for (list <RepoInfo>::iterator it = repos.begin(); it != repos.end(); ++it) {
 		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_DEVELOPMENT) && zypp_is_development_repo (*it))
 			continue;
 		// RepoInfo::alias - Unique identifier for this source.
 		// RepoInfo::name - Short label or description of the
 		// repository, to be used on the user interface
-		pk_backend_job_repo_detail (job,
-					it->alias().c_str(),
-					it->name().c_str(),
-					it->enabled());
+		PkRepoDetail *item = pk_repo_detail_new ();
+		g_object_set (item,
+			      "repo-id", it->alias().c_str(),
+			      "description", it->name().c_str(),
+			      "enabled", (gboolean) it->enabled(),
+			      NULL);
+		g_ptr_array_add (repo_details, item);
 	}
+	pk_backend_job_repo_details (job, repo_details);
 
 	pk_backend_job_finished (job);
 }
@@ -3359,6 +3378,7 @@ backend_get_files_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 
 	zypp_build_pool (zypp, true);
 
+	g_autoptr(GPtrArray) files_list = g_ptr_array_new_with_free_func (g_object_unref);
 	for (uint i = 0; package_ids[i]; i++) {
 		pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
 		sat::Solvable solvable = zypp_get_package_by_id (package_ids[i]);
@@ -3397,8 +3417,15 @@ backend_get_files_thread (PkBackendJob *job, GVariant *params, gpointer user_dat
 		/* Convert to GStrv. */
 		g_ptr_array_add (pkg_files, NULL);
 		strv = g_strdupv ((gchar **) pkg_files->pdata);
-		pk_backend_job_files (job, package_ids[i], strv);
+		PkFiles *item = pk_files_new ();
+		g_object_set (item,
+			      "package-id", package_ids[i],
+			      "files", strv,
+			      NULL);
+		g_ptr_array_add (files_list, item);
 	}
+
+	pk_backend_job_files_list (job, files_list);
 }
 
 /**
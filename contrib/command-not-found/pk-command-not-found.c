@@ -329,24 +329,20 @@ pk_cnf_find_alternatives_case (const gchar *cmd, guint len, GPtrArray *array)
 
 /**
  *
- * Generate a list of commands it might be
+ * Generate a list of unique commands it might be
  **/
 static GPtrArray *
-pk_cnf_find_alternatives (const gchar *cmd, guint len)
+pk_cnf_get_alternatives (const gchar *cmd, guint len)
 {
-	GPtrArray *array;
 	const gchar *cmdt;
-	const gchar *cmdt2;
-	guint i, j;
-	gchar buffer_bin[PK_MAX_PATH_LEN+1];
-	gchar buffer_sbin[PK_MAX_PATH_LEN+1];
-	gboolean ret;
+	guint i;
+	GPtrArray *unique;
 	g_autoptr(GPtrArray) possible = NULL;
-	g_autoptr(GPtrArray) unique = NULL;
+	g_autoptr(GHashTable) seen = NULL;
 
-	array = g_ptr_array_new_with_free_func (g_free);
+	unique = g_ptr_array_new_with_free_func (g_free);
 	possible = g_ptr_array_new_with_free_func (g_free);
-	unique = g_ptr_array_new ();
+	seen = g_hash_table_new (g_str_hash, g_str_equal);
 	pk_cnf_find_alternatives_swizzle (cmd, len, possible);
 	pk_cnf_find_alternatives_replace (cmd, len, possible);
 	if (len > 3)
@@ -356,21 +352,31 @@ pk_cnf_find_alternatives (const gchar *cmd, guint len)
 	pk_cnf_find_alternatives_locale (cmd, len, possible);
 	pk_cnf_find_alternatives_solaris (cmd, len, possible);
 
-	/* remove duplicates using a helper array */
+	/* remove duplicates */
 	for (i = 0; i < possible->len; i++) {
 		cmdt = g_ptr_array_index (possible, i);
-		ret = TRUE;
-		for (j=0; j<unique->len; j++) {
-			cmdt2 = g_ptr_array_index (unique, j);
-			if (strcmp (cmdt, cmdt2) == 0) {
-				ret = FALSE;
-				break;
-			}
-		}
-		/* only add if not duplicate */
-		if (ret)
-			g_ptr_array_add (unique, (gpointer) cmdt);
+		if (!g_hash_table_add (seen, (gpointer) cmdt))
+			continue;
+		g_ptr_array_add (unique, g_strdup (cmdt));
 	}
+	return unique;
+}
+
+/**
+ *
+ * Generate a list of installed commands it might be
+ **/
+static GPtrArray *
+pk_cnf_find_alternatives (GPtrArray *unique)
+{
+	GPtrArray *array;
+	const gchar *cmdt;
+	guint i;
+	gchar buffer_bin[PK_MAX_PATH_LEN+1];
+	gchar buffer_sbin[PK_MAX_PATH_LEN+1];
+	gboolean ret;
+
+	array = g_ptr_array_new_with_free_func (g_free);
 
 	/* ITS4: ignore, source is constant size */
 	strncpy (buffer_bin, "/usr/bin/", PK_MAX_PATH_LEN);
@@ -403,6 +409,34 @@ pk_cnf_find_alternatives (const gchar *cmd, guint len)
 	return array;
 }
 
+/**
+ *
+ * Find the installable commands it might be, and the package names providing them
+ **/
+static GPtrArray *
+pk_cnf_find_available_alternatives (PkCommandIndex *index, GPtrArray *unique)
+{
+	GPtrArray *array;
+	const gchar *cmdt;
+	guint i, j;
+
+	array = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; i < unique->len; i++) {
+		g_auto(GStrv) package_ids = NULL;
+
+		cmdt = g_ptr_array_index (unique, i);
+		package_ids = pk_command_index_lookup (index, cmdt);
+		if (package_ids == NULL)
+			continue;
+		for (j = 0; package_ids[j] != NULL; j++) {
+			g_auto(GStrv) parts = pk_package_id_split (package_ids[j]);
+			g_ptr_array_add (array, g_strdup_printf ("'%s' (%s)", cmdt,
+								 parts[PK_PACKAGE_ID_NAME]));
+		}
+	}
+	return array;
+}
+
 static void
 pk_cnf_progress_cb (PkProgress *progress, PkProgressType type, gpointer data)
 {
@@ -692,22 +726,29 @@ pk_cnf_sigint_handler (int sig)
 static gboolean
 pk_cnf_is_backend_fast_enough_to_do_search (void)
 {
+	static gint cached = -1;
 	gboolean ret = FALSE;
-	gchar *backend;
+	g_autofree gchar *backend = NULL;
 	GError *error = NULL;
 	PkControl *control = NULL;
 
-	/* Initialize PkControl */
-	control = pk_control_new ();
-	ret = pk_control_get_properties (control, cancellable, &error);
-	if (!ret) {
-		/* failed to contact the daemon */
-		g_error_free (error);
-		goto out;
-	}
+	/* only ask the daemon once */
+	if (cached != -1)
+		return cached;
 
-	/* Find backend name */
+	/* Initialize PkControl, which knows the backend if the daemon saved it */
+	control = pk_control_new ();
 	g_object_get (control, "backend-name", &backend, NULL);
+	if (backend == NULL) {
+		ret = pk_control_get_properties (control, cancellable, &error);
+		if (!ret) {
+			/* failed to contact the daemon */
+			g_error_free (error);
+			goto out;
+		}
+		g_object_get (control, "backend-name", &backend, NULL);
+	}
+	ret = TRUE;
 
 	/* Current list of too slow backends */
 	if (g_strcmp0 (backend, "yum") == 0) {
@@ -717,6 +758,7 @@ pk_cnf_is_backend_fast_enough_to_do_search (void)
 out:
 	if (control != NULL)
 		g_object_unref(control);
+	cached = ret;
 	return ret;
 }
 
@@ -735,6 +777,9 @@ main (int argc, char *argv[])
 	const gchar *env_shell;
 	g_autofree gchar *shell_to_free = NULL;
 	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GPtrArray) unique = NULL;
+	g_autoptr(PkCommandIndex) command_index = NULL;
+	g_autoptr(GError) error = NULL;
 	g_auto(GStrv) package_ids = NULL;
 
 	setlocale (LC_ALL, "");
@@ -791,8 +836,17 @@ main (int argc, char *argv[])
 	}
 
 	/* generate swizzles */
-	if (config->similar_name_search)
-		array = pk_cnf_find_alternatives (argv[1], len);
+	if (config->similar_name_search) {
+		unique = pk_cnf_get_alternatives (argv[1], len);
+		array = pk_cnf_find_alternatives (unique);
+	}
+
+	/* the daemon keeps an executable to package map for us */
+	if (config->software_source_search) {
+		command_index = pk_command_index_new_from_file (pk_command_index_get_default_filename (), &error);
+		if (command_index == NULL)
+			g_debug ("not using command index: %s", error->message);
+	}
 
 	/* one exact possibility */
 	if (array != NULL && array->len == 1) {
@@ -851,8 +905,25 @@ main (int argc, char *argv[])
 
 	/* only search using PackageKit if configured to do so */
 	} else if (config->software_source_search &&
-		   pk_cnf_is_backend_fast_enough_to_do_search ()) {
-		package_ids = pk_cnf_find_available (argv[1], config->max_search_time);
+		   (command_index != NULL || pk_cnf_is_backend_fast_enough_to_do_search ())) {
+		/* the daemon removes the index while it is stale, so a
+		 * miss in it is final */
+		if (command_index != NULL)
+			package_ids = pk_command_index_lookup (command_index, argv[1]);
+		else
+			package_ids = pk_cnf_find_available (argv[1], config->max_search_time);
+
+		/* a lookup is cheap, so also suggest installable near-misses */
+		if (package_ids == NULL && command_index != NULL && unique != NULL) {
+			g_autoptr(GPtrArray) available = NULL;
+			available = pk_cnf_find_available_alternatives (command_index, unique);
+			if (available->len > 0) {
+				/* TRANSLATORS: show the user a list of commands and the packages that provide them */
+				g_printerr ("%s\n", _("Packages providing a similar command are:"));
+				for (i = 0; i < available->len; i++)
+					g_printerr ("%s\n", (const gchar *) g_ptr_array_index (available, i));
+			}
+		}
 		if (package_ids == NULL)
 			goto out;
 		len = g_strv_length (package_ids);
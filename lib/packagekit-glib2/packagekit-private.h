@@ -24,6 +24,7 @@
 
 #define __PACKAGEKIT_H_INSIDE__
 
+#include <packagekit-glib2/pk-command-index.h>
 #include <packagekit-glib2/pk-task-sync.h>
 #include <packagekit-glib2/pk-task-text.h>
 #include <packagekit-glib2/pk-console-shared.h>
@@ -37,6 +37,7 @@
 #include <stdlib.h>
 
 #include <packagekit-glib2/pk-client.h>
+#include <packagekit-glib2/pk-client-private.h>
 #include <packagekit-glib2/pk-client-helper.h>
 #include <packagekit-glib2/pk-common.h>
 #include <packagekit-glib2/pk-control.h>
@@ -66,7 +67,12 @@ struct _PkClientPrivate
 	gboolean		 interactive;
 	gboolean		 idle;
 	gboolean		 details_with_deps_size;
+	gboolean		 columnar_results;
 	guint			 cache_age;
+	PkClientStreamFlags	 stream_flags;
+	PkClientStreamCallback	 stream_callback;
+	gpointer		 stream_user_data;
+	GDestroyNotify		 stream_destroy;
 };
 
 enum {
@@ -77,6 +83,7 @@ enum {
 	PROP_IDLE,
 	PROP_CACHE_AGE,
 	PROP_DETAILS_WITH_DEPS_SIZE,
+	PROP_COLUMNAR_RESULTS,
 	PROP_LAST
 };
 
@@ -451,6 +458,9 @@ pk_client_get_property (GObject *object, guint prop_id, GValue *value, GParamSpe
 	case PROP_DETAILS_WITH_DEPS_SIZE:
 		g_value_set_boolean (value, priv->details_with_deps_size);
 		break;
+	case PROP_COLUMNAR_RESULTS:
+		g_value_set_boolean (value, priv->columnar_results);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -483,6 +493,9 @@ pk_client_set_property (GObject *object, guint prop_id, const GValue *value, GPa
 	case PROP_DETAILS_WITH_DEPS_SIZE:
 		priv->details_with_deps_size = g_value_get_boolean (value);
 		break;
+	case PROP_COLUMNAR_RESULTS:
+		priv->columnar_results = g_value_get_boolean (value);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -889,8 +902,10 @@ pk_client_properties_changed_cb (GDBusProxy *proxy,
 		g_variant_get (changed_properties,
 				"a{sv}",
 				&iter);
+		g_object_freeze_notify (G_OBJECT (state->progress));
 		while (g_variant_iter_loop (iter, "{&sv}", &key, &value))
 			pk_client_set_property_value (state, key, value);
+		g_object_thaw_notify (G_OBJECT (state->progress));
 		g_variant_iter_free (iter);
 	}
 }
@@ -906,9 +921,39 @@ pk_client_signal_package (PkClientState *state,
 			  const gchar *summary)
 {
 	gboolean ret;
+	gboolean progress;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(PkPackage) package = NULL;
 
+	/* only emit progress for verb packages */
+	switch (info_enum) {
+	case PK_INFO_ENUM_DOWNLOADING:
+	case PK_INFO_ENUM_UPDATING:
+	case PK_INFO_ENUM_INSTALLING:
+	case PK_INFO_ENUM_REMOVING:
+	case PK_INFO_ENUM_CLEANUP:
+	case PK_INFO_ENUM_OBSOLETING:
+	case PK_INFO_ENUM_REINSTALLING:
+	case PK_INFO_ENUM_DOWNGRADING:
+	case PK_INFO_ENUM_PREPARING:
+	case PK_INFO_ENUM_DECOMPRESSING:
+	case PK_INFO_ENUM_FINISHED:
+		progress = TRUE;
+		break;
+	default:
+		progress = FALSE;
+		break;
+	}
+
+	/* keep the data packed, and don't create an object at all */
+	if (state->client->priv->columnar_results && !progress) {
+		if (state->results != NULL)
+			pk_results_add_package_row (state->results, info_enum,
+						    package_id, summary,
+						    update_severity);
+		return;
+	}
+
 	/* create virtual package */
 	package = pk_package_new ();
 	if (!pk_package_set_id (package, package_id, &error)) {
@@ -927,19 +972,7 @@ pk_client_signal_package (PkClientState *state,
 	if (state->results != NULL && info_enum != PK_INFO_ENUM_FINISHED)
 		pk_results_add_package (state->results, package);
 
-	/* only emit progress for verb packages */
-	switch (info_enum) {
-	case PK_INFO_ENUM_DOWNLOADING:
-	case PK_INFO_ENUM_UPDATING:
-	case PK_INFO_ENUM_INSTALLING:
-	case PK_INFO_ENUM_REMOVING:
-	case PK_INFO_ENUM_CLEANUP:
-	case PK_INFO_ENUM_OBSOLETING:
-	case PK_INFO_ENUM_REINSTALLING:
-	case PK_INFO_ENUM_DOWNGRADING:
-	case PK_INFO_ENUM_PREPARING:
-	case PK_INFO_ENUM_DECOMPRESSING:
-	case PK_INFO_ENUM_FINISHED:
+	if (progress) {
 		ret = pk_progress_set_package_id (state->progress, package_id);
 		if (state->progress_callback != NULL && ret) {
 			state->progress_callback (state->progress,
@@ -952,9 +985,6 @@ pk_client_signal_package (PkClientState *state,
 						  PK_PROGRESS_TYPE_PACKAGE,
 						  state->progress_user_data);
 		}
-		break;
-	default:
-		break;
 	}
 }
 
@@ -1199,6 +1229,36 @@ pk_client_signal_finished (PkClientState *state,
 	pk_client_state_finish (state, NULL);
 }
 
+static void
+results_add_details_from_variant (PkResults   *results,
+                                  GVariant    *dictionary,
+                                  PkRoleEnum   role,
+                                  const gchar *transaction_id)
+{
+	const gchar *key;
+	GVariantIter iter;
+	GVariant *value;
+	g_autoptr(PkDetails) item = pk_details_new ();
+
+	g_variant_iter_init (&iter, dictionary);
+	while (g_variant_iter_loop (&iter, "{&sv}", &key, &value)) {
+		if (g_strcmp0 (key, "group") == 0)
+			g_object_set (item, "group", g_variant_get_uint32 (value), NULL);
+		else if (g_strcmp0 (key, "size") == 0)
+			g_object_set (item, "size", g_variant_get_uint64 (value), NULL);
+		else if (g_strcmp0 (key, "download-size") == 0)
+			g_object_set (item, "download-size", g_variant_get_uint64 (value), NULL);
+		else
+			g_object_set (item, key, g_variant_get_string (value, NULL), NULL);
+	}
+	g_object_set (item,
+		      "role", role,
+		      "transaction-id", transaction_id,
+		      NULL);
+
+	pk_results_add_details (results, item);
+}
+
 static void
 results_add_update_detail_from_variant (PkResults   *results,
                                         GVariant    *update_variant,
@@ -1252,17 +1312,13 @@ results_add_update_detail_from_variant (PkResults   *results,
 }
 
 /*
- * pk_client_signal_cb:
+ * pk_client_signal_handle:
  **/
 static void
-pk_client_signal_cb (GDBusProxy *proxy,
-		     const gchar *sender_name,
-		     const gchar *signal_name,
-		     GVariant *parameters,
-		     gpointer user_data)
+pk_client_signal_handle (PkClientState *state,
+			 const gchar *signal_name,
+			 GVariant *parameters)
 {
-	GWeakRef *weak_ref = user_data;
-	g_autoptr(PkClientState) state = g_weak_ref_get (weak_ref);
 	gchar *tmp_str[12];
 	gboolean tmp_bool;
 	gboolean ret;
@@ -1270,9 +1326,6 @@ pk_client_signal_cb (GDBusProxy *proxy,
 	guint tmp_uint2;
 	guint tmp_uint3;
 
-	if (!state)
-		return;
-
 	if (g_strcmp0 (signal_name, "Finished") == 0) {
 		g_variant_get (parameters,
 			       "(uu)",
@@ -1323,50 +1376,82 @@ pk_client_signal_cb (GDBusProxy *proxy,
 
 		return;
 	}
+	if (g_strcmp0 (signal_name, "PackagesCompact") == 0) {
+		g_autoptr(GVariantIter) iter = NULL;
+		g_autofree const gchar **strings = NULL;
+		g_autoptr(GString) package_id = g_string_new (NULL);
+		gsize n_strings;
+		guint flags, arch, data, summary;
+		const gchar *name, *version;
+
+		g_variant_get (parameters, "(^a&sa(uuuuss))", &strings, &iter);
+		n_strings = g_strv_length ((gchar **) strings);
+
+		while (g_variant_iter_loop (iter, "(uuuu&s&s)",
+					    &flags, &arch, &data, &summary,
+					    &name, &version)) {
+			if (arch >= n_strings || data >= n_strings || summary >= n_strings) {
+				g_warning ("invalid string index in PackagesCompact for %s", name);
+				continue;
+			}
+			g_string_printf (package_id, "%s;%s;%s;%s",
+					 name, version, strings[arch], strings[data]);
+			pk_client_signal_package (state,
+						  flags & 0xFFFF,
+						  (flags >> 16) & 0xFFFF,
+						  package_id->str,
+						  strings[summary]);
+		}
+
+		return;
+	}
 	if (g_strcmp0 (signal_name, "Details") == 0) {
-		gchar *key;
-		GVariantIter *dictionary;
-		GVariant *value;
+		guint64 tmp_uint64;
 		g_autoptr(PkDetails) item = NULL;
-		item = pk_details_new ();
 
 		if (g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(a{sv})"))) {
-			g_variant_get_child (parameters, 0, "a{sv}", &dictionary);
-			while (g_variant_iter_loop (dictionary, "{sv}", &key, &value)) {
-				if (g_strcmp0 (key, "group") == 0)
-					g_object_set (item, "group", g_variant_get_uint32 (value), NULL);
-				else if (g_strcmp0 (key, "size") == 0)
-					g_object_set (item, "size", g_variant_get_uint64 (value), NULL);
-				else if (g_strcmp0 (key, "download-size") == 0)
-					g_object_set (item, "download-size", g_variant_get_uint64 (value), NULL);
-				else
-					g_object_set (item, key, g_variant_get_string (value, NULL), NULL);
-			}
-			g_variant_iter_free (dictionary);
-		} else {
-			guint64 tmp_uint64;
-			g_variant_get (parameters,
-				       "(&s&su&s&st)",
-				       &tmp_str[0],
-				       &tmp_str[1],
-				       &tmp_uint,
-				       &tmp_str[3],
-				       &tmp_str[4],
-				       &tmp_uint64);
-			g_object_set (item,
-				      "package-id", tmp_str[0],
-				      "license", tmp_str[1],
-				      "group", tmp_uint,
-				      "description", tmp_str[3],
-				      "url", tmp_str[4],
-				      "size", tmp_uint64,
-				      "role", state->role,
-				      "transaction-id", state->transaction_id,
-				      NULL);
+			g_autoptr(GVariant) dictionary = g_variant_get_child_value (parameters, 0);
+			results_add_details_from_variant (state->results, dictionary,
+							  state->role, state->transaction_id);
+			return;
 		}
+
+		/* the old fixed signature */
+		g_variant_get (parameters,
+			       "(&s&su&s&st)",
+			       &tmp_str[0],
+			       &tmp_str[1],
+			       &tmp_uint,
+			       &tmp_str[3],
+			       &tmp_str[4],
+			       &tmp_uint64);
+		item = pk_details_new ();
+		g_object_set (item,
+			      "package-id", tmp_str[0],
+			      "license", tmp_str[1],
+			      "group", tmp_uint,
+			      "description", tmp_str[3],
+			      "url", tmp_str[4],
+			      "size", tmp_uint64,
+			      "role", state->role,
+			      "transaction-id", state->transaction_id,
+			      NULL);
 		pk_results_add_details (state->results, item);
 		return;
 	}
+	if (g_strcmp0 (signal_name, "DetailsList") == 0) {
+		g_autoptr(GVariant) list = g_variant_get_child_value (parameters, 0);
+		GVariantIter iter;
+		GVariant *dictionary;
+
+		g_variant_iter_init (&iter, list);
+		while ((dictionary = g_variant_iter_next_value (&iter))) {
+			results_add_details_from_variant (state->results, dictionary,
+							  state->role, state->transaction_id);
+			g_variant_unref (dictionary);
+		}
+		return;
+	}
 	if (g_strcmp0 (signal_name, "UpdateDetail") == 0) {
 		results_add_update_detail_from_variant (state->results, parameters,
 							state->role, state->transaction_id);
@@ -1487,6 +1572,27 @@ pk_client_signal_cb (GDBusProxy *proxy,
 		pk_results_add_files (state->results, item);
 		return;
 	}
+	if (g_strcmp0 (signal_name, "FilesList") == 0) {
+		g_autoptr(GVariantIter) iter = NULL;
+
+		g_variant_get (parameters, "(a(sas))", &iter);
+		while (TRUE) {
+			g_autofree gchar **files = NULL;
+			g_autoptr(PkFiles) item = NULL;
+
+			if (!g_variant_iter_next (iter, "(&s^a&s)", &tmp_str[0], &files))
+				break;
+			item = pk_files_new ();
+			g_object_set (item,
+				      "package-id", tmp_str[0],
+				      "files", files,
+				      "role", state->role,
+				      "transaction-id", state->transaction_id,
+				      NULL);
+			pk_results_add_files (state->results, item);
+		}
+		return;
+	}
 	if (g_strcmp0 (signal_name, "RepoSignatureRequired") == 0) {
 		g_autoptr(PkRepoSignatureRequired) item = NULL;
 		g_variant_get (parameters,
@@ -1553,6 +1659,23 @@ pk_client_signal_cb (GDBusProxy *proxy,
 		pk_results_add_repo_detail (state->results, item);
 		return;
 	}
+	if (g_strcmp0 (signal_name, "RepoDetails") == 0) {
+		g_autoptr(GVariantIter) iter = NULL;
+
+		g_variant_get (parameters, "(a(ssb))", &iter);
+		while (g_variant_iter_next (iter, "(&s&sb)", &tmp_str[0], &tmp_str[1], &tmp_bool)) {
+			g_autoptr(PkRepoDetail) item = pk_repo_detail_new ();
+			g_object_set (item,
+				      "repo-id", tmp_str[0],
+				      "description", tmp_str[1],
+				      "enabled", tmp_bool,
+				      "role", state->role,
+				      "transaction-id", state->transaction_id,
+				      NULL);
+			pk_results_add_repo_detail (state->results, item);
+		}
+		return;
+	}
 	if (g_strcmp0 (signal_name, "ErrorCode") == 0) {
 		g_autoptr(PkError) item = NULL;
 		g_variant_get (parameters,
@@ -1622,6 +1745,124 @@ pk_client_signal_cb (GDBusProxy *proxy,
 	}
 }
 
+/*
+ * pk_client_signal_is_streamed:
+ **/
+static gboolean
+pk_client_signal_is_streamed (const gchar *signal_name)
+{
+	const gchar *streamed[] = { "Package", "Packages", "PackagesCompact", "Details",
+				    "DetailsList", "UpdateDetail", "UpdateDetails",
+				    "Files", "FilesList", NULL };
+	return g_strv_contains (streamed, signal_name);
+}
+
+/*
+ * pk_client_results_is_empty:
+ **/
+static gboolean
+pk_client_results_is_empty (PkResults *results)
+{
+	g_autoptr(GPtrArray) details = pk_results_get_details_array (results);
+	g_autoptr(GPtrArray) update_details = pk_results_get_update_detail_array (results);
+	g_autoptr(GPtrArray) files = pk_results_get_files_array (results);
+
+	return pk_results_get_package_count (results) == 0 &&
+	       details->len == 0 &&
+	       update_details->len == 0 &&
+	       files->len == 0;
+}
+
+/*
+ * pk_client_state_signal:
+ **/
+static void
+pk_client_state_signal (PkClientState *state,
+			const gchar *signal_name,
+			GVariant *parameters)
+{
+	g_autoptr(PkClient) client = NULL;
+	g_autoptr(PkResults) batch = NULL;
+	PkClientStreamFlags flags;
+	PkResults *results;
+
+	if (state->client->priv->stream_callback == NULL ||
+	    !pk_client_signal_is_streamed (signal_name)) {
+		pk_client_signal_handle (state, signal_name, parameters);
+		return;
+	}
+
+	/* decode into a results object of its own so the callback only
+	 * sees what arrived in this signal */
+	batch = pk_results_new ();
+	g_object_set (batch,
+		      "role", state->role,
+		      "progress", state->progress,
+		      "transaction-flags", state->transaction_flags,
+		      NULL);
+	results = state->results;
+	state->results = batch;
+	pk_client_signal_handle (state, signal_name, parameters);
+	state->results = results;
+
+	/* a Package signal may only have updated the progress */
+	if (pk_client_results_is_empty (batch))
+		return;
+
+	/* the callback may drop the last reference to the client */
+	client = g_object_ref (state->client);
+	flags = client->priv->stream_flags;
+	client->priv->stream_callback (client, batch, client->priv->stream_user_data);
+	if ((flags & PK_CLIENT_STREAM_FLAGS_NO_ACCUMULATE) == 0)
+		pk_results_append (state->results, batch);
+}
+
+/*
+ * pk_client_signal_cb:
+ **/
+static void
+pk_client_signal_cb (GDBusProxy *proxy,
+		     const gchar *sender_name,
+		     const gchar *signal_name,
+		     GVariant *parameters,
+		     gpointer user_data)
+{
+	GWeakRef *weak_ref = user_data;
+	g_autoptr(PkClientState) state = g_weak_ref_get (weak_ref);
+
+	if (!state)
+		return;
+	pk_client_state_signal (state, signal_name, parameters);
+}
+
+/*
+ * pk_client_signal_emit:
+ *
+ * Handles a transaction signal as if it came from the daemon, so the
+ * self tests can see what gets streamed. A floating @parameters is
+ * consumed.
+ **/
+void
+pk_client_signal_emit (PkClient *client,
+		       PkRoleEnum role,
+		       PkResults *results,
+		       const gchar *signal_name,
+		       GVariant *parameters)
+{
+	g_autoptr(GVariant) parameters_sunk = g_variant_ref_sink (parameters);
+	g_autoptr(PkClientState) state = NULL;
+
+	g_return_if_fail (PK_IS_CLIENT (client));
+	g_return_if_fail (PK_IS_RESULTS (results));
+
+	state = g_object_new (PK_TYPE_CLIENT_STATE, NULL);
+	state->client = g_object_ref (client);
+	state->role = role;
+	state->results = g_object_ref (results);
+	state->progress = pk_progress_new ();
+	pk_client_state_signal (state, signal_name, parameters_sunk);
+}
+
 static void
 pk_client_notify_name_owner_cb (GObject *obj,
 				GParamSpec *pspec,
@@ -1656,6 +1897,7 @@ pk_client_proxy_connect (PkClientState *state)
 
 	/* coldplug properties */
 	props = g_dbus_proxy_get_cached_property_names (state->proxy);
+	g_object_freeze_notify (G_OBJECT (state->progress));
 	for (i = 0; props != NULL && props[i] != NULL; i++) {
 		g_autoptr(GVariant) value_tmp = NULL;
 		value_tmp = g_dbus_proxy_get_cached_property (state->proxy,
@@ -1664,6 +1906,7 @@ pk_client_proxy_connect (PkClientState *state)
 					      props[i],
 					      value_tmp);
 	}
+	g_object_thaw_notify (G_OBJECT (state->progress));
 
 	/* connect up signals */
 	g_signal_connect_data (state->proxy, "g-properties-changed",
@@ -2314,6 +2557,8 @@ pk_client_get_proxy_cb (GObject *object,
 
 	/* Always set the supports-plural-signals hint to get higher performance signals */
 	g_ptr_array_add (array, g_strdup ("supports-plural-signals=true"));
+	g_ptr_array_add (array, g_strdup ("supports-list-signals=true"));
+	g_ptr_array_add (array, g_strdup ("supports-compact-signals=true"));
 
 	/* create socket for roles that need interaction */
 	if (state->role == PK_ROLE_ENUM_INSTALL_FILES ||
@@ -4687,6 +4932,87 @@ pk_client_get_details_with_deps_size (PkClient *client)
 	return client->priv->details_with_deps_size;
 }
 
+/**
+ * pk_client_set_columnar_results:
+ * @client: a valid #PkClient instance
+ * @columnar_results: the value to set
+ *
+ * Sets whether packages in the results should be kept in packed arrays
+ * rather than as one #PkPackage per package. The objects are only created if
+ * pk_results_get_package_array() or pk_results_get_package_sack() is called,
+ * and pk_results_package_iter_init() reads the data without them. This makes
+ * transactions that return tens of thousands of packages much cheaper.
+ *
+ * Since: 1.3.0
+ **/
+void
+pk_client_set_columnar_results (PkClient *client, gboolean columnar_results)
+{
+	g_return_if_fail (PK_IS_CLIENT (client));
+
+	if (client->priv->columnar_results == columnar_results)
+		return;
+
+	client->priv->columnar_results = columnar_results;
+	g_object_notify (G_OBJECT (client), "columnar-results");
+}
+
+/**
+ * pk_client_get_columnar_results:
+ * @client: a valid #PkClient instance
+ *
+ * Gets the client columnar-results value.
+ *
+ * Returns: whether packages in the results are kept in packed arrays
+ *
+ * Since: 1.3.0
+ **/
+gboolean
+pk_client_get_columnar_results (PkClient *client)
+{
+	g_return_val_if_fail (PK_IS_CLIENT (client), FALSE);
+	return client->priv->columnar_results;
+}
+
+/**
+ * pk_client_set_stream_callback:
+ * @client: a valid #PkClient instance
+ * @flags: a #PkClientStreamFlags, e.g. %PK_CLIENT_STREAM_FLAGS_NO_ACCUMULATE
+ * @callback: (scope notified) (nullable): the function to call, or %NULL to stop streaming
+ * @user_data: (closure callback): data to pass to @callback
+ * @destroy: (nullable): the function to free @user_data with
+ *
+ * Sets a function that is called with the packages, details, update details
+ * and files of every transaction started by @client as soon as they have
+ * been decoded, rather than only when the transaction finishes. This allows
+ * search results to be shown while the backend is still producing them.
+ *
+ * With %PK_CLIENT_STREAM_FLAGS_NO_ACCUMULATE these items are not kept in the
+ * #PkResults passed to the finish function, so memory use does not grow with
+ * the size of the transaction.
+ *
+ * Since: 1.3.0
+ **/
+void
+pk_client_set_stream_callback (PkClient *client,
+			       PkClientStreamFlags flags,
+			       PkClientStreamCallback callback,
+			       gpointer user_data,
+			       GDestroyNotify destroy)
+{
+	PkClientPrivate *priv;
+
+	g_return_if_fail (PK_IS_CLIENT (client));
+
+	priv = client->priv;
+	if (priv->stream_destroy != NULL)
+		priv->stream_destroy (priv->stream_user_data);
+	priv->stream_flags = flags;
+	priv->stream_callback = callback;
+	priv->stream_user_data = user_data;
+	priv->stream_destroy = destroy;
+}
+
 /*
  * pk_client_class_init:
  **/
@@ -4763,6 +5089,16 @@ pk_client_class_init (PkClientClass *klass)
 				      FALSE,
 				      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
 	g_object_class_install_property (object_class, PROP_DETAILS_WITH_DEPS_SIZE, pspec);
+
+	/**
+	 * PkClient:columnar-results:
+	 *
+	 * Since: 1.3.0
+	 */
+	pspec = g_param_spec_boolean ("columnar-results", NULL, NULL,
+				      FALSE,
+				      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS);
+	g_object_class_install_property (object_class, PROP_COLUMNAR_RESULTS, pspec);
 }
 
 /*
@@ -4778,6 +5114,7 @@ pk_client_init (PkClient *client)
 	client->priv->idle = TRUE;
 	client->priv->cache_age = G_MAXUINT;
 	client->priv->details_with_deps_size = FALSE;
+	client->priv->columnar_results = FALSE;
 
 	/* use a control object */
 	client->priv->control = pk_control_new ();
@@ -4798,6 +5135,8 @@ pk_client_finalize (GObject *object)
 	/* ensure we cancel any in-flight DBus calls */
 	pk_client_cancel_all_dbus_methods (client);
 
+	if (priv->stream_destroy != NULL)
+		priv->stream_destroy (priv->stream_user_data);
 	g_free (client->priv->locale);
 	g_object_unref (priv->control);
 	g_ptr_array_unref (priv->calls);
@@ -79,6 +79,21 @@ typedef enum
 	PK_CLIENT_ERROR_LAST
 } PkClientError;
 
+/**
+ * PkClientStreamFlags:
+ * @PK_CLIENT_STREAM_FLAGS_NONE:		No specific flag
+ * @PK_CLIENT_STREAM_FLAGS_NO_ACCUMULATE:	Do not also add the streamed items to the #PkResults returned when the transaction finishes
+ *
+ * Flags to control how results are passed to a #PkClientStreamCallback.
+ *
+ * Since: 1.3.0
+ */
+typedef enum
+{
+	PK_CLIENT_STREAM_FLAGS_NONE		= 0,
+	PK_CLIENT_STREAM_FLAGS_NO_ACCUMULATE	= 1 << 0
+} PkClientStreamFlags;
+
 typedef struct _PkClientPrivate		PkClientPrivate;
 typedef struct _PkClient		PkClient;
 typedef struct _PkClientClass		PkClientClass;
@@ -93,6 +108,21 @@ struct _PkClient
 	 PkClientPrivate	*priv;
 };
 
+/**
+ * PkClientStreamCallback:
+ * @client: the #PkClient
+ * @batch: a #PkResults holding only the items decoded from one signal
+ * @user_data: user data passed to pk_client_set_stream_callback()
+ *
+ * Receives packages, details, update details and files as they arrive
+ * from the daemon, before the transaction has finished.
+ *
+ * Since: 1.3.0
+ */
+typedef void (*PkClientStreamCallback) (PkClient	*client,
+					PkResults	*batch,
+					gpointer	 user_data);
+
 struct _PkClientClass
 {
 	GObjectClass	parent_class;
@@ -434,6 +464,14 @@ guint		 pk_client_get_cache_age		(PkClient		*client);
 void		 pk_client_set_details_with_deps_size	(PkClient		*client,
 							 gboolean		 details_with_deps_size);
 gboolean	 pk_client_get_details_with_deps_size	(PkClient		*client);
+void		 pk_client_set_columnar_results		(PkClient		*client,
+							 gboolean		 columnar_results);
+gboolean	 pk_client_get_columnar_results		(PkClient		*client);
+void		 pk_client_set_stream_callback		(PkClient		*client,
+							 PkClientStreamFlags	 flags,
+							 PkClientStreamCallback	 callback,
+							 gpointer		 user_data,
+							 GDestroyNotify		 destroy);
 
 G_END_DECLS
 
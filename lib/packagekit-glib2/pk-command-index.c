@@ -0,0 +1,298 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+/*
+ * A map of executables to the packages providing them. The daemon writes
+ * this map after refreshing the cache so that command-not-found can answer
+ * without a transaction. Readers only ever map the file, so a lookup costs
+ * a binary search.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "pk-command-index.h"
+
+#define PK_COMMAND_INDEX_MAGIC		"PKCMDIX"
+#define PK_COMMAND_INDEX_VERSION	1
+
+/*
+ *   header
+ *   commands[n_commands]	sorted by name
+ *   refs[n_refs]		string offsets of package-ids, per command
+ *   strings			NUL terminated, package-ids shared
+ */
+typedef struct {
+	gchar		 magic[8];
+	guint32		 version;
+	guint32		 n_commands;
+	guint32		 n_refs;
+	guint32		 strings_size;
+} PkCommandIndexHeader;
+
+typedef struct {
+	guint32		 name;
+	guint32		 first_ref;
+	guint32		 n_refs;
+} PkCommandIndexCommand;
+
+struct PkCommandIndex
+{
+	GMappedFile			*mapped;
+	const PkCommandIndexHeader	*header;
+	const PkCommandIndexCommand	*commands;
+	const guint32			*refs;
+	const gchar			*strings;
+};
+
+/**
+ * pk_command_index_get_default_filename:
+ *
+ * Return value: where the daemon keeps the index
+ **/
+const gchar *
+pk_command_index_get_default_filename (void)
+{
+	return LOCALSTATEDIR "/cache/PackageKit/command-index";
+}
+
+/**
+ * pk_command_index_free:
+ * @index: a #PkCommandIndex
+ **/
+void
+pk_command_index_free (PkCommandIndex *index)
+{
+	if (index == NULL)
+		return;
+	if (index->mapped != NULL)
+		g_mapped_file_unref (index->mapped);
+	g_free (index);
+}
+
+/**
+ * pk_command_index_new_from_file:
+ * @filename: the index file
+ * @error: a #GError, or %NULL
+ *
+ * Maps and validates an index written by pk_command_index_write().
+ *
+ * Return value: a new #PkCommandIndex, or %NULL for error
+ **/
+PkCommandIndex *
+pk_command_index_new_from_file (const gchar *filename, GError **error)
+{
+	const PkCommandIndexHeader *header;
+	const gchar *data;
+	gsize size;
+	gsize expected;
+	g_autoptr(PkCommandIndex) index = g_new0 (PkCommandIndex, 1);
+
+	index->mapped = g_mapped_file_new (filename, FALSE, error);
+	if (index->mapped == NULL)
+		return NULL;
+	data = g_mapped_file_get_contents (index->mapped);
+	size = g_mapped_file_get_length (index->mapped);
+
+	/* validate everything up front so lookups don't have to */
+	if (size < sizeof (PkCommandIndexHeader)) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+			     "%s is truncated", filename);
+		return NULL;
+	}
+	header = (const PkCommandIndexHeader *) data;
+	if (memcmp (header->magic, PK_COMMAND_INDEX_MAGIC, sizeof (header->magic)) != 0 ||
+	    header->version != PK_COMMAND_INDEX_VERSION) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+			     "%s is not a command index of version %i",
+			     filename, PK_COMMAND_INDEX_VERSION);
+		return NULL;
+	}
+	expected = sizeof (PkCommandIndexHeader) +
+		   (gsize) header->n_commands * sizeof (PkCommandIndexCommand) +
+		   (gsize) header->n_refs * sizeof (guint32) +
+		   header->strings_size;
+	if (size != expected || header->strings_size == 0) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+			     "%s has an invalid size", filename);
+		return NULL;
+	}
+
+	index->commands = (const PkCommandIndexCommand *) (data + sizeof (PkCommandIndexHeader));
+	index->refs = (const guint32 *) (index->commands + header->n_commands);
+	index->strings = (const gchar *) (index->refs + header->n_refs);
+	if (index->strings[header->strings_size - 1] != '\0') {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+			     "%s has an invalid string pool", filename);
+		return NULL;
+	}
+	for (guint i = 0; i < header->n_commands; i++) {
+		const PkCommandIndexCommand *command = &index->commands[i];
+		if (command->name >= header->strings_size ||
+		    command->first_ref > header->n_refs ||
+		    command->n_refs > header->n_refs - command->first_ref) {
+			g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				     "%s has an invalid command", filename);
+			return NULL;
+		}
+	}
+	for (guint i = 0; i < header->n_refs; i++) {
+		if (index->refs[i] >= header->strings_size) {
+			g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				     "%s has an invalid package reference", filename);
+			return NULL;
+		}
+	}
+	index->header = header;
+	return g_steal_pointer (&index);
+}
+
+/**
+ * pk_command_index_lookup:
+ * @index: a #PkCommandIndex
+ * @command: an executable name, e.g. "make"
+ *
+ * Return value: (transfer full): the package-ids providing @command in a
+ * binary directory, or %NULL if there are none
+ **/
+gchar **
+pk_command_index_lookup (PkCommandIndex *index, const gchar *command)
+{
+	guint lo = 0;
+	guint hi;
+
+	g_return_val_if_fail (index != NULL, NULL);
+	g_return_val_if_fail (command != NULL, NULL);
+
+	hi = index->header->n_commands;
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+		const PkCommandIndexCommand *item = &index->commands[mid];
+		gint rc = strcmp (command, index->strings + item->name);
+		gchar **package_ids;
+
+		if (rc < 0) {
+			hi = mid;
+			continue;
+		}
+		if (rc > 0) {
+			lo = mid + 1;
+			continue;
+		}
+		if (item->n_refs == 0)
+			return NULL;
+		package_ids = g_new0 (gchar *, item->n_refs + 1);
+		for (guint i = 0; i < item->n_refs; i++)
+			package_ids[i] = g_strdup (index->strings + index->refs[item->first_ref + i]);
+		return package_ids;
+	}
+	return NULL;
+}
+
+static guint32
+pk_command_index_add_string (GByteArray *strings, GHashTable *offsets, const gchar *str)
+{
+	gpointer value;
+	guint32 offset;
+
+	if (g_hash_table_lookup_extended (offsets, str, NULL, &value))
+		return GPOINTER_TO_UINT (value);
+	offset = strings->len;
+	g_byte_array_append (strings, (const guint8 *) str, strlen (str) + 1);
+	g_hash_table_insert (offsets, (gpointer) str, GUINT_TO_POINTER (offset));
+	return offset;
+}
+
+/**
+ * pk_command_index_write:
+ * @filename: the index file
+ * @commands: (element-type utf8 GPtrArray): command name to a #GPtrArray
+ * of package-ids
+ * @error: a #GError, or %NULL
+ *
+ * Atomically replaces @filename with an index of @commands.
+ *
+ * Return value: %TRUE for success
+ **/
+gboolean
+pk_command_index_write (const gchar *filename, GHashTable *commands, GError **error)
+{
+	PkCommandIndexHeader header;
+	g_autofree gchar *dirname = NULL;
+	g_autoptr(GByteArray) data = g_byte_array_new ();
+	g_autoptr(GByteArray) strings = g_byte_array_new ();
+	g_autoptr(GArray) records = g_array_new (FALSE, FALSE, sizeof (PkCommandIndexCommand));
+	g_autoptr(GArray) refs = g_array_new (FALSE, FALSE, sizeof (guint32));
+	g_autoptr(GHashTable) offsets = g_hash_table_new (g_str_hash, g_str_equal);
+	g_autoptr(GList) names = NULL;
+
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (commands != NULL, FALSE);
+
+	/* keep the pool non-empty even when there are no commands */
+	g_byte_array_append (strings, (const guint8 *) "", 1);
+
+	names = g_list_sort (g_hash_table_get_keys (commands), (GCompareFunc) strcmp);
+	for (GList *l = names; l != NULL; l = l->next) {
+		const gchar *name = l->data;
+		GPtrArray *package_ids = g_hash_table_lookup (commands, name);
+		PkCommandIndexCommand record;
+
+		record.name = pk_command_index_add_string (strings, offsets, name);
+		record.first_ref = refs->len;
+		for (guint i = 0; i < package_ids->len; i++) {
+			guint32 ref = pk_command_index_add_string (strings, offsets,
+								   g_ptr_array_index (package_ids, i));
+			g_array_append_val (refs, ref);
+		}
+		record.n_refs = refs->len - record.first_ref;
+		g_array_append_val (records, record);
+	}
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, PK_COMMAND_INDEX_MAGIC, sizeof (PK_COMMAND_INDEX_MAGIC));
+	header.version = PK_COMMAND_INDEX_VERSION;
+	header.n_commands = records->len;
+	header.n_refs = refs->len;
+	header.strings_size = strings->len;
+	g_byte_array_append (data, (const guint8 *) &header, sizeof (header));
+	g_byte_array_append (data, (const guint8 *) records->data,
+			     records->len * sizeof (PkCommandIndexCommand));
+	g_byte_array_append (data, (const guint8 *) refs->data,
+			     refs->len * sizeof (guint32));
+	g_byte_array_append (data, strings->data, strings->len);
+
+	dirname = g_path_get_dirname (filename);
+	if (g_mkdir_with_parents (dirname, 0755) != 0) {
+		g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+			     "failed to create %s", dirname);
+		return FALSE;
+	}
+	if (!g_file_set_contents (filename, (const gchar *) data->data, data->len, error))
+		return FALSE;
+
+	/* command-not-found runs as the user */
+	g_chmod (filename, 0644);
+	return TRUE;
+}
@@ -0,0 +1,45 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#ifndef __PK_COMMAND_INDEX_H
+#define __PK_COMMAND_INDEX_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct PkCommandIndex PkCommandIndex;
+
+const gchar	*pk_command_index_get_default_filename	(void);
+PkCommandIndex	*pk_command_index_new_from_file		(const gchar	*filename,
+							 GError		**error);
+void		 pk_command_index_free			(PkCommandIndex	*index);
+gchar		**pk_command_index_lookup		(PkCommandIndex	*index,
+							 const gchar	*command);
+gboolean	 pk_command_index_write			(const gchar	*filename,
+							 GHashTable	*commands,
+							 GError		**error);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PkCommandIndex, pk_command_index_free)
+
+G_END_DECLS
+
+#endif /* __PK_COMMAND_INDEX_H */
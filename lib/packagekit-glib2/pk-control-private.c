@@ -0,0 +1,155 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+
+/*
+ * The static daemon properties, written by the daemon each time it loads a
+ * backend. Short lived clients read these from disk rather than starting the
+ * daemon just to find out which backend and roles it has. The snapshot
+ * lists the files the daemon read the properties from, and is not used if
+ * any of them changed after it was written.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <glib/gstdio.h>
+
+#include "pk-control-private.h"
+
+#define PK_CONTROL_SNAPSHOT_VERSION	2
+#define PK_CONTROL_SNAPSHOT_TYPE	"(uasa{sv})"
+
+/*
+ * pk_control_snapshot_load:
+ * @filename: the snapshot file
+ * @error: A #GError or %NULL
+ *
+ * Return value: (transfer full): the properties as an a{sv}, or %NULL
+ **/
+GVariant *
+pk_control_snapshot_load (const gchar *filename, GError **error)
+{
+	gchar *contents = NULL;
+	gsize length = 0;
+	guint32 version = 0;
+	GStatBuf buf;
+	time_t mtime;
+	g_autofree const gchar **depends = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GVariant) properties = NULL;
+	g_autoptr(GVariant) snapshot = NULL;
+
+	if (g_stat (filename, &buf) != 0) {
+		g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+			     "failed to stat %s", filename);
+		return NULL;
+	}
+	mtime = buf.st_mtime;
+	if (!g_file_get_contents (filename, &contents, &length, error))
+		return NULL;
+	bytes = g_bytes_new_take (contents, length);
+	snapshot = g_variant_new_from_bytes (G_VARIANT_TYPE (PK_CONTROL_SNAPSHOT_TYPE),
+					     bytes, FALSE);
+	g_variant_ref_sink (snapshot);
+
+	/* a truncated file deserializes as the default value */
+	g_variant_get (snapshot, "(u^a&s@a{sv})", &version, &depends, &properties);
+	if (version != PK_CONTROL_SNAPSHOT_VERSION) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+			     "%s is not a property snapshot of version %i",
+			     filename, PK_CONTROL_SNAPSHOT_VERSION);
+		return NULL;
+	}
+
+	/* the config or the backend changed since the daemon last ran */
+	for (guint i = 0; depends[i] != NULL; i++) {
+		if (g_stat (depends[i], &buf) != 0 || buf.st_mtime > mtime) {
+			g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				     "%s is older than %s", filename, depends[i]);
+			return NULL;
+		}
+	}
+	return g_steal_pointer (&properties);
+}
+
+/*
+ * pk_control_snapshot_save:
+ * @filename: the snapshot file
+ * @depends: (array zero-terminated=1): the files @properties were read from
+ * @properties: an a{sv} of daemon properties
+ * @error: A #GError or %NULL
+ *
+ * Writes @properties to @filename, or only updates its modification time
+ * if the file already has them.
+ *
+ * Return value: %TRUE for success, else %FALSE and @error set
+ **/
+gboolean
+pk_control_snapshot_save (const gchar *filename,
+			  const gchar * const *depends,
+			  GVariant *properties,
+			  GError **error)
+{
+	gchar *contents = NULL;
+	gsize length = 0;
+	g_autofree gchar *dirname = NULL;
+	g_autoptr(GBytes) data = NULL;
+	g_autoptr(GBytes) old = NULL;
+	g_autoptr(GVariant) snapshot = NULL;
+
+	g_return_val_if_fail (g_variant_is_of_type (properties, G_VARIANT_TYPE_VARDICT), FALSE);
+
+	snapshot = g_variant_ref_sink (g_variant_new ("(u^as@a{sv})",
+						      PK_CONTROL_SNAPSHOT_VERSION,
+						      depends,
+						      properties));
+	data = g_variant_get_data_as_bytes (snapshot);
+
+	/* don't rewrite the file if nothing changed, but mark it as current */
+	if (g_file_get_contents (filename, &contents, &length, NULL)) {
+		old = g_bytes_new_take (contents, length);
+		if (g_bytes_equal (old, data)) {
+			if (g_utime (filename, NULL) != 0) {
+				g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+					     "failed to update %s", filename);
+				return FALSE;
+			}
+			return TRUE;
+		}
+	}
+
+	dirname = g_path_get_dirname (filename);
+	if (g_mkdir_with_parents (dirname, 0755) != 0) {
+		g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+			     "failed to create %s", dirname);
+		return FALSE;
+	}
+	if (!g_file_set_contents (filename,
+				  g_bytes_get_data (data, NULL),
+				  g_bytes_get_size (data),
+				  error))
+		return FALSE;
+
+	/* clients run as the user */
+	g_chmod (filename, 0644);
+	return TRUE;
+}
@@ -35,6 +35,7 @@
 #include <packagekit-glib2/pk-bitfield.h>
 #include <packagekit-glib2/pk-common.h>
 #include <packagekit-glib2/pk-control.h>
+#include <packagekit-glib2/pk-control-private.h>
 #include <packagekit-glib2/pk-version.h>
 #include <packagekit-glib2/pk-enum-types.h>
 
@@ -309,8 +310,10 @@ pk_control_properties_changed_cb (GDBusProxy *proxy,
 		g_variant_get (changed_properties,
 				"a{sv}",
 				&iter);
+		g_object_freeze_notify (G_OBJECT (control));
 		while (g_variant_iter_loop (iter, "{&sv}", &key, &value))
 			pk_control_set_property_value (control, key, value);
+		g_object_thaw_notify (G_OBJECT (control));
 		g_variant_iter_free (iter);
 	}
 }
@@ -375,6 +378,7 @@ pk_control_proxy_connect (PkControl *control,
 
 	/* coldplug properties */
 	props = g_dbus_proxy_get_cached_property_names (proxy);
+	g_object_freeze_notify (G_OBJECT (control));
 	for (i = 0; props != NULL && props[i] != NULL; i++) {
 		g_autoptr(GVariant) value_tmp = NULL;
 		value_tmp = g_dbus_proxy_get_cached_property (proxy, props[i]);
@@ -382,6 +386,7 @@ pk_control_proxy_connect (PkControl *control,
 					       props[i],
 					       value_tmp);
 	}
+	g_object_thaw_notify (G_OBJECT (control));
 
 	/* connect up signals */
 	g_signal_connect (proxy, "g-properties-changed",
@@ -396,6 +401,31 @@ pk_control_proxy_connect (PkControl *control,
 		control->priv->proxy = g_object_ref (proxy);
 }
 
+/*
+ * pk_control_load_snapshot:
+ *
+ * Sets the static properties from what the daemon last saved, so that simple
+ * queries like the backend name do not need the daemon to be running.
+ **/
+static void
+pk_control_load_snapshot (PkControl *control)
+{
+	const gchar *key;
+	GVariant *value;
+	GVariantIter iter;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) properties = NULL;
+
+	properties = pk_control_snapshot_load (PK_CONTROL_SNAPSHOT_FILENAME, &error);
+	if (properties == NULL) {
+		g_debug ("no property snapshot: %s", error->message);
+		return;
+	}
+	g_variant_iter_init (&iter, properties);
+	while (g_variant_iter_loop (&iter, "{&sv}", &key, &value))
+		pk_control_set_property_value (control, key, value);
+}
+
 /**********************************************************************/
 
 /*
@@ -1596,6 +1626,11 @@ pk_control_get_properties_cb (GObject *source_object,
  *
  * Gets global properties from the daemon.
  *
+ * The properties that only change when the daemon restarts, such as the
+ * backend name, roles, filters, groups, mime types and distro ID, are already
+ * set from an on-disk snapshot when the #PkControl is created. This function
+ * is only needed for the dynamic properties and for the change signals.
+ *
  * Since: 0.5.2
  **/
 void
@@ -2041,6 +2076,11 @@ pk_control_init (PkControl *control)
 	control->priv->version_minor = G_MAXUINT;
 	control->priv->version_micro = G_MAXUINT;
 	control->priv->cancellable = g_cancellable_new ();
+
+	/* we don't want the system daemon's properties in 'make check' */
+	if (g_getenv ("PK_SELF_TEST") == NULL)
+		pk_control_load_snapshot (control);
+
 	control->priv->watch_id = g_bus_watch_name (G_BUS_TYPE_SYSTEM,
 						    PK_DBUS_SERVICE,
 						    G_BUS_NAME_WATCHER_FLAGS_NONE,
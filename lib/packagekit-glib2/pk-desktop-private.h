@@ -0,0 +1,54 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#if !defined (__PACKAGEKIT_H_INSIDE__) && !defined (PK_COMPILATION)
+#error "Only <packagekit.h> can be included directly."
+#endif
+
+#ifndef __PK_DESKTOP_PRIVATE_H
+#define __PK_DESKTOP_PRIVATE_H
+
+/* the daemon maintains the database, everybody else only reads it */
+
+#include <glib.h>
+
+#include "pk-desktop.h"
+
+G_BEGIN_DECLS
+
+gboolean	 pk_desktop_load			(PkDesktop	*desktop,
+							 const gchar	*filename,
+							 GError		**error);
+gboolean	 pk_desktop_save			(PkDesktop	*desktop,
+							 const gchar	*filename,
+							 GError		**error);
+void		 pk_desktop_set_package_files		(PkDesktop	*desktop,
+							 const gchar	*package,
+							 GHashTable	*files);
+gboolean	 pk_desktop_is_application		(PkDesktop	*desktop,
+							 const gchar	*package);
+void		 pk_desktop_set_stamp			(PkDesktop	*desktop,
+							 const gchar	*stamp);
+gchar		*pk_desktop_get_stamp			(PkDesktop	*desktop);
+
+G_END_DECLS
+
+#endif /* __PK_DESKTOP_PRIVATE_H */
@@ -23,15 +23,21 @@
  * SECTION:pk-desktop
  * @short_description: Find desktop metadata about a package
  *
- * Desktop metadata such as icon name and localised summary may be stored in
- * a local sqlite cache, and this module allows applications to query this.
+ * The daemon keeps a database of the desktop files of the installed
+ * packages, updated after every transaction that installs or removes
+ * packages, and this module allows applications to query it.
  */
 
 #include "config.h"
 
+#include <errno.h>
 #include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
 #include <packagekit-glib2/pk-desktop.h>
 
+#include "pk-desktop-private.h"
+
 static void     pk_desktop_finalize	(GObject        *object);
 
 #define PK_DESKTOP_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_DESKTOP, PkDesktopPrivate))
@@ -43,12 +49,106 @@ static void     pk_desktop_finalize	(GObject        *object);
  **/
 struct _PkDesktopPrivate
 {
-	gpointer		 dummy;
+	GMutex			 mutex;
+	gboolean		 loaded;
+	GHashTable		*files;		/* filename : PkDesktopFile */
+	GHashTable		*packages;	/* package : GPtrArray of filenames */
+	gchar			*stamp;
 };
 
+/* not a desktop file, so readers skip it */
+#define PK_DESKTOP_STAMP_GROUP	"PackageKit"
+
+typedef struct {
+	gchar			*package;
+	gboolean		 shown;
+} PkDesktopFile;
+
 G_DEFINE_TYPE (PkDesktop, pk_desktop, G_TYPE_OBJECT)
 static gpointer pk_desktop_object = NULL;
 
+static void
+pk_desktop_file_free (PkDesktopFile *file)
+{
+	g_free (file->package);
+	g_free (file);
+}
+
+/* called with the mutex held */
+static void
+pk_desktop_remove_package (PkDesktop *desktop, const gchar *package)
+{
+	GPtrArray *filenames;
+
+	filenames = g_hash_table_lookup (desktop->priv->packages, package);
+	if (filenames == NULL)
+		return;
+	for (guint i = 0; i < filenames->len; i++)
+		g_hash_table_remove (desktop->priv->files, g_ptr_array_index (filenames, i));
+	g_hash_table_remove (desktop->priv->packages, package);
+}
+
+/* called with the mutex held */
+static void
+pk_desktop_add_file (PkDesktop *desktop,
+		     const gchar *filename,
+		     const gchar *package,
+		     gboolean shown)
+{
+	PkDesktopFile *file;
+	PkDesktopFile *old;
+	GPtrArray *filenames;
+
+	/* a file moving between packages must not be listed twice */
+	old = g_hash_table_lookup (desktop->priv->files, filename);
+	if (old != NULL && g_strcmp0 (old->package, package) != 0) {
+		guint idx;
+		filenames = g_hash_table_lookup (desktop->priv->packages, old->package);
+		if (g_ptr_array_find_with_equal_func (filenames, filename, g_str_equal, &idx))
+			g_ptr_array_remove_index_fast (filenames, idx);
+	}
+
+	file = g_new0 (PkDesktopFile, 1);
+	file->package = g_strdup (package);
+	file->shown = shown;
+	g_hash_table_insert (desktop->priv->files, g_strdup (filename), file);
+
+	filenames = g_hash_table_lookup (desktop->priv->packages, package);
+	if (filenames == NULL) {
+		filenames = g_ptr_array_new_with_free_func (g_free);
+		g_hash_table_insert (desktop->priv->packages, g_strdup (package), filenames);
+	}
+	if (!g_ptr_array_find_with_equal_func (filenames, filename, g_str_equal, NULL))
+		g_ptr_array_add (filenames, g_strdup (filename));
+}
+
+static GPtrArray *
+pk_desktop_get_files_internal (PkDesktop *desktop,
+			       const gchar *package,
+			       gboolean only_shown,
+			       GError **error)
+{
+	GPtrArray *array;
+	GPtrArray *filenames;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&desktop->priv->mutex);
+
+	if (!desktop->priv->loaded) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_INITIALIZED,
+				     "database is not open");
+		return NULL;
+	}
+	array = g_ptr_array_new_with_free_func (g_free);
+	filenames = g_hash_table_lookup (desktop->priv->packages, package);
+	for (guint i = 0; filenames != NULL && i < filenames->len; i++) {
+		const gchar *filename = g_ptr_array_index (filenames, i);
+		PkDesktopFile *file = g_hash_table_lookup (desktop->priv->files, filename);
+		if (only_shown && !file->shown)
+			continue;
+		g_ptr_array_add (array, g_strdup (filename));
+	}
+	return array;
+}
+
 /**
  * pk_desktop_get_files_for_package:
  * @desktop: a valid #PkDesktop instance
@@ -60,16 +160,14 @@ static gpointer pk_desktop_object = NULL;
  *
  * Return value: (transfer container) (element-type utf8): string array of results, free with g_ptr_array_unref()
  *
- * NOTE: This method is unused and will be removed next time the library
- * soname changes!
- *
  * Since: 0.5.3
  **/
 GPtrArray *
 pk_desktop_get_files_for_package (PkDesktop *desktop, const gchar *package, GError **error)
 {
-	g_set_error_literal (error, 1, 0, "no longer supported");
-	return NULL;
+	g_return_val_if_fail (PK_IS_DESKTOP (desktop), NULL);
+	g_return_val_if_fail (package != NULL, NULL);
+	return pk_desktop_get_files_internal (desktop, package, FALSE, error);
 }
 
 /**
@@ -83,16 +181,14 @@ pk_desktop_get_files_for_package (PkDesktop *desktop, const gchar *package, GErr
  *
  * Return value: (transfer container) (element-type utf8): string array of results, free with g_ptr_array_unref()
  *
- * NOTE: This method is unused and will be removed next time the library
- * soname changes!
- *
  * Since: 0.5.3
  **/
 GPtrArray *
 pk_desktop_get_shown_for_package (PkDesktop *desktop, const gchar *package, GError **error)
 {
-	g_set_error_literal (error, 1, 0, "no longer supported");
-	return NULL;
+	g_return_val_if_fail (PK_IS_DESKTOP (desktop), NULL);
+	g_return_val_if_fail (package != NULL, NULL);
+	return pk_desktop_get_files_internal (desktop, package, TRUE, error);
 }
 
 /**
@@ -105,16 +201,30 @@ pk_desktop_get_shown_for_package (PkDesktop *desktop, const gchar *package, GErr
  *
  * Return value: package name, or %NULL
  *
- * NOTE: This method is unused and will be removed next time the library
- * soname changes!
- *
  * Since: 0.5.3
  **/
 gchar *
 pk_desktop_get_package_for_file (PkDesktop *desktop, const gchar *filename, GError **error)
 {
-	g_set_error_literal (error, 1, 0, "no longer supported");
-	return NULL;
+	PkDesktopFile *file;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (PK_IS_DESKTOP (desktop), NULL);
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	locker = g_mutex_locker_new (&desktop->priv->mutex);
+	if (!desktop->priv->loaded) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_INITIALIZED,
+				     "database is not open");
+		return NULL;
+	}
+	file = g_hash_table_lookup (desktop->priv->files, filename);
+	if (file == NULL) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+			     "no package owns %s", filename);
+		return NULL;
+	}
+	return g_strdup (file->package);
 }
 
 /**
@@ -122,8 +232,8 @@ pk_desktop_get_package_for_file (PkDesktop *desktop, const gchar *filename, GErr
  * @desktop: a valid #PkDesktop instance
  * @error: a #GError to put the error code and message in, or %NULL
  *
- * This method is unused and will be removed next time the library
- * soname changes!
+ * Loads the database the daemon keeps in %PK_DESKTOP_DEFAULT_DATABASE.
+ * It only exists once the daemon has installed or removed packages.
  *
  * Return value: %TRUE if opened correctly
  *
@@ -132,9 +242,185 @@ pk_desktop_get_package_for_file (PkDesktop *desktop, const gchar *filename, GErr
 gboolean
 pk_desktop_open_database (PkDesktop *desktop, GError **error)
 {
+	g_return_val_if_fail (PK_IS_DESKTOP (desktop), FALSE);
+	return pk_desktop_load (desktop, PK_DESKTOP_DEFAULT_DATABASE, error);
+}
+
+/*
+ * pk_desktop_load:
+ *
+ * Replaces the contents with the keyfile written by pk_desktop_save(),
+ * which has a group for each desktop file.
+ **/
+gboolean
+pk_desktop_load (PkDesktop *desktop, const gchar *filename, GError **error)
+{
+	g_auto(GStrv) groups = NULL;
+	g_autoptr(GKeyFile) keyfile = g_key_file_new ();
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (PK_IS_DESKTOP (desktop), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	if (!g_key_file_load_from_file (keyfile, filename, G_KEY_FILE_NONE, error))
+		return FALSE;
+
+	locker = g_mutex_locker_new (&desktop->priv->mutex);
+	g_hash_table_remove_all (desktop->priv->files);
+	g_hash_table_remove_all (desktop->priv->packages);
+	g_free (desktop->priv->stamp);
+	desktop->priv->stamp = g_key_file_get_string (keyfile, PK_DESKTOP_STAMP_GROUP,
+						      "InstalledStamp", NULL);
+	groups = g_key_file_get_groups (keyfile, NULL);
+	for (guint i = 0; groups[i] != NULL; i++) {
+		g_autofree gchar *package = NULL;
+
+		package = g_key_file_get_string (keyfile, groups[i], "Package", NULL);
+		if (package == NULL)
+			continue;
+		pk_desktop_add_file (desktop, groups[i], package,
+				     !g_key_file_get_boolean (keyfile, groups[i],
+							      "NoDisplay", NULL));
+	}
+	desktop->priv->loaded = TRUE;
 	return TRUE;
 }
 
+/*
+ * pk_desktop_save:
+ **/
+gboolean
+pk_desktop_save (PkDesktop *desktop, const gchar *filename, GError **error)
+{
+	g_autofree gchar *dirname = NULL;
+	g_autofree gchar *data = NULL;
+	g_autoptr(GKeyFile) keyfile = g_key_file_new ();
+	g_autoptr(GList) filenames = NULL;
+	g_autoptr(GMutexLocker) locker = NULL;
+	gsize length;
+
+	g_return_val_if_fail (PK_IS_DESKTOP (desktop), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	/* sorted, so the file only changes where the packages did */
+	locker = g_mutex_locker_new (&desktop->priv->mutex);
+	filenames = g_list_sort (g_hash_table_get_keys (desktop->priv->files),
+				 (GCompareFunc) g_strcmp0);
+	for (GList *l = filenames; l != NULL; l = l->next) {
+		PkDesktopFile *file = g_hash_table_lookup (desktop->priv->files, l->data);
+		g_key_file_set_string (keyfile, l->data, "Package", file->package);
+		if (!file->shown)
+			g_key_file_set_boolean (keyfile, l->data, "NoDisplay", TRUE);
+	}
+	if (desktop->priv->stamp != NULL) {
+		g_key_file_set_string (keyfile, PK_DESKTOP_STAMP_GROUP,
+				       "InstalledStamp", desktop->priv->stamp);
+	}
+	g_clear_pointer (&locker, g_mutex_locker_free);
+	data = g_key_file_to_data (keyfile, &length, NULL);
+
+	dirname = g_path_get_dirname (filename);
+	if (g_mkdir_with_parents (dirname, 0755) != 0) {
+		g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+			     "failed to create %s", dirname);
+		return FALSE;
+	}
+	if (!g_file_set_contents (filename, data, length, error))
+		return FALSE;
+
+	/* applications read it as the user */
+	g_chmod (filename, 0644);
+	return TRUE;
+}
+
+/*
+ * pk_desktop_set_package_files:
+ * @files: (element-type utf8 gboolean) (nullable): the desktop files of
+ * @package to whether they are shown, or %NULL if it is not installed
+ *
+ * Replaces everything known about @package in one step, so concurrent
+ * readers never see it half updated.
+ **/
+void
+pk_desktop_set_package_files (PkDesktop *desktop, const gchar *package, GHashTable *files)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (PK_IS_DESKTOP (desktop));
+	g_return_if_fail (package != NULL);
+
+	locker = g_mutex_locker_new (&desktop->priv->mutex);
+	desktop->priv->loaded = TRUE;
+	pk_desktop_remove_package (desktop, package);
+	if (files == NULL)
+		return;
+	g_hash_table_iter_init (&iter, files);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		pk_desktop_add_file (desktop, key, package, GPOINTER_TO_INT (value));
+}
+
+/*
+ * pk_desktop_set_stamp:
+ * @stamp: (nullable): what the backend says the installed packages
+ * looked like when the files were read
+ **/
+void
+pk_desktop_set_stamp (PkDesktop *desktop, const gchar *stamp)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (PK_IS_DESKTOP (desktop));
+
+	locker = g_mutex_locker_new (&desktop->priv->mutex);
+	g_free (desktop->priv->stamp);
+	desktop->priv->stamp = g_strdup (stamp);
+}
+
+/*
+ * pk_desktop_get_stamp:
+ *
+ * Return value: (transfer full) (nullable): the stamp of the loaded or
+ * saved database
+ **/
+gchar *
+pk_desktop_get_stamp (PkDesktop *desktop)
+{
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (PK_IS_DESKTOP (desktop), NULL);
+
+	locker = g_mutex_locker_new (&desktop->priv->mutex);
+	return g_strdup (desktop->priv->stamp);
+}
+
+/*
+ * pk_desktop_is_application:
+ *
+ * Return value: %TRUE if @package has a desktop file that is shown
+ **/
+gboolean
+pk_desktop_is_application (PkDesktop *desktop, const gchar *package)
+{
+	GPtrArray *filenames;
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail (PK_IS_DESKTOP (desktop), FALSE);
+	g_return_val_if_fail (package != NULL, FALSE);
+
+	locker = g_mutex_locker_new (&desktop->priv->mutex);
+	filenames = g_hash_table_lookup (desktop->priv->packages, package);
+	for (guint i = 0; filenames != NULL && i < filenames->len; i++) {
+		PkDesktopFile *file = g_hash_table_lookup (desktop->priv->files,
+							   g_ptr_array_index (filenames, i));
+		if (file->shown)
+			return TRUE;
+	}
+	return FALSE;
+}
+
 /*
  * pk_desktop_class_init:
  **/
@@ -153,6 +439,11 @@ static void
 pk_desktop_init (PkDesktop *desktop)
 {
 	desktop->priv = PK_DESKTOP_GET_PRIVATE (desktop);
+	g_mutex_init (&desktop->priv->mutex);
+	desktop->priv->files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						      (GDestroyNotify) pk_desktop_file_free);
+	desktop->priv->packages = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+							 (GDestroyNotify) g_ptr_array_unref);
 }
 
 /*
@@ -161,16 +452,23 @@ pk_desktop_init (PkDesktop *desktop)
 static void
 pk_desktop_finalize (GObject *object)
 {
+	PkDesktop *desktop;
+
 	g_return_if_fail (object != NULL);
 	g_return_if_fail (PK_IS_DESKTOP (object));
+	desktop = PK_DESKTOP (object);
+	g_hash_table_unref (desktop->priv->files);
+	g_hash_table_unref (desktop->priv->packages);
+	g_free (desktop->priv->stamp);
+	g_mutex_clear (&desktop->priv->mutex);
 	G_OBJECT_CLASS (pk_desktop_parent_class)->finalize (object);
 }
 
 /**
  * pk_desktop_new:
  *
- * NOTE: This method is unused and will be removed next time the library
- * soname changes!
+ * Return value: the shared #PkDesktop, call pk_desktop_open_database()
+ * before querying it
  *
  * Since: 0.5.3
  **/
@@ -0,0 +1,86 @@
+#!/usr/bin/python3
+# SPDX-License-Identifier: LGPL-2.1+
+#
+# Generates collision-free hash slots and value-indexed string arrays for
+# the PkEnumMatch tables in pk-enum.c, see PkEnumIndex in pk-enum-private.h
+
+from re import compile, DOTALL, MULTILINE
+import sys
+
+enum = compile(r"static const PkEnumMatch enum_([a-z_]+)\[\] = {(.*?)};", DOTALL|MULTILINE)
+value = compile(r"{(PK_[A-Z0-9_]+),\s+\"([^\"]+)\"}")
+
+def pk_enum_hash(string, seed):
+	# must match pk_enum_hash() in pk-enum.c
+	h = 2166136261 ^ seed
+	for c in string.encode():
+		h ^= c
+		h = (h * 16777619) & 0xffffffff
+	# the low bits of FNV only depend on the low bits of the input
+	return h ^ (h >> 16)
+
+def find_seed(strings, size):
+	for seed in range(1 << 24):
+		used = set()
+		for string in strings:
+			slot = pk_enum_hash(string, seed) & (size - 1)
+			if slot in used:
+				break
+			used.add(slot)
+		else:
+			return seed
+	raise ValueError("no perfect hash found")
+
+inp = open(sys.argv[1]).read()
+indexes = []
+
+print("/* This file was autogenerated from %s by pk-enum-hash.py */\n" % sys.argv[1].split('/')[-1])
+
+for (name, data) in enum.findall(inp):
+	entries = value.findall(data)
+	if len(entries) == 0 or len(entries) > 254:
+		raise ValueError("enum_%s: unsupported table size %i" % (name, len(entries)))
+
+	# pk_enum_find_value() returns the first match, so must we
+	strings = []
+	positions = {}
+	for (i, (constant, string)) in enumerate(entries):
+		if string not in positions:
+			positions[string] = i
+			strings.append(string)
+
+	# four slots per string keeps the seed search short
+	size = 1
+	while size < 4 * len(strings):
+		size <<= 1
+	seed = find_seed(strings, size)
+
+	slots = [0] * size
+	for string in strings:
+		slots[pk_enum_hash(string, seed) & (size - 1)] = positions[string] + 1
+
+	print("static const guint8 enum_%s_slots[%i] = {" % (name, size))
+	for i in range(0, size, 16):
+		print("\t%s," % ", ".join(str(s) for s in slots[i:i + 16]))
+	print("};\n")
+
+	constants = set()
+	print("static const gchar * const enum_%s_strings[] = {" % name)
+	for (constant, string) in entries:
+		if constant in constants:
+			continue
+		constants.add(constant)
+		print("\t[%s] = \"%s\"," % (constant, string))
+	print("};\n")
+
+	print("static const PkEnumIndex enum_%s_index = {" % name)
+	print("\tenum_%s, enum_%s_slots, %i, %iu," % (name, name, size - 1, seed))
+	print("\tenum_%s_strings, G_N_ELEMENTS (enum_%s_strings)" % (name, name))
+	print("};\n")
+	indexes.append(name)
+
+print("static const PkEnumIndex *pk_enum_indexes[] = {")
+for name in indexes:
+	print("\t&enum_%s_index," % name)
+print("\tNULL")
+print("};")
@@ -0,0 +1,57 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU Lesser General Public License Version 2.1
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA
+ */
+
+#if !defined (__PACKAGEKIT_H_INSIDE__) && !defined (PK_COMPILATION)
+#error "Only <packagekit.h> can be included directly."
+#endif
+
+#ifndef __PK_ENUM_PRIVATE_H
+#define __PK_ENUM_PRIVATE_H
+
+#include <glib.h>
+
+#include "pk-enum.h"
+
+G_BEGIN_DECLS
+
+/*
+ * The lookup tables pk-enum-hash.py generates for a PkEnumMatch table:
+ * @slots maps the masked string hash to the table position plus one, and
+ * @strings is indexed by the enumerated value.
+ */
+typedef struct {
+	const PkEnumMatch	*table;
+	const guint8		*slots;
+	guint			 mask;
+	guint32			 seed;
+	const gchar * const	*strings;
+	guint			 n_strings;
+} PkEnumIndex;
+
+guint		 pk_enum_index_find_value		(const PkEnumIndex *idx,
+							 const gchar	*string);
+const gchar	*pk_enum_index_find_string		(const PkEnumIndex *idx,
+							 guint		 value);
+const PkEnumIndex * const *pk_enum_get_indexes		(void);
+
+G_END_DECLS
+
+#endif /* __PK_ENUM_PRIVATE_H */
@@ -36,6 +36,8 @@
 #include <packagekit-glib2/pk-common.h>
 #include <packagekit-glib2/pk-enum.h>
 
+#include "pk-enum-private.h"
+
 static const PkEnumMatch enum_exit[] = {
 	{PK_EXIT_ENUM_UNKNOWN,			"unknown"},	/* fall though value */
 	{PK_EXIT_ENUM_SUCCESS,			"success"},
@@ -384,6 +386,71 @@ static const PkEnumMatch enum_transaction_flag[] = {
 	{0, NULL}
 };
 
+#include "pk-enum-hash.h"
+
+/* FNV-1a, must match pk_enum_hash() in pk-enum-hash.py */
+static inline guint32
+pk_enum_hash (const gchar *string, guint32 seed)
+{
+	guint32 hash = 2166136261u ^ seed;
+	for (; *string != '\0'; string++) {
+		hash ^= (guint8) *string;
+		hash *= 16777619u;
+	}
+	return hash ^ (hash >> 16);
+}
+
+/**
+ * pk_enum_index_find_value:
+ * @idx: A #PkEnumIndex generated for a table
+ * @string: the string constant to search for, e.g. "desktop-gnome"
+ *
+ * Like pk_enum_find_value() but using the generated perfect hash.
+ *
+ * Return value: the enumerated constant value, e.g. PK_SIGTYPE_ENUM_GPG
+ */
+guint
+pk_enum_index_find_value (const PkEnumIndex *idx, const gchar *string)
+{
+	guint slot;
+
+	/* return the first entry on non-found or error */
+	if (string == NULL)
+		return idx->table[0].value;
+	slot = idx->slots[pk_enum_hash (string, idx->seed) & idx->mask];
+	if (slot == 0 || strcmp (idx->table[slot - 1].string, string) != 0)
+		return idx->table[0].value;
+	return idx->table[slot - 1].value;
+}
+
+/**
+ * pk_enum_index_find_string:
+ * @idx: A #PkEnumIndex generated for a table
+ * @value: the enumerated constant value, e.g. PK_SIGTYPE_ENUM_GPG
+ *
+ * Like pk_enum_find_string() but indexing the generated string array.
+ *
+ * Return value: the string constant, e.g. "desktop-gnome"
+ */
+const gchar *
+pk_enum_index_find_string (const PkEnumIndex *idx, guint value)
+{
+	if (value >= idx->n_strings || idx->strings[value] == NULL)
+		return idx->table[0].string;
+	return idx->strings[value];
+}
+
+/**
+ * pk_enum_get_indexes:
+ *
+ * Return value: the %NULL terminated list of generated indexes, for tests
+ */
+const PkEnumIndex * const *
+pk_enum_get_indexes (void)
+{
+	return pk_enum_indexes;
+}
+
 /**
  * pk_enum_find_value:
  * @table: A #PkEnumMatch enum table of values
@@ -452,7 +519,7 @@ pk_enum_find_string (const PkEnumMatch *table, guint value)
 PkSigTypeEnum
 pk_sig_type_enum_from_string (const gchar *sig_type)
 {
-	return pk_enum_find_value (enum_sig_type, sig_type);
+	return pk_enum_index_find_value (&enum_sig_type_index, sig_type);
 }
 
 /**
@@ -468,7 +535,7 @@ pk_sig_type_enum_from_string (const gchar *sig_type)
 const gchar *
 pk_sig_type_enum_to_string (PkSigTypeEnum sig_type)
 {
-	return pk_enum_find_string (enum_sig_type, sig_type);
+	return pk_enum_index_find_string (&enum_sig_type_index, sig_type);
 }
 
 /**
@@ -484,7 +551,7 @@ pk_sig_type_enum_to_string (PkSigTypeEnum sig_type)
 PkDistroUpgradeEnum
 pk_distro_upgrade_enum_from_string (const gchar *upgrade)
 {
-	return pk_enum_find_value (enum_upgrade, upgrade);
+	return pk_enum_index_find_value (&enum_upgrade_index, upgrade);
 }
 
 /**
@@ -500,7 +567,7 @@ pk_distro_upgrade_enum_from_string (const gchar *upgrade)
 const gchar *
 pk_distro_upgrade_enum_to_string (PkDistroUpgradeEnum upgrade)
 {
-	return pk_enum_find_string (enum_upgrade, upgrade);
+	return pk_enum_index_find_string (&enum_upgrade_index, upgrade);
 }
 
 /**
@@ -516,7 +583,7 @@ pk_distro_upgrade_enum_to_string (PkDistroUpgradeEnum upgrade)
 PkInfoEnum
 pk_info_enum_from_string (const gchar *info)
 {
-	return pk_enum_find_value (enum_info, info);
+	return pk_enum_index_find_value (&enum_info_index, info);
 }
 
 /**
@@ -532,7 +599,7 @@ pk_info_enum_from_string (const gchar *info)
 const gchar *
 pk_info_enum_to_string (PkInfoEnum info)
 {
-	return pk_enum_find_string (enum_info, info);
+	return pk_enum_index_find_string (&enum_info_index, info);
 }
 
 /**
@@ -548,7 +615,7 @@ pk_info_enum_to_string (PkInfoEnum info)
 PkExitEnum
 pk_exit_enum_from_string (const gchar *exit_text)
 {
-	return pk_enum_find_value (enum_exit, exit_text);
+	return pk_enum_index_find_value (&enum_exit_index, exit_text);
 }
 
 /**
@@ -564,7 +631,7 @@ pk_exit_enum_from_string (const gchar *exit_text)
 const gchar *
 pk_exit_enum_to_string (PkExitEnum exit_enum)
 {
-	return pk_enum_find_string (enum_exit, exit_enum);
+	return pk_enum_index_find_string (&enum_exit_index, exit_enum);
 }
 
 /**
@@ -580,7 +647,7 @@ pk_exit_enum_to_string (PkExitEnum exit_enum)
 PkNetworkEnum
 pk_network_enum_from_string (const gchar *network)
 {
-	return pk_enum_find_value (enum_network, network);
+	return pk_enum_index_find_value (&enum_network_index, network);
 }
 
 /**
@@ -596,7 +663,7 @@ pk_network_enum_from_string (const gchar *network)
 const gchar *
 pk_network_enum_to_string (PkNetworkEnum network)
 {
-	return pk_enum_find_string (enum_network, network);
+	return pk_enum_index_find_string (&enum_network_index, network);
 }
 
 /**
@@ -612,7 +679,7 @@ pk_network_enum_to_string (PkNetworkEnum network)
 PkStatusEnum
 pk_status_enum_from_string (const gchar *status)
 {
-	return pk_enum_find_value (enum_status, status);
+	return pk_enum_index_find_value (&enum_status_index, status);
 }
 
 /**
@@ -628,7 +695,7 @@ pk_status_enum_from_string (const gchar *status)
 const gchar *
 pk_status_enum_to_string (PkStatusEnum status)
 {
-	return pk_enum_find_string (enum_status, status);
+	return pk_enum_index_find_string (&enum_status_index, status);
 }
 
 /**
@@ -644,7 +711,7 @@ pk_status_enum_to_string (PkStatusEnum status)
 PkRoleEnum
 pk_role_enum_from_string (const gchar *role)
 {
-	return pk_enum_find_value (enum_role, role);
+	return pk_enum_index_find_value (&enum_role_index, role);
 }
 
 /**
@@ -660,7 +727,7 @@ pk_role_enum_from_string (const gchar *role)
 const gchar *
 pk_role_enum_to_string (PkRoleEnum role)
 {
-	return pk_enum_find_string (enum_role, role);
+	return pk_enum_index_find_string (&enum_role_index, role);
 }
 
 /**
@@ -676,7 +743,7 @@ pk_role_enum_to_string (PkRoleEnum role)
 PkErrorEnum
 pk_error_enum_from_string (const gchar *code)
 {
-	return pk_enum_find_value (enum_error, code);
+	return pk_enum_index_find_value (&enum_error_index, code);
 }
 
 /**
@@ -692,7 +759,7 @@ pk_error_enum_from_string (const gchar *code)
 const gchar *
 pk_error_enum_to_string (PkErrorEnum code)
 {
-	return pk_enum_find_string (enum_error, code);
+	return pk_enum_index_find_string (&enum_error_index, code);
 }
 
 /**
@@ -708,7 +775,7 @@ pk_error_enum_to_string (PkErrorEnum code)
 PkRestartEnum
 pk_restart_enum_from_string (const gchar *restart)
 {
-	return pk_enum_find_value (enum_restart, restart);
+	return pk_enum_index_find_value (&enum_restart_index, restart);
 }
 
 /**
@@ -724,7 +791,7 @@ pk_restart_enum_from_string (const gchar *restart)
 const gchar *
 pk_restart_enum_to_string (PkRestartEnum restart)
 {
-	return pk_enum_find_string (enum_restart, restart);
+	return pk_enum_index_find_string (&enum_restart_index, restart);
 }
 
 /**
@@ -740,7 +807,7 @@ pk_restart_enum_to_string (PkRestartEnum restart)
 PkGroupEnum
 pk_group_enum_from_string (const gchar *group)
 {
-	return pk_enum_find_value (enum_group, group);
+	return pk_enum_index_find_value (&enum_group_index, group);
 }
 
 /**
@@ -756,7 +823,7 @@ pk_group_enum_from_string (const gchar *group)
 const gchar *
 pk_group_enum_to_string (PkGroupEnum group)
 {
-	return pk_enum_find_string (enum_group, group);
+	return pk_enum_index_find_string (&enum_group_index, group);
 }
 
 /**
@@ -772,7 +839,7 @@ pk_group_enum_to_string (PkGroupEnum group)
 PkUpdateStateEnum
 pk_update_state_enum_from_string (const gchar *update_state)
 {
-	return pk_enum_find_value (enum_update_state, update_state);
+	return pk_enum_index_find_value (&enum_update_state_index, update_state);
 }
 
 /**
@@ -788,7 +855,7 @@ pk_update_state_enum_from_string (const gchar *update_state)
 const gchar *
 pk_update_state_enum_to_string (PkUpdateStateEnum update_state)
 {
-	return pk_enum_find_string (enum_update_state, update_state);
+	return pk_enum_index_find_string (&enum_update_state_index, update_state);
 }
 
 /**
@@ -804,7 +871,7 @@ pk_update_state_enum_to_string (PkUpdateStateEnum update_state)
 PkFilterEnum
 pk_filter_enum_from_string (const gchar *filter)
 {
-	return pk_enum_find_value (enum_filter, filter);
+	return pk_enum_index_find_value (&enum_filter_index, filter);
 }
 
 /**
@@ -820,7 +887,7 @@ pk_filter_enum_from_string (const gchar *filter)
 const gchar *
 pk_filter_enum_to_string (PkFilterEnum filter)
 {
-	return pk_enum_find_string (enum_filter, filter);
+	return pk_enum_index_find_string (&enum_filter_index, filter);
 }
 
 /**
@@ -836,7 +903,7 @@ pk_filter_enum_to_string (PkFilterEnum filter)
 PkMediaTypeEnum
 pk_media_type_enum_from_string (const gchar *media_type)
 {
-	return pk_enum_find_value (enum_media_type, media_type);
+	return pk_enum_index_find_value (&enum_media_type_index, media_type);
 }
 
 /**
@@ -852,7 +919,7 @@ pk_media_type_enum_from_string (const gchar *media_type)
 const gchar *
 pk_media_type_enum_to_string (PkMediaTypeEnum media_type)
 {
-	return pk_enum_find_string (enum_media_type, media_type);
+	return pk_enum_index_find_string (&enum_media_type_index, media_type);
 }
 
 /**
@@ -868,7 +935,7 @@ pk_media_type_enum_to_string (PkMediaTypeEnum media_type)
 PkAuthorizeEnum
 pk_authorize_type_enum_from_string (const gchar *authorize_type)
 {
-	return pk_enum_find_value (enum_authorize_type, authorize_type);
+	return pk_enum_index_find_value (&enum_authorize_type_index, authorize_type);
 }
 
 /**
@@ -884,7 +951,7 @@ pk_authorize_type_enum_from_string (const gchar *authorize_type)
 const gchar *
 pk_authorize_type_enum_to_string (PkAuthorizeEnum authorize_type)
 {
-	return pk_enum_find_string (enum_authorize_type, authorize_type);
+	return pk_enum_index_find_string (&enum_authorize_type_index, authorize_type);
 }
 
 /**
@@ -900,7 +967,7 @@ pk_authorize_type_enum_to_string (PkAuthorizeEnum authorize_type)
 PkUpgradeKindEnum
 pk_upgrade_kind_enum_from_string (const gchar *upgrade_kind)
 {
-	return pk_enum_find_value (enum_upgrade_kind, upgrade_kind);
+	return pk_enum_index_find_value (&enum_upgrade_kind_index, upgrade_kind);
 }
 
 /**
@@ -916,7 +983,7 @@ pk_upgrade_kind_enum_from_string (const gchar *upgrade_kind)
 const gchar *
 pk_upgrade_kind_enum_to_string (PkUpgradeKindEnum upgrade_kind)
 {
-	return pk_enum_find_string (enum_upgrade_kind, upgrade_kind);
+	return pk_enum_index_find_string (&enum_upgrade_kind_index, upgrade_kind);
 }
 
 /**
@@ -932,7 +999,7 @@ pk_upgrade_kind_enum_to_string (PkUpgradeKindEnum upgrade_kind)
 PkTransactionFlagEnum
 pk_transaction_flag_enum_from_string (const gchar *transaction_flag)
 {
-	return pk_enum_find_value (enum_transaction_flag, transaction_flag);
+	return pk_enum_index_find_value (&enum_transaction_flag_index, transaction_flag);
 }
 
 /**
@@ -948,7 +1015,7 @@ pk_transaction_flag_enum_from_string (const gchar *transaction_flag)
 const gchar *
 pk_transaction_flag_enum_to_string (PkTransactionFlagEnum transaction_flag)
 {
-	return pk_enum_find_string (enum_transaction_flag, transaction_flag);
+	return pk_enum_index_find_string (&enum_transaction_flag_index, transaction_flag);
 }
 
 /**
@@ -30,10 +30,13 @@
 
 #include "config.h"
 
+#include <string.h>
 #include <glib-object.h>
 #include <gio/gio.h>
 
 #include <packagekit-glib2/pk-package-sack.h>
+#include <packagekit-glib2/pk-package-sack-private.h>
+#include <packagekit-glib2/pk-package-private.h>
 #include <packagekit-glib2/pk-client.h>
 #include <packagekit-glib2/pk-common.h>
 #include <packagekit-glib2/pk-enum.h>
@@ -52,6 +55,10 @@ static void     pk_package_sack_finalize	(GObject     *object);
 struct _PkPackageSackPrivate
 {
 	GHashTable		*table;
+	GHashTable		*names;		/* name : GPtrArray of PkPackage */
+	GHashTable		*name_arches;	/* name;arch : GPtrArray of PkPackage */
+	GHashTable		*infos;		/* PkInfoEnum : GPtrArray of PkPackage, or NULL */
+	guint			 infos_serial;
 	GPtrArray		*array;
 	PkClient		*client;
 };
@@ -63,6 +70,193 @@ enum {
 
 G_DEFINE_TYPE (PkPackageSack, pk_package_sack, G_TYPE_OBJECT)
 
+/*
+ * pk_package_sack_bucket_add:
+ *
+ * The buckets keep the order of the sack, so the first package of a
+ * bucket is the one a scan of the sack would have found.
+ **/
+static void
+pk_package_sack_bucket_add (GHashTable *buckets, const gchar *key, PkPackage *package)
+{
+	GPtrArray *bucket;
+
+	bucket = g_hash_table_lookup (buckets, key);
+	if (bucket == NULL) {
+		bucket = g_ptr_array_new ();
+		g_hash_table_insert (buckets, g_strdup (key), bucket);
+	}
+	g_ptr_array_add (bucket, package);
+}
+
+/*
+ * pk_package_sack_info_add:
+ **/
+static void
+pk_package_sack_info_add (GHashTable *infos, PkPackage *package)
+{
+	GPtrArray *bucket;
+	gpointer key = GUINT_TO_POINTER (pk_package_get_info (package));
+
+	bucket = g_hash_table_lookup (infos, key);
+	if (bucket == NULL) {
+		bucket = g_ptr_array_new ();
+		g_hash_table_insert (infos, key, bucket);
+	}
+	g_ptr_array_add (bucket, package);
+}
+
+/*
+ * pk_package_sack_bucket_remove:
+ **/
+static void
+pk_package_sack_bucket_remove (GHashTable *buckets, gconstpointer key, PkPackage *package)
+{
+	GPtrArray *bucket;
+
+	bucket = g_hash_table_lookup (buckets, key);
+	if (bucket == NULL)
+		return;
+	g_ptr_array_remove (bucket, package);
+	if (bucket->len == 0)
+		g_hash_table_remove (buckets, key);
+}
+
+/*
+ * pk_package_sack_name_arch_key:
+ **/
+static gchar *
+pk_package_sack_name_arch_key (const gchar *name, const gchar *arch)
+{
+	return g_strdup_printf ("%s;%s", name, arch != NULL ? arch : "");
+}
+
+/*
+ * pk_package_sack_index_package:
+ **/
+static void
+pk_package_sack_index_package (PkPackageSack *sack, PkPackage *package)
+{
+	const gchar *name = pk_package_get_name (package);
+	g_autofree gchar *key = NULL;
+
+	g_hash_table_insert (sack->priv->table,
+			     (gpointer) pk_package_get_id (package),
+			     (gpointer) package);
+	if (sack->priv->infos != NULL &&
+	    sack->priv->infos_serial != pk_package_get_info_serial ())
+		g_clear_pointer (&sack->priv->infos, g_hash_table_unref);
+	if (sack->priv->infos != NULL)
+		pk_package_sack_info_add (sack->priv->infos, package);
+	if (name == NULL)
+		return;
+	pk_package_sack_bucket_add (sack->priv->names, name, package);
+	key = pk_package_sack_name_arch_key (name, pk_package_get_arch (package));
+	pk_package_sack_bucket_add (sack->priv->name_arches, key, package);
+}
+
+/*
+ * pk_package_sack_unindex_package:
+ **/
+static void
+pk_package_sack_unindex_package (PkPackageSack *sack, PkPackage *package)
+{
+	const gchar *name = pk_package_get_name (package);
+	g_autofree gchar *key = NULL;
+
+	g_hash_table_remove (sack->priv->table, pk_package_get_id (package));
+
+	/* the package may not be in the bucket of its current info */
+	if (sack->priv->infos != NULL &&
+	    sack->priv->infos_serial != pk_package_get_info_serial ())
+		g_clear_pointer (&sack->priv->infos, g_hash_table_unref);
+	if (sack->priv->infos != NULL) {
+		pk_package_sack_bucket_remove (sack->priv->infos,
+					       GUINT_TO_POINTER (pk_package_get_info (package)),
+					       package);
+	}
+	if (name == NULL)
+		return;
+	pk_package_sack_bucket_remove (sack->priv->names, name, package);
+	key = pk_package_sack_name_arch_key (name, pk_package_get_arch (package));
+	pk_package_sack_bucket_remove (sack->priv->name_arches, key, package);
+}
+
+/*
+ * pk_package_sack_reindex:
+ *
+ * Rebuilds the buckets after the order of the sack changed.
+ **/
+static void
+pk_package_sack_reindex (PkPackageSack *sack)
+{
+	g_clear_pointer (&sack->priv->infos, g_hash_table_unref);
+	g_hash_table_remove_all (sack->priv->table);
+	g_hash_table_remove_all (sack->priv->names);
+	g_hash_table_remove_all (sack->priv->name_arches);
+	for (guint i = 0; i < sack->priv->array->len; i++)
+		pk_package_sack_index_package (sack, g_ptr_array_index (sack->priv->array, i));
+}
+
+/*
+ * pk_package_sack_get_infos:
+ *
+ * The info index is built on first use, and again when the info of any
+ * package has changed since.
+ **/
+static GHashTable *
+pk_package_sack_get_infos (PkPackageSack *sack)
+{
+	PkPackageSackPrivate *priv = sack->priv;
+	guint serial = pk_package_get_info_serial ();
+
+	if (priv->infos != NULL && priv->infos_serial == serial)
+		return priv->infos;
+	g_clear_pointer (&priv->infos, g_hash_table_unref);
+	priv->infos = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+					     NULL, (GDestroyNotify) g_ptr_array_unref);
+	priv->infos_serial = serial;
+	for (guint i = 0; i < priv->array->len; i++)
+		pk_package_sack_info_add (priv->infos, g_ptr_array_index (priv->array, i));
+	return priv->infos;
+}
+
+/*
+ * pk_package_sack_remove_where:
+ *
+ * Removes every package that @filter_cb does not keep in one pass, keeping
+ * the order of the rest.
+ **/
+static gboolean
+pk_package_sack_remove_where (PkPackageSack *sack,
+			      PkPackageSackFilterFunc filter_cb,
+			      gpointer user_data)
+{
+	PkPackage *package;
+	guint i;
+	guint kept = 0;
+	GPtrArray *array = sack->priv->array;
+	g_autoptr(GPtrArray) removed = g_ptr_array_new ();
+
+	for (i = 0; i < array->len; i++) {
+		package = g_ptr_array_index (array, i);
+		if (filter_cb (package, user_data)) {
+			array->pdata[kept++] = package;
+			continue;
+		}
+		pk_package_sack_unindex_package (sack, package);
+		g_ptr_array_add (removed, package);
+	}
+	if (removed->len == 0)
+		return FALSE;
+
+	/* move the removed packages to the end so the array unrefs them */
+	for (i = 0; i < removed->len; i++)
+		array->pdata[kept + i] = g_ptr_array_index (removed, i);
+	g_ptr_array_set_size (array, kept);
+	return TRUE;
+}
+
 /**
  * pk_package_sack_clear:
  * @sack: a valid #PkPackageSack instance
@@ -77,7 +271,10 @@ pk_package_sack_clear (PkPackageSack *sack)
 	g_return_if_fail (PK_IS_PACKAGE_SACK (sack));
 
 	g_ptr_array_set_size (sack->priv->array, 0);
+	g_clear_pointer (&sack->priv->infos, g_hash_table_unref);
 	g_hash_table_remove_all (sack->priv->table);
+	g_hash_table_remove_all (sack->priv->names);
+	g_hash_table_remove_all (sack->priv->name_arches);
 }
 
 /**
@@ -160,10 +357,8 @@ PkPackageSack *
 pk_package_sack_filter_by_info (PkPackageSack *sack, PkInfoEnum info)
 {
 	PkPackageSack *results;
-	PkPackage *package;
-	PkInfoEnum info_tmp;
+	GPtrArray *bucket;
 	guint i;
-	PkPackageSackPrivate *priv = sack->priv;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
 
@@ -171,12 +366,9 @@ pk_package_sack_filter_by_info (PkPackageSack *sack, PkInfoEnum info)
 	results = pk_package_sack_new ();
 
 	/* add each that matches the info enum */
-	for (i = 0; i < priv->array->len; i++) {
-		package = g_ptr_array_index (priv->array, i);
-		info_tmp = pk_package_get_info (package);
-		if (info_tmp == info)
-			pk_package_sack_add_package (results, package);
-	}
+	bucket = g_hash_table_lookup (pk_package_sack_get_infos (sack), GUINT_TO_POINTER (info));
+	for (i = 0; bucket != NULL && i < bucket->len; i++)
+		pk_package_sack_add_package (results, g_ptr_array_index (bucket, i));
 
 	return results;
 }
@@ -237,9 +429,7 @@ pk_package_sack_add_package (PkPackageSack *sack, PkPackage *package)
 	/* add to array */
 	g_ptr_array_add (sack->priv->array,
 			 g_object_ref (package));
-	g_hash_table_insert (sack->priv->table,
-			     (gpointer) pk_package_get_id (package),
-			     (gpointer) package);
+	pk_package_sack_index_package (sack, package);
 
 	return TRUE;
 }
@@ -411,12 +601,17 @@ pk_package_sack_to_file (PkPackageSack *sack, GFile *file, GError **error)
 gboolean
 pk_package_sack_remove_package (PkPackageSack *sack, PkPackage *package)
 {
+	guint idx;
+
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (PK_IS_PACKAGE (package), FALSE);
 
 	/* remove from array */
-	g_hash_table_remove (sack->priv->table, pk_package_get_id (package));
-	return g_ptr_array_remove (sack->priv->array, package);
+	if (!g_ptr_array_find (sack->priv->array, package, &idx))
+		return FALSE;
+	pk_package_sack_unindex_package (sack, package);
+	g_ptr_array_remove_index (sack->priv->array, idx);
+	return TRUE;
 }
 
 /**
@@ -436,21 +631,51 @@ pk_package_sack_remove_package_by_id (PkPackageSack *sack,
 				      const gchar *package_id)
 {
 	PkPackage *package;
-	guint i;
-	GPtrArray *array;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (package_id != NULL, FALSE);
 
-	array = sack->priv->array;
-	for (i = 0; i < array->len; i++) {
-		package = g_ptr_array_index (array, i);
-		if (g_strcmp0 (package_id, pk_package_get_id (package)) == 0) {
-			pk_package_sack_remove_package (sack, package);
-			return TRUE;
-		}
-	}
-	return FALSE;
+	package = g_hash_table_lookup (sack->priv->table, package_id);
+	if (package == NULL)
+		return FALSE;
+	return pk_package_sack_remove_package (sack, package);
+}
+
+/*
+ * pk_package_sack_remove_by_ids_cb:
+ **/
+static gboolean
+pk_package_sack_remove_by_ids_cb (PkPackage *package, gpointer user_data)
+{
+	GHashTable *ids = (GHashTable *) user_data;
+	return !g_hash_table_contains (ids, pk_package_get_id (package));
+}
+
+/**
+ * pk_package_sack_remove_by_ids:
+ * @sack: a valid #PkPackageSack instance
+ * @package_ids: (array zero-terminated=1): the package IDs to remove
+ *
+ * Removes all the packages with any of the given IDs from the sack in a
+ * single pass, which is much faster than removing them one by one.
+ *
+ * Return value: %TRUE if a package was removed from the sack
+ *
+ * Since: 1.3.0
+ **/
+gboolean
+pk_package_sack_remove_by_ids (PkPackageSack *sack, gchar **package_ids)
+{
+	guint i;
+	g_autoptr(GHashTable) ids = NULL;
+
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
+	g_return_val_if_fail (package_ids != NULL, FALSE);
+
+	ids = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; package_ids[i] != NULL; i++)
+		g_hash_table_add (ids, package_ids[i]);
+	return pk_package_sack_remove_where (sack, pk_package_sack_remove_by_ids_cb, ids);
 }
 
 /**
@@ -471,26 +696,10 @@ pk_package_sack_remove_by_filter (PkPackageSack *sack,
 				  PkPackageSackFilterFunc filter_cb,
 				  gpointer user_data)
 {
-	gboolean ret = FALSE;
-	PkPackage *package;
-	gint i;
-	PkPackageSackPrivate *priv = sack->priv;
-
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), FALSE);
 	g_return_val_if_fail (filter_cb != NULL, FALSE);
 
-	/* add each that matches the info enum */
-	for (i = 0; i < (gint) priv->array->len; i++) {
-		package = g_ptr_array_index (priv->array, i);
-		if (!filter_cb (package, user_data)) {
-			ret = TRUE;
-			pk_package_sack_remove_package (sack, package);
-
-			/* ensure we pick up subsequent matches */
-			i--;
-		}
-	}
-	return ret;
+	return pk_package_sack_remove_where (sack, filter_cb, user_data);
 }
 
 /**
@@ -535,27 +744,317 @@ pk_package_sack_find_by_id (PkPackageSack *sack, const gchar *package_id)
 PkPackage *
 pk_package_sack_find_by_id_name_arch (PkPackageSack *sack, const gchar *package_id)
 {
-	PkPackage *pkg_tmp;
-	guint i;
+	GPtrArray *bucket;
 	g_auto(GStrv) split = NULL;
+	g_autofree gchar *key = NULL;
 
 	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
 	g_return_val_if_fail (package_id != NULL, NULL);
 
-	/* does the package name feature in the array */
+	/* does the package name and arch feature in the array */
 	split = pk_package_id_split (package_id);
 	if (split == NULL)
 		return NULL;
+	key = pk_package_sack_name_arch_key (split[PK_PACKAGE_ID_NAME], split[PK_PACKAGE_ID_ARCH]);
+	bucket = g_hash_table_lookup (sack->priv->name_arches, key);
+	if (bucket == NULL)
+		return NULL;
+	return g_object_ref (g_ptr_array_index (bucket, 0));
+}
+
+/**
+ * pk_package_sack_find_by_name:
+ * @sack: a valid #PkPackageSack instance
+ * @name: a package name, e.g. "gnome-shell"
+ *
+ * Finds all the packages in a sack with a given name, whatever their
+ * version and architecture.
+ *
+ * Return value: (element-type PkPackage) (transfer container): the packages, free with g_ptr_array_unref()
+ *
+ * Since: 1.3.0
+ */
+GPtrArray *
+pk_package_sack_find_by_name (PkPackageSack *sack, const gchar *name)
+{
+	GPtrArray *bucket;
+	GPtrArray *packages;
+	guint i;
+
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
+	g_return_val_if_fail (name != NULL, NULL);
+
+	packages = g_ptr_array_new_with_free_func (g_object_unref);
+	bucket = g_hash_table_lookup (sack->priv->names, name);
+	for (i = 0; bucket != NULL && i < bucket->len; i++)
+		g_ptr_array_add (packages, g_object_ref (g_ptr_array_index (bucket, i)));
+	return packages;
+}
+
+/**
+ * pk_package_sack_intersect:
+ * @sack: a valid #PkPackageSack instance
+ * @other: another #PkPackageSack
+ *
+ * Returns a new package sack with the packages of @sack whose package ID
+ * is also in @other.
+ *
+ * Return value: (transfer full): a new #PkPackageSack, free with g_object_unref()
+ *
+ * Since: 1.3.0
+ **/
+PkPackageSack *
+pk_package_sack_intersect (PkPackageSack *sack, PkPackageSack *other)
+{
+	PkPackageSack *results;
+	PkPackage *package;
+	guint i;
+
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (other), NULL);
+
+	results = pk_package_sack_new ();
 	for (i = 0; i < sack->priv->array->len; i++) {
-		pkg_tmp = g_ptr_array_index (sack->priv->array, i);
-		if (g_strcmp0 (pk_package_get_name (pkg_tmp),
-			       split[PK_PACKAGE_ID_NAME]) == 0 &&
-		    g_strcmp0 (pk_package_get_arch (pkg_tmp),
-			       split[PK_PACKAGE_ID_ARCH]) == 0) {
-			return g_object_ref (pkg_tmp);
+		package = g_ptr_array_index (sack->priv->array, i);
+		if (g_hash_table_contains (other->priv->table, pk_package_get_id (package)))
+			pk_package_sack_add_package (results, package);
+	}
+	return results;
+}
+
+/**
+ * pk_package_sack_difference:
+ * @sack: a valid #PkPackageSack instance
+ * @other: another #PkPackageSack
+ *
+ * Returns a new package sack with the packages of @sack whose package ID
+ * is not in @other.
+ *
+ * Return value: (transfer full): a new #PkPackageSack, free with g_object_unref()
+ *
+ * Since: 1.3.0
+ **/
+PkPackageSack *
+pk_package_sack_difference (PkPackageSack *sack, PkPackageSack *other)
+{
+	PkPackageSack *results;
+	PkPackage *package;
+	guint i;
+
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (other), NULL);
+
+	results = pk_package_sack_new ();
+	for (i = 0; i < sack->priv->array->len; i++) {
+		package = g_ptr_array_index (sack->priv->array, i);
+		if (!g_hash_table_contains (other->priv->table, pk_package_get_id (package)))
+			pk_package_sack_add_package (results, package);
+	}
+	return results;
+}
+
+/*
+ * pk_package_sack_vercmp_segment:
+ *
+ * Compares one run of digits or letters, numbers sorting after letters.
+ **/
+static gint
+pk_package_sack_vercmp_segment (const gchar **a, const gchar **b)
+{
+	const gchar *start_a = *a;
+	const gchar *start_b = *b;
+	gsize len_a, len_b;
+	gint rc;
+
+	if (g_ascii_isdigit (**a)) {
+		if (!g_ascii_isdigit (**b))
+			return 1;
+		while (**a == '0')
+			(*a)++;
+		while (**b == '0')
+			(*b)++;
+		start_a = *a;
+		start_b = *b;
+		while (g_ascii_isdigit (**a))
+			(*a)++;
+		while (g_ascii_isdigit (**b))
+			(*b)++;
+		len_a = *a - start_a;
+		len_b = *b - start_b;
+		if (len_a != len_b)
+			return len_a > len_b ? 1 : -1;
+		return strncmp (start_a, start_b, len_a);
+	}
+	if (g_ascii_isdigit (**b))
+		return -1;
+	while (g_ascii_isalpha (**a))
+		(*a)++;
+	while (g_ascii_isalpha (**b))
+		(*b)++;
+	len_a = *a - start_a;
+	len_b = *b - start_b;
+	rc = strncmp (start_a, start_b, MIN (len_a, len_b));
+	if (rc != 0)
+		return rc;
+	if (len_a != len_b)
+		return len_a > len_b ? 1 : -1;
+	return 0;
+}
+
+/*
+ * pk_package_sack_vercmp_part:
+ *
+ * Compares a version or a release the way rpm and dpkg mostly agree on;
+ * a '~' sorts before everything, even the end of the string.
+ **/
+static gint
+pk_package_sack_vercmp_part (const gchar *a, const gchar *b)
+{
+	gint rc;
+
+	while (*a != '\0' || *b != '\0') {
+		/* skip separators */
+		while (*a != '\0' && *a != '~' && !g_ascii_isalnum (*a))
+			a++;
+		while (*b != '\0' && *b != '~' && !g_ascii_isalnum (*b))
+			b++;
+
+		if (*a == '~' || *b == '~') {
+			if (*a != '~')
+				return 1;
+			if (*b != '~')
+				return -1;
+			a++;
+			b++;
+			continue;
 		}
+		if (*a == '\0' || *b == '\0')
+			break;
+
+		rc = pk_package_sack_vercmp_segment (&a, &b);
+		if (rc != 0)
+			return rc;
 	}
-	return NULL;
+	if (*a == '\0' && *b == '\0')
+		return 0;
+	return *a == '\0' ? -1 : 1;
+}
+
+/*
+ * pk_package_sack_vercmp:
+ *
+ * Compares [epoch:]version[-release] strings like rpmvercmp, the epoch
+ * first, then the version and then the release after the last '-'.
+ **/
+gint
+pk_package_sack_vercmp (const gchar *a, const gchar *b)
+{
+	gint rc;
+	guint64 epoch_a = 0;
+	guint64 epoch_b = 0;
+	const gchar *release_a;
+	const gchar *release_b;
+	const gchar *tmp;
+	g_autofree gchar *version_a = NULL;
+	g_autofree gchar *version_b = NULL;
+
+	if (a == NULL || b == NULL)
+		return g_strcmp0 (a, b);
+
+	/* a missing epoch is zero */
+	tmp = strchr (a, ':');
+	if (tmp != NULL) {
+		epoch_a = g_ascii_strtoull (a, NULL, 10);
+		a = tmp + 1;
+	}
+	tmp = strchr (b, ':');
+	if (tmp != NULL) {
+		epoch_b = g_ascii_strtoull (b, NULL, 10);
+		b = tmp + 1;
+	}
+	if (epoch_a != epoch_b)
+		return epoch_a > epoch_b ? 1 : -1;
+
+	/* 1.0.1-1 is newer than 1.0-10 */
+	release_a = strrchr (a, '-');
+	release_b = strrchr (b, '-');
+	version_a = g_strndup (a, release_a != NULL ? (gsize) (release_a - a) : strlen (a));
+	version_b = g_strndup (b, release_b != NULL ? (gsize) (release_b - b) : strlen (b));
+	rc = pk_package_sack_vercmp_part (version_a, version_b);
+	if (rc != 0)
+		return rc;
+
+	/* like rpm, a missing release matches any */
+	if (release_a == NULL || release_b == NULL)
+		return 0;
+	return pk_package_sack_vercmp_part (release_a + 1, release_b + 1);
+}
+
+/*
+ * pk_package_sack_merge_newest_add:
+ **/
+static void
+pk_package_sack_merge_newest_add (GHashTable *newest, GPtrArray *keys, PkPackageSack *sack)
+{
+	PkPackage *package;
+	PkPackage *existing;
+	gchar *key;
+	guint i;
+
+	for (i = 0; i < sack->priv->array->len; i++) {
+		package = g_ptr_array_index (sack->priv->array, i);
+		key = g_strdup_printf ("%s;%s",
+				       pk_package_get_name (package),
+				       pk_package_get_arch (package));
+		existing = g_hash_table_lookup (newest, key);
+		if (existing == NULL) {
+			g_ptr_array_add (keys, key);
+			g_hash_table_insert (newest, key, package);
+			continue;
+		}
+		if (pk_package_sack_vercmp (pk_package_get_version (package),
+					    pk_package_get_version (existing)) > 0)
+			g_hash_table_insert (newest, key, package);
+		g_free (key);
+	}
+}
+
+/**
+ * pk_package_sack_merge_newest:
+ * @sack: a valid #PkPackageSack instance
+ * @other: another #PkPackageSack
+ *
+ * Returns a new package sack with one package for each name and
+ * architecture in either sack, which is the one with the newest version.
+ * Packages from @sack win ties.
+ *
+ * Return value: (transfer full): a new #PkPackageSack, free with g_object_unref()
+ *
+ * Since: 1.3.0
+ **/
+PkPackageSack *
+pk_package_sack_merge_newest (PkPackageSack *sack, PkPackageSack *other)
+{
+	PkPackageSack *results;
+	guint i;
+	g_autoptr(GHashTable) newest = NULL;
+	g_autoptr(GPtrArray) keys = NULL;
+
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (sack), NULL);
+	g_return_val_if_fail (PK_IS_PACKAGE_SACK (other), NULL);
+
+	/* keys are owned by the array, which also keeps the order stable */
+	keys = g_ptr_array_new_with_free_func (g_free);
+	newest = g_hash_table_new (g_str_hash, g_str_equal);
+	pk_package_sack_merge_newest_add (newest, keys, sack);
+	pk_package_sack_merge_newest_add (newest, keys, other);
+
+	results = pk_package_sack_new ();
+	for (i = 0; i < keys->len; i++) {
+		PkPackage *package = g_hash_table_lookup (newest, g_ptr_array_index (keys, i));
+		pk_package_sack_add_package (results, package);
+	}
+	return results;
 }
 
 /*
@@ -564,16 +1063,7 @@ pk_package_sack_find_by_id_name_arch (PkPackageSack *sack, const gchar *package_
 static gint
 pk_package_sack_sort_compare_name_func (PkPackage **a, PkPackage **b)
 {
-	const gchar *package_id1;
-	const gchar *package_id2;
-	g_auto(GStrv) split1 = NULL;
-	g_auto(GStrv) split2 = NULL;
-
-	package_id1 = pk_package_get_id (*a);
-	package_id2 = pk_package_get_id (*b);
-	split1 = pk_package_id_split (package_id1);
-	split2 = pk_package_id_split (package_id2);
-	return g_strcmp0 (split1[PK_PACKAGE_ID_NAME], split2[PK_PACKAGE_ID_NAME]);
+	return g_strcmp0 (pk_package_get_name (*a), pk_package_get_name (*b));
 }
 
 /*
@@ -640,6 +1130,7 @@ pk_package_sack_sort (PkPackageSack *sack, PkPackageSackSortType type)
 		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_summary_func);
 	else if (type == PK_PACKAGE_SACK_SORT_TYPE_INFO)
 		g_ptr_array_sort (sack->priv->array, (GCompareFunc) pk_package_sack_sort_compare_info_func);
+	pk_package_sack_reindex (sack);
 }
 
 /**
@@ -1082,6 +1573,10 @@ pk_package_sack_init (PkPackageSack *sack)
 	priv = sack->priv;
 
 	priv->table = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->names = g_hash_table_new_full (g_str_hash, g_str_equal,
+					     g_free, (GDestroyNotify) g_ptr_array_unref);
+	priv->name_arches = g_hash_table_new_full (g_str_hash, g_str_equal,
+						   g_free, (GDestroyNotify) g_ptr_array_unref);
 	priv->array = g_ptr_array_new_with_free_func (g_object_unref);
 	priv->client = pk_client_new ();
 }
@@ -1097,6 +1592,10 @@ pk_package_sack_finalize (GObject *object)
 
 	g_ptr_array_unref (priv->array);
 	g_hash_table_unref (priv->table);
+	g_hash_table_unref (priv->names);
+	g_hash_table_unref (priv->name_arches);
+	if (priv->infos != NULL)
+		g_hash_table_unref (priv->infos);
 	g_object_unref (priv->client);
 
 	G_OBJECT_CLASS (pk_package_sack_parent_class)->finalize (object);
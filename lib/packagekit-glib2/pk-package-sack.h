@@ -128,15 +128,25 @@ gboolean	 pk_package_sack_remove_package_by_id	(PkPackageSack		*sack,
 gboolean	 pk_package_sack_remove_by_filter	(PkPackageSack		*sack,
 							 PkPackageSackFilterFunc filter_cb,
 							 gpointer		 user_data);
+gboolean	 pk_package_sack_remove_by_ids		(PkPackageSack		*sack,
+							 gchar			**package_ids);
 PkPackage	*pk_package_sack_find_by_id		(PkPackageSack		*sack,
 							 const gchar		*package_id);
 PkPackage	*pk_package_sack_find_by_id_name_arch	(PkPackageSack		*sack,
 							 const gchar		*package_id);
+GPtrArray	*pk_package_sack_find_by_name		(PkPackageSack		*sack,
+							 const gchar		*name);
 PkPackageSack	*pk_package_sack_filter_by_info		(PkPackageSack		*sack,
 							 PkInfoEnum		 info);
 PkPackageSack	*pk_package_sack_filter			(PkPackageSack		*sack,
 							 PkPackageSackFilterFunc filter_cb,
 							 gpointer		 user_data);
+PkPackageSack	*pk_package_sack_intersect		(PkPackageSack		*sack,
+							 PkPackageSack		*other);
+PkPackageSack	*pk_package_sack_difference		(PkPackageSack		*sack,
+							 PkPackageSack		*other);
+PkPackageSack	*pk_package_sack_merge_newest		(PkPackageSack		*sack,
+							 PkPackageSack		*other);
 guint64		 pk_package_sack_get_total_bytes	(PkPackageSack		*sack);
 
 gboolean	 pk_package_sack_merge_generic_finish	(PkPackageSack		*sack,
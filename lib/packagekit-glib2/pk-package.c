@@ -37,9 +37,13 @@
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-enum-types.h>
 #include <packagekit-glib2/pk-package-id.h>
+#include <packagekit-glib2/pk-package-private.h>
 
 static void     pk_package_finalize	(GObject     *object);
 
+/* bumped whenever the info of any package changes */
+static gint pk_package_info_serial = 0;
+
 #define PK_PACKAGE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_PACKAGE, PkPackagePrivate))
 
 /**
@@ -269,9 +273,23 @@ void
 pk_package_set_info (PkPackage *package, PkInfoEnum info)
 {
 	g_return_if_fail (PK_IS_PACKAGE (package));
+	if (package->priv->info != info)
+		g_atomic_int_inc (&pk_package_info_serial);
 	package->priv->info = info;
 }
 
+/*
+ * pk_package_get_info_serial:
+ *
+ * Lets a #PkPackageSack know when the packages it indexed by info have
+ * changed, as pk_package_set_info() does not notify.
+ **/
+guint
+pk_package_get_info_serial (void)
+{
+	return (guint) g_atomic_int_get (&pk_package_info_serial);
+}
+
 /**
  * pk_package_set_summary:
  * @package: a valid #PkPackage instance
@@ -36,6 +36,7 @@
 #include <packagekit-glib2/pk-results.h>
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-enum-types.h>
+#include <packagekit-glib2/pk-package-id.h>
 
 static void     pk_results_finalize	(GObject     *object);
 
@@ -66,8 +67,24 @@ struct _PkResultsPrivate
 	GPtrArray		*media_change_required_array;
 	GPtrArray		*repo_detail_array;
 	PkPackageSack		*package_sack;
+	/* packages not made into objects yet, which all come after the sack */
+	GStringChunk		*row_strings;
+	GPtrArray		*row_package_ids;
+	GPtrArray		*row_summaries;
+	GByteArray		*row_infos;
+	GByteArray		*row_update_severities;
 };
 
+typedef struct {
+	PkResults		*results;
+	GPtrArray		*packages;
+	guint			 package_idx;
+	guint			 row_idx;
+	gpointer		 padding[4];
+} PkResultsRealPackageIter;
+
+G_STATIC_ASSERT (sizeof (PkResultsRealPackageIter) == sizeof (PkResultsPackageIter));
+
 enum {
 	PROP_0,
 	PROP_ROLE,
@@ -181,6 +198,42 @@ pk_results_set_exit_code (PkResults *results, PkExitEnum exit_enum)
 	return TRUE;
 }
 
+/*
+ * pk_results_materialize_package_rows:
+ *
+ * Turns the packed package rows into #PkPackage objects in the sack.
+ **/
+static void
+pk_results_materialize_package_rows (PkResults *results)
+{
+	PkResultsPrivate *priv = results->priv;
+	const gchar *transaction_id = NULL;
+
+	if (priv->row_package_ids->len == 0)
+		return;
+
+	if (priv->progress != NULL)
+		transaction_id = pk_progress_get_transaction_id (priv->progress);
+	for (guint i = 0; i < priv->row_package_ids->len; i++) {
+		g_autoptr(PkPackage) package = pk_package_new ();
+		pk_package_set_id (package, g_ptr_array_index (priv->row_package_ids, i), NULL);
+		pk_package_set_info (package, priv->row_infos->data[i]);
+		pk_package_set_summary (package, g_ptr_array_index (priv->row_summaries, i));
+		pk_package_set_update_severity (package, priv->row_update_severities->data[i]);
+		g_object_set (package,
+			      "role", priv->role,
+			      "transaction-id", transaction_id,
+			      NULL);
+		pk_package_sack_add_package (priv->package_sack, package);
+	}
+
+	g_ptr_array_set_size (priv->row_package_ids, 0);
+	g_ptr_array_set_size (priv->row_summaries, 0);
+	g_byte_array_set_size (priv->row_infos, 0);
+	g_byte_array_set_size (priv->row_update_severities, 0);
+	g_string_chunk_clear (priv->row_strings);
+}
+
 /**
  * pk_results_add_package:
  * @results: a valid #PkResults instance
@@ -203,10 +256,66 @@ pk_results_add_package (PkResults *results, PkPackage *item)
 		g_warning ("Finished packages cannot be added to PkResults");
 		return FALSE;
 	}
+
+	/* keep the order packages were added in */
+	pk_results_materialize_package_rows (results);
 	pk_package_sack_add_package (results->priv->package_sack, item);
 	return TRUE;
 }
 
+/**
+ * pk_results_add_package_row:
+ * @results: a valid #PkResults instance
+ * @info: the #PkInfoEnum of the package
+ * @package_id: the package ID
+ * @summary: the package summary
+ * @update_severity: the #PkInfoEnum update severity, or %PK_INFO_ENUM_UNKNOWN
+ *
+ * Adds a package to the results set without creating a #PkPackage for it.
+ * The data is kept in packed arrays, and only made into objects if
+ * pk_results_get_package_array() or pk_results_get_package_sack() is called.
+ * Use pk_results_package_iter_init() to read it back without allocating.
+ *
+ * Return value: %TRUE if the value was set
+ *
+ * Since: 1.3.0
+ **/
+gboolean
+pk_results_add_package_row (PkResults *results,
+			    PkInfoEnum info,
+			    const gchar *package_id,
+			    const gchar *summary,
+			    PkInfoEnum update_severity)
+{
+	PkResultsPrivate *priv;
+	guint8 tmp;
+
+	g_return_val_if_fail (PK_IS_RESULTS (results), FALSE);
+	g_return_val_if_fail (package_id != NULL, FALSE);
+	G_STATIC_ASSERT (PK_INFO_ENUM_LAST <= G_MAXUINT8);
+
+	/* do not allow finished types */
+	if (info == PK_INFO_ENUM_FINISHED) {
+		g_warning ("Finished packages cannot be added to PkResults");
+		return FALSE;
+	}
+	if (!pk_package_id_check (package_id)) {
+		g_warning ("invalid package id %s", package_id);
+		return FALSE;
+	}
+
+	priv = results->priv;
+	g_ptr_array_add (priv->row_package_ids,
+			 g_string_chunk_insert (priv->row_strings, package_id));
+	g_ptr_array_add (priv->row_summaries,
+			 summary != NULL ? g_string_chunk_insert_const (priv->row_strings, summary) : NULL);
+	tmp = info;
+	g_byte_array_append (priv->row_infos, &tmp, 1);
+	tmp = update_severity;
+	g_byte_array_append (priv->row_update_severities, &tmp, 1);
+	return TRUE;
+}
+
 /**
  * pk_results_add_details:
  * @results: a valid #PkResults instance
@@ -485,6 +594,70 @@ pk_results_set_error_code (PkResults *results, PkError *item)
 	return TRUE;
 }
 
+static void
+pk_results_append_array (GPtrArray *array, GPtrArray *source)
+{
+	for (guint i = 0; i < source->len; i++)
+		g_ptr_array_add (array, g_object_ref (g_ptr_array_index (source, i)));
+}
+
+/**
+ * pk_results_append:
+ * @results: a valid #PkResults instance
+ * @source: the #PkResults to take the items from
+ *
+ * Adds everything in @source to the end of @results. The items are shared
+ * rather than copied, and packages added with pk_results_add_package_row()
+ * stay in the packed form.
+ *
+ * Since: 1.3.0
+ **/
+void
+pk_results_append (PkResults *results, PkResults *source)
+{
+	PkResultsPrivate *priv;
+	PkResultsPrivate *src;
+	g_autoptr(GPtrArray) packages = NULL;
+
+	g_return_if_fail (PK_IS_RESULTS (results));
+	g_return_if_fail (PK_IS_RESULTS (source));
+	g_return_if_fail (results != source);
+
+	priv = results->priv;
+	src = source->priv;
+
+	/* the package objects in the sack always come before the rows */
+	packages = pk_package_sack_get_array (src->package_sack);
+	for (guint i = 0; i < packages->len; i++)
+		pk_results_add_package (results, g_ptr_array_index (packages, i));
+	for (guint i = 0; i < src->row_package_ids->len; i++) {
+		const gchar *summary = g_ptr_array_index (src->row_summaries, i);
+		g_ptr_array_add (priv->row_package_ids,
+				 g_string_chunk_insert (priv->row_strings,
+							g_ptr_array_index (src->row_package_ids, i)));
+		g_ptr_array_add (priv->row_summaries,
+				 summary != NULL ? g_string_chunk_insert_const (priv->row_strings, summary) : NULL);
+	}
+	g_byte_array_append (priv->row_infos,
+			     src->row_infos->data, src->row_infos->len);
+	g_byte_array_append (priv->row_update_severities,
+			     src->row_update_severities->data, src->row_update_severities->len);
+
+	pk_results_append_array (priv->details_array, src->details_array);
+	pk_results_append_array (priv->update_detail_array, src->update_detail_array);
+	pk_results_append_array (priv->category_array, src->category_array);
+	pk_results_append_array (priv->distro_upgrade_array, src->distro_upgrade_array);
+	pk_results_append_array (priv->require_restart_array, src->require_restart_array);
+	pk_results_append_array (priv->transaction_array, src->transaction_array);
+	pk_results_append_array (priv->files_array, src->files_array);
+	pk_results_append_array (priv->repo_signature_required_array, src->repo_signature_required_array);
+	pk_results_append_array (priv->eula_required_array, src->eula_required_array);
+	pk_results_append_array (priv->media_change_required_array, src->media_change_required_array);
+	pk_results_append_array (priv->repo_detail_array, src->repo_detail_array);
+	if (src->error_code != NULL)
+		pk_results_set_error_code (results, src->error_code);
+}
+
 /**
  * pk_results_get_exit_code:
  * @results: a valid #PkResults instance
@@ -578,9 +751,106 @@ GPtrArray *
 pk_results_get_package_array (PkResults *results)
 {
 	g_return_val_if_fail (PK_IS_RESULTS (results), NULL);
+	pk_results_materialize_package_rows (results);
 	return pk_package_sack_get_array (results->priv->package_sack);
 }
 
+/**
+ * pk_results_get_package_count:
+ * @results: a valid #PkResults instance
+ *
+ * Gets the number of packages in the results, without creating a
+ * #PkPackage for each one.
+ *
+ * Return value: the number of packages
+ *
+ * Since: 1.3.0
+ **/
+guint
+pk_results_get_package_count (PkResults *results)
+{
+	g_return_val_if_fail (PK_IS_RESULTS (results), 0);
+	return pk_package_sack_get_size (results->priv->package_sack) +
+	       results->priv->row_package_ids->len;
+}
+
+/**
+ * pk_results_package_iter_init:
+ * @iter: an uninitialized #PkResultsPackageIter
+ * @results: a valid #PkResults instance
+ *
+ * Sets up @iter to walk the packages in @results in the order they were
+ * added. The results must not be changed while iterating.
+ *
+ * Since: 1.3.0
+ **/
+void
+pk_results_package_iter_init (PkResultsPackageIter *iter, PkResults *results)
+{
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+
+	g_return_if_fail (iter != NULL);
+	g_return_if_fail (PK_IS_RESULTS (results));
+
+	ri->results = results;
+	ri->package_idx = 0;
+	ri->row_idx = 0;
+
+	/* the sack holds a reference for as long as the results are unchanged */
+	ri->packages = pk_package_sack_get_array (results->priv->package_sack);
+	g_ptr_array_unref (ri->packages);
+}
+
+/**
+ * pk_results_package_iter_next:
+ * @iter: a #PkResultsPackageIter
+ * @info: (out) (optional): the #PkInfoEnum of the package
+ * @package_id: (out) (optional) (transfer none): the package ID
+ * @summary: (out) (optional) (transfer none): the package summary
+ *
+ * Gets the next package. The strings are owned by the results.
+ *
+ * Return value: %FALSE when there are no more packages
+ *
+ * Since: 1.3.0
+ **/
+gboolean
+pk_results_package_iter_next (PkResultsPackageIter *iter,
+			      PkInfoEnum *info,
+			      const gchar **package_id,
+			      const gchar **summary)
+{
+	PkResultsRealPackageIter *ri = (PkResultsRealPackageIter *) iter;
+	PkResultsPrivate *priv;
+
+	g_return_val_if_fail (iter != NULL, FALSE);
+
+	/* objects first */
+	if (ri->package_idx < ri->packages->len) {
+		PkPackage *package = g_ptr_array_index (ri->packages, ri->package_idx++);
+		if (info != NULL)
+			*info = pk_package_get_info (package);
+		if (package_id != NULL)
+			*package_id = pk_package_get_id (package);
+		if (summary != NULL)
+			*summary = pk_package_get_summary (package);
+		return TRUE;
+	}
+
+	/* then the packed rows */
+	priv = ri->results->priv;
+	if (ri->row_idx >= priv->row_package_ids->len)
+		return FALSE;
+	if (info != NULL)
+		*info = priv->row_infos->data[ri->row_idx];
+	if (package_id != NULL)
+		*package_id = g_ptr_array_index (priv->row_package_ids, ri->row_idx);
+	if (summary != NULL)
+		*summary = g_ptr_array_index (priv->row_summaries, ri->row_idx);
+	ri->row_idx++;
+	return TRUE;
+}
+
 /**
  * pk_results_get_package_sack:
  * @results: a valid #PkResults instance
@@ -595,6 +865,7 @@ PkPackageSack *
 pk_results_get_package_sack (PkResults *results)
 {
 	g_return_val_if_fail (PK_IS_RESULTS (results), NULL);
+	pk_results_materialize_package_rows (results);
 	return g_object_ref (results->priv->package_sack);
 }
 
@@ -898,6 +1169,11 @@ pk_results_init (PkResults *results)
 	results->priv->progress = NULL;
 	results->priv->error_code = NULL;
 	results->priv->package_sack = pk_package_sack_new ();
+	results->priv->row_strings = g_string_chunk_new (64 * 1024);
+	results->priv->row_package_ids = g_ptr_array_new ();
+	results->priv->row_summaries = g_ptr_array_new ();
+	results->priv->row_infos = g_byte_array_new ();
+	results->priv->row_update_severities = g_byte_array_new ();
 	results->priv->details_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	results->priv->update_detail_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	results->priv->category_array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
@@ -932,6 +1208,11 @@ pk_results_finalize (GObject *object)
 	g_ptr_array_unref (priv->media_change_required_array);
 	g_ptr_array_unref (priv->repo_detail_array);
 	g_object_unref (priv->package_sack);
+	g_string_chunk_free (priv->row_strings);
+	g_ptr_array_unref (priv->row_package_ids);
+	g_ptr_array_unref (priv->row_summaries);
+	g_byte_array_unref (priv->row_infos);
+	g_byte_array_unref (priv->row_update_severities);
 	if (results->priv->progress != NULL)
 		g_object_unref (results->priv->progress);
 	if (results->priv->error_code != NULL)
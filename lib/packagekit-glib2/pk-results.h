@@ -78,6 +78,23 @@ struct _PkResultsClass
 	void (*_pk_reserved5) (void);
 };
 
+/**
+ * PkResultsPackageIter:
+ *
+ * An opaque structure used to walk the packages in a #PkResults without
+ * creating a #PkPackage for each one.
+ *
+ * Since: 1.3.0
+ **/
+typedef struct {
+	/*< private >*/
+	gpointer	 dummy1;
+	gpointer	 dummy2;
+	guint		 dummy3;
+	guint		 dummy4;
+	gpointer	 dummy5[4];
+} PkResultsPackageIter;
+
 GType		 pk_results_get_type		  	(void);
 PkResults	*pk_results_new				(void);
 
@@ -92,6 +109,11 @@ gboolean	 pk_results_set_error_code 		(PkResults		*results,
 /* add */
 gboolean	 pk_results_add_package			(PkResults		*results,
 							 PkPackage		*item);
+gboolean	 pk_results_add_package_row		(PkResults		*results,
+							 PkInfoEnum		 info,
+							 const gchar		*package_id,
+							 const gchar		*summary,
+							 PkInfoEnum		 update_severity);
 gboolean	 pk_results_add_details			(PkResults		*results,
 							 PkDetails		*item);
 gboolean	 pk_results_add_update_detail		(PkResults		*results,
@@ -114,6 +136,8 @@ gboolean	 pk_results_add_media_change_required	(PkResults		*results,
 							 PkMediaChangeRequired	*item);
 gboolean	 pk_results_add_repo_detail 		(PkResults		*results,
 							 PkRepoDetail		*item);
+void		 pk_results_append			(PkResults		*results,
+							 PkResults		*source);
 
 /* get single data */
 PkExitEnum	 pk_results_get_exit_code		(PkResults		*results);
@@ -137,6 +161,15 @@ GPtrArray	*pk_results_get_eula_required_array	(PkResults		*results);
 GPtrArray	*pk_results_get_media_change_required_array (PkResults		*results);
 GPtrArray	*pk_results_get_repo_detail_array	(PkResults		*results);
 
+/* walk packages without allocating */
+guint		 pk_results_get_package_count		(PkResults		*results);
+void		 pk_results_package_iter_init		(PkResultsPackageIter	*iter,
+							 PkResults		*results);
+gboolean	 pk_results_package_iter_next		(PkResultsPackageIter	*iter,
+							 PkInfoEnum		*info,
+							 const gchar		**package_id,
+							 const gchar		**summary);
+
 G_END_DECLS
 
 #endif /* __PK_RESULTS_H */
@@ -22,9 +22,17 @@
 
 #include "config.h"
 
+#include <string.h>
+#include <utime.h>
 #include <glib-object.h>
+#include <glib/gstdio.h>
 
+#include "pk-client-private.h"
+#include "pk-command-index.h"
 #include "pk-common.h"
+#include "pk-control-private.h"
+#include "pk-desktop-private.h"
+#include "pk-enum-private.h"
 #include "pk-debug.h"
 #include "pk-enum.h"
 #include "pk-offline.h"
@@ -32,6 +40,7 @@
 #include "pk-package.h"
 #include "pk-package-id.h"
 #include "pk-package-ids.h"
+#include "pk-package-sack.h"
 #include "pk-progress-bar.h"
 #include "pk-results.h"
 
@@ -326,6 +335,43 @@ pk_test_enum_func (void)
 	}
 }
 
+static void
+pk_test_enum_hash_func (void)
+{
+	const PkEnumIndex * const *indexes = pk_enum_get_indexes ();
+	guint i, j;
+
+	g_assert_nonnull (indexes[0]);
+	for (i = 0; indexes[i] != NULL; i++) {
+		const PkEnumIndex *idx = indexes[i];
+		const PkEnumMatch *table = idx->table;
+
+		/* every string and value agrees with the linear search */
+		for (j = 0; table[j].string != NULL; j++) {
+			g_assert_cmpint (pk_enum_index_find_value (idx, table[j].string), ==,
+					 pk_enum_find_value (table, table[j].string));
+			g_assert_cmpstr (pk_enum_index_find_string (idx, table[j].value), ==,
+					 pk_enum_find_string (table, table[j].value));
+		}
+
+		/* so do the fallbacks */
+		g_assert_cmpint (pk_enum_index_find_value (idx, NULL), ==, table[0].value);
+		g_assert_cmpint (pk_enum_index_find_value (idx, ""), ==, table[0].value);
+		g_assert_cmpint (pk_enum_index_find_value (idx, "not-an-enum-string"), ==,
+				 pk_enum_find_value (table, "not-an-enum-string"));
+		for (j = 0; j < idx->n_strings + 16; j++) {
+			g_assert_cmpstr (pk_enum_index_find_string (idx, j), ==,
+					 pk_enum_find_string (table, j));
+		}
+		g_assert_cmpstr (pk_enum_index_find_string (idx, G_MAXUINT), ==, table[0].string);
+	}
+
+	/* and the public functions use them */
+	g_assert_cmpint (pk_filter_enum_from_string ("~installed"), ==, PK_FILTER_ENUM_NOT_INSTALLED);
+	g_assert_cmpint (pk_filter_enum_from_string ("installed"), ==, PK_FILTER_ENUM_INSTALLED);
+	g_assert_cmpstr (pk_info_enum_to_string (PK_INFO_ENUM_SECURITY), ==, "security");
+}
+
 static void
 pk_test_package_id_func (void)
 {
@@ -536,6 +582,93 @@ pk_test_results_func (void)
 	g_object_unref (results);
 }
 
+static void
+pk_test_results_rows_func (void)
+{
+	const guint size = 80000;
+	gboolean ret;
+	gdouble elapsed;
+	guint count = 0;
+	PkInfoEnum info;
+	PkPackage *package;
+	const gchar *package_id;
+	const gchar *summary;
+	PkResultsPackageIter iter;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+	g_autoptr(PkPackage) item = pk_package_new ();
+	g_autoptr(PkResults) results = pk_results_new ();
+	g_autoptr(PkResults) merged = pk_results_new ();
+
+	/* rows and objects keep the order they were added in */
+	ret = pk_results_add_package_row (results, PK_INFO_ENUM_AVAILABLE,
+					  "gnome-power-manager;0.1.2;i386;fedora",
+					  "Power manager for GNOME",
+					  PK_INFO_ENUM_UNKNOWN);
+	g_assert_true (ret);
+	g_test_expect_message (G_LOG_DOMAIN, G_LOG_LEVEL_WARNING, "invalid package id*");
+	ret = pk_results_add_package_row (results, PK_INFO_ENUM_AVAILABLE,
+					  "not-a-package-id", NULL,
+					  PK_INFO_ENUM_UNKNOWN);
+	g_test_assert_expected_messages ();
+	g_assert_false (ret);
+	pk_package_set_id (item, "gnome-packagekit;0.2.3;i386;fedora", NULL);
+	pk_package_set_info (item, PK_INFO_ENUM_INSTALLED);
+	pk_results_add_package (results, item);
+	ret = pk_results_add_package_row (results, PK_INFO_ENUM_SECURITY,
+					  "powertop;1.8-1.fc8;i386;updates",
+					  "Power consumption monitor",
+					  PK_INFO_ENUM_CRITICAL);
+	g_assert_true (ret);
+	g_assert_cmpint (pk_results_get_package_count (results), ==, 3);
+
+	pk_results_package_iter_init (&iter, results);
+	g_assert_true (pk_results_package_iter_next (&iter, &info, &package_id, &summary));
+	g_assert_cmpint (info, ==, PK_INFO_ENUM_AVAILABLE);
+	g_assert_cmpstr (package_id, ==, "gnome-power-manager;0.1.2;i386;fedora");
+	g_assert_true (pk_results_package_iter_next (&iter, &info, &package_id, NULL));
+	g_assert_cmpint (info, ==, PK_INFO_ENUM_INSTALLED);
+	g_assert_true (pk_results_package_iter_next (&iter, NULL, &package_id, &summary));
+	g_assert_cmpstr (package_id, ==, "powertop;1.8-1.fc8;i386;updates");
+	g_assert_cmpstr (summary, ==, "Power consumption monitor");
+	g_assert_false (pk_results_package_iter_next (&iter, NULL, NULL, NULL));
+
+	/* appending keeps the rows packed and in order */
+	pk_results_append (merged, results);
+	pk_results_append (merged, results);
+	g_assert_cmpint (pk_results_get_package_count (merged), ==, 6);
+	pk_results_package_iter_init (&iter, merged);
+	for (guint i = 0; i < 4; i++)
+		g_assert_true (pk_results_package_iter_next (&iter, NULL, &package_id, NULL));
+	g_assert_cmpstr (package_id, ==, "gnome-power-manager;0.1.2;i386;fedora");
+
+	/* objects are only made when asked for */
+	packages = pk_results_get_package_array (results);
+	g_assert_cmpint (packages->len, ==, 3);
+	package = g_ptr_array_index (packages, 2);
+	g_assert_cmpstr (pk_package_get_name (package), ==, "powertop");
+	g_assert_cmpint (pk_package_get_info (package), ==, PK_INFO_ENUM_SECURITY);
+	g_assert_cmpint (pk_package_get_update_severity (package), ==, PK_INFO_ENUM_CRITICAL);
+	g_assert_cmpstr (pk_package_get_summary (package), ==, "Power consumption monitor");
+	g_assert_cmpint (pk_results_get_package_count (results), ==, 3);
+	g_clear_object (&results);
+
+	/* a big listing, read back without objects */
+	results = pk_results_new ();
+	g_timer_reset (timer);
+	for (guint i = 0; i < size; i++) {
+		g_autofree gchar *tmp = g_strdup_printf ("package%u;1.0-1;x86_64;fedora", i);
+		pk_results_add_package_row (results, PK_INFO_ENUM_AVAILABLE,
+					    tmp, "A package", PK_INFO_ENUM_UNKNOWN);
+	}
+	pk_results_package_iter_init (&iter, results);
+	while (pk_results_package_iter_next (&iter, NULL, NULL, NULL))
+		count++;
+	g_assert_cmpint (count, ==, size);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_test_message ("adding and iterating %u rows: %.3fms", size, elapsed * 1000);
+}
+
 static void
 pk_test_package_func (void)
 {
@@ -599,6 +732,235 @@ pk_test_package_func (void)
 	g_object_unref (package);
 }
 
+static gboolean
+pk_test_package_sack_keep_even_cb (PkPackage *package, gpointer user_data)
+{
+	const gchar *name = pk_package_get_name (package);
+	return (name[strlen (name) - 1] - '0') % 2 == 0;
+}
+
+static PkPackageSack *
+pk_test_package_sack_new_sized (guint size, const gchar *version)
+{
+	PkPackageSack *sack = pk_package_sack_new ();
+	for (guint i = 0; i < size; i++) {
+		g_autofree gchar *package_id = NULL;
+		package_id = g_strdup_printf ("package%u;%s;x86_64;fedora", i, version);
+		pk_package_sack_add_package_by_id (sack, package_id, NULL);
+	}
+	return sack;
+}
+
+static void
+pk_test_package_sack_func (void)
+{
+	const guint size = 50000;
+	gboolean ret;
+	gdouble elapsed;
+	g_auto(GStrv) package_ids = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+	g_autoptr(PkPackage) package = NULL;
+	g_autoptr(PkPackageSack) difference = NULL;
+	g_autoptr(PkPackageSack) filtered = NULL;
+	g_autoptr(PkPackageSack) installed = NULL;
+	g_autoptr(PkPackageSack) intersect = NULL;
+	g_autoptr(PkPackageSack) merged = NULL;
+	g_autoptr(PkPackageSack) sack = NULL;
+	g_autoptr(PkPackageSack) updates = NULL;
+	gchar *remove_ids[] = { "package1;1.0;x86_64;fedora",
+				"package3;1.0;x86_64;fedora",
+				"package9;1.0;x86_64;fedora",
+				NULL };
+
+	/* name and name+arch lookups */
+	sack = pk_package_sack_new ();
+	pk_package_sack_add_package_by_id (sack, "gnome-shell;40.1;x86_64;fedora", NULL);
+	pk_package_sack_add_package_by_id (sack, "gnome-shell;40.1;i686;fedora", NULL);
+	pk_package_sack_add_package_by_id (sack, "gnome-shell-extensions;40.1;noarch;fedora", NULL);
+	packages = pk_package_sack_find_by_name (sack, "gnome-shell");
+	g_assert_cmpint (packages->len, ==, 2);
+	package = pk_package_sack_find_by_id_name_arch (sack, "gnome-shell;41.0;i686;updates");
+	g_assert_nonnull (package);
+	g_assert_cmpstr (pk_package_get_id (package), ==, "gnome-shell;40.1;i686;fedora");
+	g_clear_object (&package);
+	ret = pk_package_sack_remove_package_by_id (sack, "gnome-shell;40.1;i686;fedora");
+	g_assert_true (ret);
+	package = pk_package_sack_find_by_id_name_arch (sack, "gnome-shell;41.0;i686;updates");
+	g_assert_null (package);
+	g_clear_object (&sack);
+
+	/* removing one package keeps the order of the rest */
+	sack = pk_package_sack_new ();
+	pk_package_sack_add_package_by_id (sack, "gnome-shell;40.1;x86_64;fedora", NULL);
+	pk_package_sack_add_package_by_id (sack, "gnome-shell;40.2;x86_64;updates", NULL);
+	pk_package_sack_add_package_by_id (sack, "mutter;40.1;x86_64;fedora", NULL);
+	pk_package_sack_add_package_by_id (sack, "gjs;1.68;x86_64;fedora", NULL);
+	ret = pk_package_sack_remove_package_by_id (sack, "gnome-shell;40.1;x86_64;fedora");
+	g_assert_true (ret);
+	package_ids = pk_package_sack_get_ids (sack);
+	g_assert_cmpint (g_strv_length (package_ids), ==, 3);
+	g_assert_cmpstr (package_ids[0], ==, "gnome-shell;40.2;x86_64;updates");
+	g_assert_cmpstr (package_ids[1], ==, "mutter;40.1;x86_64;fedora");
+	g_assert_cmpstr (package_ids[2], ==, "gjs;1.68;x86_64;fedora");
+	package = pk_package_sack_find_by_id_name_arch (sack, "gnome-shell;41.0;x86_64;updates");
+	g_assert_cmpstr (pk_package_get_id (package), ==, "gnome-shell;40.2;x86_64;updates");
+
+	/* the info index follows packages that change after being added */
+	filtered = pk_package_sack_filter_by_info (sack, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpint (pk_package_sack_get_size (filtered), ==, 0);
+	g_clear_object (&filtered);
+	pk_package_set_info (package, PK_INFO_ENUM_INSTALLED);
+	filtered = pk_package_sack_filter_by_info (sack, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpint (pk_package_sack_get_size (filtered), ==, 1);
+	g_clear_object (&filtered);
+	pk_package_set_info (package, PK_INFO_ENUM_AVAILABLE);
+	filtered = pk_package_sack_filter_by_info (sack, PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpint (pk_package_sack_get_size (filtered), ==, 0);
+	g_clear_object (&filtered);
+	g_clear_object (&package);
+	g_clear_object (&sack);
+
+	/* merging prefers the newest version for each name and arch */
+	installed = pk_package_sack_new ();
+	pk_package_sack_add_package_by_id (installed, "kernel;5.10.0-1;x86_64;installed", NULL);
+	pk_package_sack_add_package_by_id (installed, "bash;5.1~rc1-1;x86_64;installed", NULL);
+	pk_package_sack_add_package_by_id (installed, "zlib;1:1.2-1;x86_64;installed", NULL);
+	pk_package_sack_add_package_by_id (installed, "glib2;1.0-10;x86_64;installed", NULL);
+	updates = pk_package_sack_new ();
+	pk_package_sack_add_package_by_id (updates, "kernel;5.9.16-1;x86_64;updates", NULL);
+	pk_package_sack_add_package_by_id (updates, "bash;5.1-1;x86_64;updates", NULL);
+	pk_package_sack_add_package_by_id (updates, "zlib;1.3-1;x86_64;updates", NULL);
+	pk_package_sack_add_package_by_id (updates, "glib2;1.0.1-1;x86_64;updates", NULL);
+	merged = pk_package_sack_merge_newest (installed, updates);
+	g_assert_cmpint (pk_package_sack_get_size (merged), ==, 4);
+	package = pk_package_sack_find_by_id (merged, "kernel;5.10.0-1;x86_64;installed");
+	g_assert_nonnull (package);
+	g_clear_object (&package);
+	package = pk_package_sack_find_by_id (merged, "bash;5.1-1;x86_64;updates");
+	g_assert_nonnull (package);
+	g_clear_object (&package);
+	package = pk_package_sack_find_by_id (merged, "zlib;1:1.2-1;x86_64;installed");
+	g_assert_nonnull (package);
+	g_clear_object (&package);
+	package = pk_package_sack_find_by_id (merged, "glib2;1.0.1-1;x86_64;updates");
+	g_assert_nonnull (package);
+	g_clear_object (&package);
+	g_clear_object (&installed);
+	g_clear_object (&updates);
+	g_clear_object (&merged);
+
+	/* these should all be linear, so time them on a large sack */
+	installed = pk_test_package_sack_new_sized (size, "1.0");
+	updates = pk_test_package_sack_new_sized (size, "1.1");
+	pk_package_sack_add_package_by_id (updates, "package1;1.0;x86_64;fedora", NULL);
+
+	g_timer_reset (timer);
+	for (guint i = 0; i < size; i++) {
+		g_autofree gchar *package_id = NULL;
+		g_autoptr(PkPackage) found = NULL;
+		package_id = g_strdup_printf ("package%u;2.0;x86_64;updates", i);
+		found = pk_package_sack_find_by_id_name_arch (installed, package_id);
+		g_assert_nonnull (found);
+	}
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_test_message ("%u name+arch lookups: %.3fms", size, elapsed * 1000);
+
+	g_timer_reset (timer);
+	intersect = pk_package_sack_intersect (installed, updates);
+	g_assert_cmpint (pk_package_sack_get_size (intersect), ==, 1);
+	difference = pk_package_sack_difference (installed, updates);
+	g_assert_cmpint (pk_package_sack_get_size (difference), ==, size - 1);
+	merged = pk_package_sack_merge_newest (installed, updates);
+	g_assert_cmpint (pk_package_sack_get_size (merged), ==, size);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_test_message ("intersect, difference and merge of %u: %.3fms", size, elapsed * 1000);
+
+	g_timer_reset (timer);
+	ret = pk_package_sack_remove_by_filter (installed, pk_test_package_sack_keep_even_cb, NULL);
+	g_assert_true (ret);
+	g_assert_cmpint (pk_package_sack_get_size (installed), ==, size / 2);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_test_message ("removing %u by filter: %.3fms", size / 2, elapsed * 1000);
+
+	/* the rest one by one, which shifts the array to keep its order */
+	g_timer_reset (timer);
+	for (guint i = 0; i < size / 2; i += 2) {
+		g_autofree gchar *package_id = NULL;
+		package_id = g_strdup_printf ("package%u;1.1;x86_64;fedora", i);
+		ret = pk_package_sack_remove_package_by_id (updates, package_id);
+		g_assert_true (ret);
+	}
+	g_assert_cmpint (pk_package_sack_get_size (updates), ==, size + 1 - size / 4);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_test_message ("removing %u by id: %.3fms", size / 4, elapsed * 1000);
+	package = pk_package_sack_find_by_id (updates, "package1;1.1;x86_64;fedora");
+	g_assert_nonnull (package);
+	g_clear_object (&package);
+	ret = pk_package_sack_remove_package_by_id (updates, "package0;1.1;x86_64;fedora");
+	g_assert_false (ret);
+
+	/* the odd ones are gone already, and the rest must still be findable */
+	ret = pk_package_sack_remove_by_ids (installed, remove_ids);
+	g_assert_false (ret);
+	ret = pk_package_sack_remove_by_ids (difference, remove_ids);
+	g_assert_true (ret);
+	g_assert_cmpint (pk_package_sack_get_size (difference), ==, size - 3);
+	package = pk_package_sack_find_by_id (installed, "package2;1.0;x86_64;fedora");
+	g_assert_nonnull (package);
+	g_clear_object (&package);
+	package = pk_package_sack_find_by_id_name_arch (installed, "package3;1.0;x86_64;fedora");
+	g_assert_null (package);
+}
+
+static void
+pk_test_client_stream_cb (PkClient *client, PkResults *batch, gpointer user_data)
+{
+	GPtrArray *batches = user_data;
+	g_ptr_array_add (batches, g_object_ref (batch));
+}
+
+static void
+pk_test_client_stream_func (void)
+{
+	const gchar *files[] = { "/usr/bin/powertop", NULL };
+	PkResults *batch;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GPtrArray) batches = g_ptr_array_new_with_free_func (g_object_unref);
+	g_autoptr(PkClient) client = pk_client_new ();
+	g_autoptr(PkResults) results = pk_results_new ();
+
+	pk_client_set_stream_callback (client, PK_CLIENT_STREAM_FLAGS_NONE,
+				       pk_test_client_stream_cb, batches, NULL);
+
+	/* one batch per signal */
+	pk_client_signal_emit (client, PK_ROLE_ENUM_SEARCH_NAME, results, "Package",
+			       g_variant_new ("(uss)", PK_INFO_ENUM_AVAILABLE,
+					      "powertop;1.8-1.fc8;i386;fedora",
+					      "Power consumption monitor"));
+	pk_client_signal_emit (client, PK_ROLE_ENUM_SEARCH_NAME, results, "Files",
+			       g_variant_new ("(s^as)", "powertop;1.8-1.fc8;i386;fedora", files));
+	g_assert_cmpint (batches->len, ==, 2);
+	batch = g_ptr_array_index (batches, 0);
+	g_assert_cmpint (pk_results_get_package_count (batch), ==, 1);
+	batch = g_ptr_array_index (batches, 1);
+	g_assert_cmpint (pk_results_get_package_count (batch), ==, 0);
+	array = pk_results_get_files_array (batch);
+	g_assert_cmpint (array->len, ==, 1);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* progress only */
+	pk_client_signal_emit (client, PK_ROLE_ENUM_INSTALL_PACKAGES, results, "Package",
+			       g_variant_new ("(uss)", PK_INFO_ENUM_FINISHED,
+					      "powertop;1.8-1.fc8;i386;fedora", ""));
+	g_assert_cmpint (batches->len, ==, 2);
+
+	/* and everything streamed is also in the final results */
+	g_assert_cmpint (pk_results_get_package_count (results), ==, 1);
+	array = pk_results_get_files_array (results);
+	g_assert_cmpint (array->len, ==, 1);
+}
+
 static void
 pk_test_offline_func (void)
 {
@@ -910,6 +1272,204 @@ pk_test_offline_upgrade_func (void)
 	g_assert_true (!g_file_test (PK_OFFLINE_RESULTS_FILENAME, G_FILE_TEST_EXISTS));
 }
 
+static void
+pk_test_command_index_func (void)
+{
+	const gchar *filename = "/tmp/PackageKit-self-test/command-index";
+	gboolean ret;
+	GPtrArray *ids;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GHashTable) commands = NULL;
+	g_autoptr(PkCommandIndex) index = NULL;
+	g_auto(GStrv) package_ids = NULL;
+
+	commands = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+					  (GDestroyNotify) g_ptr_array_unref);
+	ids = g_ptr_array_new_with_free_func (g_free);
+	g_ptr_array_add (ids, g_strdup ("vim-enhanced;9.0-1;x86_64;fedora"));
+	g_ptr_array_add (ids, g_strdup ("neovim;0.9-1;x86_64;fedora"));
+	g_hash_table_insert (commands, g_strdup ("vim"), ids);
+	ids = g_ptr_array_new_with_free_func (g_free);
+	g_ptr_array_add (ids, g_strdup ("powertop;0.1.3;i386;fedora"));
+	g_hash_table_insert (commands, g_strdup ("powertop"), ids);
+
+	/* write */
+	ret = pk_command_index_write (filename, commands, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* read back */
+	index = pk_command_index_new_from_file (filename, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (index);
+	package_ids = pk_command_index_lookup (index, "vim");
+	g_assert_nonnull (package_ids);
+	g_assert_cmpint (g_strv_length (package_ids), ==, 2);
+	g_assert_true (g_strv_contains ((const gchar * const *) package_ids, "neovim;0.9-1;x86_64;fedora"));
+	g_strfreev (package_ids);
+	package_ids = pk_command_index_lookup (index, "powertop");
+	g_assert_cmpstr (package_ids[0], ==, "powertop;0.1.3;i386;fedora");
+	g_assert_null (package_ids[1]);
+	g_strfreev (package_ids);
+	package_ids = pk_command_index_lookup (index, "vi");
+	g_assert_null (package_ids);
+	g_clear_pointer (&index, pk_command_index_free);
+
+	/* truncated files are rejected */
+	ret = g_file_set_contents (filename, "PKCMDIX", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	index = pk_command_index_new_from_file (filename, &error);
+	g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL);
+	g_assert_null (index);
+}
+
+static void
+pk_test_desktop_func (void)
+{
+	const gchar *filename = "/tmp/PackageKit-self-test/desktop-files.db";
+	gboolean ret;
+	gchar *package;
+	g_autofree gchar *stamp = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GHashTable) files = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(PkDesktop) desktop = g_object_new (PK_TYPE_DESKTOP, NULL);
+	g_autoptr(PkDesktop) reader = g_object_new (PK_TYPE_DESKTOP, NULL);
+
+	/* nothing to query before it is loaded */
+	array = pk_desktop_get_files_for_package (reader, "gnome-power-manager", &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_INITIALIZED);
+	g_assert_null (array);
+	g_clear_error (&error);
+
+	files = g_hash_table_new (g_str_hash, g_str_equal);
+	g_hash_table_insert (files, "/usr/share/applications/gpm-prefs.desktop", GINT_TO_POINTER (TRUE));
+	g_hash_table_insert (files, "/usr/share/applications/gpm-statistics.desktop", GINT_TO_POINTER (FALSE));
+	pk_desktop_set_package_files (desktop, "gnome-power-manager", files);
+	g_hash_table_remove_all (files);
+	g_hash_table_insert (files, "/usr/share/applications/mimeinfo.desktop", GINT_TO_POINTER (FALSE));
+	pk_desktop_set_package_files (desktop, "shared-mime-info", files);
+	g_assert_true (pk_desktop_is_application (desktop, "gnome-power-manager"));
+	g_assert_false (pk_desktop_is_application (desktop, "shared-mime-info"));
+	g_assert_false (pk_desktop_is_application (desktop, "powertop"));
+
+	/* write and read back, with what the packages looked like */
+	pk_desktop_set_stamp (desktop, "1700000000.0");
+	ret = pk_desktop_save (desktop, filename, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = pk_desktop_load (reader, filename, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	array = pk_desktop_get_files_for_package (reader, "gnome-power-manager", &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 2);
+	g_clear_pointer (&array, g_ptr_array_unref);
+	array = pk_desktop_get_shown_for_package (reader, "gnome-power-manager", &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 1);
+	g_assert_cmpstr (g_ptr_array_index (array, 0), ==, "/usr/share/applications/gpm-prefs.desktop");
+	g_clear_pointer (&array, g_ptr_array_unref);
+	package = pk_desktop_get_package_for_file (reader, "/usr/share/applications/mimeinfo.desktop", &error);
+	g_assert_no_error (error);
+	g_assert_cmpstr (package, ==, "shared-mime-info");
+	g_free (package);
+	stamp = pk_desktop_get_stamp (reader);
+	g_assert_cmpstr (stamp, ==, "1700000000.0");
+	package = pk_desktop_get_package_for_file (reader, "PackageKit", &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null (package);
+	g_clear_error (&error);
+
+	/* removing the package drops its files */
+	pk_desktop_set_package_files (reader, "gnome-power-manager", NULL);
+	g_assert_false (pk_desktop_is_application (reader, "gnome-power-manager"));
+	package = pk_desktop_get_package_for_file (reader, "/usr/share/applications/gpm-prefs.desktop", &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null (package);
+}
+
+static void
+pk_test_control_snapshot_func (void)
+{
+	const gchar *filename = "/tmp/PackageKit-self-test/daemon-properties";
+	const gchar *conf_filename = "/tmp/PackageKit-self-test/PackageKit.conf";
+	const gchar *depends[] = { conf_filename, NULL };
+	const gchar *mime_types[] = { "application/x-rpm", NULL };
+	gboolean ret;
+	const gchar *tmp;
+	guint64 roles;
+	struct utimbuf times;
+	GVariantBuilder builder;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) properties = NULL;
+	g_autoptr(GVariant) snapshot = NULL;
+	g_autofree const gchar **mime_types_tmp = NULL;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder, "{sv}", "BackendName", g_variant_new_string ("dummy"));
+	g_variant_builder_add (&builder, "{sv}", "Roles", g_variant_new_uint64 (0x1f));
+	g_variant_builder_add (&builder, "{sv}", "MimeTypes", g_variant_new_strv (mime_types, -1));
+	properties = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+	/* save, and save again without changes */
+	ret = g_file_set_contents (conf_filename, "[Daemon]\n", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = pk_control_snapshot_save (filename, depends, properties, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = pk_control_snapshot_save (filename, depends, properties, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* load */
+	snapshot = pk_control_snapshot_load (filename, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (snapshot);
+	g_assert_true (g_variant_lookup (snapshot, "BackendName", "&s", &tmp));
+	g_assert_cmpstr (tmp, ==, "dummy");
+	g_assert_true (g_variant_lookup (snapshot, "Roles", "t", &roles));
+	g_assert_cmpint (roles, ==, 0x1f);
+	g_assert_true (g_variant_lookup (snapshot, "MimeTypes", "^a&s", &mime_types_tmp));
+	g_assert_cmpstr (mime_types_tmp[0], ==, "application/x-rpm");
+	g_clear_pointer (&snapshot, g_variant_unref);
+
+	/* the config was edited after the daemon last ran */
+	times.actime = times.modtime = time (NULL) + 60;
+	g_assert_cmpint (g_utime (conf_filename, &times), ==, 0);
+	snapshot = pk_control_snapshot_load (filename, &error);
+	g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL);
+	g_assert_null (snapshot);
+	g_clear_error (&error);
+
+	/* saving the same properties again trusts them again */
+	times.actime = times.modtime = time (NULL) - 60;
+	g_assert_cmpint (g_utime (conf_filename, &times), ==, 0);
+	times.actime = times.modtime = time (NULL) - 120;
+	g_assert_cmpint (g_utime (filename, &times), ==, 0);
+	snapshot = pk_control_snapshot_load (filename, &error);
+	g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL);
+	g_assert_null (snapshot);
+	g_clear_error (&error);
+	ret = pk_control_snapshot_save (filename, depends, properties, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	snapshot = pk_control_snapshot_load (filename, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (snapshot);
+	g_clear_pointer (&snapshot, g_variant_unref);
+
+	/* garbage is rejected */
+	ret = g_file_set_contents (filename, "PackageKit", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	snapshot = pk_control_snapshot_load (filename, &error);
+	g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL);
+	g_assert_null (snapshot);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -924,14 +1484,21 @@ main (int argc, char **argv)
 	/* tests go here */
 	g_test_add_func ("/packagekit-glib2/common", pk_test_common_func);
 	g_test_add_func ("/packagekit-glib2/enum", pk_test_enum_func);
+	g_test_add_func ("/packagekit-glib2/enum-hash", pk_test_enum_hash_func);
 	g_test_add_func ("/packagekit-glib2/bitfield", pk_test_bitfield_func);
 	g_test_add_func ("/packagekit-glib2/package-id", pk_test_package_id_func);
 	g_test_add_func ("/packagekit-glib2/package-ids", pk_test_package_ids_func);
 	g_test_add_func ("/packagekit-glib2/progress", pk_test_progress_func);
 	g_test_add_func ("/packagekit-glib2/results", pk_test_results_func);
+	g_test_add_func ("/packagekit-glib2/results-rows", pk_test_results_rows_func);
 	g_test_add_func ("/packagekit-glib2/package", pk_test_package_func);
+	g_test_add_func ("/packagekit-glib2/package-sack", pk_test_package_sack_func);
 	g_test_add_func ("/packagekit-glib2/progress-bar", pk_test_progress_bar);
+	g_test_add_func ("/packagekit-glib2/client-stream", pk_test_client_stream_func);
 	g_test_add_func ("/packagekit-glib2/offline", pk_test_offline_func);
+	g_test_add_func ("/packagekit-glib2/command-index", pk_test_command_index_func);
+	g_test_add_func ("/packagekit-glib2/desktop", pk_test_desktop_func);
+	g_test_add_func ("/packagekit-glib2/control-snapshot", pk_test_control_snapshot_func);
 	g_test_add_func ("/packagekit-glib2/offline-upgrade", pk_test_offline_upgrade_func);
 
 	return g_test_run ();
@@ -108,6 +108,8 @@ struct PkBackendJobPrivate
 	PkStatusEnum		 status;
 	GTimer			*timer;
 	gboolean		 started;
+	GMutex			 progress_mutex;
+	guint32			 progress_pending; /* bitmask of PkBackendJobSignal */
 };
 
 G_DEFINE_TYPE (PkBackendJob, pk_backend_job, G_TYPE_OBJECT)
@@ -583,6 +585,12 @@ pk_backend_job_signal_to_string (PkBackendJobSignal id)
 		return "UpdateDetails";
 	if (id == PK_BACKEND_SIGNAL_CATEGORY)
 		return "Category";
+	if (id == PK_BACKEND_SIGNAL_DETAILS_LIST)
+		return "DetailsList";
+	if (id == PK_BACKEND_SIGNAL_FILES_LIST)
+		return "FilesList";
+	if (id == PK_BACKEND_SIGNAL_REPO_DETAILS)
+		return "RepoDetails";
 	return NULL;
 }
 
@@ -612,6 +620,78 @@ pk_backend_job_call_vfunc_idle_cb (gpointer user_data)
 	return FALSE;
 }
 
+static gboolean
+pk_backend_job_call_vfunc_progress_idle_cb (gpointer user_data)
+{
+	PkBackendJobVFuncHelper *helper = (PkBackendJobVFuncHelper *) user_data;
+	PkBackendJob *job = helper->job;
+	PkBackendJobVFuncItem *item;
+	guint64 download_size_remaining;
+	guint value = 0;
+
+	/* take the latest value and let the next change queue a new idle */
+	g_mutex_lock (&job->priv->progress_mutex);
+	job->priv->progress_pending &= ~(1u << helper->signal_kind);
+	if (helper->signal_kind == PK_BACKEND_SIGNAL_PERCENTAGE)
+		value = job->priv->percentage;
+	else if (helper->signal_kind == PK_BACKEND_SIGNAL_SPEED)
+		value = job->priv->speed;
+	download_size_remaining = job->priv->download_size_remaining;
+	g_mutex_unlock (&job->priv->progress_mutex);
+
+	item = &job->priv->vfunc_items[helper->signal_kind];
+	if (item->vfunc == NULL) {
+		g_warning ("tried to do signal %s when no longer connected",
+			   pk_backend_job_signal_to_string (helper->signal_kind));
+		return FALSE;
+	}
+	if (helper->signal_kind == PK_BACKEND_SIGNAL_DOWNLOAD_SIZE_REMAINING)
+		item->vfunc (job, &download_size_remaining, item->user_data);
+	else
+		item->vfunc (job, GUINT_TO_POINTER (value), item->user_data);
+	return FALSE;
+}
+
+/*
+ * pk_backend_job_call_vfunc_progress:
+ *
+ * Like pk_backend_job_call_vfunc(), but for values where only the latest
+ * one matters. Backends set these from tight download loops, so rather
+ * than queueing one idle per call, at most one idle per signal is pending
+ * and it reads the current value from the job when it runs.
+ **/
+static void
+pk_backend_job_call_vfunc_progress (PkBackendJob *job,
+				    PkBackendJobSignal signal_kind)
+{
+	PkBackendJobVFuncHelper *helper;
+	PkBackendJobVFuncItem *item;
+	g_autoptr(GSource) source = NULL;
+
+	item = &job->priv->vfunc_items[signal_kind];
+	if (!item->enabled || item->vfunc == NULL)
+		return;
+
+	g_mutex_lock (&job->priv->progress_mutex);
+	if (job->priv->progress_pending & (1u << signal_kind)) {
+		g_mutex_unlock (&job->priv->progress_mutex);
+		return;
+	}
+	job->priv->progress_pending |= 1u << signal_kind;
+	g_mutex_unlock (&job->priv->progress_mutex);
+
+	helper = g_new0 (PkBackendJobVFuncHelper, 1);
+	helper->job = g_object_ref (job);
+	helper->signal_kind = signal_kind;
+	source = g_idle_source_new ();
+	g_source_set_callback (source,
+			       pk_backend_job_call_vfunc_progress_idle_cb,
+			       helper,
+			       (GDestroyNotify) pk_backend_job_vfunc_event_free);
+	g_source_set_name (source, "[PkBackendJob] progress_idle_cb");
+	g_source_attach (source, NULL);
+}
+
 /**
  * pk_backend_job_call_vfunc:
  *
@@ -654,6 +734,38 @@ pk_backend_job_call_vfunc (PkBackendJob *job,
 	g_source_attach (source, NULL);
 }
 
+/*
+ * pk_backend_job_call_vfunc_list:
+ *
+ * Emits @items as one list signal if something is listening for it, and
+ * otherwise as one signal per item so that consumers which only connect
+ * the singular vfunc still see everything.
+ **/
+static void
+pk_backend_job_call_vfunc_list (PkBackendJob *job,
+				PkBackendJobSignal list_kind,
+				PkBackendJobSignal item_kind,
+				GPtrArray *items)
+{
+	PkBackendJobVFuncItem *item = &job->priv->vfunc_items[list_kind];
+
+	if (items->len == 0)
+		return;
+	if (item->enabled && item->vfunc != NULL) {
+		pk_backend_job_call_vfunc (job,
+					   list_kind,
+					   g_ptr_array_ref (items),
+					   (GDestroyNotify) g_ptr_array_unref);
+		return;
+	}
+	for (guint i = 0; i < items->len; i++) {
+		pk_backend_job_call_vfunc (job,
+					   item_kind,
+					   g_object_ref (g_ptr_array_index (items, i)),
+					   g_object_unref);
+	}
+}
+
 /**
  * pk_backend_job_set_vfunc:
  * @job: A valid PkBackendJob
@@ -824,11 +936,10 @@ pk_backend_job_set_percentage (PkBackendJob *job, guint percentage)
 	}
 
 	/* save in case we need this from coldplug */
+	g_mutex_lock (&job->priv->progress_mutex);
 	job->priv->percentage = percentage;
-	pk_backend_job_call_vfunc (job,
-				   PK_BACKEND_SIGNAL_PERCENTAGE,
-				   GUINT_TO_POINTER (percentage),
-				   NULL);
+	g_mutex_unlock (&job->priv->progress_mutex);
+	pk_backend_job_call_vfunc_progress (job, PK_BACKEND_SIGNAL_PERCENTAGE);
 }
 
 void
@@ -847,17 +958,15 @@ pk_backend_job_set_speed (PkBackendJob *job, guint speed)
 		return;
 
 	/* set new value */
+	g_mutex_lock (&job->priv->progress_mutex);
 	job->priv->speed = speed;
-	pk_backend_job_call_vfunc (job,
-				   PK_BACKEND_SIGNAL_SPEED,
-				   GUINT_TO_POINTER (speed),
-				   NULL);
+	g_mutex_unlock (&job->priv->progress_mutex);
+	pk_backend_job_call_vfunc_progress (job, PK_BACKEND_SIGNAL_SPEED);
 }
 
 void
 pk_backend_job_set_download_size_remaining (PkBackendJob *job, guint64 download_size_remaining)
 {
-	guint64 *tmp;
 	g_return_if_fail (PK_IS_BACKEND_JOB (job));
 
 	/* have we already set an error? */
@@ -871,15 +980,10 @@ pk_backend_job_set_download_size_remaining (PkBackendJob *job, guint64 download_
 		return;
 
 	/* set new value */
+	g_mutex_lock (&job->priv->progress_mutex);
 	job->priv->download_size_remaining = download_size_remaining;
-
-	/* we can't squash a 64bit value into a pointer on a 32bit arch */
-	tmp = g_new0 (guint64, 1);
-	*tmp = download_size_remaining;
-	pk_backend_job_call_vfunc (job,
-				   PK_BACKEND_SIGNAL_DOWNLOAD_SIZE_REMAINING,
-				   tmp,
-				   g_free);
+	g_mutex_unlock (&job->priv->progress_mutex);
+	pk_backend_job_call_vfunc_progress (job, PK_BACKEND_SIGNAL_DOWNLOAD_SIZE_REMAINING);
 }
 
 void
@@ -1287,6 +1391,34 @@ pk_backend_job_details_full (PkBackendJob *job,
 				   g_object_unref);
 }
 
+/**
+ * pk_backend_job_details_list:
+ *
+ * Emits the #PkDetails in @details together, which is much cheaper than
+ * calling pk_backend_job_details() for each package when there are many.
+ **/
+void
+pk_backend_job_details_list (PkBackendJob *job,
+			     GPtrArray *details  /* (element-type PkDetails) */)
+{
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+	g_return_if_fail (details != NULL);
+
+	/* have we already set an error? */
+	if (job->priv->set_error) {
+		g_warning ("already set error: details");
+		return;
+	}
+
+	/* emit; this relies on the @details array having ownership of all its
+	 * elements, as the job is asynchronous so they may be freed in their
+	 * original calling context */
+	pk_backend_job_call_vfunc_list (job,
+					PK_BACKEND_SIGNAL_DETAILS_LIST,
+					PK_BACKEND_SIGNAL_DETAILS,
+					details);
+}
+
 /**
  * pk_backend_job_files:
  *
@@ -1333,6 +1465,50 @@ pk_backend_job_files (PkBackendJob *job,
 	job->priv->download_files++;
 }
 
+/**
+ * pk_backend_job_files_list:
+ *
+ * Emits the #PkFiles in @files together. Items with an invalid package ID
+ * are dropped with a warning, as in pk_backend_job_files().
+ **/
+void
+pk_backend_job_files_list (PkBackendJob *job,
+			   GPtrArray *files  /* (element-type PkFiles) */)
+{
+	g_autoptr(GPtrArray) valid = NULL;
+
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+	g_return_if_fail (files != NULL);
+
+	/* have we already set an error? */
+	if (job->priv->set_error) {
+		g_warning ("already set error: files");
+		return;
+	}
+
+	/* check we are valid if specified */
+	valid = g_ptr_array_new_full (files->len, g_object_unref);
+	for (guint i = 0; i < files->len; i++) {
+		PkFiles *item = g_ptr_array_index (files, i);
+		const gchar *package_id = pk_files_get_package_id (item);
+
+		if (package_id != NULL && !pk_package_id_check (package_id)) {
+			g_warning ("package_id invalid and cannot be processed: %s", package_id);
+			continue;
+		}
+		g_ptr_array_add (valid, g_object_ref (item));
+	}
+
+	/* emit */
+	pk_backend_job_call_vfunc_list (job,
+					PK_BACKEND_SIGNAL_FILES_LIST,
+					PK_BACKEND_SIGNAL_FILES,
+					valid);
+
+	/* success */
+	job->priv->download_files += valid->len;
+}
+
 void
 pk_backend_job_distro_upgrade (PkBackendJob *job,
 			       PkDistroUpgradeEnum state,
@@ -1529,6 +1705,32 @@ pk_backend_job_repo_detail (PkBackendJob *job,
 				   g_object_unref);
 }
 
+/**
+ * pk_backend_job_repo_details:
+ *
+ * Emits the #PkRepoDetail in @repo_details together.
+ **/
+void
+pk_backend_job_repo_details (PkBackendJob *job,
+			     GPtrArray *repo_details  /* (element-type PkRepoDetail) */)
+{
+	g_return_if_fail (PK_IS_BACKEND_JOB (job));
+	g_return_if_fail (repo_details != NULL);
+
+	/* have we already set an error? */
+	if (job->priv->set_error) {
+		g_warning ("already set error: repo-details");
+		return;
+	}
+
+	/* emit; this relies on the @repo_details array having ownership of
+	 * all its elements */
+	pk_backend_job_call_vfunc_list (job,
+					PK_BACKEND_SIGNAL_REPO_DETAILS,
+					PK_BACKEND_SIGNAL_REPO_DETAIL,
+					repo_details);
+}
+
 void
 pk_backend_job_category (PkBackendJob *job,
 			 const gchar *parent_id,
@@ -1792,6 +1994,7 @@ pk_backend_job_finalize (GObject *object)
 	if (job->priv->params != NULL)
 		g_variant_unref (job->priv->params);
 	g_timer_destroy (job->priv->timer);
+	g_mutex_clear (&job->priv->progress_mutex);
 	g_key_file_unref (job->priv->conf);
 	g_object_unref (job->priv->cancellable);
 
@@ -1811,6 +2014,7 @@ pk_backend_job_init (PkBackendJob *job)
 {
 	job->priv = PK_BACKEND_JOB_GET_PRIVATE (job);
 	job->priv->timer = g_timer_new ();
+	g_mutex_init (&job->priv->progress_mutex);
 	job->priv->cancellable = g_cancellable_new ();
 	job->priv->last_error_code = PK_ERROR_ENUM_UNKNOWN;
 	job->priv->locale = g_strdup ("C");
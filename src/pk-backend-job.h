@@ -62,6 +62,9 @@ typedef enum {
 	PK_BACKEND_SIGNAL_UPDATE_DETAIL,
 	PK_BACKEND_SIGNAL_UPDATE_DETAILS,
 	PK_BACKEND_SIGNAL_CATEGORY,
+	PK_BACKEND_SIGNAL_DETAILS_LIST,
+	PK_BACKEND_SIGNAL_FILES_LIST,
+	PK_BACKEND_SIGNAL_REPO_DETAILS,
 	PK_BACKEND_SIGNAL_LAST
 } PkBackendJobSignal;
 
@@ -191,6 +194,8 @@ void		 pk_backend_job_repo_detail		(PkBackendJob	*job,
 							 const gchar	*repo_id,
 							 const gchar	*description,
 							 gboolean	 enabled);
+void		 pk_backend_job_repo_details		(PkBackendJob	*job,
+							 GPtrArray	*repo_details);
 void		 pk_backend_job_update_detail		(PkBackendJob	*job,
 							 const gchar	*package_id,
 							 gchar		**updates,
@@ -226,9 +231,13 @@ void		 pk_backend_job_details_full		(PkBackendJob	*job,
 							 const gchar	*url,
 							 gulong		 size,
 							 guint64	 download_size);
+void		 pk_backend_job_details_list		(PkBackendJob	*job,
+							 GPtrArray	*details);
 void	 	 pk_backend_job_files 			(PkBackendJob	*job,
 							 const gchar	*package_id,
 							 gchar	 	**files);
+void		 pk_backend_job_files_list		(PkBackendJob	*job,
+							 GPtrArray	*files);
 void	 	 pk_backend_job_distro_upgrade		(PkBackendJob	*job,
 							 PkDistroUpgradeEnum type,
 							 const gchar 	*name,
@@ -21,19 +21,24 @@
 
 #include <config.h>
 
+#include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 
 #include <glib/gi18n.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <gmodule.h>
+#include <packagekit-glib2/pk-command-index.h>
+#include <packagekit-glib2/pk-desktop-private.h>
 #include <packagekit-glib2/pk-offline-private.h>
 #include <packagekit-glib2/pk-package-id.h>
 #include <packagekit-glib2/pk-results.h>
 #include <packagekit-glib2/pk-common.h>
 
 #include "pk-backend.h"
+#include "pk-metrics.h"
 #include "pk-shared.h"
 
 #define PK_BACKEND_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_BACKEND, PkBackendPrivate))
@@ -57,7 +62,11 @@ typedef struct {
 	PkBitfield	(*get_roles)			(PkBackend	*backend);
 	PkBitfield	(*get_provides)			(PkBackend	*backend);
 	gchar		**(*get_mime_types)		(PkBackend	*backend);
+	gchar		**(*get_native_arches)		(PkBackend	*backend);
+	gchar		*(*get_installed_stamp)		(PkBackend	*backend);
 	gboolean	(*supports_parallelization)	(PkBackend	*backend);
+	gboolean	(*supports_search_index)	(PkBackend	*backend);
+	gboolean	(*supports_command_index)	(PkBackend	*backend);
 	void		(*job_start)			(PkBackend	*backend,
 							 PkBackendJob	*job);
 	void		(*job_stop)			(PkBackend	*backend,
@@ -202,7 +211,22 @@ struct PkBackendPrivate
 	guint			 transaction_inhibit_end_idle_id;
 	guint			 repo_list_changed_id;
 	guint			 installed_db_changed_id;
+	GMutex			 installed_changes_mutex;
+	GHashTable		*installed_changes;	/* package-id : PkInfoEnum */
+	gboolean		 installed_changes_all;
 	guint			 updates_changed_id;
+	PkSearchIndex		*search_index;
+	PkMetrics		*metrics;
+	GTask			*search_index_task;
+	gboolean		 search_index_again;
+	gchar			*command_index;
+	GTask			*command_index_task;
+	gchar			*desktop_database;
+	PkDesktop		*desktop;
+	gint			 desktop_ready;
+	GTask			*desktop_task;
+	GHashTable		*desktop_queued;
+	gboolean		 desktop_stale;
 };
 
 G_DEFINE_TYPE (PkBackend, pk_backend, G_TYPE_OBJECT)
@@ -242,6 +266,43 @@ pk_backend_get_mime_types (PkBackend *backend)
 	return backend->priv->desc->get_mime_types (backend);
 }
 
+/**
+ * pk_backend_get_native_arches:
+ *
+ * Return value: (transfer full): the architectures kept by the
+ * %PK_FILTER_ENUM_ARCH filter, or %NULL if the backend does not say
+ **/
+gchar **
+pk_backend_get_native_arches (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), NULL);
+	g_return_val_if_fail (backend->priv->loaded, NULL);
+
+	/* not compulsory */
+	if (backend->priv->desc->get_native_arches == NULL)
+		return NULL;
+	return backend->priv->desc->get_native_arches (backend);
+}
+
+/**
+ * pk_backend_get_installed_stamp:
+ *
+ * Return value: (transfer full): a string that changes whenever the
+ * installed packages do, even outside of PackageKit, or %NULL if the
+ * backend does not say
+ **/
+gchar *
+pk_backend_get_installed_stamp (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), NULL);
+	g_return_val_if_fail (backend->priv->loaded, NULL);
+
+	/* not compulsory */
+	if (backend->priv->desc->get_installed_stamp == NULL)
+		return NULL;
+	return backend->priv->desc->get_installed_stamp (backend);
+}
+
 gboolean
 pk_backend_supports_parallelization (PkBackend	*backend)
 {
@@ -253,6 +314,50 @@ pk_backend_supports_parallelization (PkBackend	*backend)
 	return backend->priv->desc->supports_parallelization (backend);
 }
 
+/**
+ * pk_backend_supports_search_index:
+ *
+ * Backends opt in to having SearchNames and SearchDetails answered from the
+ * daemon's search index, which is built from what the backend emits for
+ * GetPackages and GetDetails after anything changed the package lists.
+ * The rebuild runs next to other transactions, so it is only used if the
+ * backend also supports parallelization.
+ **/
+gboolean
+pk_backend_supports_search_index (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
+
+	/* not compulsory */
+	if (backend->priv->desc->supports_search_index == NULL)
+		return FALSE;
+	if (backend->priv->desc->get_packages == NULL)
+		return FALSE;
+	return backend->priv->desc->supports_search_index (backend);
+}
+
+/**
+ * pk_backend_supports_command_index:
+ *
+ * Backends opt in to the daemon writing the command-not-found index if
+ * GetFiles lists the files of packages that are not installed. Like the
+ * search index it is rebuilt next to other transactions, so it is only
+ * used if the backend also supports parallelization.
+ **/
+gboolean
+pk_backend_supports_command_index (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
+
+	/* not compulsory */
+	if (backend->priv->desc->supports_command_index == NULL)
+		return FALSE;
+	if (backend->priv->desc->get_packages == NULL ||
+	    backend->priv->desc->get_files == NULL)
+		return FALSE;
+	return backend->priv->desc->supports_command_index (backend);
+}
+
 void
 pk_backend_thread_start (PkBackend *backend, PkBackendJob *job, gpointer func)
 {
@@ -512,7 +617,11 @@ pk_backend_load (PkBackend *backend, GError **error)
 		g_module_symbol (handle, "pk_backend_get_filters", (gpointer *)&desc->get_filters);
 		g_module_symbol (handle, "pk_backend_get_groups", (gpointer *)&desc->get_groups);
 		g_module_symbol (handle, "pk_backend_get_mime_types", (gpointer *)&desc->get_mime_types);
+		g_module_symbol (handle, "pk_backend_get_native_arches", (gpointer *)&desc->get_native_arches);
+		g_module_symbol (handle, "pk_backend_get_installed_stamp", (gpointer *)&desc->get_installed_stamp);
 		g_module_symbol (handle, "pk_backend_supports_parallelization", (gpointer *)&desc->supports_parallelization);
+		g_module_symbol (handle, "pk_backend_supports_search_index", (gpointer *)&desc->supports_search_index);
+		g_module_symbol (handle, "pk_backend_supports_command_index", (gpointer *)&desc->supports_command_index);
 		g_module_symbol (handle, "pk_backend_get_packages", (gpointer *)&desc->get_packages);
 		g_module_symbol (handle, "pk_backend_get_repo_list", (gpointer *)&desc->get_repo_list);
 		g_module_symbol (handle, "pk_backend_required_by", (gpointer *)&desc->required_by);
@@ -612,6 +721,15 @@ pk_backend_repo_list_changed_cb (gpointer user_data)
 	g_debug ("emitting repo-list-changed");
 	g_signal_emit (backend, signals [SIGNAL_REPO_LIST_CHANGED], 0);
 	backend->priv->repo_list_changed_id = 0;
+
+	/* we can only run our own jobs next to the scheduler's if the
+	 * backend copes with that, otherwise the next transaction that
+	 * changes the package lists will catch up; a refresh that is
+	 * already running notices the invalidation by itself */
+	if (backend->priv->search_index != NULL &&
+	    backend->priv->search_index_task == NULL &&
+	    pk_backend_supports_parallelization (backend))
+		pk_backend_search_index_refresh_async (backend, NULL, NULL);
 	return FALSE;
 }
 
@@ -621,6 +739,10 @@ pk_backend_repo_list_changed (PkBackend *backend)
 	g_return_if_fail (PK_IS_BACKEND (backend));
 	g_return_if_fail (backend->priv->loaded);
 
+	/* stop answering searches with packages from the old repos */
+	if (backend->priv->search_index != NULL)
+		pk_search_index_invalidate (backend->priv->search_index);
+
 	/* already scheduled */
 	if (backend->priv->repo_list_changed_id != 0)
 		return;
@@ -669,23 +791,144 @@ pk_backend_updates_changed_delay (PkBackend *backend, guint timeout)
 	return TRUE;
 }
 
+/* the backends look at the file lists until it is rebuilt, which backends
+ * that can't run our jobs next to a transaction do in the next one */
+static void
+pk_backend_desktop_invalidate (PkBackend *backend)
+{
+	gchar *none[] = { NULL };
+
+	if (backend->priv->desktop == NULL)
+		return;
+	g_atomic_int_set (&backend->priv->desktop_ready, FALSE);
+	backend->priv->desktop_stale = TRUE;
+	if (!pk_backend_supports_parallelization (backend) ||
+	    backend->priv->desktop_task != NULL)
+		return;
+	pk_backend_desktop_refresh_async (backend, none, NULL, NULL);
+}
+
+/* the backend can tell when something else changed the installed
+ * packages, even if nothing was watching */
+static void
+pk_backend_desktop_check_stamp (PkBackend *backend)
+{
+	g_autofree gchar *stamp = NULL;
+	g_autofree gchar *saved = NULL;
+
+	if (!g_atomic_int_get (&backend->priv->desktop_ready) ||
+	    backend->priv->desktop_task != NULL ||
+	    backend->priv->transaction_in_progress ||
+	    backend->priv->desc->get_installed_stamp == NULL)
+		return;
+	stamp = backend->priv->desc->get_installed_stamp (backend);
+	saved = pk_desktop_get_stamp (backend->priv->desktop);
+	if (g_strcmp0 (stamp, saved) == 0)
+		return;
+	g_debug ("installed packages changed since the desktop file database was written");
+	pk_backend_desktop_invalidate (backend);
+}
+
+/* updates the caches for just the packages in the change journal, and
+ * only throws them away if they don't know one of the packages */
+static void
+pk_backend_installed_db_apply (PkBackend *backend, GHashTable *changes)
+{
+	PkSearchIndex *search_index = backend->priv->search_index;
+	GHashTableIter iter;
+	gpointer key, value;
+	g_autofree gchar **names = NULL;
+	g_autoptr(GHashTable) changed = NULL;
+
+	changed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	g_hash_table_iter_init (&iter, changes);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		const gchar *package_id = key;
+		g_auto(GStrv) split = pk_package_id_split (package_id);
+
+		if (split == NULL)
+			continue;
+		g_hash_table_add (changed, g_strdup (split[PK_PACKAGE_ID_NAME]));
+		if (search_index == NULL || !pk_search_index_is_valid (search_index))
+			continue;
+		if (!pk_search_index_set_info (search_index, package_id,
+					       GPOINTER_TO_UINT (value))) {
+			g_debug ("%s is not in the search index", package_id);
+			pk_search_index_invalidate (search_index);
+		}
+	}
+	g_debug ("applied changes of %u installed packages",
+		 g_hash_table_size (changes));
+
+	/* a running refresh read the packages before they changed */
+	if (search_index != NULL && backend->priv->search_index_task != NULL)
+		backend->priv->search_index_again = TRUE;
+
+	/* read the desktop files of the changed packages again */
+	if (backend->priv->desktop == NULL || g_hash_table_size (changed) == 0)
+		return;
+	if (!pk_backend_supports_parallelization (backend)) {
+		/* updated by the next transaction, while it holds the slot */
+		if (backend->priv->desktop_queued == NULL)
+			backend->priv->desktop_queued = g_hash_table_new_full (g_str_hash, g_str_equal,
+									      g_free, NULL);
+		g_hash_table_iter_init (&iter, changed);
+		while (g_hash_table_iter_next (&iter, &key, NULL))
+			g_hash_table_add (backend->priv->desktop_queued, g_strdup (key));
+		return;
+	}
+	names = (gchar **) g_hash_table_get_keys_as_array (changed, NULL);
+	pk_backend_desktop_refresh_async (backend, names, NULL, NULL);
+}
+
 static gboolean
 pk_backend_installed_db_changed_cb (gpointer user_data)
 {
 	PkBackend *backend = PK_BACKEND (user_data);
+	gboolean all;
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GHashTable) changes = NULL;
+
+	g_mutex_lock (&backend->priv->installed_changes_mutex);
+	all = backend->priv->installed_changes_all;
+	backend->priv->installed_changes_all = FALSE;
+	backend->priv->installed_db_changed_id = 0;
+
+	/* the journal is applied once the transaction has ended */
+	if (!backend->priv->transaction_in_progress)
+		changes = g_steal_pointer (&backend->priv->installed_changes);
+	g_mutex_unlock (&backend->priv->installed_changes_mutex);
 
 	if (!backend->priv->transaction_in_progress) {
 		g_debug ("invalidating offline updates");
 		if (!pk_offline_auth_invalidate (&error))
 			g_warning ("failed to invalidate: %s", error->message);
+		if (all) {
+			if (backend->priv->search_index != NULL)
+				pk_search_index_invalidate (backend->priv->search_index);
+			pk_backend_desktop_invalidate (backend);
+		} else if (changes != NULL) {
+			pk_backend_installed_db_apply (backend, changes);
+		}
 	}
-	backend->priv->installed_db_changed_id = 0;
 	g_debug ("emitting installed-changed");
 	g_signal_emit (backend, signals [SIGNAL_INSTALLED_CHANGED], 0);
 	return FALSE;
 }
 
+/* called with installed_changes_mutex held */
+static void
+pk_backend_installed_db_schedule (PkBackend *backend)
+{
+	/* already scheduled */
+	if (backend->priv->installed_db_changed_id != 0)
+		return;
+
+	/* idle add */
+	backend->priv->installed_db_changed_id =
+		g_idle_add (pk_backend_installed_db_changed_cb, backend);
+}
+
 /**
  * pk_backend_installed_db_changed:
  *
@@ -698,6 +941,8 @@ pk_backend_installed_db_changed_cb (gpointer user_data)
  * transactions done by PackageKit itself, a backend would call
  * pk_backend_transaction_inhibit_start() before each transaction and
  * pk_backend_transaction_inhibit_end() after the transaction has finished.
+ * If the backend can tell which packages changed it should call
+ * pk_backend_installed_db_package_changed() instead.
  *
  * This function can be called on any thread.
  **/
@@ -707,13 +952,43 @@ pk_backend_installed_db_changed (PkBackend *backend)
 	g_return_if_fail (PK_IS_BACKEND (backend));
 	g_return_if_fail (backend->priv->loaded);
 
-	/* already scheduled */
-	if (backend->priv->installed_db_changed_id != 0)
-		return;
+	g_mutex_lock (&backend->priv->installed_changes_mutex);
+	backend->priv->installed_changes_all = TRUE;
+	pk_backend_installed_db_schedule (backend);
+	g_mutex_unlock (&backend->priv->installed_changes_mutex);
+}
 
-	/* idle add */
-	backend->priv->installed_db_changed_id =
-		g_idle_add (pk_backend_installed_db_changed_cb, backend);
+/**
+ * pk_backend_installed_db_package_changed:
+ * @package_id: a package that was installed or removed
+ * @info: %PK_INFO_ENUM_INSTALLED, or %PK_INFO_ENUM_AVAILABLE if it was removed
+ *
+ * Like pk_backend_installed_db_changed(), but records which package
+ * changed in a journal, so that the caches are updated for just the
+ * packages in it rather than thrown away. A backend would call this for
+ * every package that differs between two reads of its package database,
+ * e.g. the dpkg status file or the header instances of the rpmdb.
+ *
+ * This function can be called on any thread.
+ **/
+void
+pk_backend_installed_db_package_changed (PkBackend *backend,
+					 const gchar *package_id,
+					 PkInfoEnum info)
+{
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_return_if_fail (backend->priv->loaded);
+	g_return_if_fail (package_id != NULL);
+
+	g_mutex_lock (&backend->priv->installed_changes_mutex);
+	if (backend->priv->installed_changes == NULL)
+		backend->priv->installed_changes = g_hash_table_new_full (g_str_hash, g_str_equal,
+									 g_free, NULL);
+	/* only the last change of a package counts */
+	g_hash_table_insert (backend->priv->installed_changes,
+			     g_strdup (package_id), GUINT_TO_POINTER (info));
+	pk_backend_installed_db_schedule (backend);
+	g_mutex_unlock (&backend->priv->installed_changes_mutex);
 }
 
 /**
@@ -732,10 +1007,19 @@ static gboolean
 transaction_inhibit_end_idle (gpointer user_data)
 {
 	PkBackend *backend = user_data;
+	g_autoptr(GHashTable) changes = NULL;
 
 	backend->priv->transaction_in_progress = FALSE;
 	backend->priv->transaction_inhibit_end_idle_id = 0;
 
+	/* packages the journal recorded while the transaction ran */
+	g_mutex_lock (&backend->priv->installed_changes_mutex);
+	if (backend->priv->installed_db_changed_id == 0)
+		changes = g_steal_pointer (&backend->priv->installed_changes);
+	g_mutex_unlock (&backend->priv->installed_changes_mutex);
+	if (changes != NULL)
+		pk_backend_installed_db_apply (backend, changes);
+
 	return G_SOURCE_REMOVE;
 }
 
@@ -812,6 +1096,7 @@ pk_backend_start_job (PkBackend *backend, PkBackendJob *job)
 	}
 
 	pk_backend_job_set_started (job, TRUE);
+	pk_backend_desktop_check_stamp (backend);
 
 	/* optional */
 	if (backend->priv->desc->job_start != NULL)
@@ -914,6 +1199,19 @@ pk_backend_get_name (PkBackend *backend)
 	return backend->priv->name;
 }
 
+/**
+ * pk_backend_get_module_filename:
+ *
+ * Return value: the file the backend was loaded from
+ **/
+const gchar *
+pk_backend_get_module_filename (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), NULL);
+	g_return_val_if_fail (backend->priv->loaded, NULL);
+	return g_module_name (backend->priv->handle);
+}
+
 const gchar *
 pk_backend_get_description (PkBackend *backend)
 {
@@ -1011,6 +1309,986 @@ pk_backend_set_user_data (PkBackend *backend, gpointer user_data)
 	backend->priv->user_data = user_data;
 }
 
+/**
+ * pk_backend_get_search_index:
+ *
+ * Return value: (transfer none): the search index, or %NULL if the backend
+ * does not use one
+ **/
+PkSearchIndex *
+pk_backend_get_search_index (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), NULL);
+	return backend->priv->search_index;
+}
+
+void
+pk_backend_set_search_index (PkBackend *backend, PkSearchIndex *search_index)
+{
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_set_object (&backend->priv->search_index, search_index);
+}
+
+/**
+ * pk_backend_add_cache_lookup:
+ * @backend: a #PkBackend
+ * @cache: the name of the backend cache, e.g. "dnf-sack"
+ * @hit: whether the cached data could be reused
+ *
+ * Counts a lookup in one of the backend's own caches so that it shows up
+ * in the metrics. This can be called from the job thread.
+ **/
+void
+pk_backend_add_cache_lookup (PkBackend *backend, const gchar *cache, gboolean hit)
+{
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	pk_metrics_add_cache_lookup (backend->priv->metrics, cache, hit);
+}
+
+static gboolean
+pk_backend_search_index_search (PkBackend *backend,
+				PkBackendJob *job,
+				PkBitfield filters,
+				gchar **values)
+{
+	PkRoleEnum role = pk_backend_job_get_role (job);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+
+	if (backend->priv->search_index == NULL)
+		return FALSE;
+
+	/* the backend may only know them once it has loaded its metadata */
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_ARCH) ||
+	    pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_ARCH)) {
+		g_auto(GStrv) arches = pk_backend_get_native_arches (backend);
+		pk_search_index_set_native_arches (backend->priv->search_index, arches);
+	}
+	if (!pk_search_index_can_search (backend->priv->search_index, role, filters)) {
+		pk_metrics_add_cache_lookup (backend->priv->metrics, "search-index", FALSE);
+		return FALSE;
+	}
+	array = pk_search_index_search (backend->priv->search_index,
+					role, filters, values, &error);
+	if (array == NULL) {
+		g_debug ("asking the backend instead: %s", error->message);
+		pk_metrics_add_cache_lookup (backend->priv->metrics, "search-index", FALSE);
+		return FALSE;
+	}
+	pk_metrics_add_cache_lookup (backend->priv->metrics, "search-index", TRUE);
+	pk_backend_job_set_status (job, PK_STATUS_ENUM_QUERY);
+	pk_backend_job_packages (job, array);
+	pk_backend_job_finished (job);
+	return TRUE;
+}
+
+typedef struct {
+	GPtrArray	*packages;
+	GHashTable	*descriptions;
+	guint		 generation;
+	gboolean	 retried;
+} PkBackendSearchIndexHelper;
+
+static void
+pk_backend_search_index_helper_free (PkBackendSearchIndexHelper *helper)
+{
+	g_clear_pointer (&helper->packages, g_ptr_array_unref);
+	g_clear_pointer (&helper->descriptions, g_hash_table_unref);
+	g_free (helper);
+}
+
+static void pk_backend_search_index_get_packages (PkBackend *backend);
+
+static void
+pk_backend_search_index_return (PkBackend *backend, GError *error)
+{
+	g_autoptr(GTask) task = g_steal_pointer (&backend->priv->search_index_task);
+
+	if (error != NULL)
+		g_task_return_error (task, error);
+	else
+		g_task_return_boolean (task, TRUE);
+}
+
+static void
+pk_backend_search_index_build (PkBackend *backend)
+{
+	PkBackendSearchIndexHelper *helper;
+	GError *error = NULL;
+
+	helper = g_task_get_task_data (backend->priv->search_index_task);
+	if (!pk_search_index_build (backend->priv->search_index,
+				    helper->packages,
+				    helper->descriptions,
+				    &error)) {
+		pk_backend_search_index_return (backend, error);
+		return;
+	}
+
+	/* the package lists changed again while we were reading them */
+	if (backend->priv->search_index_again ||
+	    pk_search_index_get_generation (backend->priv->search_index) != helper->generation) {
+		if (!helper->retried) {
+			helper->retried = TRUE;
+			pk_backend_search_index_get_packages (backend);
+			return;
+		}
+		pk_search_index_invalidate (backend->priv->search_index);
+	}
+	pk_backend_search_index_return (backend, NULL);
+}
+
+static void
+pk_backend_search_index_job_package_cb (PkBackendJob *job,
+					PkPackage *item,
+					PkBackend *backend)
+{
+	PkBackendSearchIndexHelper *helper = g_task_get_task_data (backend->priv->search_index_task);
+	g_ptr_array_add (helper->packages, g_object_ref (item));
+}
+
+static void
+pk_backend_search_index_job_packages_cb (PkBackendJob *job,
+					 GPtrArray *array,
+					 PkBackend *backend)
+{
+	PkBackendSearchIndexHelper *helper = g_task_get_task_data (backend->priv->search_index_task);
+	for (guint i = 0; i < array->len; i++)
+		g_ptr_array_add (helper->packages, g_object_ref (g_ptr_array_index (array, i)));
+}
+
+static void
+pk_backend_search_index_job_details_cb (PkBackendJob *job,
+					PkDetails *item,
+					PkBackend *backend)
+{
+	PkBackendSearchIndexHelper *helper = g_task_get_task_data (backend->priv->search_index_task);
+	const gchar *description = pk_details_get_description (item);
+
+	if (description == NULL)
+		return;
+	g_hash_table_insert (helper->descriptions,
+			     g_strdup (pk_details_get_package_id (item)),
+			     g_strdup (description));
+}
+
+static PkExitEnum
+pk_backend_internal_job_stop (PkBackend *backend, PkBackendJob *job, gpointer object)
+{
+	pk_backend_job_disconnect_vfuncs (job);
+	pk_backend_stop_job (backend, job);
+	g_object_unref (job);
+	return GPOINTER_TO_UINT (object);
+}
+
+static gboolean
+pk_backend_internal_job_start (PkBackend *backend, PkBackendJob *job)
+{
+	pk_backend_start_job (backend, job);
+	if (!pk_backend_job_get_is_error_set (job))
+		return TRUE;
+	pk_backend_internal_job_stop (backend, job, NULL);
+	return FALSE;
+}
+
+static void
+pk_backend_search_index_details_finished_cb (PkBackendJob *job,
+					     gpointer object,
+					     PkBackend *backend)
+{
+	PkExitEnum exit_enum = pk_backend_internal_job_stop (backend, job, object);
+
+	/* packages without a description are still found by name and summary */
+	if (exit_enum != PK_EXIT_ENUM_SUCCESS)
+		g_debug ("GetDetails for the search index failed with %s",
+			 pk_exit_enum_to_string (exit_enum));
+	pk_backend_search_index_build (backend);
+}
+
+static void
+pk_backend_search_index_packages_finished_cb (PkBackendJob *job,
+					      gpointer object,
+					      PkBackend *backend)
+{
+	PkBackendSearchIndexHelper *helper;
+	PkExitEnum exit_enum;
+	PkBackendJob *details_job;
+	g_autoptr(GPtrArray) missing = NULL;
+
+	exit_enum = pk_backend_internal_job_stop (backend, job, object);
+	if (exit_enum != PK_EXIT_ENUM_SUCCESS) {
+		pk_backend_search_index_return (backend,
+						g_error_new (G_IO_ERROR, G_IO_ERROR_FAILED,
+							     "GetPackages failed with %s",
+							     pk_exit_enum_to_string (exit_enum)));
+		return;
+	}
+
+	/* only ask for the descriptions of package-ids we've not seen before */
+	helper = g_task_get_task_data (backend->priv->search_index_task);
+	missing = g_ptr_array_new ();
+	for (guint i = 0; i < helper->packages->len; i++) {
+		PkPackage *item = g_ptr_array_index (helper->packages, i);
+		const gchar *package_id = pk_package_get_id (item);
+		const gchar *description;
+
+		if (g_hash_table_contains (helper->descriptions, package_id))
+			continue;
+		description = pk_search_index_get_description (backend->priv->search_index,
+							       package_id);
+		if (description != NULL) {
+			g_hash_table_insert (helper->descriptions,
+					     g_strdup (package_id),
+					     g_strdup (description));
+			continue;
+		}
+		g_ptr_array_add (missing, (gpointer) package_id);
+	}
+	g_debug ("search index has %u packages, %u of them new",
+		 helper->packages->len, missing->len);
+	if (missing->len == 0 || backend->priv->desc->get_details == NULL) {
+		pk_backend_search_index_build (backend);
+		return;
+	}
+	g_ptr_array_add (missing, NULL);
+
+	details_job = pk_backend_job_new (backend->priv->conf);
+	pk_backend_job_set_backend (details_job, backend);
+	pk_backend_job_set_vfunc (details_job, PK_BACKEND_SIGNAL_DETAILS,
+				  PK_BACKEND_JOB_VFUNC (pk_backend_search_index_job_details_cb),
+				  backend);
+	pk_backend_job_set_vfunc (details_job, PK_BACKEND_SIGNAL_FINISHED,
+				  PK_BACKEND_JOB_VFUNC (pk_backend_search_index_details_finished_cb),
+				  backend);
+	if (!pk_backend_internal_job_start (backend, details_job)) {
+		pk_backend_search_index_build (backend);
+		return;
+	}
+	pk_backend_get_details (backend, details_job, (gchar **) missing->pdata);
+}
+
+static void
+pk_backend_search_index_get_packages (PkBackend *backend)
+{
+	PkBackendSearchIndexHelper *helper;
+	PkBackendJob *job;
+
+	helper = g_task_get_task_data (backend->priv->search_index_task);
+	g_clear_pointer (&helper->packages, g_ptr_array_unref);
+	helper->packages = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_clear_pointer (&helper->descriptions, g_hash_table_unref);
+	helper->descriptions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	helper->generation = pk_search_index_get_generation (backend->priv->search_index);
+	backend->priv->search_index_again = FALSE;
+
+	job = pk_backend_job_new (backend->priv->conf);
+	pk_backend_job_set_backend (job, backend);
+	pk_backend_job_set_vfunc (job, PK_BACKEND_SIGNAL_PACKAGE,
+				  PK_BACKEND_JOB_VFUNC (pk_backend_search_index_job_package_cb),
+				  backend);
+	pk_backend_job_set_vfunc (job, PK_BACKEND_SIGNAL_PACKAGES,
+				  PK_BACKEND_JOB_VFUNC (pk_backend_search_index_job_packages_cb),
+				  backend);
+	pk_backend_job_set_vfunc (job, PK_BACKEND_SIGNAL_FINISHED,
+				  PK_BACKEND_JOB_VFUNC (pk_backend_search_index_packages_finished_cb),
+				  backend);
+	if (!pk_backend_internal_job_start (backend, job)) {
+		pk_backend_search_index_return (backend,
+						g_error_new (G_IO_ERROR, G_IO_ERROR_FAILED,
+							     "failed to start GetPackages"));
+		return;
+	}
+	pk_backend_get_packages (backend, job, pk_bitfield_value (PK_FILTER_ENUM_NONE));
+}
+
+/**
+ * pk_backend_search_index_refresh_async:
+ *
+ * Rebuilds the search index from GetPackages, only asking the backend for
+ * the details of packages the old index did not have. If a refresh is
+ * already running it is restarted once it has finished reading.
+ **/
+void
+pk_backend_search_index_refresh_async (PkBackend *backend,
+				       GAsyncReadyCallback callback,
+				       gpointer user_data)
+{
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_return_if_fail (pk_is_thread_default ());
+
+	task = g_task_new (backend, NULL, callback, user_data);
+	if (backend->priv->search_index == NULL) {
+		g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+					 "backend does not use a search index");
+		return;
+	}
+	if (backend->priv->search_index_task != NULL) {
+		backend->priv->search_index_again = TRUE;
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+	g_task_set_task_data (task, g_new0 (PkBackendSearchIndexHelper, 1),
+			      (GDestroyNotify) pk_backend_search_index_helper_free);
+	backend->priv->search_index_task = g_steal_pointer (&task);
+	pk_backend_search_index_get_packages (backend);
+}
+
+gboolean
+pk_backend_search_index_refresh_finish (PkBackend *backend,
+					GAsyncResult *res,
+					GError **error)
+{
+	g_return_val_if_fail (g_task_is_valid (res, backend), FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+/**
+ * pk_backend_get_command_index:
+ *
+ * Return value: the file the command-not-found index is written to, or
+ * %NULL if the daemon does not maintain one for this backend
+ **/
+const gchar *
+pk_backend_get_command_index (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), NULL);
+	return backend->priv->command_index;
+}
+
+void
+pk_backend_set_command_index (PkBackend *backend, const gchar *filename)
+{
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_free (backend->priv->command_index);
+	backend->priv->command_index = g_strdup (filename);
+}
+
+static void
+pk_backend_command_index_return (PkBackend *backend, GError *error)
+{
+	g_autoptr(GTask) task = g_steal_pointer (&backend->priv->command_index_task);
+
+	if (error != NULL)
+		g_task_return_error (task, error);
+	else
+		g_task_return_boolean (task, TRUE);
+}
+
+static void
+pk_backend_command_index_job_package_cb (PkBackendJob *job,
+					 PkPackage *item,
+					 PkBackend *backend)
+{
+	GPtrArray *package_ids = g_task_get_task_data (backend->priv->command_index_task);
+	g_ptr_array_add (package_ids, g_strdup (pk_package_get_id (item)));
+}
+
+static void
+pk_backend_command_index_job_packages_cb (PkBackendJob *job,
+					  GPtrArray *array,
+					  PkBackend *backend)
+{
+	for (guint i = 0; i < array->len; i++)
+		pk_backend_command_index_job_package_cb (job, g_ptr_array_index (array, i), backend);
+}
+
+static void
+pk_backend_command_index_job_files_cb (PkBackendJob *job,
+				       PkFiles *item,
+				       GHashTable *commands)
+{
+	const gchar *dirs[] = { "/usr/bin/", "/usr/sbin/", "/bin/", "/sbin/", NULL };
+	gchar **files = pk_files_get_files (item);
+
+	for (guint i = 0; files != NULL && files[i] != NULL; i++) {
+		const gchar *command = NULL;
+		GPtrArray *package_ids;
+
+		/* only what is directly inside one of the binary directories */
+		for (guint j = 0; dirs[j] != NULL; j++) {
+			if (g_str_has_prefix (files[i], dirs[j])) {
+				command = files[i] + strlen (dirs[j]);
+				break;
+			}
+		}
+		if (command == NULL || command[0] == '\0' || strchr (command, '/') != NULL)
+			continue;
+
+		package_ids = g_hash_table_lookup (commands, command);
+		if (package_ids == NULL) {
+			package_ids = g_ptr_array_new_with_free_func (g_free);
+			g_hash_table_insert (commands, g_strdup (command), package_ids);
+		}
+		if (!g_ptr_array_find_with_equal_func (package_ids,
+						       pk_files_get_package_id (item),
+						       g_str_equal, NULL))
+			g_ptr_array_add (package_ids, g_strdup (pk_files_get_package_id (item)));
+	}
+}
+
+static void
+pk_backend_command_index_files_finished_cb (PkBackendJob *job,
+					    gpointer object,
+					    PkBackend *backend)
+{
+	PkExitEnum exit_enum;
+	GError *error = NULL;
+	g_autoptr(GHashTable) commands = NULL;
+
+	/* the hash is the user data of the files vfunc */
+	commands = g_hash_table_ref (g_object_get_data (G_OBJECT (job), "commands"));
+	exit_enum = pk_backend_internal_job_stop (backend, job, object);
+	if (exit_enum != PK_EXIT_ENUM_SUCCESS) {
+		pk_backend_command_index_return (backend,
+						 g_error_new (G_IO_ERROR, G_IO_ERROR_FAILED,
+							      "GetFiles failed with %s",
+							      pk_exit_enum_to_string (exit_enum)));
+		return;
+	}
+	if (!pk_command_index_write (backend->priv->command_index, commands, &error)) {
+		pk_backend_command_index_return (backend, error);
+		return;
+	}
+	g_debug ("wrote command index of %u commands", g_hash_table_size (commands));
+	pk_backend_command_index_return (backend, NULL);
+}
+
+static void
+pk_backend_command_index_packages_finished_cb (PkBackendJob *job,
+					       gpointer object,
+					       PkBackend *backend)
+{
+	GPtrArray *package_ids;
+	PkExitEnum exit_enum;
+	PkBackendJob *files_job;
+	GHashTable *commands;
+
+	exit_enum = pk_backend_internal_job_stop (backend, job, object);
+	if (exit_enum != PK_EXIT_ENUM_SUCCESS) {
+		pk_backend_command_index_return (backend,
+						 g_error_new (G_IO_ERROR, G_IO_ERROR_FAILED,
+							      "GetPackages failed with %s",
+							      pk_exit_enum_to_string (exit_enum)));
+		return;
+	}
+
+	commands = g_hash_table_new_full (g_str_hash, g_str_equal,
+					  g_free, (GDestroyNotify) g_ptr_array_unref);
+
+	/* everything is installed */
+	package_ids = g_task_get_task_data (backend->priv->command_index_task);
+	if (package_ids->len == 0) {
+		GError *error = NULL;
+		if (!pk_command_index_write (backend->priv->command_index, commands, &error))
+			pk_backend_command_index_return (backend, error);
+		else
+			pk_backend_command_index_return (backend, NULL);
+		g_hash_table_unref (commands);
+		return;
+	}
+
+	files_job = pk_backend_job_new (backend->priv->conf);
+	g_object_set_data_full (G_OBJECT (files_job), "commands", commands,
+				(GDestroyNotify) g_hash_table_unref);
+	pk_backend_job_set_backend (files_job, backend);
+	pk_backend_job_set_vfunc (files_job, PK_BACKEND_SIGNAL_FILES,
+				  PK_BACKEND_JOB_VFUNC (pk_backend_command_index_job_files_cb),
+				  commands);
+	pk_backend_job_set_vfunc (files_job, PK_BACKEND_SIGNAL_FINISHED,
+				  PK_BACKEND_JOB_VFUNC (pk_backend_command_index_files_finished_cb),
+				  backend);
+	if (!pk_backend_internal_job_start (backend, files_job)) {
+		pk_backend_command_index_return (backend,
+						 g_error_new (G_IO_ERROR, G_IO_ERROR_FAILED,
+							      "failed to start GetFiles"));
+		return;
+	}
+
+	/* one job for all of them, the backend can batch its file lists */
+	g_debug ("reading the files of %u available packages", package_ids->len);
+	g_ptr_array_add (package_ids, NULL);
+	pk_backend_get_files (backend, files_job, (gchar **) package_ids->pdata);
+}
+
+/**
+ * pk_backend_command_index_refresh_async:
+ *
+ * Rewrites the command-not-found index from the files of the newest
+ * available package of each name. The old index is removed first so
+ * that it is never used while stale. A refresh that is requested while
+ * one is running is skipped.
+ **/
+void
+pk_backend_command_index_refresh_async (PkBackend *backend,
+					GAsyncReadyCallback callback,
+					gpointer user_data)
+{
+	PkBackendJob *job;
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_return_if_fail (pk_is_thread_default ());
+
+	task = g_task_new (backend, NULL, callback, user_data);
+	if (backend->priv->command_index == NULL ||
+	    !pk_backend_supports_command_index (backend)) {
+		g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+					 "backend does not use a command index");
+		return;
+	}
+	if (backend->priv->command_index_task != NULL) {
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+	g_task_set_task_data (task, g_ptr_array_new_with_free_func (g_free),
+			      (GDestroyNotify) g_ptr_array_unref);
+	backend->priv->command_index_task = g_steal_pointer (&task);
+
+	/* command-not-found trusts a miss in the index, so it has to
+	 * search the backend until the new one is written */
+	if (g_unlink (backend->priv->command_index) < 0 && errno != ENOENT)
+		g_warning ("failed to remove %s: %s",
+			   backend->priv->command_index, g_strerror (errno));
+
+	job = pk_backend_job_new (backend->priv->conf);
+	pk_backend_job_set_backend (job, backend);
+	pk_backend_job_set_vfunc (job, PK_BACKEND_SIGNAL_PACKAGE,
+				  PK_BACKEND_JOB_VFUNC (pk_backend_command_index_job_package_cb),
+				  backend);
+	pk_backend_job_set_vfunc (job, PK_BACKEND_SIGNAL_PACKAGES,
+				  PK_BACKEND_JOB_VFUNC (pk_backend_command_index_job_packages_cb),
+				  backend);
+	pk_backend_job_set_vfunc (job, PK_BACKEND_SIGNAL_FINISHED,
+				  PK_BACKEND_JOB_VFUNC (pk_backend_command_index_packages_finished_cb),
+				  backend);
+	if (!pk_backend_internal_job_start (backend, job)) {
+		pk_backend_command_index_return (backend,
+						 g_error_new (G_IO_ERROR, G_IO_ERROR_FAILED,
+							      "failed to start GetPackages"));
+		return;
+	}
+	pk_backend_get_packages (backend, job,
+				 pk_bitfield_from_enums (PK_FILTER_ENUM_NOT_INSTALLED,
+							 PK_FILTER_ENUM_NEWEST,
+							 PK_FILTER_ENUM_ARCH,
+							 -1));
+}
+
+gboolean
+pk_backend_command_index_refresh_finish (PkBackend *backend,
+					 GAsyncResult *res,
+					 GError **error)
+{
+	g_return_val_if_fail (g_task_is_valid (res, backend), FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
+/**
+ * pk_backend_get_desktop_database:
+ *
+ * Return value: the file the desktop file database is written to, or
+ * %NULL if the daemon does not maintain one for this backend
+ **/
+const gchar *
+pk_backend_get_desktop_database (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), NULL);
+	return backend->priv->desktop_database;
+}
+
+/**
+ * pk_backend_set_desktop_database:
+ *
+ * Loads the desktop file database the last daemon wrote. If there is none
+ * it is built from scratch the next time packages are installed or removed,
+ * and if the packages changed since it was written, by the next transaction.
+ **/
+void
+pk_backend_set_desktop_database (PkBackend *backend, const gchar *filename)
+{
+	g_autoptr(GError) error = NULL;
+
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_return_if_fail (backend->priv->desktop_task == NULL);
+
+	g_free (backend->priv->desktop_database);
+	backend->priv->desktop_database = g_strdup (filename);
+	g_clear_object (&backend->priv->desktop);
+	g_atomic_int_set (&backend->priv->desktop_ready, FALSE);
+	if (filename == NULL)
+		return;
+
+	backend->priv->desktop = g_object_new (PK_TYPE_DESKTOP, NULL);
+	if (!pk_desktop_load (backend->priv->desktop, filename, &error)) {
+		g_debug ("no desktop file database until packages change: %s",
+			 error->message);
+		return;
+	}
+	g_atomic_int_set (&backend->priv->desktop_ready, TRUE);
+	pk_backend_desktop_check_stamp (backend);
+}
+
+/**
+ * pk_backend_desktop_needs_refresh:
+ *
+ * Return value: %TRUE if packages changed outside of the transactions
+ * that refresh the desktop file database, and a transaction should
+ * refresh it while it holds the slot
+ **/
+gboolean
+pk_backend_desktop_needs_refresh (PkBackend *backend)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
+
+	if (backend->priv->desktop == NULL || backend->priv->desktop_task != NULL)
+		return FALSE;
+	if (backend->priv->desktop_stale)
+		return TRUE;
+	return backend->priv->desktop_queued != NULL &&
+	       g_hash_table_size (backend->priv->desktop_queued) > 0;
+}
+
+/**
+ * pk_backend_lookup_application:
+ * @backend: a #PkBackend
+ * @package_name: the name of an installed package
+ * @is_application: (out): if @package_name has a desktop file that is shown
+ *
+ * Answers the APPLICATION filter for installed packages from the desktop
+ * file database. This may be called from the backend threads.
+ *
+ * Return value: %FALSE if there is no database, and the backend has to
+ * look at the files of the package itself
+ **/
+gboolean
+pk_backend_lookup_application (PkBackend *backend,
+			       const gchar *package_name,
+			       gboolean *is_application)
+{
+	g_return_val_if_fail (PK_IS_BACKEND (backend), FALSE);
+	g_return_val_if_fail (package_name != NULL, FALSE);
+	g_return_val_if_fail (is_application != NULL, FALSE);
+
+	if (!g_atomic_int_get (&backend->priv->desktop_ready))
+		return FALSE;
+	*is_application = pk_desktop_is_application (backend->priv->desktop, package_name);
+	return TRUE;
+}
+
+typedef struct {
+	gchar			**names;	/* NULL when rebuilding */
+	gchar			*stamp;
+	GPtrArray		*package_ids;
+	GHashTable		*packages;	/* name : (filename : shown) */
+} PkBackendDesktopHelper;
+
+static void
+pk_backend_desktop_helper_free (PkBackendDesktopHelper *helper)
+{
+	g_strfreev (helper->names);
+	g_free (helper->stamp);
+	g_ptr_array_unref (helper->package_ids);
+	g_hash_table_unref (helper->packages);
+	g_free (helper);
+}
+
+static void
+pk_backend_desktop_return (PkBackend *backend, GError *error)
+{
+	g_autoptr(GTask) task = g_steal_pointer (&backend->priv->desktop_task);
+	gchar *none[] = { NULL };
+
+	if (error != NULL)
+		g_task_return_error (task, error);
+	else
+		g_task_return_boolean (task, TRUE);
+
+	/* packages that changed while we were reading the file lists, which
+	 * the next transaction folds into its refresh if we can't run now */
+	if (!pk_backend_supports_parallelization (backend))
+		return;
+	if (backend->priv->desktop_stale ||
+	    (backend->priv->desktop_queued != NULL &&
+	     g_hash_table_size (backend->priv->desktop_queued) > 0))
+		pk_backend_desktop_refresh_async (backend, none, NULL, NULL);
+}
+
+static GHashTable *
+pk_backend_desktop_get_files (PkBackendDesktopHelper *helper, const gchar *name)
+{
+	GHashTable *files = g_hash_table_lookup (helper->packages, name);
+
+	if (files == NULL) {
+		files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		g_hash_table_insert (helper->packages, g_strdup (name), files);
+	}
+	return files;
+}
+
+static void
+pk_backend_desktop_job_package_cb (PkBackendJob *job,
+				   PkPackage *item,
+				   PkBackend *backend)
+{
+	PkBackendDesktopHelper *helper = g_task_get_task_data (backend->priv->desktop_task);
+
+	/* installed, but maybe without any desktop files */
+	pk_backend_desktop_get_files (helper, pk_package_get_name (item));
+	g_ptr_array_add (helper->package_ids, g_strdup (pk_package_get_id (item)));
+}
+
+static void
+pk_backend_desktop_job_packages_cb (PkBackendJob *job,
+				    GPtrArray *array,
+				    PkBackend *backend)
+{
+	for (guint i = 0; i < array->len; i++)
+		pk_backend_desktop_job_package_cb (job, g_ptr_array_index (array, i), backend);
+}
+
+static void
+pk_backend_desktop_job_files_cb (PkBackendJob *job,
+				 PkFiles *item,
+				 PkBackend *backend)
+{
+	PkBackendDesktopHelper *helper = g_task_get_task_data (backend->priv->desktop_task);
+	gchar **files = pk_files_get_files (item);
+	GHashTable *desktop_files;
+	g_auto(GStrv) split = NULL;
+
+	split = pk_package_id_split (pk_files_get_package_id (item));
+	if (split == NULL)
+		return;
+	desktop_files = pk_backend_desktop_get_files (helper, split[PK_PACKAGE_ID_NAME]);
+	for (guint i = 0; files != NULL && files[i] != NULL; i++) {
+		g_autoptr(GKeyFile) keyfile = NULL;
+		gboolean shown = TRUE;
+
+		if (!g_str_has_prefix (files[i], PK_DESKTOP_DEFAULT_APPLICATION_DIR "/") ||
+		    !g_str_has_suffix (files[i], ".desktop"))
+			continue;
+
+		/* the package is installed, so the file is on disk */
+		keyfile = g_key_file_new ();
+		if (g_key_file_load_from_file (keyfile, files[i], G_KEY_FILE_NONE, NULL))
+			shown = !g_key_file_get_boolean (keyfile, G_KEY_FILE_DESKTOP_GROUP,
+							 G_KEY_FILE_DESKTOP_KEY_NO_DISPLAY, NULL);
+		g_hash_table_insert (desktop_files, g_strdup (files[i]), GINT_TO_POINTER (shown));
+	}
+}
+
+static void
+pk_backend_desktop_save (PkBackend *backend)
+{
+	PkBackendDesktopHelper *helper = g_task_get_task_data (backend->priv->desktop_task);
+	GError *error = NULL;
+
+	if (helper->names == NULL) {
+		GHashTableIter iter;
+		gpointer key;
+		gpointer value;
+
+		g_hash_table_iter_init (&iter, helper->packages);
+		while (g_hash_table_iter_next (&iter, &key, &value))
+			pk_desktop_set_package_files (backend->priv->desktop, key, value);
+	} else {
+		/* the names that did not resolve have been removed */
+		for (guint i = 0; helper->names[i] != NULL; i++) {
+			pk_desktop_set_package_files (backend->priv->desktop,
+						      helper->names[i],
+						      g_hash_table_lookup (helper->packages,
+									   helper->names[i]));
+		}
+	}
+	pk_desktop_set_stamp (backend->priv->desktop, helper->stamp);
+
+	/* unless everything changed again while we were reading */
+	if (!backend->priv->desktop_stale)
+		g_atomic_int_set (&backend->priv->desktop_ready, TRUE);
+
+	if (!pk_desktop_save (backend->priv->desktop, backend->priv->desktop_database, &error)) {
+		pk_backend_desktop_return (backend, error);
+		return;
+	}
+	g_debug ("updated the desktop files of %u packages",
+		 g_hash_table_size (helper->packages));
+	pk_backend_desktop_return (backend, NULL);
+}
+
+static void
+pk_backend_desktop_files_finished_cb (PkBackendJob *job,
+				      gpointer object,
+				      PkBackend *backend)
+{
+	PkExitEnum exit_enum = pk_backend_internal_job_stop (backend, job, object);
+
+	if (exit_enum != PK_EXIT_ENUM_SUCCESS) {
+		pk_backend_desktop_return (backend,
+					   g_error_new (G_IO_ERROR, G_IO_ERROR_FAILED,
+							"GetFiles failed with %s",
+							pk_exit_enum_to_string (exit_enum)));
+		return;
+	}
+	pk_backend_desktop_save (backend);
+}
+
+static void
+pk_backend_desktop_packages_finished_cb (PkBackendJob *job,
+					 gpointer object,
+					 PkBackend *backend)
+{
+	PkBackendDesktopHelper *helper;
+	PkExitEnum exit_enum;
+	PkBackendJob *files_job;
+
+	exit_enum = pk_backend_internal_job_stop (backend, job, object);
+	if (exit_enum != PK_EXIT_ENUM_SUCCESS) {
+		pk_backend_desktop_return (backend,
+					   g_error_new (G_IO_ERROR, G_IO_ERROR_FAILED,
+							"querying the installed packages failed with %s",
+							pk_exit_enum_to_string (exit_enum)));
+		return;
+	}
+
+	/* everything was removed */
+	helper = g_task_get_task_data (backend->priv->desktop_task);
+	if (helper->package_ids->len == 0) {
+		pk_backend_desktop_save (backend);
+		return;
+	}
+
+	files_job = pk_backend_job_new (backend->priv->conf);
+	pk_backend_job_set_backend (files_job, backend);
+	pk_backend_job_set_vfunc (files_job, PK_BACKEND_SIGNAL_FILES,
+				  PK_BACKEND_JOB_VFUNC (pk_backend_desktop_job_files_cb),
+				  backend);
+	pk_backend_job_set_vfunc (files_job, PK_BACKEND_SIGNAL_FINISHED,
+				  PK_BACKEND_JOB_VFUNC (pk_backend_desktop_files_finished_cb),
+				  backend);
+	if (!pk_backend_internal_job_start (backend, files_job)) {
+		pk_backend_desktop_return (backend,
+					   g_error_new (G_IO_ERROR, G_IO_ERROR_FAILED,
+							"failed to start GetFiles"));
+		return;
+	}
+	g_ptr_array_add (helper->package_ids, NULL);
+	pk_backend_get_files (backend, files_job, (gchar **) helper->package_ids->pdata);
+}
+
+/**
+ * pk_backend_desktop_refresh_async:
+ * @package_names: the packages that were installed or removed
+ *
+ * Updates the desktop file database from the files of the installed
+ * packages called @package_names and of the ones that changed outside of
+ * transactions since the last refresh, or of all installed packages if
+ * there is no current database. Names that arrive while a refresh is
+ * running are updated straight after it, or by the next transaction if
+ * the backend can't run our jobs next to one.
+ **/
+void
+pk_backend_desktop_refresh_async (PkBackend *backend,
+				  gchar **package_names,
+				  GAsyncReadyCallback callback,
+				  gpointer user_data)
+{
+	PkBackendDesktopHelper *helper;
+	PkBackendJob *job;
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (PK_IS_BACKEND (backend));
+	g_return_if_fail (package_names != NULL);
+	g_return_if_fail (pk_is_thread_default ());
+
+	task = g_task_new (backend, NULL, callback, user_data);
+	if (backend->priv->desktop == NULL ||
+	    backend->priv->desc->get_packages == NULL ||
+	    backend->priv->desc->resolve == NULL ||
+	    backend->priv->desc->get_files == NULL) {
+		g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+					 "backend does not use a desktop file database");
+		return;
+	}
+	if (backend->priv->desktop_task != NULL) {
+		if (backend->priv->desktop_queued == NULL)
+			backend->priv->desktop_queued = g_hash_table_new_full (g_str_hash, g_str_equal,
+									      g_free, NULL);
+		for (guint i = 0; package_names[i] != NULL; i++)
+			g_hash_table_add (backend->priv->desktop_queued, g_strdup (package_names[i]));
+		g_task_return_boolean (task, TRUE);
+		return;
+	}
+
+	/* everything that changed outside of transactions too */
+	if (g_atomic_int_get (&backend->priv->desktop_ready)) {
+		g_autoptr(GHashTable) names = NULL;
+
+		names = g_steal_pointer (&backend->priv->desktop_queued);
+		if (names == NULL)
+			names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+		for (guint i = 0; package_names[i] != NULL; i++)
+			g_hash_table_add (names, g_strdup (package_names[i]));
+		if (g_hash_table_size (names) == 0) {
+			g_task_return_boolean (task, TRUE);
+			return;
+		}
+		helper = g_new0 (PkBackendDesktopHelper, 1);
+		helper->names = (gchar **) g_hash_table_get_keys_as_array (names, NULL);
+		g_hash_table_steal_all (names);
+	} else {
+		/* a rebuild reads them anyway */
+		g_clear_pointer (&backend->priv->desktop_queued, g_hash_table_unref);
+		backend->priv->desktop_stale = FALSE;
+		helper = g_new0 (PkBackendDesktopHelper, 1);
+	}
+	helper->stamp = pk_backend_get_installed_stamp (backend);
+	helper->package_ids = g_ptr_array_new_with_free_func (g_free);
+	helper->packages = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+						  (GDestroyNotify) g_hash_table_unref);
+	g_task_set_task_data (task, helper, (GDestroyNotify) pk_backend_desktop_helper_free);
+	backend->priv->desktop_task = g_steal_pointer (&task);
+
+	job = pk_backend_job_new (backend->priv->conf);
+	pk_backend_job_set_backend (job, backend);
+	pk_backend_job_set_vfunc (job, PK_BACKEND_SIGNAL_PACKAGE,
+				  PK_BACKEND_JOB_VFUNC (pk_backend_desktop_job_package_cb),
+				  backend);
+	pk_backend_job_set_vfunc (job, PK_BACKEND_SIGNAL_PACKAGES,
+				  PK_BACKEND_JOB_VFUNC (pk_backend_desktop_job_packages_cb),
+				  backend);
+	pk_backend_job_set_vfunc (job, PK_BACKEND_SIGNAL_FINISHED,
+				  PK_BACKEND_JOB_VFUNC (pk_backend_desktop_packages_finished_cb),
+				  backend);
+	if (!pk_backend_internal_job_start (backend, job)) {
+		pk_backend_desktop_return (backend,
+					   g_error_new (G_IO_ERROR, G_IO_ERROR_FAILED,
+							"failed to start the package query"));
+		return;
+	}
+
+	/* without a database there is nothing to update incrementally */
+	if (helper->names == NULL) {
+		g_debug ("building the desktop file database");
+		pk_backend_get_packages (backend, job,
+					 pk_bitfield_value (PK_FILTER_ENUM_INSTALLED));
+		return;
+	}
+	pk_backend_resolve (backend, job,
+			    pk_bitfield_value (PK_FILTER_ENUM_INSTALLED),
+			    helper->names);
+}
+
+gboolean
+pk_backend_desktop_refresh_finish (PkBackend *backend,
+				   GAsyncResult *res,
+				   GError **error)
+{
+	g_return_val_if_fail (g_task_is_valid (res, backend), FALSE);
+	return g_task_propagate_boolean (G_TASK (res), error);
+}
+
 static void
 pk_backend_file_monitor_changed_cb (GFileMonitor *monitor,
 				    GFile *file,
@@ -1077,6 +2355,10 @@ pk_backend_finalize (GObject *object)
 	g_mutex_clear (&backend->priv->eulas_mutex);
 	g_mutex_clear (&backend->priv->thread_hash_mutex);
 	g_hash_table_unref (backend->priv->thread_hash);
+	if (backend->priv->installed_db_changed_id != 0)
+		g_source_remove (backend->priv->installed_db_changed_id);
+	g_clear_pointer (&backend->priv->installed_changes, g_hash_table_unref);
+	g_mutex_clear (&backend->priv->installed_changes_mutex);
 	g_free (backend->priv->desc);
 
 	if (backend->priv->monitor != NULL)
@@ -1085,6 +2367,13 @@ pk_backend_finalize (GObject *object)
 		g_source_remove (backend->priv->transaction_inhibit_end_idle_id);
 	if (backend->priv->updates_changed_id != 0)
 		g_source_remove (backend->priv->updates_changed_id);
+	if (backend->priv->search_index != NULL)
+		g_object_unref (backend->priv->search_index);
+	g_object_unref (backend->priv->metrics);
+	g_free (backend->priv->command_index);
+	g_free (backend->priv->desktop_database);
+	g_clear_object (&backend->priv->desktop);
+	g_clear_pointer (&backend->priv->desktop_queued, g_hash_table_unref);
 	if (backend->priv->handle != NULL)
 		g_module_close (backend->priv->handle);
 
@@ -1479,6 +2768,8 @@ pk_backend_search_details (PkBackend *backend,
 	pk_backend_job_set_parameters (job, g_variant_new ("(t^as)",
 							   filters,
 							   values));
+	if (pk_backend_search_index_search (backend, job, filters, values))
+		return;
 	backend->priv->desc->search_details (backend, job, filters, values);
 }
 
@@ -1539,6 +2830,8 @@ pk_backend_search_names (PkBackend *backend,
 	pk_backend_job_set_parameters (job, g_variant_new ("(t^as)",
 							   filters,
 							   values));
+	if (pk_backend_search_index_search (backend, job, filters, values))
+		return;
 	backend->priv->desc->search_names (backend, job, filters, values);
 }
 
@@ -1725,6 +3018,8 @@ pk_backend_init (PkBackend *backend)
 							    g_free);
 	g_mutex_init (&backend->priv->eulas_mutex);
 	g_mutex_init (&backend->priv->thread_hash_mutex);
+	g_mutex_init (&backend->priv->installed_changes_mutex);
+	backend->priv->metrics = pk_metrics_new ();
 }
 
 PkBackend *
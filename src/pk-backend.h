@@ -25,6 +25,7 @@
 #include <glib.h>
 #include <glib-object.h>
 #include <gmodule.h>
+#include <gio/gio.h>
 
 /* these include the includes the backends should be using */
 #include <packagekit-glib2/pk-enum.h>
@@ -38,6 +39,7 @@
 
 #include "pk-backend.h"
 #include "pk-backend-job.h"
+#include "pk-search-index.h"
 
 G_BEGIN_DECLS
 
@@ -87,6 +89,9 @@ gboolean	 pk_backend_is_implemented		(PkBackend	*backend,
 gchar		*pk_backend_get_accepted_eula_string	(PkBackend	*backend);
 void		 pk_backend_repo_list_changed		(PkBackend      *backend);
 void		 pk_backend_installed_db_changed	(PkBackend      *backend);
+void		 pk_backend_installed_db_package_changed (PkBackend	*backend,
+							 const gchar	*package_id,
+							 PkInfoEnum	 info);
 
 
 gboolean	 pk_backend_updates_changed		(PkBackend	*backend);
@@ -112,6 +117,8 @@ gboolean	 pk_backend_watch_file			(PkBackend	*backend,
 /* call into the backend using a vfunc */
 const gchar	*pk_backend_get_name			(PkBackend	*backend)
 							 G_GNUC_WARN_UNUSED_RESULT;
+const gchar	*pk_backend_get_module_filename		(PkBackend	*backend)
+							 G_GNUC_WARN_UNUSED_RESULT;
 const gchar	*pk_backend_get_description		(PkBackend	*backend)
 							 G_GNUC_WARN_UNUSED_RESULT;
 const gchar	*pk_backend_get_author			(PkBackend	*backend)
@@ -120,7 +127,14 @@ PkBitfield	 pk_backend_get_groups			(PkBackend	*backend);
 PkBitfield	 pk_backend_get_filters			(PkBackend	*backend);
 PkBitfield	 pk_backend_get_roles			(PkBackend	*backend);
 gchar		**pk_backend_get_mime_types		(PkBackend	*backend);
+gchar		**pk_backend_get_native_arches		(PkBackend	*backend);
+gchar		*pk_backend_get_installed_stamp		(PkBackend	*backend);
 gboolean	 pk_backend_supports_parallelization	(PkBackend	*backend);
+gboolean	 pk_backend_supports_search_index	(PkBackend	*backend);
+gboolean	 pk_backend_supports_command_index	(PkBackend	*backend);
+void		 pk_backend_add_cache_lookup		(PkBackend	*backend,
+							 const gchar	*cache,
+							 gboolean	 hit);
 void		 pk_backend_initialize			(GKeyFile		*conf,
 							 PkBackend	*backend);
 void		 pk_backend_destroy			(PkBackend	*backend);
@@ -262,6 +276,44 @@ gpointer	 pk_backend_get_user_data		(PkBackend	*backend);
 void		 pk_backend_set_user_data		(PkBackend	*backend,
 							 gpointer	 user_data);
 
+/* daemon-side search index */
+PkSearchIndex	*pk_backend_get_search_index		(PkBackend	*backend);
+void		 pk_backend_set_search_index		(PkBackend	*backend,
+							 PkSearchIndex	*search_index);
+void		 pk_backend_search_index_refresh_async	(PkBackend	*backend,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+gboolean	 pk_backend_search_index_refresh_finish	(PkBackend	*backend,
+							 GAsyncResult	*res,
+							 GError		**error);
+
+/* daemon-side command-not-found index */
+const gchar	*pk_backend_get_command_index		(PkBackend	*backend);
+void		 pk_backend_set_command_index		(PkBackend	*backend,
+							 const gchar	*filename);
+void		 pk_backend_command_index_refresh_async	(PkBackend	*backend,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+gboolean	 pk_backend_command_index_refresh_finish	(PkBackend	*backend,
+							 GAsyncResult	*res,
+							 GError		**error);
+
+/* daemon-side desktop file database */
+const gchar	*pk_backend_get_desktop_database	(PkBackend	*backend);
+void		 pk_backend_set_desktop_database	(PkBackend	*backend,
+							 const gchar	*filename);
+gboolean	 pk_backend_lookup_application		(PkBackend	*backend,
+							 const gchar	*package_name,
+							 gboolean	*is_application);
+gboolean	 pk_backend_desktop_needs_refresh	(PkBackend	*backend);
+void		 pk_backend_desktop_refresh_async	(PkBackend	*backend,
+							 gchar		**package_names,
+							 GAsyncReadyCallback callback,
+							 gpointer	 user_data);
+gboolean	 pk_backend_desktop_refresh_finish	(PkBackend	*backend,
+							 GAsyncResult	*res,
+							 GError		**error);
+
 G_END_DECLS
 
 #endif /* __PK_BACKEND_H */
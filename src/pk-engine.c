@@ -38,6 +38,9 @@
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
 #include <gio/gunixfdlist.h>
+#include <packagekit-glib2/pk-command-index.h>
+#include <packagekit-glib2/pk-control-private.h>
+#include <packagekit-glib2/pk-desktop.h>
 #include <packagekit-glib2/pk-offline.h>
 #include <packagekit-glib2/pk-offline-private.h>
 #include <packagekit-glib2/pk-version.h>
@@ -46,6 +49,7 @@
 #include "pk-backend.h"
 #include "pk-dbus.h"
 #include "pk-engine.h"
+#include "pk-metrics.h"
 #include "pk-shared.h"
 #include "pk-transaction-db.h"
 #include "pk-transaction.h"
@@ -58,6 +62,7 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(PolkitSubject, g_object_unref)
 
 static void     pk_engine_finalize	(GObject       *object);
 static void	pk_engine_set_locked (PkEngine *engine, gboolean is_locked);
+static void	pk_engine_save_property_snapshot (PkEngine *engine);
 
 #define PK_ENGINE_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_ENGINE, PkEnginePrivate))
 
@@ -78,6 +83,7 @@ struct PkEnginePrivate
 	GNetworkMonitor		*network_monitor;
 	GKeyFile		*conf;
 	PkDbus			*dbus;
+	PkMetrics		*metrics;
 	GFileMonitor		*monitor_conf;
 	GFileMonitor		*monitor_binary;
 	GFileMonitor		*monitor_offline;
@@ -1010,6 +1016,47 @@ pk_engine_load_backend (PkEngine *engine, GError **error)
 	engine->priv->backend_name = pk_backend_get_name (engine->priv->backend);
 	engine->priv->backend_description = pk_backend_get_description (engine->priv->backend);
 	engine->priv->backend_author = pk_backend_get_author (engine->priv->backend);
+
+	/* answer searches from our own index if the backend wants that, it
+	 * is rebuilt next to the transactions the scheduler runs */
+	if (pk_backend_supports_search_index (engine->priv->backend) &&
+	    pk_backend_supports_parallelization (engine->priv->backend)) {
+		g_autofree gchar *filename = NULL;
+		g_autoptr(GError) error_local = NULL;
+		g_autoptr(PkSearchIndex) search_index = pk_search_index_new ();
+
+		filename = g_build_filename (LOCALSTATEDIR, "cache", "PackageKit",
+					     "search-index", NULL);
+		if (!pk_search_index_load (search_index, filename,
+					   engine->priv->backend_name,
+					   &error_local)) {
+			g_debug ("no search index until the next refresh: %s",
+				 error_local->message);
+		}
+		pk_backend_set_search_index (engine->priv->backend, search_index);
+	}
+
+	/* map executables to available packages for command-not-found */
+	if (pk_backend_supports_command_index (engine->priv->backend) &&
+	    pk_backend_supports_parallelization (engine->priv->backend) &&
+	    (!g_key_file_has_key (engine->priv->conf, "Daemon", "CommandNotFoundIndex", NULL) ||
+	     g_key_file_get_boolean (engine->priv->conf, "Daemon", "CommandNotFoundIndex", NULL))) {
+		pk_backend_set_command_index (engine->priv->backend,
+					      pk_command_index_get_default_filename ());
+	}
+
+	/* map desktop files to installed packages for the application filter */
+	if (pk_bitfield_contain (engine->priv->roles, PK_ROLE_ENUM_GET_PACKAGES) &&
+	    pk_bitfield_contain (engine->priv->roles, PK_ROLE_ENUM_RESOLVE) &&
+	    pk_bitfield_contain (engine->priv->roles, PK_ROLE_ENUM_GET_FILES) &&
+	    (!g_key_file_has_key (engine->priv->conf, "Daemon", "DesktopDatabase", NULL) ||
+	     g_key_file_get_boolean (engine->priv->conf, "Daemon", "DesktopDatabase", NULL))) {
+		pk_backend_set_desktop_database (engine->priv->backend,
+						 PK_DESKTOP_DEFAULT_DATABASE);
+	}
+
+	/* let clients find out about the backend without starting us */
+	pk_engine_save_property_snapshot (engine);
 	return TRUE;
 }
 
@@ -1127,51 +1174,45 @@ pk_engine_daemon_get_property (GDBusConnection *connection_, const gchar *sender
 	return NULL;
 }
 
-static gboolean
-pk_engine_package_name_in_strv (gchar **strv, PkPackage *pkg)
-{
-	guint i;
-	for (i = 0; strv[i] != NULL; i++) {
-		if (g_strcmp0 (strv[i], pk_package_get_name (pkg)) == 0)
-			return TRUE;
-	}
-	return FALSE;
-}
-
-static GVariant *
-pk_engine_get_package_history_pkg (PkTransactionPast *item, PkPackage *pkg)
+static void
+pk_engine_save_property_snapshot (PkEngine *engine)
 {
+	const gchar *static_properties[] = {
+		"VersionMajor",
+		"VersionMinor",
+		"VersionMicro",
+		"BackendName",
+		"BackendDescription",
+		"BackendAuthor",
+		"Roles",
+		"Groups",
+		"Filters",
+		"MimeTypes",
+		"DistroId",
+		NULL };
+	const gchar *depends[3] = { NULL };
+	guint n_depends = 0;
 	GVariantBuilder builder;
-	g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
-	g_variant_builder_add (&builder, "{sv}", "info",
-			       g_variant_new_uint32 (pk_package_get_info (pkg)));
-	g_variant_builder_add (&builder, "{sv}", "source",
-			       g_variant_new_string (pk_package_get_data (pkg)));
-	g_variant_builder_add (&builder, "{sv}", "version",
-			       g_variant_new_string (pk_package_get_version (pkg)));
-	g_variant_builder_add (&builder, "{sv}", "timestamp",
-			       g_variant_new_uint64 (pk_transaction_past_get_timestamp (item)));
-	g_variant_builder_add (&builder, "{sv}", "user-id",
-			       g_variant_new_uint32 (pk_transaction_past_get_uid (item)));
-	return g_variant_builder_end (&builder);
-}
-
-static gboolean
-pk_engine_is_package_history_interesing (PkPackage *package)
-{
-	gboolean ret;
-
-	switch (pk_package_get_info (package)) {
-	case PK_INFO_ENUM_INSTALLING:
-	case PK_INFO_ENUM_REMOVING:
-	case PK_INFO_ENUM_UPDATING:
-		ret = TRUE;
-		break;
-	default:
-		ret = FALSE;
-		break;
+	g_autofree gchar *conf_filename = pk_util_get_config_filename ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) properties = NULL;
+
+	/* clients don't trust the snapshot once either of these changes */
+	if (conf_filename != NULL)
+		depends[n_depends++] = conf_filename;
+	depends[n_depends++] = pk_backend_get_module_filename (engine->priv->backend);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	for (guint i = 0; static_properties[i] != NULL; i++) {
+		GVariant *value;
+		value = pk_engine_daemon_get_property (NULL, NULL, NULL, NULL,
+						       static_properties[i],
+						       NULL, engine);
+		g_variant_builder_add (&builder, "{sv}", static_properties[i], value);
 	}
-	return ret;
+	properties = g_variant_ref_sink (g_variant_builder_end (&builder));
+	if (!pk_control_snapshot_save (PK_CONTROL_SNAPSHOT_FILENAME, depends, properties, &error))
+		g_warning ("failed to save property snapshot: %s", error->message);
 }
 
 static GVariant *
@@ -1180,120 +1221,30 @@ pk_engine_get_package_history (PkEngine *engine,
 			       guint max_size,
 			       GError **error)
 {
-	const gchar *data;
-	const gchar *pkgname;
-	gboolean ret;
-	gchar *key;
-	gint64 timestamp;
-	GList *l;
-	GList *list;
-	GPtrArray *array = NULL;
-	guint i;
 	GVariantBuilder builder;
-	GVariant *value = NULL;
-	PkTransactionPast *item;
-	g_autoptr(GHashTable) deduplicate_hash = NULL;
-	g_autoptr(GHashTable) pkgname_hash = NULL;
-	g_autoptr(GList) keys = NULL;
-	g_autoptr(PkPackage) package_tmp = NULL;
-
-	list = pk_transaction_db_get_list (engine->priv->transaction_db, max_size);
-
-	/* simplify the loop */
-	if (max_size == 0)
-		max_size = G_MAXUINT;
-
-	pkgname_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
-	deduplicate_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-	package_tmp = pk_package_new ();
-	for (l = list; l != NULL; l = l->next) {
-		g_auto(GStrv) package_lines = NULL;
-		item = PK_TRANSACTION_PAST (l->data);
-
-		/* ignore anything that failed */
-		if (!pk_transaction_past_get_succeeded (item))
-			continue;
+	g_autoptr(GHashTable) seen = NULL;
 
-		/* split up data */
-		data = pk_transaction_past_get_data (item);
-		if (data == NULL)
-			continue;
-		package_lines = g_strsplit (data, "\n", -1);
-		for (i = 0; package_lines[i] != NULL; i++) {
-			g_autoptr(GError) error_local = NULL;
-			ret = pk_package_parse (package_tmp,
-						package_lines[i],
-						&error_local);
-			if (!ret) {
-				g_warning ("Failed to parse package: '%s': %s",
-					   package_lines[i], error_local->message);
-				continue;
-			}
-
-			/* not the package we care about */
-			if (!pk_engine_package_name_in_strv (package_names, package_tmp))
-				continue;
-
-			/* not a state we care about */
-			if (!pk_engine_is_package_history_interesing (package_tmp))
-				continue;
-
-			/* transactions without a timestamp are not interesting */
-			timestamp = pk_transaction_past_get_timestamp (item);
-			if (timestamp == 0)
-				continue;
-
-			/* de-duplicate the entry, in the case of multiarch */
-			key = g_strdup_printf ("%s-%" G_GINT64_FORMAT,
-					       pk_package_get_name (package_tmp),
-					       timestamp);
-			if (g_hash_table_lookup (deduplicate_hash, key) != NULL) {
-				g_free (key);
-				continue;
-			}
-			g_hash_table_insert (deduplicate_hash, key, package_lines[i]);
-
-			/* get the blob for this data item */
-			value = pk_engine_get_package_history_pkg (item, package_tmp);
-			if (value == NULL)
-				continue;
-
-			/* find the array */
-			pkgname = pk_package_get_name (package_tmp);
-			array = g_hash_table_lookup (pkgname_hash, pkgname);
-			if (array == NULL) {
-				array = g_ptr_array_new ();
-				g_hash_table_insert (pkgname_hash,
-						     g_strdup (pkgname),
-						     array);
-			}
-			g_ptr_array_add (array, value);
-		}
-	}
+	/* each name is a range query on the package_history index */
+	seen = g_hash_table_new (g_str_hash, g_str_equal);
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{saa{sv}}"));
+	for (guint i = 0; package_names[i] != NULL; i++) {
+		GVariant *value;
 
-	/* no history returns an empty array */
-	if (g_hash_table_size (pkgname_hash) == 0) {
-		value = g_variant_new_array (G_VARIANT_TYPE ("{saa{sv}}"), NULL, 0);
-		goto out;
-	}
+		if (!g_hash_table_add (seen, package_names[i]))
+			continue;
+		value = pk_transaction_db_get_package_history (engine->priv->transaction_db,
+							       package_names[i],
+							       max_size);
+		if (value == NULL)
+			continue;
 
-	/* we have a hash of pkgname:GPtrArray where the GPtrArray is an array
-	 * of GVariants of type a{sv} */
-	g_variant_builder_init (&builder, G_VARIANT_TYPE_ARRAY);
-	keys = g_hash_table_get_keys (pkgname_hash);
-	for (l = keys; l != NULL; l = l->next) {
-		pkgname = l->data;
-		array = g_hash_table_lookup (pkgname_hash, pkgname);
-		/* create aa{sv} */
-		value = g_variant_new_array (NULL,
-					     (GVariant * const *) array->pdata,
-					     MIN (array->len, max_size));
-		g_variant_builder_add (&builder, "{s@aa{sv}}", pkgname, value);
+		/* no history for this name */
+		g_variant_ref_sink (value);
+		if (g_variant_n_children (value) > 0)
+			g_variant_builder_add (&builder, "{s@aa{sv}}", package_names[i], value);
+		g_variant_unref (value);
 	}
-	value = g_variant_builder_end (&builder);
-out:
-	g_list_free_full (list, (GDestroyNotify) g_object_unref);
-	return value;
+	return g_variant_builder_end (&builder);
 }
 
 static void
@@ -1338,6 +1289,13 @@ pk_engine_daemon_method_call (GDBusConnection *connection_, const gchar *sender,
 		return;
 	}
 
+	if (g_strcmp0 (method_name, "GetDaemonMetrics") == 0) {
+		value = pk_metrics_to_variant (engine->priv->metrics);
+		tuple = g_variant_new_tuple (&value, 1);
+		g_dbus_method_invocation_return_value (invocation, tuple);
+		return;
+	}
+
 	if (g_strcmp0 (method_name, "GetPackageHistory") == 0) {
 		g_autofree gchar **package_names = NULL;
 
@@ -1944,6 +1902,7 @@ pk_engine_finalize (GObject *object)
 	g_object_unref (engine->priv->backend);
 	g_key_file_unref (engine->priv->conf);
 	g_object_unref (engine->priv->dbus);
+	g_object_unref (engine->priv->metrics);
 	g_strfreev (engine->priv->mime_types);
 	g_free (engine->priv->distro_id);
 
@@ -1954,6 +1913,8 @@ PkEngine *
 pk_engine_new (GKeyFile *conf)
 {
 	PkEngine *engine;
+	g_autofree gchar *metrics_socket = NULL;
+	g_autoptr(GError) error = NULL;
 	engine = g_object_new (PK_TYPE_ENGINE, NULL);
 	engine->priv->conf = g_key_file_ref (conf);
 	engine->priv->backend = pk_backend_new (engine->priv->conf);
@@ -1964,6 +1925,14 @@ pk_engine_new (GKeyFile *conf)
 	g_signal_connect (engine->priv->backend, "updates-changed",
 			  G_CALLBACK (pk_engine_backend_updates_changed_cb), engine);
 	engine->priv->scheduler = pk_scheduler_new (engine->priv->conf);
+
+	/* optionally serve the metrics without going through the bus */
+	engine->priv->metrics = pk_metrics_new ();
+	metrics_socket = g_key_file_get_string (engine->priv->conf, "Daemon", "MetricsSocket", NULL);
+	if (metrics_socket != NULL && metrics_socket[0] != '\0' &&
+	    !pk_metrics_listen (engine->priv->metrics, metrics_socket, &error))
+		g_warning ("failed to serve metrics: %s", error->message);
+
 	pk_scheduler_set_backend (engine->priv->scheduler,
 				  engine->priv->backend);
 	g_signal_connect (engine->priv->scheduler, "changed",
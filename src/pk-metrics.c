@@ -0,0 +1,518 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <sys/resource.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <gio/gunixsocketaddress.h>
+
+#include "pk-metrics.h"
+
+#define PK_METRICS_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_METRICS, PkMetricsPrivate))
+
+/* upper bounds of the histogram buckets, in seconds; the last is +Inf */
+static const gdouble pk_metrics_bounds[] = {
+	0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5, 10, 30, 60, 300 };
+
+#define PK_METRICS_BUCKETS	(G_N_ELEMENTS (pk_metrics_bounds) + 1)
+
+typedef struct {
+	guint64		 buckets[PK_METRICS_BUCKETS];
+	guint64		 count;
+	gdouble		 sum;
+} PkMetricsHistogram;
+
+typedef struct {
+	guint64		 exits[PK_EXIT_ENUM_LAST];
+	guint64		 signals;
+	guint64		 bytes;
+	PkMetricsHistogram queue_wait;
+	PkMetricsHistogram first_emission;
+	PkMetricsHistogram run_time;
+} PkMetricsRole;
+
+typedef struct {
+	guint64		 hits;
+	guint64		 misses;
+} PkMetricsCache;
+
+struct PkMetricsPrivate
+{
+	PkMetricsRole	 roles[PK_ROLE_ENUM_LAST];
+	GHashTable	*caches;
+	GMutex		 caches_mutex;
+	PkMetricsHistogram db_write;
+	GSocketService	*service;
+	gchar		*socket_path;
+};
+
+static gpointer pk_metrics_object = NULL;
+
+G_DEFINE_TYPE (PkMetrics, pk_metrics, G_TYPE_OBJECT)
+
+static void
+pk_metrics_histogram_add (PkMetricsHistogram *histogram, gint64 duration)
+{
+	gdouble value = (gdouble) duration / G_USEC_PER_SEC;
+	guint i;
+
+	for (i = 0; i < G_N_ELEMENTS (pk_metrics_bounds); i++) {
+		if (value <= pk_metrics_bounds[i])
+			break;
+	}
+	histogram->buckets[i]++;
+	histogram->count++;
+	histogram->sum += value;
+}
+
+void
+pk_metrics_add_transaction (PkMetrics *metrics,
+			    PkRoleEnum role,
+			    PkExitEnum exit_enum,
+			    const PkMetricsTransaction *item)
+{
+	PkMetricsRole *tmp;
+
+	g_return_if_fail (PK_IS_METRICS (metrics));
+	g_return_if_fail (role < PK_ROLE_ENUM_LAST);
+	g_return_if_fail (exit_enum < PK_EXIT_ENUM_LAST);
+
+	tmp = &metrics->priv->roles[role];
+	tmp->exits[exit_enum]++;
+	tmp->signals += item->signals;
+	tmp->bytes += item->bytes;
+
+	/* transactions can finish without ever being queued or run */
+	if (item->queued != 0 && item->started >= item->queued)
+		pk_metrics_histogram_add (&tmp->queue_wait, item->started - item->queued);
+	if (item->started != 0 && item->first_emission >= item->started)
+		pk_metrics_histogram_add (&tmp->first_emission, item->first_emission - item->started);
+	if (item->started != 0 && item->finished >= item->started)
+		pk_metrics_histogram_add (&tmp->run_time, item->finished - item->started);
+}
+
+void
+pk_metrics_add_cache_lookup (PkMetrics *metrics, const gchar *cache, gboolean hit)
+{
+	PkMetricsCache *tmp;
+
+	g_return_if_fail (PK_IS_METRICS (metrics));
+	g_return_if_fail (cache != NULL);
+
+	/* backends look up their caches in their threads */
+	g_mutex_lock (&metrics->priv->caches_mutex);
+	tmp = g_hash_table_lookup (metrics->priv->caches, cache);
+	if (tmp == NULL) {
+		tmp = g_new0 (PkMetricsCache, 1);
+		g_hash_table_insert (metrics->priv->caches, g_strdup (cache), tmp);
+	}
+	if (hit)
+		tmp->hits++;
+	else
+		tmp->misses++;
+	g_mutex_unlock (&metrics->priv->caches_mutex);
+}
+
+void
+pk_metrics_add_db_write (PkMetrics *metrics, gint64 duration)
+{
+	g_return_if_fail (PK_IS_METRICS (metrics));
+	pk_metrics_histogram_add (&metrics->priv->db_write, duration);
+}
+
+static guint64
+pk_metrics_get_peak_rss (void)
+{
+	struct rusage usage;
+
+	if (getrusage (RUSAGE_SELF, &usage) != 0)
+		return 0;
+
+	/* Linux reports KiB */
+	return (guint64) usage.ru_maxrss * 1024;
+}
+
+static GVariant *
+pk_metrics_histogram_to_variant (const PkMetricsHistogram *histogram)
+{
+	return g_variant_new ("(td@at)",
+			      histogram->count,
+			      histogram->sum,
+			      g_variant_new_fixed_array (G_VARIANT_TYPE_UINT64,
+							 histogram->buckets,
+							 PK_METRICS_BUCKETS,
+							 sizeof (guint64)));
+}
+
+/**
+ * pk_metrics_to_variant:
+ *
+ * Returns the metrics as the a{sv} of the GetDaemonMetrics method.
+ * Histograms are (count, sum, buckets) where the buckets are not
+ * cumulative and are bounded by bucket-bounds, with a final +Inf bucket.
+ **/
+GVariant *
+pk_metrics_to_variant (PkMetrics *metrics)
+{
+	GVariantBuilder builder;
+	GVariantBuilder roles;
+	GVariantBuilder caches;
+	GHashTableIter iter;
+	gpointer key, value;
+
+	g_return_val_if_fail (PK_IS_METRICS (metrics), NULL);
+
+	g_variant_builder_init (&roles, G_VARIANT_TYPE ("a{sa{sv}}"));
+	for (guint i = 0; i < PK_ROLE_ENUM_LAST; i++) {
+		PkMetricsRole *tmp = &metrics->priv->roles[i];
+		GVariantBuilder role;
+		GVariantBuilder exits;
+		guint64 requests = 0;
+
+		g_variant_builder_init (&exits, G_VARIANT_TYPE ("a{st}"));
+		for (guint j = 0; j < PK_EXIT_ENUM_LAST; j++) {
+			if (tmp->exits[j] == 0)
+				continue;
+			requests += tmp->exits[j];
+			g_variant_builder_add (&exits, "{st}",
+					       pk_exit_enum_to_string (j),
+					       tmp->exits[j]);
+		}
+		if (requests == 0) {
+			g_variant_builder_clear (&exits);
+			continue;
+		}
+
+		g_variant_builder_init (&role, G_VARIANT_TYPE ("a{sv}"));
+		g_variant_builder_add (&role, "{sv}", "requests", g_variant_new_uint64 (requests));
+		g_variant_builder_add (&role, "{sv}", "exits", g_variant_builder_end (&exits));
+		g_variant_builder_add (&role, "{sv}", "signals", g_variant_new_uint64 (tmp->signals));
+		g_variant_builder_add (&role, "{sv}", "bytes", g_variant_new_uint64 (tmp->bytes));
+		g_variant_builder_add (&role, "{sv}", "queue-wait",
+				       pk_metrics_histogram_to_variant (&tmp->queue_wait));
+		g_variant_builder_add (&role, "{sv}", "first-emission",
+				       pk_metrics_histogram_to_variant (&tmp->first_emission));
+		g_variant_builder_add (&role, "{sv}", "run-time",
+				       pk_metrics_histogram_to_variant (&tmp->run_time));
+		g_variant_builder_add (&roles, "{sa{sv}}", pk_role_enum_to_string (i), &role);
+	}
+
+	g_variant_builder_init (&caches, G_VARIANT_TYPE ("a{s(tt)}"));
+	g_mutex_lock (&metrics->priv->caches_mutex);
+	g_hash_table_iter_init (&iter, metrics->priv->caches);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		PkMetricsCache *tmp = value;
+		g_variant_builder_add (&caches, "{s(tt)}", key, tmp->hits, tmp->misses);
+	}
+	g_mutex_unlock (&metrics->priv->caches_mutex);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+	g_variant_builder_add (&builder, "{sv}", "bucket-bounds",
+			       g_variant_new_fixed_array (G_VARIANT_TYPE_DOUBLE,
+							  pk_metrics_bounds,
+							  G_N_ELEMENTS (pk_metrics_bounds),
+							  sizeof (gdouble)));
+	g_variant_builder_add (&builder, "{sv}", "roles", g_variant_builder_end (&roles));
+	g_variant_builder_add (&builder, "{sv}", "caches", g_variant_builder_end (&caches));
+	g_variant_builder_add (&builder, "{sv}", "db-write",
+			       pk_metrics_histogram_to_variant (&metrics->priv->db_write));
+	g_variant_builder_add (&builder, "{sv}", "peak-rss",
+			       g_variant_new_uint64 (pk_metrics_get_peak_rss ()));
+	return g_variant_builder_end (&builder);
+}
+
+static void
+pk_metrics_histogram_to_text (GString *string,
+			      const gchar *name,
+			      const gchar *labels,
+			      const PkMetricsHistogram *histogram)
+{
+	gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+	guint64 cumulative = 0;
+	const gchar *sep = labels[0] != '\0' ? "," : "";
+
+	for (guint i = 0; i < PK_METRICS_BUCKETS; i++) {
+		cumulative += histogram->buckets[i];
+		if (i < G_N_ELEMENTS (pk_metrics_bounds))
+			g_ascii_formatd (buf, sizeof (buf), "%g", pk_metrics_bounds[i]);
+		else
+			g_strlcpy (buf, "+Inf", sizeof (buf));
+		g_string_append_printf (string, "%s_bucket{%s%sle=\"%s\"} %" G_GUINT64_FORMAT "\n",
+					name, labels, sep, buf, cumulative);
+	}
+	g_ascii_formatd (buf, sizeof (buf), "%.9g", histogram->sum);
+	if (labels[0] != '\0') {
+		g_string_append_printf (string, "%s_sum{%s} %s\n", name, labels, buf);
+		g_string_append_printf (string, "%s_count{%s} %" G_GUINT64_FORMAT "\n",
+					name, labels, histogram->count);
+	} else {
+		g_string_append_printf (string, "%s_sum %s\n", name, buf);
+		g_string_append_printf (string, "%s_count %" G_GUINT64_FORMAT "\n",
+					name, histogram->count);
+	}
+}
+
+/**
+ * pk_metrics_to_text:
+ *
+ * Returns the metrics in the Prometheus text exposition format.
+ **/
+gchar *
+pk_metrics_to_text (PkMetrics *metrics)
+{
+	GString *string = g_string_new (NULL);
+	GHashTableIter iter;
+	gpointer key, value;
+	struct {
+		const gchar	*name;
+		const gchar	*help;
+		gsize		 offset;
+	} histograms[] = {
+		{ "packagekit_transaction_queue_wait_seconds",
+		  "Time from being queued by the scheduler to running",
+		  G_STRUCT_OFFSET (PkMetricsRole, queue_wait) },
+		{ "packagekit_transaction_first_emission_seconds",
+		  "Time from running to the first signal",
+		  G_STRUCT_OFFSET (PkMetricsRole, first_emission) },
+		{ "packagekit_transaction_run_seconds",
+		  "Time from running to finished",
+		  G_STRUCT_OFFSET (PkMetricsRole, run_time) },
+	};
+
+	g_return_val_if_fail (PK_IS_METRICS (metrics), NULL);
+
+	g_string_append (string,
+			 "# HELP packagekit_transactions_total Finished transactions\n"
+			 "# TYPE packagekit_transactions_total counter\n");
+	for (guint i = 0; i < PK_ROLE_ENUM_LAST; i++) {
+		for (guint j = 0; j < PK_EXIT_ENUM_LAST; j++) {
+			if (metrics->priv->roles[i].exits[j] == 0)
+				continue;
+			g_string_append_printf (string,
+						"packagekit_transactions_total{role=\"%s\",exit=\"%s\"} %" G_GUINT64_FORMAT "\n",
+						pk_role_enum_to_string (i),
+						pk_exit_enum_to_string (j),
+						metrics->priv->roles[i].exits[j]);
+		}
+	}
+
+	g_string_append (string,
+			 "# HELP packagekit_transaction_signals_total Signals emitted by transactions\n"
+			 "# TYPE packagekit_transaction_signals_total counter\n");
+	for (guint i = 0; i < PK_ROLE_ENUM_LAST; i++) {
+		if (metrics->priv->roles[i].signals == 0)
+			continue;
+		g_string_append_printf (string,
+					"packagekit_transaction_signals_total{role=\"%s\"} %" G_GUINT64_FORMAT "\n",
+					pk_role_enum_to_string (i),
+					metrics->priv->roles[i].signals);
+	}
+
+	g_string_append (string,
+			 "# HELP packagekit_transaction_signal_bytes_total Serialized size of the signals emitted by transactions\n"
+			 "# TYPE packagekit_transaction_signal_bytes_total counter\n");
+	for (guint i = 0; i < PK_ROLE_ENUM_LAST; i++) {
+		if (metrics->priv->roles[i].bytes == 0)
+			continue;
+		g_string_append_printf (string,
+					"packagekit_transaction_signal_bytes_total{role=\"%s\"} %" G_GUINT64_FORMAT "\n",
+					pk_role_enum_to_string (i),
+					metrics->priv->roles[i].bytes);
+	}
+
+	for (guint h = 0; h < G_N_ELEMENTS (histograms); h++) {
+		g_string_append_printf (string, "# HELP %s %s\n# TYPE %s histogram\n",
+					histograms[h].name, histograms[h].help,
+					histograms[h].name);
+		for (guint i = 0; i < PK_ROLE_ENUM_LAST; i++) {
+			PkMetricsRole *tmp = &metrics->priv->roles[i];
+			PkMetricsHistogram *histogram;
+			g_autofree gchar *labels = NULL;
+
+			histogram = G_STRUCT_MEMBER_P (tmp, histograms[h].offset);
+			if (histogram->count == 0)
+				continue;
+			labels = g_strdup_printf ("role=\"%s\"", pk_role_enum_to_string (i));
+			pk_metrics_histogram_to_text (string, histograms[h].name, labels, histogram);
+		}
+	}
+
+	g_string_append (string,
+			 "# HELP packagekit_cache_lookups_total Backend cache lookups\n"
+			 "# TYPE packagekit_cache_lookups_total counter\n");
+	g_mutex_lock (&metrics->priv->caches_mutex);
+	g_hash_table_iter_init (&iter, metrics->priv->caches);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		PkMetricsCache *tmp = value;
+		g_string_append_printf (string,
+					"packagekit_cache_lookups_total{cache=\"%s\",result=\"hit\"} %" G_GUINT64_FORMAT "\n"
+					"packagekit_cache_lookups_total{cache=\"%s\",result=\"miss\"} %" G_GUINT64_FORMAT "\n",
+					(const gchar *) key, tmp->hits,
+					(const gchar *) key, tmp->misses);
+	}
+	g_mutex_unlock (&metrics->priv->caches_mutex);
+
+	g_string_append (string,
+			 "# HELP packagekit_db_write_seconds Transaction database write latency\n"
+			 "# TYPE packagekit_db_write_seconds histogram\n");
+	pk_metrics_histogram_to_text (string, "packagekit_db_write_seconds", "",
+				      &metrics->priv->db_write);
+
+	g_string_append_printf (string,
+				"# HELP packagekit_peak_rss_bytes Peak resident set size of the daemon\n"
+				"# TYPE packagekit_peak_rss_bytes gauge\n"
+				"packagekit_peak_rss_bytes %" G_GUINT64_FORMAT "\n",
+				pk_metrics_get_peak_rss ());
+
+	return g_string_free (string, FALSE);
+}
+
+static void
+pk_metrics_write_cb (GObject *source_object, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GSocketConnection) connection = G_SOCKET_CONNECTION (user_data);
+	g_autoptr(GError) error = NULL;
+
+	if (!g_output_stream_write_all_finish (G_OUTPUT_STREAM (source_object), res, NULL, &error))
+		g_debug ("failed to write metrics: %s", error->message);
+	g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+}
+
+static gboolean
+pk_metrics_incoming_cb (GSocketService *service,
+			GSocketConnection *connection,
+			GObject *source_object,
+			PkMetrics *metrics)
+{
+	GOutputStream *stream;
+	gchar *text;
+
+	/* a scraper that doesn't read must not block the main loop */
+	text = pk_metrics_to_text (metrics);
+	g_object_set_data_full (G_OBJECT (connection), "text", text, g_free);
+	stream = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+	g_output_stream_write_all_async (stream, text, strlen (text),
+					 G_PRIORITY_DEFAULT, NULL,
+					 pk_metrics_write_cb,
+					 g_object_ref (connection));
+	return TRUE;
+}
+
+/**
+ * pk_metrics_listen:
+ * @path: the filename of the Unix socket
+ *
+ * Serves pk_metrics_to_text() to every client connecting to @path, so
+ * that the daemon can be scraped without going through the bus.
+ **/
+gboolean
+pk_metrics_listen (PkMetrics *metrics, const gchar *path, GError **error)
+{
+	g_autoptr(GSocketAddress) address = NULL;
+	g_autoptr(GSocketService) service = NULL;
+
+	g_return_val_if_fail (PK_IS_METRICS (metrics), FALSE);
+	g_return_val_if_fail (path != NULL, FALSE);
+
+	if (metrics->priv->service != NULL) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_EXISTS,
+			     "already listening on %s", metrics->priv->socket_path);
+		return FALSE;
+	}
+
+	/* remove the socket of a previous instance */
+	g_unlink (path);
+
+	address = g_unix_socket_address_new (path);
+	service = g_socket_service_new ();
+	if (!g_socket_listener_add_address (G_SOCKET_LISTENER (service),
+					    address,
+					    G_SOCKET_TYPE_STREAM,
+					    G_SOCKET_PROTOCOL_DEFAULT,
+					    NULL, NULL, error)) {
+		g_prefix_error (error, "failed to listen on %s: ", path);
+		return FALSE;
+	}
+	g_signal_connect (service, "incoming",
+			  G_CALLBACK (pk_metrics_incoming_cb), metrics);
+	g_socket_service_start (service);
+
+	metrics->priv->service = g_steal_pointer (&service);
+	metrics->priv->socket_path = g_strdup (path);
+	return TRUE;
+}
+
+static void
+pk_metrics_finalize (GObject *object)
+{
+	PkMetrics *metrics = PK_METRICS (object);
+
+	if (metrics->priv->service != NULL) {
+		g_socket_service_stop (metrics->priv->service);
+		g_socket_listener_close (G_SOCKET_LISTENER (metrics->priv->service));
+		g_object_unref (metrics->priv->service);
+		g_unlink (metrics->priv->socket_path);
+	}
+	g_free (metrics->priv->socket_path);
+	g_hash_table_unref (metrics->priv->caches);
+	g_mutex_clear (&metrics->priv->caches_mutex);
+
+	G_OBJECT_CLASS (pk_metrics_parent_class)->finalize (object);
+}
+
+static void
+pk_metrics_class_init (PkMetricsClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = pk_metrics_finalize;
+	g_type_class_add_private (klass, sizeof (PkMetricsPrivate));
+}
+
+static void
+pk_metrics_init (PkMetrics *metrics)
+{
+	metrics->priv = PK_METRICS_GET_PRIVATE (metrics);
+	metrics->priv->caches = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, g_free);
+	g_mutex_init (&metrics->priv->caches_mutex);
+}
+
+/**
+ * pk_metrics_new:
+ *
+ * Returns the metrics of the daemon, which are shared by everything
+ * that records into them.
+ **/
+PkMetrics *
+pk_metrics_new (void)
+{
+	if (pk_metrics_object != NULL) {
+		g_object_ref (pk_metrics_object);
+	} else {
+		pk_metrics_object = g_object_new (PK_TYPE_METRICS, NULL);
+		g_object_add_weak_pointer (pk_metrics_object, &pk_metrics_object);
+	}
+	return PK_METRICS (pk_metrics_object);
+}
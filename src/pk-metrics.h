@@ -0,0 +1,83 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __PK_METRICS_H
+#define __PK_METRICS_H
+
+#include <glib-object.h>
+#include <packagekit-glib2/pk-enum.h>
+
+G_BEGIN_DECLS
+
+#define PK_TYPE_METRICS		(pk_metrics_get_type ())
+#define PK_METRICS(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), PK_TYPE_METRICS, PkMetrics))
+#define PK_METRICS_CLASS(k)	(G_TYPE_CHECK_CLASS_CAST((k), PK_TYPE_METRICS, PkMetricsClass))
+#define PK_IS_METRICS(o)	(G_TYPE_CHECK_INSTANCE_TYPE ((o), PK_TYPE_METRICS))
+#define PK_IS_METRICS_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), PK_TYPE_METRICS))
+#define PK_METRICS_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), PK_TYPE_METRICS, PkMetricsClass))
+
+typedef struct PkMetricsPrivate PkMetricsPrivate;
+
+typedef struct
+{
+	GObject			 parent;
+	PkMetricsPrivate	*priv;
+} PkMetrics;
+
+typedef struct
+{
+	GObjectClass		 parent_class;
+} PkMetricsClass;
+
+/* the timestamps of one transaction, in µs of g_get_monotonic_time() or 0 */
+typedef struct {
+	gint64		 queued;
+	gint64		 started;
+	gint64		 first_emission;
+	gint64		 finished;
+	guint		 signals;
+	guint64		 bytes;
+} PkMetricsTransaction;
+
+#ifdef G_DEFINE_AUTOPTR_CLEANUP_FUNC
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(PkMetrics, g_object_unref)
+#endif
+
+GType		 pk_metrics_get_type			(void);
+PkMetrics	*pk_metrics_new				(void);
+void		 pk_metrics_add_transaction		(PkMetrics		*metrics,
+							 PkRoleEnum		 role,
+							 PkExitEnum		 exit_enum,
+							 const PkMetricsTransaction *item);
+void		 pk_metrics_add_cache_lookup		(PkMetrics		*metrics,
+							 const gchar		*cache,
+							 gboolean		 hit);
+void		 pk_metrics_add_db_write		(PkMetrics		*metrics,
+							 gint64			 duration);
+GVariant	*pk_metrics_to_variant			(PkMetrics		*metrics);
+gchar		*pk_metrics_to_text			(PkMetrics		*metrics);
+gboolean	 pk_metrics_listen			(PkMetrics		*metrics,
+							 const gchar		*path,
+							 GError			**error);
+
+G_END_DECLS
+
+#endif /* __PK_METRICS_H */
@@ -0,0 +1,1087 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <packagekit-glib2/pk-package.h>
+#include <packagekit-glib2/pk-package-id.h>
+#include <packagekit-glib2/pk-package-sack-private.h>
+
+#include "pk-search-index.h"
+
+static void     pk_search_index_finalize	(GObject        *object);
+
+#define PK_SEARCH_INDEX_GET_PRIVATE(o) (G_TYPE_INSTANCE_GET_PRIVATE ((o), PK_TYPE_SEARCH_INDEX, PkSearchIndexPrivate))
+
+#define PK_SEARCH_INDEX_MAGIC		"PKSRCHIX"
+#define PK_SEARCH_INDEX_VERSION		1
+
+/*
+ * The index file is written once per refresh and then only ever mapped:
+ *
+ *   header
+ *   records[n_records]		sorted by package-id
+ *   trigrams[n_trigrams]	sorted by trigram
+ *   postings			delta-encoded varints of record numbers
+ *   strings			NUL terminated, referenced by offset
+ *
+ * Trigrams are taken over the ASCII-lowercased name, summary and
+ * description of each package, so a search term of three or more bytes
+ * only has to look at the records that contain all of its trigrams.
+ */
+typedef struct {
+	gchar		 magic[8];
+	guint32		 version;
+	guint32		 n_records;
+	guint32		 n_trigrams;
+	guint32		 postings_size;
+	guint32		 strings_size;
+	guint32		 backend_name;
+} PkSearchIndexHeader;
+
+typedef struct {
+	guint32		 package_id;
+	guint32		 name;
+	guint32		 summary;
+	guint32		 description;
+	guint32		 info;
+} PkSearchIndexRecord;
+
+typedef struct {
+	guint32		 trigram;
+	guint32		 offset;	/* into the postings */
+	guint32		 size;		/* in bytes */
+	guint32		 n_postings;
+} PkSearchIndexTrigram;
+
+struct PkSearchIndexPrivate
+{
+	gchar				*filename;
+	gchar				*backend_name;
+	GMappedFile			*mapped;
+	const PkSearchIndexHeader	*header;
+	const PkSearchIndexRecord	*records;
+	const PkSearchIndexTrigram	*trigrams;
+	const guint8			*postings;
+	const gchar			*strings;
+	gint				 valid;
+	guint				 generation;
+	GHashTable			*changes;	/* record : PkInfoEnum */
+	gchar				**native_arches;
+};
+
+G_DEFINE_TYPE (PkSearchIndex, pk_search_index, G_TYPE_OBJECT)
+
+static inline guint32
+pk_search_index_trigram (const gchar *str)
+{
+	return ((guint32) (guint8) g_ascii_tolower (str[0]) << 16) |
+	       ((guint32) (guint8) g_ascii_tolower (str[1]) << 8) |
+	       (guint32) (guint8) g_ascii_tolower (str[2]);
+}
+
+static const gchar *
+pk_search_index_get_string (PkSearchIndex *index, guint32 offset)
+{
+	return index->priv->strings + offset;
+}
+
+/* @needle is already lowercase */
+static gboolean
+pk_search_index_strcasestr (const gchar *haystack, const gchar *needle)
+{
+	gsize needle_len = strlen (needle);
+
+	/* like a substring search in the backend */
+	if (needle_len == 0)
+		return TRUE;
+	for (; *haystack != '\0'; haystack++) {
+		if (g_ascii_tolower (*haystack) != needle[0])
+			continue;
+		if (g_ascii_strncasecmp (haystack, needle, needle_len) == 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+pk_search_index_unmap (PkSearchIndex *index)
+{
+	PkSearchIndexPrivate *priv = index->priv;
+
+	g_atomic_int_set (&priv->valid, FALSE);
+	g_clear_pointer (&priv->mapped, g_mapped_file_unref);
+	g_clear_pointer (&priv->changes, g_hash_table_unref);
+	priv->header = NULL;
+	priv->records = NULL;
+	priv->trigrams = NULL;
+	priv->postings = NULL;
+	priv->strings = NULL;
+}
+
+static gboolean
+pk_search_index_map (PkSearchIndex *index, GError **error)
+{
+	PkSearchIndexPrivate *priv = index->priv;
+	const PkSearchIndexHeader *header;
+	const gchar *data;
+	gsize size;
+	gsize expected;
+	guint i;
+	g_autoptr(GMappedFile) mapped = NULL;
+
+	mapped = g_mapped_file_new (priv->filename, FALSE, error);
+	if (mapped == NULL)
+		return FALSE;
+	data = g_mapped_file_get_contents (mapped);
+	size = g_mapped_file_get_length (mapped);
+
+	/* validate everything up front so lookups don't have to */
+	if (size < sizeof (PkSearchIndexHeader)) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+			     "%s is truncated", priv->filename);
+		return FALSE;
+	}
+	header = (const PkSearchIndexHeader *) data;
+	if (memcmp (header->magic, PK_SEARCH_INDEX_MAGIC, sizeof (header->magic)) != 0 ||
+	    header->version != PK_SEARCH_INDEX_VERSION) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+			     "%s is not a search index of version %i",
+			     priv->filename, PK_SEARCH_INDEX_VERSION);
+		return FALSE;
+	}
+	expected = sizeof (PkSearchIndexHeader) +
+		   (gsize) header->n_records * sizeof (PkSearchIndexRecord) +
+		   (gsize) header->n_trigrams * sizeof (PkSearchIndexTrigram) +
+		   header->postings_size + header->strings_size;
+	if (size != expected || header->strings_size == 0) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+			     "%s has an invalid size", priv->filename);
+		return FALSE;
+	}
+
+	priv->header = header;
+	priv->records = (const PkSearchIndexRecord *) (data + sizeof (PkSearchIndexHeader));
+	priv->trigrams = (const PkSearchIndexTrigram *) (priv->records + header->n_records);
+	priv->postings = (const guint8 *) (priv->trigrams + header->n_trigrams);
+	priv->strings = (const gchar *) (priv->postings + header->postings_size);
+	if (priv->strings[header->strings_size - 1] != '\0' ||
+	    header->backend_name >= header->strings_size) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+			     "%s has an invalid string pool", priv->filename);
+		priv->header = NULL;
+		return FALSE;
+	}
+	for (i = 0; i < header->n_records; i++) {
+		const PkSearchIndexRecord *record = &priv->records[i];
+		if (record->package_id >= header->strings_size ||
+		    record->name >= header->strings_size ||
+		    record->summary >= header->strings_size ||
+		    record->description >= header->strings_size) {
+			g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				     "%s has an invalid record", priv->filename);
+			priv->header = NULL;
+			return FALSE;
+		}
+	}
+	for (i = 0; i < header->n_trigrams; i++) {
+		const PkSearchIndexTrigram *trigram = &priv->trigrams[i];
+		if ((gsize) trigram->offset + trigram->size > header->postings_size) {
+			g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				     "%s has an invalid posting list", priv->filename);
+			priv->header = NULL;
+			return FALSE;
+		}
+	}
+
+	/* built by a different backend */
+	if (g_strcmp0 (pk_search_index_get_string (index, header->backend_name),
+		       priv->backend_name) != 0) {
+		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+			     "%s was built for the %s backend", priv->filename,
+			     pk_search_index_get_string (index, header->backend_name));
+		priv->header = NULL;
+		return FALSE;
+	}
+
+	priv->mapped = g_steal_pointer (&mapped);
+	g_atomic_int_set (&priv->valid, TRUE);
+	return TRUE;
+}
+
+/**
+ * pk_search_index_load:
+ *
+ * Maps the index written by an earlier refresh. The filename and backend
+ * name are remembered for the next pk_search_index_build() even if there
+ * is no usable index on disk yet.
+ **/
+gboolean
+pk_search_index_load (PkSearchIndex *index,
+		      const gchar *filename,
+		      const gchar *backend_name,
+		      GError **error)
+{
+	g_return_val_if_fail (PK_IS_SEARCH_INDEX (index), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	g_free (index->priv->filename);
+	index->priv->filename = g_strdup (filename);
+	g_free (index->priv->backend_name);
+	index->priv->backend_name = g_strdup (backend_name);
+
+	pk_search_index_unmap (index);
+	return pk_search_index_map (index, error);
+}
+
+/**
+ * pk_search_index_is_valid:
+ *
+ * Return value: %TRUE if searches can be answered from the index
+ **/
+gboolean
+pk_search_index_is_valid (PkSearchIndex *index)
+{
+	g_return_val_if_fail (PK_IS_SEARCH_INDEX (index), FALSE);
+	return g_atomic_int_get (&index->priv->valid);
+}
+
+/**
+ * pk_search_index_invalidate:
+ *
+ * Stops searches being answered from the index until it is rebuilt.
+ * This can be called from any thread.
+ **/
+void
+pk_search_index_invalidate (PkSearchIndex *index)
+{
+	g_return_if_fail (PK_IS_SEARCH_INDEX (index));
+	g_atomic_int_inc (&index->priv->generation);
+	if (g_atomic_int_compare_and_exchange (&index->priv->valid, TRUE, FALSE))
+		g_debug ("search index invalidated");
+}
+
+/**
+ * pk_search_index_get_generation:
+ *
+ * Return value: a counter bumped by every pk_search_index_invalidate()
+ **/
+guint
+pk_search_index_get_generation (PkSearchIndex *index)
+{
+	g_return_val_if_fail (PK_IS_SEARCH_INDEX (index), 0);
+	return (guint) g_atomic_int_get (&index->priv->generation);
+}
+
+static const PkSearchIndexRecord *
+pk_search_index_find_record (PkSearchIndex *index, const gchar *package_id)
+{
+	guint lo = 0;
+	guint hi;
+
+	if (index->priv->header == NULL)
+		return NULL;
+	hi = index->priv->header->n_records;
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+		const PkSearchIndexRecord *record = &index->priv->records[mid];
+		gint rc = strcmp (package_id, pk_search_index_get_string (index, record->package_id));
+		if (rc == 0)
+			return record;
+		if (rc < 0)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return NULL;
+}
+
+/**
+ * pk_search_index_get_description:
+ *
+ * Return value: the description the index holds for @package_id, which
+ * lets a refresh skip GetDetails for packages that have not changed
+ **/
+const gchar *
+pk_search_index_get_description (PkSearchIndex *index, const gchar *package_id)
+{
+	const PkSearchIndexRecord *record;
+
+	g_return_val_if_fail (PK_IS_SEARCH_INDEX (index), NULL);
+
+	record = pk_search_index_find_record (index, package_id);
+	if (record == NULL || record->description == 0)
+		return NULL;
+	return pk_search_index_get_string (index, record->description);
+}
+
+/* records the info of one record until the index is written again */
+static void
+pk_search_index_set_record_info (PkSearchIndex *index, guint record, PkInfoEnum info)
+{
+	PkSearchIndexPrivate *priv = index->priv;
+
+	if (priv->changes == NULL)
+		priv->changes = g_hash_table_new (g_direct_hash, g_direct_equal);
+	g_hash_table_insert (priv->changes, GUINT_TO_POINTER (record),
+			     GUINT_TO_POINTER (info));
+}
+
+/**
+ * pk_search_index_set_info:
+ * @package_id: a package installed or removed outside of PackageKit
+ * @info: %PK_INFO_ENUM_INSTALLED, or %PK_INFO_ENUM_AVAILABLE if removed
+ *
+ * Updates the index for one package without writing it again. An
+ * installed package is looked up by its own ID, and by the repo in its
+ * data if that is "installed:repo". Without a repo it only stands for an
+ * available package if there is just one with the same name, version and
+ * arch. A removed package makes all of them available, and records of
+ * installed packages that were removed are not found anymore.
+ *
+ * Return value: %FALSE if the package is not in the index, which then has
+ * to be rebuilt
+ **/
+gboolean
+pk_search_index_set_info (PkSearchIndex *index,
+			  const gchar *package_id,
+			  PkInfoEnum info)
+{
+	PkSearchIndexPrivate *priv = index->priv;
+	const gchar *data;
+	const gchar *repo = NULL;
+	gboolean found = FALSE;
+	gsize prefix_len;
+	guint lo = 0;
+	guint hi;
+	g_auto(GStrv) split = NULL;
+	g_autofree gchar *prefix = NULL;
+	g_autoptr(GArray) available = NULL;
+
+	g_return_val_if_fail (PK_IS_SEARCH_INDEX (index), FALSE);
+	g_return_val_if_fail (package_id != NULL, FALSE);
+
+	if (!pk_search_index_is_valid (index))
+		return FALSE;
+	split = pk_package_id_split (package_id);
+	if (split == NULL)
+		return FALSE;
+
+	/* the repo the package was installed from, if the backend says */
+	data = split[PK_PACKAGE_ID_DATA];
+	if (g_str_has_prefix (data, "installed:"))
+		repo = data + strlen ("installed:");
+	else if (!g_str_has_prefix (data, "installed"))
+		repo = data;
+
+	/* the records of the package are next to each other */
+	prefix = g_strdup_printf ("%s;%s;%s;",
+				  split[PK_PACKAGE_ID_NAME],
+				  split[PK_PACKAGE_ID_VERSION],
+				  split[PK_PACKAGE_ID_ARCH]);
+	prefix_len = strlen (prefix);
+	hi = priv->header->n_records;
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+		if (strcmp (pk_search_index_get_string (index, priv->records[mid].package_id), prefix) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	available = g_array_new (FALSE, FALSE, sizeof (guint));
+	for (; lo < priv->header->n_records; lo++) {
+		const gchar *id = pk_search_index_get_string (index, priv->records[lo].package_id);
+		gboolean installed_record;
+
+		if (strncmp (id, prefix, prefix_len) != 0)
+			break;
+		installed_record = g_str_has_prefix (id + prefix_len, "installed");
+
+		/* only one of them can be installed, so none of them is now */
+		if (info != PK_INFO_ENUM_INSTALLED) {
+			pk_search_index_set_record_info (index, lo,
+							 installed_record ? PK_INFO_ENUM_UNKNOWN :
+									    PK_INFO_ENUM_AVAILABLE);
+			found = TRUE;
+			continue;
+		}
+		if (g_strcmp0 (id, package_id) == 0 ||
+		    (!installed_record && g_strcmp0 (id + prefix_len, repo) == 0)) {
+			pk_search_index_set_record_info (index, lo, info);
+			found = TRUE;
+		} else if (!installed_record) {
+			g_array_append_val (available, lo);
+		}
+	}
+
+	/* the backend did not say which repo it came from */
+	if (!found && repo == NULL && available->len == 1) {
+		pk_search_index_set_record_info (index, g_array_index (available, guint, 0), info);
+		found = TRUE;
+	}
+	return found;
+}
+
+/* the info written to the index, unless changed since */
+static PkInfoEnum
+pk_search_index_get_info (PkSearchIndex *index, const PkSearchIndexRecord *record)
+{
+	gpointer info;
+
+	if (index->priv->changes != NULL &&
+	    g_hash_table_lookup_extended (index->priv->changes,
+					  GUINT_TO_POINTER (record - index->priv->records),
+					  NULL, &info))
+		return GPOINTER_TO_UINT (info);
+	return record->info;
+}
+
+static void
+pk_search_index_varint_append (GByteArray *buf, guint32 value)
+{
+	guint8 byte;
+
+	while (value >= 0x80) {
+		byte = (value & 0x7f) | 0x80;
+		g_byte_array_append (buf, &byte, 1);
+		value >>= 7;
+	}
+	byte = value;
+	g_byte_array_append (buf, &byte, 1);
+}
+
+typedef struct {
+	GByteArray	*buf;
+	guint32		 last;
+	guint32		 n_postings;
+} PkSearchIndexPostings;
+
+static void
+pk_search_index_postings_free (PkSearchIndexPostings *postings)
+{
+	g_byte_array_unref (postings->buf);
+	g_free (postings);
+}
+
+static void
+pk_search_index_add_trigrams (GHashTable *hash, const gchar *text, guint32 record)
+{
+	gsize len;
+	gsize i;
+
+	if (text == NULL)
+		return;
+	len = strlen (text);
+	for (i = 0; i + 3 <= len; i++) {
+		guint32 trigram = pk_search_index_trigram (text + i);
+		PkSearchIndexPostings *postings;
+
+		postings = g_hash_table_lookup (hash, GUINT_TO_POINTER (trigram));
+		if (postings == NULL) {
+			postings = g_new0 (PkSearchIndexPostings, 1);
+			postings->buf = g_byte_array_new ();
+			pk_search_index_varint_append (postings->buf, record);
+			postings->last = record;
+			postings->n_postings = 1;
+			g_hash_table_insert (hash, GUINT_TO_POINTER (trigram), postings);
+			continue;
+		}
+
+		/* records are added in order, so this is the only duplicate */
+		if (postings->last == record && postings->n_postings > 0)
+			continue;
+		pk_search_index_varint_append (postings->buf, record - postings->last);
+		postings->last = record;
+		postings->n_postings++;
+	}
+}
+
+static guint32
+pk_search_index_add_string (GByteArray *strings, GHashTable *dedupe, const gchar *str)
+{
+	gpointer offset;
+	guint32 value;
+
+	if (str == NULL || str[0] == '\0')
+		return 0;
+	if (g_hash_table_lookup_extended (dedupe, str, NULL, &offset))
+		return GPOINTER_TO_UINT (offset);
+	value = strings->len;
+	g_byte_array_append (strings, (const guint8 *) str, strlen (str) + 1);
+	g_hash_table_insert (dedupe, (gpointer) str, GUINT_TO_POINTER (value));
+	return value;
+}
+
+static gint
+pk_search_index_sort_packages_cb (gconstpointer a, gconstpointer b)
+{
+	PkPackage *package_a = *((PkPackage **) a);
+	PkPackage *package_b = *((PkPackage **) b);
+	return g_strcmp0 (pk_package_get_id (package_a), pk_package_get_id (package_b));
+}
+
+static gint
+pk_search_index_sort_trigrams_cb (gconstpointer a, gconstpointer b)
+{
+	const PkSearchIndexTrigram *trigram_a = a;
+	const PkSearchIndexTrigram *trigram_b = b;
+	if (trigram_a->trigram < trigram_b->trigram)
+		return -1;
+	return trigram_a->trigram > trigram_b->trigram;
+}
+
+static gint
+pk_search_index_sort_records_cb (gconstpointer a, gconstpointer b)
+{
+	guint32 nr_a = *((const guint32 *) a);
+	guint32 nr_b = *((const guint32 *) b);
+	if (nr_a < nr_b)
+		return -1;
+	return nr_a > nr_b;
+}
+
+/**
+ * pk_search_index_build:
+ * @packages: (element-type PkPackage): every package known to the backend
+ * @descriptions: (nullable): package-id to description
+ *
+ * Writes a new index and maps it.
+ **/
+gboolean
+pk_search_index_build (PkSearchIndex *index,
+		       GPtrArray *packages,
+		       GHashTable *descriptions,
+		       GError **error)
+{
+	GHashTableIter iter;
+	PkSearchIndexHeader header;
+	PkSearchIndexPostings *postings;
+	gpointer key;
+	guint i;
+	guint32 record_nr = 0;
+	g_autofree gchar *dirname = NULL;
+	g_autoptr(GArray) records = NULL;
+	g_autoptr(GArray) trigrams = NULL;
+	g_autoptr(GByteArray) data = NULL;
+	g_autoptr(GByteArray) postings_buf = NULL;
+	g_autoptr(GByteArray) strings = NULL;
+	g_autoptr(GHashTable) dedupe = NULL;
+	g_autoptr(GHashTable) trigram_hash = NULL;
+	g_autoptr(GPtrArray) sorted = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	g_return_val_if_fail (PK_IS_SEARCH_INDEX (index), FALSE);
+	g_return_val_if_fail (packages != NULL, FALSE);
+	g_return_val_if_fail (index->priv->filename != NULL, FALSE);
+
+	/* sorted by package-id so single packages can be bisected */
+	sorted = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (i = 0; i < packages->len; i++)
+		g_ptr_array_add (sorted, g_object_ref (g_ptr_array_index (packages, i)));
+	g_ptr_array_sort (sorted, pk_search_index_sort_packages_cb);
+
+	/* offset zero is the empty string */
+	strings = g_byte_array_new ();
+	g_byte_array_append (strings, (const guint8 *) "", 1);
+	dedupe = g_hash_table_new (g_str_hash, g_str_equal);
+	records = g_array_sized_new (FALSE, TRUE, sizeof (PkSearchIndexRecord), sorted->len);
+	trigram_hash = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+					      (GDestroyNotify) pk_search_index_postings_free);
+	for (i = 0; i < sorted->len; i++) {
+		PkPackage *package = g_ptr_array_index (sorted, i);
+		PkSearchIndexRecord record;
+		const gchar *description = NULL;
+		const gchar *name;
+
+		/* only the last emission of a package-id counts */
+		if (i + 1 < sorted->len &&
+		    g_strcmp0 (pk_package_get_id (package),
+			       pk_package_get_id (g_ptr_array_index (sorted, i + 1))) == 0)
+			continue;
+
+		if (descriptions != NULL)
+			description = g_hash_table_lookup (descriptions, pk_package_get_id (package));
+		name = pk_package_get_name (package);
+
+		record.package_id = pk_search_index_add_string (strings, dedupe, pk_package_get_id (package));
+		record.name = pk_search_index_add_string (strings, dedupe, name);
+		record.summary = pk_search_index_add_string (strings, dedupe, pk_package_get_summary (package));
+		record.description = pk_search_index_add_string (strings, dedupe, description);
+		record.info = pk_package_get_info (package);
+		g_array_append_val (records, record);
+
+		pk_search_index_add_trigrams (trigram_hash, name, record_nr);
+		pk_search_index_add_trigrams (trigram_hash, pk_package_get_summary (package), record_nr);
+		pk_search_index_add_trigrams (trigram_hash, description, record_nr);
+		record_nr++;
+	}
+
+	/* sorted trigram table and the postings it points into */
+	postings_buf = g_byte_array_new ();
+	trigrams = g_array_sized_new (FALSE, TRUE, sizeof (PkSearchIndexTrigram),
+				      g_hash_table_size (trigram_hash));
+	g_hash_table_iter_init (&iter, trigram_hash);
+	while (g_hash_table_iter_next (&iter, &key, (gpointer *) &postings)) {
+		PkSearchIndexTrigram trigram;
+		trigram.trigram = GPOINTER_TO_UINT (key);
+		trigram.offset = postings_buf->len;
+		trigram.size = postings->buf->len;
+		trigram.n_postings = postings->n_postings;
+		g_byte_array_append (postings_buf, postings->buf->data, postings->buf->len);
+		g_array_append_val (trigrams, trigram);
+	}
+	g_array_sort (trigrams, pk_search_index_sort_trigrams_cb);
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, PK_SEARCH_INDEX_MAGIC, sizeof (header.magic));
+	header.version = PK_SEARCH_INDEX_VERSION;
+	header.backend_name = pk_search_index_add_string (strings, dedupe, index->priv->backend_name);
+	header.n_records = records->len;
+	header.n_trigrams = trigrams->len;
+	header.postings_size = postings_buf->len;
+	header.strings_size = strings->len;
+
+	data = g_byte_array_sized_new (sizeof (header) +
+				       records->len * sizeof (PkSearchIndexRecord) +
+				       trigrams->len * sizeof (PkSearchIndexTrigram) +
+				       postings_buf->len + strings->len);
+	g_byte_array_append (data, (const guint8 *) &header, sizeof (header));
+	g_byte_array_append (data, (const guint8 *) records->data,
+			     records->len * sizeof (PkSearchIndexRecord));
+	g_byte_array_append (data, (const guint8 *) trigrams->data,
+			     trigrams->len * sizeof (PkSearchIndexTrigram));
+	g_byte_array_append (data, postings_buf->data, postings_buf->len);
+	g_byte_array_append (data, strings->data, strings->len);
+
+	/* the descriptions may point into the old mapping, so drop it last */
+	dirname = g_path_get_dirname (index->priv->filename);
+	if (g_mkdir_with_parents (dirname, 0755) != 0) {
+		g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+			     "failed to create %s", dirname);
+		return FALSE;
+	}
+	if (!g_file_set_contents (index->priv->filename,
+				  (const gchar *) data->data, data->len, error))
+		return FALSE;
+	g_debug ("wrote search index of %u packages and %u trigrams (%u bytes) in %.1fms",
+		 records->len, trigrams->len, data->len,
+		 g_timer_elapsed (timer, NULL) * 1000);
+
+	pk_search_index_unmap (index);
+	return pk_search_index_map (index, error);
+}
+
+/**
+ * pk_search_index_set_native_arches:
+ * @arches: (nullable): the architectures the %PK_FILTER_ENUM_ARCH filter
+ * keeps, including "noarch"
+ *
+ * Without them the index leaves searches with an arch filter to the backend.
+ **/
+void
+pk_search_index_set_native_arches (PkSearchIndex *index, gchar **arches)
+{
+	g_return_if_fail (PK_IS_SEARCH_INDEX (index));
+	g_strfreev (index->priv->native_arches);
+	index->priv->native_arches = g_strdupv (arches);
+}
+
+/**
+ * pk_search_index_can_search:
+ *
+ * The index matches like the backends that support it: a package matches
+ * if any of the terms is in its name for SearchName, or in its description
+ * for SearchDetails.
+ *
+ * It evaluates the installed, source, arch and newest filters that
+ * frontends send with every search; the application, free, GUI and
+ * development filters need the backend's metadata.
+ *
+ * Return value: %TRUE if the index can answer @role with @filters
+ **/
+gboolean
+pk_search_index_can_search (PkSearchIndex *index,
+			    PkRoleEnum role,
+			    PkBitfield filters)
+{
+	PkBitfield supported;
+
+	g_return_val_if_fail (PK_IS_SEARCH_INDEX (index), FALSE);
+
+	if (role != PK_ROLE_ENUM_SEARCH_NAME && role != PK_ROLE_ENUM_SEARCH_DETAILS)
+		return FALSE;
+	if (!pk_search_index_is_valid (index))
+		return FALSE;
+	supported = pk_bitfield_from_enums (PK_FILTER_ENUM_NONE,
+					    PK_FILTER_ENUM_INSTALLED,
+					    PK_FILTER_ENUM_NOT_INSTALLED,
+					    PK_FILTER_ENUM_SOURCE,
+					    PK_FILTER_ENUM_NOT_SOURCE,
+					    PK_FILTER_ENUM_NEWEST,
+					    -1);
+	if (index->priv->native_arches != NULL) {
+		pk_bitfield_add (supported, PK_FILTER_ENUM_ARCH);
+		pk_bitfield_add (supported, PK_FILTER_ENUM_NOT_ARCH);
+	}
+	return (filters & ~supported) == 0;
+}
+
+static const PkSearchIndexTrigram *
+pk_search_index_find_trigram (PkSearchIndex *index, guint32 value)
+{
+	guint lo = 0;
+	guint hi = index->priv->header->n_trigrams;
+
+	while (lo < hi) {
+		guint mid = lo + (hi - lo) / 2;
+		const PkSearchIndexTrigram *trigram = &index->priv->trigrams[mid];
+		if (trigram->trigram == value)
+			return trigram;
+		if (value < trigram->trigram)
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+	return NULL;
+}
+
+/* decodes the posting list and keeps only the entries also in @candidates */
+static void
+pk_search_index_intersect (PkSearchIndex *index,
+			   const PkSearchIndexTrigram *trigram,
+			   GArray *candidates,
+			   gboolean first)
+{
+	const guint8 *p = index->priv->postings + trigram->offset;
+	const guint8 *end = p + trigram->size;
+	guint32 value = 0;
+	guint n;
+	guint in = 0;
+	guint out = 0;
+
+	for (n = 0; n < trigram->n_postings && p < end; n++) {
+		guint32 delta = 0;
+		guint shift = 0;
+
+		while (p < end && shift < 32) {
+			delta |= (guint32) (*p & 0x7f) << shift;
+			shift += 7;
+			if ((*p++ & 0x80) == 0)
+				break;
+		}
+		value = n == 0 ? delta : value + delta;
+
+		if (first) {
+			g_array_append_val (candidates, value);
+			continue;
+		}
+		while (in < candidates->len &&
+		       g_array_index (candidates, guint32, in) < value)
+			in++;
+		if (in == candidates->len)
+			break;
+		if (g_array_index (candidates, guint32, in) == value)
+			g_array_index (candidates, guint32, out++) = value;
+	}
+	if (!first)
+		g_array_set_size (candidates, out);
+}
+
+static gboolean
+pk_search_index_match_record (PkSearchIndex *index,
+			      const PkSearchIndexRecord *record,
+			      PkRoleEnum role,
+			      PkBitfield filters,
+			      gchar **needles)
+{
+	const gchar *package_id;
+	const gchar *text;
+	PkInfoEnum info = pk_search_index_get_info (index, record);
+	guint i;
+
+	/* removed since the index was written */
+	if (info == PK_INFO_ENUM_UNKNOWN)
+		return FALSE;
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_INSTALLED) &&
+	    info != PK_INFO_ENUM_INSTALLED)
+		return FALSE;
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_INSTALLED) &&
+	    info == PK_INFO_ENUM_INSTALLED)
+		return FALSE;
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_SOURCE) ||
+	    pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_SOURCE) ||
+	    pk_bitfield_contain (filters, PK_FILTER_ENUM_ARCH) ||
+	    pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_ARCH)) {
+		g_auto(GStrv) split = NULL;
+		gboolean is_source;
+		gboolean is_native;
+
+		package_id = pk_search_index_get_string (index, record->package_id);
+		split = pk_package_id_split (package_id);
+		if (split == NULL)
+			return FALSE;
+		is_source = g_strcmp0 (split[PK_PACKAGE_ID_ARCH], "source") == 0 ||
+			    g_strcmp0 (split[PK_PACKAGE_ID_ARCH], "src") == 0;
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_SOURCE) && !is_source)
+			return FALSE;
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_SOURCE) && is_source)
+			return FALSE;
+		is_native = index->priv->native_arches != NULL &&
+			    g_strv_contains ((const gchar * const *) index->priv->native_arches,
+					     split[PK_PACKAGE_ID_ARCH]);
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_ARCH) && !is_native)
+			return FALSE;
+		if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NOT_ARCH) && is_native)
+			return FALSE;
+	}
+
+	/* any term can match */
+	text = pk_search_index_get_string (index, role == PK_ROLE_ENUM_SEARCH_NAME ?
+						  record->name : record->description);
+	for (i = 0; needles[i] != NULL; i++) {
+		if (pk_search_index_strcasestr (text, needles[i]))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/* what the newest filter groups by, with the version of the record */
+static gchar *
+pk_search_index_newest_key (PkSearchIndex *index,
+			    const PkSearchIndexRecord *record,
+			    gchar **version)
+{
+	g_auto(GStrv) split = NULL;
+
+	split = pk_package_id_split (pk_search_index_get_string (index, record->package_id));
+	if (split == NULL)
+		return NULL;
+	if (version != NULL)
+		*version = g_strdup (split[PK_PACKAGE_ID_VERSION]);
+	return g_strdup_printf ("%s;%s;%i", split[PK_PACKAGE_ID_NAME],
+				split[PK_PACKAGE_ID_ARCH],
+				pk_search_index_get_info (index, record) == PK_INFO_ENUM_INSTALLED);
+}
+
+/* like the backends, keeps the newest installed and the newest available
+ * version of each name and arch */
+static void
+pk_search_index_filter_newest (PkSearchIndex *index, GArray *matches)
+{
+	guint i;
+	guint n = 0;
+	g_autoptr(GHashTable) newest = NULL;
+	g_autoptr(GHashTable) versions = NULL;
+
+	newest = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	versions = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+	for (i = 0; i < matches->len; i++) {
+		guint32 nr = g_array_index (matches, guint32, i);
+		const gchar *best;
+		gchar *version = NULL;
+		gchar *key;
+
+		key = pk_search_index_newest_key (index, &index->priv->records[nr], &version);
+		if (key == NULL)
+			continue;
+		best = g_hash_table_lookup (versions, key);
+		if (best != NULL && pk_package_sack_vercmp (version, best) <= 0) {
+			g_free (version);
+			g_free (key);
+			continue;
+		}
+		/* the key is owned by @newest, which frees it if it is already there */
+		g_hash_table_insert (versions, key, version);
+		g_hash_table_insert (newest, key, GUINT_TO_POINTER (nr));
+	}
+
+	/* in the order of the matches */
+	for (i = 0; i < matches->len; i++) {
+		guint32 nr = g_array_index (matches, guint32, i);
+		gpointer value;
+		g_autofree gchar *key = NULL;
+
+		key = pk_search_index_newest_key (index, &index->priv->records[nr], NULL);
+		if (key == NULL)
+			continue;
+		if (g_hash_table_lookup_extended (newest, key, NULL, &value) &&
+		    GPOINTER_TO_UINT (value) == nr)
+			g_array_index (matches, guint32, n++) = nr;
+	}
+	g_array_set_size (matches, n);
+}
+
+/**
+ * pk_search_index_search:
+ *
+ * Return value: (element-type PkPackage): the matching packages, or %NULL
+ * if the backend has to be asked instead
+ **/
+GPtrArray *
+pk_search_index_search (PkSearchIndex *index,
+			PkRoleEnum role,
+			PkBitfield filters,
+			gchar **values,
+			GError **error)
+{
+	gboolean full_scan = FALSE;
+	guint i;
+	g_autoptr(GArray) candidates = NULL;
+	g_autoptr(GArray) matches = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_auto(GStrv) needles = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	g_return_val_if_fail (PK_IS_SEARCH_INDEX (index), NULL);
+	g_return_val_if_fail (values != NULL, NULL);
+
+	if (!pk_search_index_can_search (index, role, filters)) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+			     "search index cannot answer %s",
+			     pk_role_enum_to_string (role));
+		return NULL;
+	}
+
+	/* a term shorter than a trigram could be anywhere */
+	needles = g_new0 (gchar *, g_strv_length (values) + 1);
+	for (i = 0; values[i] != NULL; i++) {
+		needles[i] = g_ascii_strdown (values[i], -1);
+		if (strlen (needles[i]) < 3)
+			full_scan = TRUE;
+	}
+
+	/* otherwise any term can match, so the candidates are the records
+	 * with every trigram of one of the terms */
+	candidates = g_array_new (FALSE, FALSE, sizeof (guint32));
+	for (i = 0; !full_scan && needles[i] != NULL; i++) {
+		gsize len = strlen (needles[i]);
+		gsize j;
+		g_autoptr(GArray) term = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+		for (j = 0; j + 3 <= len; j++) {
+			const PkSearchIndexTrigram *trigram;
+
+			trigram = pk_search_index_find_trigram (index,
+								pk_search_index_trigram (needles[i] + j));
+			if (trigram == NULL) {
+				g_array_set_size (term, 0);
+				break;
+			}
+			pk_search_index_intersect (index, trigram, term, j == 0);
+			if (term->len == 0)
+				break;
+		}
+		g_array_append_vals (candidates, term->data, term->len);
+	}
+	if (full_scan) {
+		g_array_set_size (candidates, index->priv->header->n_records);
+		for (i = 0; i < candidates->len; i++)
+			g_array_index (candidates, guint32, i) = i;
+	} else if (g_strv_length (needles) > 1) {
+		guint n = 0;
+
+		/* a record can have the trigrams of several terms */
+		g_array_sort (candidates, pk_search_index_sort_records_cb);
+		for (i = 0; i < candidates->len; i++) {
+			if (n > 0 && g_array_index (candidates, guint32, n - 1) ==
+				     g_array_index (candidates, guint32, i))
+				continue;
+			g_array_index (candidates, guint32, n++) = g_array_index (candidates, guint32, i);
+		}
+		g_array_set_size (candidates, n);
+	}
+
+	/* then check the candidates */
+	matches = g_array_new (FALSE, FALSE, sizeof (guint32));
+	for (i = 0; i < candidates->len; i++) {
+		guint32 nr = g_array_index (candidates, guint32, i);
+
+		if (nr >= index->priv->header->n_records)
+			continue;
+		if (!pk_search_index_match_record (index, &index->priv->records[nr],
+						   role, filters, needles))
+			continue;
+		g_array_append_val (matches, nr);
+	}
+	if (pk_bitfield_contain (filters, PK_FILTER_ENUM_NEWEST))
+		pk_search_index_filter_newest (index, matches);
+
+	array = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (i = 0; i < matches->len; i++) {
+		const PkSearchIndexRecord *record;
+		g_autoptr(PkPackage) package = NULL;
+
+		record = &index->priv->records[g_array_index (matches, guint32, i)];
+		package = pk_package_new ();
+		if (!pk_package_set_id (package,
+					pk_search_index_get_string (index, record->package_id),
+					NULL))
+			continue;
+		pk_package_set_info (package, pk_search_index_get_info (index, record));
+		pk_package_set_summary (package,
+					pk_search_index_get_string (index, record->summary));
+		g_ptr_array_add (array, g_steal_pointer (&package));
+	}
+	g_debug ("search index answered %s with %u of %u candidates in %.2fms",
+		 pk_role_enum_to_string (role), array->len, candidates->len,
+		 g_timer_elapsed (timer, NULL) * 1000);
+	return g_steal_pointer (&array);
+}
+
+static void
+pk_search_index_class_init (PkSearchIndexClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = pk_search_index_finalize;
+	g_type_class_add_private (klass, sizeof (PkSearchIndexPrivate));
+}
+
+static void
+pk_search_index_init (PkSearchIndex *index)
+{
+	index->priv = PK_SEARCH_INDEX_GET_PRIVATE (index);
+}
+
+static void
+pk_search_index_finalize (GObject *object)
+{
+	PkSearchIndex *index;
+	g_return_if_fail (PK_IS_SEARCH_INDEX (object));
+	index = PK_SEARCH_INDEX (object);
+
+	pk_search_index_unmap (index);
+	g_free (index->priv->filename);
+	g_free (index->priv->backend_name);
+	g_strfreev (index->priv->native_arches);
+
+	G_OBJECT_CLASS (pk_search_index_parent_class)->finalize (object);
+}
+
+PkSearchIndex *
+pk_search_index_new (void)
+{
+	PkSearchIndex *index;
+	index = g_object_new (PK_TYPE_SEARCH_INDEX, NULL);
+	return PK_SEARCH_INDEX (index);
+}
@@ -0,0 +1,86 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*-
+ *
+ * Copyright (C) 2026 PackageKit contributors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __PK_SEARCH_INDEX_H
+#define __PK_SEARCH_INDEX_H
+
+#include <glib-object.h>
+#include <packagekit-glib2/pk-bitfield.h>
+#include <packagekit-glib2/pk-enum.h>
+
+G_BEGIN_DECLS
+
+#define PK_TYPE_SEARCH_INDEX		(pk_search_index_get_type ())
+#define PK_SEARCH_INDEX(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), PK_TYPE_SEARCH_INDEX, PkSearchIndex))
+#define PK_SEARCH_INDEX_CLASS(k)	(G_TYPE_CHECK_CLASS_CAST((k), PK_TYPE_SEARCH_INDEX, PkSearchIndexClass))
+#define PK_IS_SEARCH_INDEX(o)		(G_TYPE_CHECK_INSTANCE_TYPE ((o), PK_TYPE_SEARCH_INDEX))
+#define PK_IS_SEARCH_INDEX_CLASS(k)	(G_TYPE_CHECK_CLASS_TYPE ((k), PK_TYPE_SEARCH_INDEX))
+#define PK_SEARCH_INDEX_GET_CLASS(o)	(G_TYPE_INSTANCE_GET_CLASS ((o), PK_TYPE_SEARCH_INDEX, PkSearchIndexClass))
+
+typedef struct PkSearchIndexPrivate PkSearchIndexPrivate;
+
+typedef struct
+{
+	 GObject		 parent;
+	 PkSearchIndexPrivate	*priv;
+} PkSearchIndex;
+
+typedef struct
+{
+	GObjectClass	parent_class;
+} PkSearchIndexClass;
+
+#ifdef G_DEFINE_AUTOPTR_CLEANUP_FUNC
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(PkSearchIndex, g_object_unref)
+#endif
+
+GType		 pk_search_index_get_type		(void);
+PkSearchIndex	*pk_search_index_new			(void);
+gboolean	 pk_search_index_load			(PkSearchIndex		*index,
+							 const gchar		*filename,
+							 const gchar		*backend_name,
+							 GError			**error);
+gboolean	 pk_search_index_is_valid		(PkSearchIndex		*index);
+void		 pk_search_index_invalidate		(PkSearchIndex		*index);
+guint		 pk_search_index_get_generation		(PkSearchIndex		*index);
+gboolean	 pk_search_index_build			(PkSearchIndex		*index,
+							 GPtrArray		*packages,
+							 GHashTable		*descriptions,
+							 GError			**error);
+const gchar	*pk_search_index_get_description	(PkSearchIndex		*index,
+							 const gchar		*package_id);
+gboolean	 pk_search_index_set_info		(PkSearchIndex		*index,
+							 const gchar		*package_id,
+							 PkInfoEnum		 info);
+void		 pk_search_index_set_native_arches	(PkSearchIndex		*index,
+							 gchar			**arches);
+gboolean	 pk_search_index_can_search		(PkSearchIndex		*index,
+							 PkRoleEnum		 role,
+							 PkBitfield		 filters);
+GPtrArray	*pk_search_index_search			(PkSearchIndex		*index,
+							 PkRoleEnum		 role,
+							 PkBitfield		 filters,
+							 gchar			**values,
+							 GError			**error);
+
+G_END_DECLS
+
+#endif /* __PK_SEARCH_INDEX_H */
@@ -25,16 +25,19 @@
 #include <glib.h>
 #include <glib-object.h>
 #include <glib/gstdio.h>
+#include <string.h>
 
 #include "pk-backend.h"
 #include "pk-backend-spawn.h"
 #include "pk-dbus.h"
 #include "pk-engine.h"
+#include "pk-metrics.h"
 #include "pk-spawn.h"
 #include "pk-transaction-db.h"
 #include "pk-transaction.h"
 #include "pk-transaction-private.h"
 #include "pk-scheduler.h"
+#include "pk-search-index.h"
 
 
 #define PK_TRANSACTION_ERROR_INPUT_INVALID	14
@@ -151,6 +154,54 @@ pk_test_backend_packages_cb (PkBackend *backend, GPtrArray *package_array, gpoin
 	}
 }
 
+static void
+pk_test_backend_job_details_cb (PkBackendJob *job, PkDetails *item, guint *count)
+{
+	(*count)++;
+}
+
+static void
+pk_test_backend_job_details_list_cb (PkBackendJob *job, GPtrArray *details, guint *count)
+{
+	*count += details->len;
+}
+
+static void
+pk_test_backend_job_lists_func (void)
+{
+	guint singular = 0;
+	guint plural = 0;
+	g_autoptr(GKeyFile) conf = g_key_file_new ();
+	g_autoptr(PkBackendJob) job = pk_backend_job_new (conf);
+	g_autoptr(GPtrArray) details = g_ptr_array_new_with_free_func (g_object_unref);
+
+	for (guint i = 0; i < 3; i++) {
+		g_autofree gchar *package_id = g_strdup_printf ("pkg%u;1.0;noarch;fedora", i);
+		PkDetails *item = pk_details_new ();
+		g_object_set (item, "package-id", package_id, NULL);
+		g_ptr_array_add (details, item);
+	}
+
+	/* without a list consumer every item goes to the singular vfunc */
+	pk_backend_job_set_vfunc (job,
+				  PK_BACKEND_SIGNAL_DETAILS,
+				  PK_BACKEND_JOB_VFUNC (pk_test_backend_job_details_cb),
+				  &singular);
+	pk_backend_job_details_list (job, details);
+	while (g_main_context_iteration (NULL, FALSE));
+	g_assert_cmpint (singular, ==, 3);
+
+	/* with one, they arrive together */
+	pk_backend_job_set_vfunc (job,
+				  PK_BACKEND_SIGNAL_DETAILS_LIST,
+				  PK_BACKEND_JOB_VFUNC (pk_test_backend_job_details_list_cb),
+				  &plural);
+	pk_backend_job_details_list (job, details);
+	while (g_main_context_iteration (NULL, FALSE));
+	g_assert_cmpint (singular, ==, 3);
+	g_assert_cmpint (plural, ==, 3);
+}
+
 static void
 pk_test_backend_func (void)
 {
@@ -754,6 +805,100 @@ pk_test_transaction_func (void)
 	g_dbus_node_info_unref (introspection);
 }
 
+static void
+pk_test_transaction_eta_func (void)
+{
+	PkTransactionEta eta = { 0 };
+
+	/* the first sample only sets the baseline */
+	g_assert_cmpuint (pk_transaction_eta_update (&eta, 1 * G_USEC_PER_SEC, 0, 0, 0), ==, 0);
+
+	/* 10% per second */
+	g_assert_cmpuint (pk_transaction_eta_update (&eta, 2 * G_USEC_PER_SEC, 10, 0, 0), ==, 9);
+	g_assert_cmpuint (pk_transaction_eta_update (&eta, 3 * G_USEC_PER_SEC, 20, 0, 0), ==, 8);
+
+	/* a stall slows the estimate down rather than making it infinite */
+	g_assert_cmpuint (pk_transaction_eta_update (&eta, 4 * G_USEC_PER_SEC, 20, 0, 0), ==, 11);
+
+	/* an unknown percentage resets everything */
+	g_assert_cmpuint (pk_transaction_eta_update (&eta, 5 * G_USEC_PER_SEC, PK_BACKEND_PERCENTAGE_INVALID, 0, 0), ==, 0);
+	g_assert_cmpuint (eta.samples, ==, 0);
+
+	/* downloads are estimated from the bytes left, 200 bytes per second */
+	g_assert_cmpuint (pk_transaction_eta_update (&eta, 6 * G_USEC_PER_SEC, 0, 1000, 0), ==, 0);
+	g_assert_cmpuint (pk_transaction_eta_update (&eta, 7 * G_USEC_PER_SEC, 5, 800, 0), ==, 4);
+
+	/* a backend speed of 400 bytes per second is blended in */
+	g_assert_cmpuint (pk_transaction_eta_update (&eta, 8 * G_USEC_PER_SEC, 10, 600, 3200), ==, 2);
+
+	/* going backwards starts a new phase */
+	g_assert_cmpuint (pk_transaction_eta_update (&eta, 9 * G_USEC_PER_SEC, 0, 0, 0), ==, 0);
+}
+
+static void
+pk_test_metrics_func (void)
+{
+	g_autoptr(PkMetrics) metrics = pk_metrics_new ();
+	g_autoptr(PkMetrics) metrics2 = pk_metrics_new ();
+	g_autoptr(GVariant) value = NULL;
+	g_autoptr(GVariant) roles = NULL;
+	g_autoptr(GVariant) role = NULL;
+	g_autoptr(GVariant) run_time = NULL;
+	g_autoptr(GVariant) db_write = NULL;
+	g_autofree gchar *text = NULL;
+	PkMetricsTransaction item = {
+		.queued = 1 * G_USEC_PER_SEC,
+		.started = 3 * G_USEC_PER_SEC,
+		.first_emission = 3 * G_USEC_PER_SEC + 2000,
+		.finished = 10 * G_USEC_PER_SEC,
+		.signals = 12,
+		.bytes = 1024,
+	};
+	guint64 count, requests;
+	gdouble sum;
+
+	/* shared by everything in the daemon */
+	g_assert_true (metrics == metrics2);
+
+	pk_metrics_add_transaction (metrics, PK_ROLE_ENUM_REPAIR_SYSTEM, PK_EXIT_ENUM_SUCCESS, &item);
+	pk_metrics_add_cache_lookup (metrics, "search-index", TRUE);
+	pk_metrics_add_cache_lookup (metrics, "search-index", FALSE);
+	pk_metrics_add_cache_lookup (metrics, "search-index", TRUE);
+	pk_metrics_add_db_write (metrics, 300);
+
+	value = pk_metrics_to_variant (metrics);
+	g_variant_ref_sink (value);
+	roles = g_variant_lookup_value (value, "roles", G_VARIANT_TYPE ("a{sa{sv}}"));
+	g_assert_nonnull (roles);
+	role = g_variant_lookup_value (roles, "repair-system", G_VARIANT_TYPE ("a{sv}"));
+	g_assert_nonnull (role);
+	g_assert_true (g_variant_lookup (role, "requests", "t", &requests));
+	g_assert_cmpuint (requests, ==, 1);
+
+	/* 7 seconds falls in the (5, 10] bucket */
+	run_time = g_variant_lookup_value (role, "run-time", G_VARIANT_TYPE ("(tdat)"));
+	g_assert_nonnull (run_time);
+	g_variant_get (run_time, "(tdat)", &count, &sum, NULL);
+	g_assert_cmpuint (count, ==, 1);
+	g_assert_cmpfloat (sum, ==, 7);
+
+	/* other tests may have written to the database too */
+	db_write = g_variant_lookup_value (value, "db-write", G_VARIANT_TYPE ("(tdat)"));
+	g_assert_nonnull (db_write);
+	g_variant_get (db_write, "(tdat)", &count, &sum, NULL);
+	g_assert_cmpuint (count, >=, 1);
+
+	text = pk_metrics_to_text (metrics);
+	g_assert_nonnull (strstr (text, "packagekit_transactions_total{role=\"repair-system\",exit=\"success\"} 1\n"));
+	g_assert_nonnull (strstr (text, "packagekit_transaction_queue_wait_seconds_bucket{role=\"repair-system\",le=\"1\"} 0\n"));
+	g_assert_nonnull (strstr (text, "packagekit_transaction_queue_wait_seconds_bucket{role=\"repair-system\",le=\"5\"} 1\n"));
+	g_assert_nonnull (strstr (text, "packagekit_transaction_first_emission_seconds_bucket{role=\"repair-system\",le=\"0.005\"} 1\n"));
+	g_assert_nonnull (strstr (text, "packagekit_transaction_signal_bytes_total{role=\"repair-system\"} 1024\n"));
+	g_assert_nonnull (strstr (text, "packagekit_cache_lookups_total{cache=\"search-index\",result=\"hit\"} 2\n"));
+	g_assert_nonnull (strstr (text, "packagekit_db_write_seconds_bucket{le=\"+Inf\"} "));
+	g_assert_nonnull (strstr (text, "packagekit_peak_rss_bytes "));
+}
+
 static void
 pk_test_transaction_db_func (void)
 {
@@ -765,6 +910,11 @@ pk_test_transaction_db_func (void)
 	g_autoptr(PkTransactionDb) db = NULL;
 	g_autofree gchar *proxy_http = NULL;
 	g_autofree gchar *proxy_ftp = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	PkPackage *pkg;
+	GVariant *history;
+	GVariant *entry;
+	const gchar *version;
 
 	/* remove the self check file */
 #if PK_BUILD_LOCAL
@@ -880,10 +1030,426 @@ pk_test_transaction_db_func (void)
 	g_assert_true (ret);
 	g_assert_cmpstr (proxy_http, ==, "127.0.0.1:80");
 	g_assert_cmpstr (proxy_ftp, ==, "127.0.0.1:21");
+
+	/* record some package history */
+	packages = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	pkg = pk_package_new ();
+	ret = pk_package_set_id (pkg, "colord;1.0-1;i386;fedora", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	pk_package_set_info (pkg, PK_INFO_ENUM_INSTALLING);
+	g_ptr_array_add (packages, pkg);
+	pkg = pk_package_new ();
+	ret = pk_package_set_id (pkg, "colord;1.0-1;x86_64;fedora", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	pk_package_set_info (pkg, PK_INFO_ENUM_INSTALLING);
+	g_ptr_array_add (packages, pkg);
+	pkg = pk_package_new ();
+	ret = pk_package_set_id (pkg, "lcms2;2.9-1;x86_64;fedora", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	pk_package_set_info (pkg, PK_INFO_ENUM_FINISHED);
+	g_ptr_array_add (packages, pkg);
+	tid = pk_transaction_db_generate_id (db);
+	ret = pk_transaction_db_add (db, tid);
+	g_assert_true (ret);
+	ret = pk_transaction_db_add_package_history (db, tid, 500, packages);
+	g_assert_true (ret);
+	g_free (tid);
+
+	/* multiarch is de-duplicated and the finished package skipped */
+	history = pk_transaction_db_get_package_history (db, "colord", 0);
+	g_variant_ref_sink (history);
+	g_assert_cmpint (g_variant_n_children (history), ==, 1);
+	entry = g_variant_get_child_value (history, 0);
+	ret = g_variant_lookup (entry, "version", "&s", &version);
+	g_assert_true (ret);
+	g_assert_cmpstr (version, ==, "1.0-1");
+	ret = g_variant_lookup (entry, "user-id", "u", &value);
+	g_assert_true (ret);
+	g_assert_cmpint (value, ==, 500);
+	g_variant_unref (entry);
+	g_variant_unref (history);
+
+	history = pk_transaction_db_get_package_history (db, "lcms2", 0);
+	g_variant_ref_sink (history);
+	g_assert_cmpint (g_variant_n_children (history), ==, 0);
+	g_variant_unref (history);
 }
 
 static PkTransactionDb *db = NULL;
 
+static PkPackage *
+pk_test_search_index_package_new (PkInfoEnum info, const gchar *package_id, const gchar *summary)
+{
+	PkPackage *item = pk_package_new ();
+	g_assert_true (pk_package_set_id (item, package_id, NULL));
+	pk_package_set_info (item, info);
+	pk_package_set_summary (item, summary);
+	return item;
+}
+
+static void
+pk_test_search_index_func (void)
+{
+	gboolean ret;
+	gchar *values_power[] = { "POWER", NULL };
+	gchar *values_laptop[] = { "laptop", NULL };
+	gchar *values_two[] = { "manager", "top", NULL };
+	gchar *values_details[] = { "BATTERY", "nosuchpackage", NULL };
+	gchar *values_summary[] = { "consumption", NULL };
+	gchar *values_short[] = { "gn", NULL };
+	gchar *values_none[] = { "nosuchpackage", NULL };
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GHashTable) descriptions = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(PkSearchIndex) index = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autofree gchar *filename = NULL;
+
+	tmpdir = g_dir_make_tmp ("pk-self-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	filename = g_build_filename (tmpdir, "search-index", NULL);
+
+	/* nothing on disk yet */
+	index = pk_search_index_new ();
+	ret = pk_search_index_load (index, filename, "dummy", &error);
+	g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+	g_assert_false (ret);
+	g_clear_error (&error);
+	g_assert_false (pk_search_index_is_valid (index));
+
+	packages = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_ptr_array_add (packages, pk_test_search_index_package_new (PK_INFO_ENUM_INSTALLED,
+			 "gnome-power-manager;2.6.19;i386;installed", "GNOME Power Manager"));
+	g_ptr_array_add (packages, pk_test_search_index_package_new (PK_INFO_ENUM_AVAILABLE,
+			 "kpowersave;0.7.3;i386;fedora", "Power management for KDE"));
+	g_ptr_array_add (packages, pk_test_search_index_package_new (PK_INFO_ENUM_AVAILABLE,
+			 "powertop;2.15;i386;fedora", "Power consumption monitor"));
+	g_ptr_array_add (packages, pk_test_search_index_package_new (PK_INFO_ENUM_AVAILABLE,
+			 "glib2;2.80.0;source;fedora", "Low level core library"));
+	descriptions = g_hash_table_new (g_str_hash, g_str_equal);
+	g_hash_table_insert (descriptions, "powertop;2.15;i386;fedora",
+			     "Finds what drains the battery of your laptop.");
+
+	ret = pk_search_index_build (index, packages, descriptions, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_true (pk_search_index_is_valid (index));
+	g_assert_cmpstr (pk_search_index_get_description (index, "powertop;2.15;i386;fedora"), ==,
+			 "Finds what drains the battery of your laptop.");
+	g_assert_null (pk_search_index_get_description (index, "kpowersave;0.7.3;i386;fedora"));
+
+	/* names are matched case-insensitively */
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+					pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					values_power, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 3);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* the description only matches for details */
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+					pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					values_laptop, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 0);
+	g_clear_pointer (&array, g_ptr_array_unref);
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_DETAILS,
+					pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					values_laptop, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 1);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 0)), ==,
+			 "powertop;2.15;i386;fedora");
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* like the backend, any of the terms can match */
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+					pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					values_two, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 2);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 0)), ==,
+			 "gnome-power-manager;2.6.19;i386;installed");
+	g_assert_cmpint (pk_package_get_info (g_ptr_array_index (array, 0)), ==,
+			 PK_INFO_ENUM_INSTALLED);
+	g_assert_cmpstr (pk_package_get_summary (g_ptr_array_index (array, 0)), ==,
+			 "GNOME Power Manager");
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 1)), ==,
+			 "powertop;2.15;i386;fedora");
+	g_clear_pointer (&array, g_ptr_array_unref);
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_DETAILS,
+					pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					values_details, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 1);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* and details only match the description */
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_DETAILS,
+					pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					values_summary, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 0);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* terms shorter than a trigram are still found */
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+					pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					values_short, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 1);
+	g_clear_pointer (&array, g_ptr_array_unref);
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_DETAILS,
+					pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					values_none, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 0);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* filters the index can evaluate */
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+					pk_bitfield_value (PK_FILTER_ENUM_NOT_INSTALLED),
+					values_power, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 2);
+	g_clear_pointer (&array, g_ptr_array_unref);
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_DETAILS,
+					pk_bitfield_value (PK_FILTER_ENUM_SOURCE),
+					values_short, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 0);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* and ones it has to leave to the backend */
+	g_assert_false (pk_search_index_can_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+						    pk_bitfield_value (PK_FILTER_ENUM_APPLICATION)));
+	g_assert_false (pk_search_index_can_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+						    pk_bitfield_value (PK_FILTER_ENUM_ARCH)));
+	g_assert_false (pk_search_index_can_search (index, PK_ROLE_ENUM_SEARCH_FILE,
+						    pk_bitfield_value (PK_FILTER_ENUM_NONE)));
+
+	/* packages installed and removed outside of PackageKit */
+	ret = pk_search_index_set_info (index, "powertop;2.15;i386;installed",
+					PK_INFO_ENUM_INSTALLED);
+	g_assert_true (ret);
+	ret = pk_search_index_set_info (index, "gnome-power-manager;2.6.19;i386;installed",
+					PK_INFO_ENUM_AVAILABLE);
+	g_assert_true (ret);
+	ret = pk_search_index_set_info (index, "powertop;2.16;i386;installed",
+					PK_INFO_ENUM_INSTALLED);
+	g_assert_false (ret);
+	g_assert_true (pk_search_index_is_valid (index));
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+					pk_bitfield_value (PK_FILTER_ENUM_INSTALLED),
+					values_power, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 1);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 0)), ==,
+			 "powertop;2.15;i386;fedora");
+	g_assert_cmpint (pk_package_get_info (g_ptr_array_index (array, 0)), ==,
+			 PK_INFO_ENUM_INSTALLED);
+	g_clear_pointer (&array, g_ptr_array_unref);
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+					pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					values_power, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 2);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* the file is reused by the same backend only */
+	g_clear_object (&index);
+	index = pk_search_index_new ();
+	ret = pk_search_index_load (index, filename, "dummy", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_DETAILS,
+					pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					values_laptop, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 1);
+	g_clear_pointer (&array, g_ptr_array_unref);
+	g_clear_object (&index);
+	index = pk_search_index_new ();
+	ret = pk_search_index_load (index, filename, "aptcc", &error);
+	g_assert_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL);
+	g_assert_false (ret);
+	g_clear_error (&error);
+
+	/* nothing is answered once invalidated */
+	ret = pk_search_index_load (index, filename, "dummy", &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	pk_search_index_invalidate (index);
+	g_assert_false (pk_search_index_is_valid (index));
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+					pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					values_power, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED);
+	g_assert_null (array);
+
+	g_unlink (filename);
+	g_rmdir (tmpdir);
+}
+
+static void
+pk_test_search_index_filters_func (void)
+{
+	gboolean ret;
+	gchar *arches[] = { "x86_64", "noarch", NULL };
+	gchar *values_empty[] = { "", NULL };
+	gchar *values_power[] = { "power", NULL };
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(PkSearchIndex) index = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autofree gchar *filename = NULL;
+
+	tmpdir = g_dir_make_tmp ("pk-self-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	filename = g_build_filename (tmpdir, "search-index", NULL);
+
+	index = pk_search_index_new ();
+	pk_search_index_load (index, filename, "dummy", NULL);
+	packages = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_ptr_array_add (packages, pk_test_search_index_package_new (PK_INFO_ENUM_INSTALLED,
+			 "powertop;2.9-1;x86_64;installed", "Power consumption monitor"));
+	g_ptr_array_add (packages, pk_test_search_index_package_new (PK_INFO_ENUM_AVAILABLE,
+			 "powertop;2.10-1;x86_64;fedora", "Power consumption monitor"));
+	g_ptr_array_add (packages, pk_test_search_index_package_new (PK_INFO_ENUM_AVAILABLE,
+			 "powertop;2.9-2;x86_64;fedora", "Power consumption monitor"));
+	g_ptr_array_add (packages, pk_test_search_index_package_new (PK_INFO_ENUM_AVAILABLE,
+			 "powertop;2.10-1;i686;fedora", "Power consumption monitor"));
+	g_ptr_array_add (packages, pk_test_search_index_package_new (PK_INFO_ENUM_AVAILABLE,
+			 "power-profiles;1:0.1-1;noarch;fedora", "Power profiles"));
+	ret = pk_search_index_build (index, packages, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* the filters GNOME Software and pkcon send */
+	g_assert_true (pk_search_index_can_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+						   pk_bitfield_value (PK_FILTER_ENUM_NEWEST)));
+	g_assert_false (pk_search_index_can_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+						    pk_bitfield_from_enums (PK_FILTER_ENUM_NEWEST,
+									    PK_FILTER_ENUM_ARCH, -1)));
+	pk_search_index_set_native_arches (index, arches);
+	g_assert_true (pk_search_index_can_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+						   pk_bitfield_from_enums (PK_FILTER_ENUM_NEWEST,
+									   PK_FILTER_ENUM_ARCH, -1)));
+
+	/* the newest installed and available version of each arch */
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+					pk_bitfield_value (PK_FILTER_ENUM_NEWEST),
+					values_power, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 4);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 0)), ==,
+			 "power-profiles;1:0.1-1;noarch;fedora");
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 1)), ==,
+			 "powertop;2.10-1;i686;fedora");
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 2)), ==,
+			 "powertop;2.10-1;x86_64;fedora");
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 3)), ==,
+			 "powertop;2.9-1;x86_64;installed");
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* only the native arches */
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+					pk_bitfield_from_enums (PK_FILTER_ENUM_NEWEST,
+								PK_FILTER_ENUM_ARCH,
+								PK_FILTER_ENUM_NOT_INSTALLED, -1),
+					values_power, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 2);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 0)), ==,
+			 "power-profiles;1:0.1-1;noarch;fedora");
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 1)), ==,
+			 "powertop;2.10-1;x86_64;fedora");
+	g_clear_pointer (&array, g_ptr_array_unref);
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+					pk_bitfield_value (PK_FILTER_ENUM_NOT_ARCH),
+					values_power, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 1);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* an empty term matches everything, like in the backend */
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+					pk_bitfield_value (PK_FILTER_ENUM_NONE),
+					values_empty, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 5);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	g_unlink (filename);
+	g_rmdir (tmpdir);
+}
+
+static void
+pk_test_search_index_set_info_func (void)
+{
+	gboolean ret;
+	gchar *values_top[] = { "top", NULL };
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+	g_autoptr(PkSearchIndex) index = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autofree gchar *filename = NULL;
+
+	tmpdir = g_dir_make_tmp ("pk-self-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	filename = g_build_filename (tmpdir, "search-index", NULL);
+
+	index = pk_search_index_new ();
+	pk_search_index_load (index, filename, "dummy", NULL);
+	packages = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_ptr_array_add (packages, pk_test_search_index_package_new (PK_INFO_ENUM_AVAILABLE,
+			 "powertop;2.15-1;x86_64;fedora", "Power consumption monitor"));
+	g_ptr_array_add (packages, pk_test_search_index_package_new (PK_INFO_ENUM_AVAILABLE,
+			 "powertop;2.15-1;x86_64;updates", "Power consumption monitor"));
+	g_ptr_array_add (packages, pk_test_search_index_package_new (PK_INFO_ENUM_AVAILABLE,
+			 "htop;3.3-1;x86_64;fedora", "Interactive process viewer"));
+	ret = pk_search_index_build (index, packages, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* the same package in two repos is only found with the repo */
+	g_assert_false (pk_search_index_set_info (index, "powertop;2.15-1;x86_64;installed",
+						  PK_INFO_ENUM_INSTALLED));
+	g_assert_true (pk_search_index_set_info (index, "powertop;2.15-1;x86_64;installed:updates",
+						 PK_INFO_ENUM_INSTALLED));
+	g_assert_true (pk_search_index_set_info (index, "htop;3.3-1;x86_64;installed",
+						 PK_INFO_ENUM_INSTALLED));
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+					pk_bitfield_value (PK_FILTER_ENUM_INSTALLED),
+					values_top, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 2);
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 0)), ==,
+			 "htop;3.3-1;x86_64;fedora");
+	g_assert_cmpstr (pk_package_get_id (g_ptr_array_index (array, 1)), ==,
+			 "powertop;2.15-1;x86_64;updates");
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	/* and removed from whichever repo it came */
+	g_assert_true (pk_search_index_set_info (index, "powertop;2.15-1;x86_64;installed",
+						 PK_INFO_ENUM_AVAILABLE));
+	array = pk_search_index_search (index, PK_ROLE_ENUM_SEARCH_NAME,
+					pk_bitfield_value (PK_FILTER_ENUM_NOT_INSTALLED),
+					values_top, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (array->len, ==, 2);
+	g_clear_pointer (&array, g_ptr_array_unref);
+
+	g_unlink (filename);
+	g_rmdir (tmpdir);
+}
+
 static void
 pk_test_scheduler_finished_cb (PkTransaction *transaction, const gchar *exit_text, guint time, gpointer user_data)
 {
@@ -1443,10 +2009,16 @@ main (int argc, char **argv)
 	g_test_add_func ("/packagekit/spawn", pk_test_spawn_func);
 	g_test_add_func ("/packagekit/scheduler", pk_test_scheduler_func);
 	g_test_add_func ("/packagekit/scheduler-parallel", pk_test_scheduler_parallel_func);
+	g_test_add_func ("/packagekit/transaction-eta", pk_test_transaction_eta_func);
+	g_test_add_func ("/packagekit/metrics", pk_test_metrics_func);
 	g_test_add_func ("/packagekit/transaction-db", pk_test_transaction_db_func);
+	g_test_add_func ("/packagekit/search-index", pk_test_search_index_func);
+	g_test_add_func ("/packagekit/search-index/filters", pk_test_search_index_filters_func);
+	g_test_add_func ("/packagekit/search-index/set-info", pk_test_search_index_set_info_func);
 
 	/* backend stuff */
 	g_test_add_func ("/packagekit/backend", pk_test_backend_func);
+	g_test_add_func ("/packagekit/backend-job-lists", pk_test_backend_job_lists_func);
 	g_test_add_func ("/packagekit/backend_spawn", pk_test_backend_spawn_func);
 
 	return g_test_run ();
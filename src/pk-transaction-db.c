@@ -39,7 +39,9 @@
 #include <packagekit-glib2/pk-enum.h>
 #include <packagekit-glib2/pk-results.h>
 #include <packagekit-glib2/pk-common.h>
+#include <packagekit-glib2/pk-package.h>
 
+#include "pk-metrics.h"
 #include "pk-shared.h"
 
 #include "pk-transaction-db.h"
@@ -54,6 +56,7 @@ struct PkTransactionDbPrivate
 {
 	gboolean		 loaded;
 	sqlite3			*db;
+	PkMetrics		*metrics;
 	guint			 job_count;
 	guint			 database_save_id;
 };
@@ -132,12 +135,14 @@ static gboolean
 pk_transaction_db_sql_statement (PkTransactionDb *tdb, const gchar *sql)
 {
 	gchar *error_msg = NULL;
+	gint64 start = g_get_monotonic_time ();
 	gint rc;
 
 	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
 	g_return_val_if_fail (tdb->priv->db != NULL, FALSE);
 
 	rc = sqlite3_exec (tdb->priv->db, sql, NULL, tdb, &error_msg);
+	pk_metrics_add_db_write (tdb->priv->metrics, g_get_monotonic_time () - start);
 	if (rc != SQLITE_OK) {
 		g_warning ("SQL error: %s", error_msg);
 		sqlite3_free (error_msg);
@@ -309,11 +314,14 @@ pk_transaction_db_prepare (PkTransactionDb *tdb, const gchar *sql, sqlite3_stmt
 }
 
 static gboolean
-pk_transaction_db_step (sqlite3 *db, sqlite3_stmt *statement)
+pk_transaction_db_step (PkTransactionDb *tdb, sqlite3_stmt *statement)
 {
+	sqlite3 *db = tdb->priv->db;
+	gint64 start = g_get_monotonic_time ();
 	gint rc = 0;
 
 	rc = sqlite3_step (statement);
+	pk_metrics_add_db_write (tdb->priv->metrics, g_get_monotonic_time () - start);
 
 	if (rc != SQLITE_OK && rc != SQLITE_DONE) {
 		g_warning ("SQL error: %d: %s", rc, sqlite3_errmsg (db));
@@ -348,7 +356,7 @@ pk_transaction_db_set_strings (PkTransactionDb *tdb, const gchar *sql, const gch
 		return FALSE;
 	}
 
-	return pk_transaction_db_step (tdb->priv->db, statement);
+	return pk_transaction_db_step (tdb, statement);
 }
 
 gboolean
@@ -398,7 +406,7 @@ pk_transaction_db_set_uid (PkTransactionDb *tdb, const gchar *tid, guint uid)
 		return FALSE;
 	}
 
-	return pk_transaction_db_step (tdb->priv->db, statement);
+	return pk_transaction_db_step (tdb, statement);
 }
 
 gboolean
@@ -448,7 +456,161 @@ pk_transaction_db_set_finished (PkTransactionDb *tdb, const gchar *tid, gboolean
 		return FALSE;
 	}
 
-	return pk_transaction_db_step (tdb->priv->db, statement);
+	return pk_transaction_db_step (tdb, statement);
+}
+
+static gboolean
+pk_transaction_db_history_is_interesting (PkInfoEnum info)
+{
+	return info == PK_INFO_ENUM_INSTALLING ||
+	       info == PK_INFO_ENUM_REMOVING ||
+	       info == PK_INFO_ENUM_UPDATING;
+}
+
+static gint64
+pk_transaction_db_timespec_to_timestamp (const gchar *timespec)
+{
+	gint64 timestamp;
+	g_autoptr(GDateTime) datetime = NULL;
+
+	if (timespec == NULL)
+		return 0;
+	datetime = pk_iso8601_to_datetime (timespec);
+	if (datetime == NULL)
+		return 0;
+	timestamp = g_date_time_to_unix (datetime);
+	return timestamp;
+}
+
+static gboolean
+pk_transaction_db_insert_history (PkTransactionDb *tdb,
+				  sqlite3_stmt *statement,
+				  const gchar *tid,
+				  gint64 timestamp,
+				  guint uid,
+				  PkPackage *package)
+{
+	gboolean ret;
+
+	sqlite3_reset (statement);
+	sqlite3_bind_text (statement, 1, tid, -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 2, pk_package_get_name (package), -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 3, pk_info_enum_to_string (pk_package_get_info (package)), -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 4, pk_package_get_version (package), -1, SQLITE_STATIC);
+	sqlite3_bind_text (statement, 5, pk_package_get_data (package), -1, SQLITE_STATIC);
+	sqlite3_bind_int64 (statement, 6, timestamp);
+	sqlite3_bind_int (statement, 7, uid);
+	ret = pk_transaction_db_step (tdb, statement);
+	sqlite3_clear_bindings (statement);
+	return ret;
+}
+
+#define PK_TRANSACTION_DB_INSERT_HISTORY_SQL \
+	"INSERT OR IGNORE INTO package_history " \
+	"(transaction_id, package_name, info, version, source, timestamp, uid) " \
+	"VALUES (?1, ?2, ?3, ?4, ?5, ?6, ?7)"
+
+/*
+ * Records the packages a successful transaction installed, removed or
+ * updated, using the start time of the transaction as the timestamp.
+ * Multiarch duplicates of the same name and time are only stored once.
+ */
+gboolean
+pk_transaction_db_add_package_history (PkTransactionDb *tdb,
+				       const gchar *tid,
+				       guint uid,
+				       GPtrArray *packages)
+{
+	gint64 timestamp;
+	gboolean ret = TRUE;
+	g_autoptr(sqlite3_stmt) statement = NULL;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), FALSE);
+	g_return_val_if_fail (tdb->priv->db != NULL, FALSE);
+	g_return_val_if_fail (tid != NULL, FALSE);
+	g_return_val_if_fail (packages != NULL, FALSE);
+
+	/* use the same clock as the transactions table */
+	if (!pk_transaction_db_prepare (tdb, "SELECT timespec FROM transactions WHERE transaction_id = ?1", &statement))
+		return FALSE;
+	sqlite3_bind_text (statement, 1, tid, -1, SQLITE_STATIC);
+	if (sqlite3_step (statement) != SQLITE_ROW) {
+		g_warning ("no transaction %s to add history to", tid);
+		return FALSE;
+	}
+	timestamp = pk_transaction_db_timespec_to_timestamp ((const gchar *) sqlite3_column_text (statement, 0));
+	g_clear_pointer (&statement, sqlite3_finalize);
+
+	/* transactions without a timestamp are not interesting */
+	if (timestamp == 0)
+		return TRUE;
+
+	if (!pk_transaction_db_prepare (tdb, PK_TRANSACTION_DB_INSERT_HISTORY_SQL, &statement))
+		return FALSE;
+
+	pk_transaction_db_sql_statement (tdb, "BEGIN TRANSACTION");
+	for (guint i = 0; i < packages->len; i++) {
+		PkPackage *package = g_ptr_array_index (packages, i);
+		if (!pk_transaction_db_history_is_interesting (pk_package_get_info (package)))
+			continue;
+		if (!pk_transaction_db_insert_history (tdb, statement, tid, timestamp, uid, package)) {
+			ret = FALSE;
+			break;
+		}
+	}
+	pk_transaction_db_sql_statement (tdb, "COMMIT");
+	return ret;
+}
+
+/*
+ * Returns the history of one package name as a floating aa{sv}, oldest
+ * first, as used by GetPackageHistory. If @limit is non-zero only the most
+ * recent @limit entries are returned.
+ */
+GVariant *
+pk_transaction_db_get_package_history (PkTransactionDb *tdb,
+				       const gchar *package_name,
+				       guint limit)
+{
+	GVariantBuilder builder;
+	g_autoptr(sqlite3_stmt) statement = NULL;
+
+	g_return_val_if_fail (PK_IS_TRANSACTION_DB (tdb), NULL);
+	g_return_val_if_fail (tdb->priv->db != NULL, NULL);
+	g_return_val_if_fail (package_name != NULL, NULL);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+
+	/* newest first to apply the limit, then back into time order */
+	if (!pk_transaction_db_prepare (tdb,
+					"SELECT info, version, source, timestamp, uid FROM "
+					"(SELECT * FROM package_history WHERE package_name = ?1 "
+					"ORDER BY timestamp DESC LIMIT ?2) ORDER BY timestamp ASC",
+					&statement))
+		return g_variant_builder_end (&builder);
+	sqlite3_bind_text (statement, 1, package_name, -1, SQLITE_STATIC);
+	sqlite3_bind_int64 (statement, 2, limit > 0 ? (gint64) limit : -1);
+
+	while (sqlite3_step (statement) == SQLITE_ROW) {
+		const gchar *source = (const gchar *) sqlite3_column_text (statement, 2);
+		const gchar *version = (const gchar *) sqlite3_column_text (statement, 1);
+		const gchar *info = (const gchar *) sqlite3_column_text (statement, 0);
+
+		g_variant_builder_open (&builder, G_VARIANT_TYPE ("a{sv}"));
+		g_variant_builder_add (&builder, "{sv}", "info",
+				       g_variant_new_uint32 (pk_info_enum_from_string (info)));
+		g_variant_builder_add (&builder, "{sv}", "source",
+				       g_variant_new_string (source != NULL ? source : ""));
+		g_variant_builder_add (&builder, "{sv}", "version",
+				       g_variant_new_string (version != NULL ? version : ""));
+		g_variant_builder_add (&builder, "{sv}", "timestamp",
+				       g_variant_new_uint64 (sqlite3_column_int64 (statement, 3)));
+		g_variant_builder_add (&builder, "{sv}", "user-id",
+				       g_variant_new_uint32 (sqlite3_column_int (statement, 4)));
+		g_variant_builder_close (&builder);
+	}
+
+	return g_variant_builder_end (&builder);
 }
 
 gboolean
@@ -474,6 +636,8 @@ pk_transaction_db_empty (PkTransactionDb *tdb)
 
 	statement = "TRUNCATE TABLE transactions;";
 	sqlite3_exec (tdb->priv->db, statement, NULL, NULL, NULL);
+	statement = "DELETE FROM package_history;";
+	sqlite3_exec (tdb->priv->db, statement, NULL, NULL, NULL);
 	return TRUE;
 }
 
@@ -874,6 +1038,59 @@ pk_transaction_db_execute (PkTransactionDb *tdb,
 	return ret;
 }
 
+/* fill package_history from the data column of older databases */
+static gboolean
+pk_transaction_db_migrate_package_history (PkTransactionDb *tdb, GError **error)
+{
+	guint cnt = 0;
+	g_autoptr(PkPackage) package = pk_package_new ();
+	g_autoptr(sqlite3_stmt) insert = NULL;
+	g_autoptr(sqlite3_stmt) select = NULL;
+
+	if (!pk_transaction_db_prepare (tdb,
+					"SELECT transaction_id, timespec, uid, data FROM transactions "
+					"WHERE succeeded = 1 AND data IS NOT NULL ORDER BY timespec ASC",
+					&select) ||
+	    !pk_transaction_db_prepare (tdb, PK_TRANSACTION_DB_INSERT_HISTORY_SQL, &insert)) {
+		g_set_error (error, 1, 0,
+			     "failed to prepare history migration: %s",
+			     sqlite3_errmsg (tdb->priv->db));
+		return FALSE;
+	}
+
+	if (!pk_transaction_db_execute (tdb, "BEGIN TRANSACTION", error))
+		return FALSE;
+	while (sqlite3_step (select) == SQLITE_ROW) {
+		const gchar *tid = (const gchar *) sqlite3_column_text (select, 0);
+		guint uid = sqlite3_column_int (select, 2);
+		gint64 timestamp;
+		g_auto(GStrv) package_lines = NULL;
+
+		timestamp = pk_transaction_db_timespec_to_timestamp ((const gchar *) sqlite3_column_text (select, 1));
+		if (timestamp == 0)
+			continue;
+
+		package_lines = g_strsplit ((const gchar *) sqlite3_column_text (select, 3), "\n", -1);
+		for (guint i = 0; package_lines[i] != NULL; i++) {
+			g_autoptr(GError) error_local = NULL;
+			if (!pk_package_parse (package, package_lines[i], &error_local)) {
+				g_warning ("Failed to parse package: '%s': %s",
+					   package_lines[i], error_local->message);
+				continue;
+			}
+			if (!pk_transaction_db_history_is_interesting (pk_package_get_info (package)))
+				continue;
+			if (pk_transaction_db_insert_history (tdb, insert, tid, timestamp, uid, package))
+				cnt++;
+		}
+	}
+	if (!pk_transaction_db_execute (tdb, "COMMIT", error))
+		return FALSE;
+
+	g_debug ("migrated %u package history entries", cnt);
+	return TRUE;
+}
+
 gboolean
 pk_transaction_db_load (PkTransactionDb *tdb, GError **error)
 {
@@ -969,6 +1186,25 @@ pk_transaction_db_load (PkTransactionDb *tdb, GError **error)
 			return FALSE;
 	}
 
+	/* normalized package history (since 1.3.0) */
+	if (!pk_transaction_db_execute (tdb, "SELECT * FROM package_history LIMIT 1", &error_local)) {
+		g_debug ("adding table package_history: %s", error_local->message);
+		g_clear_error (&error_local);
+		statement = "CREATE TABLE package_history ("
+			    "transaction_id TEXT,"
+			    "package_name TEXT NOT NULL,"
+			    "info TEXT,"
+			    "version TEXT,"
+			    "source TEXT,"
+			    "timestamp INTEGER NOT NULL,"
+			    "uid INTEGER DEFAULT 0,"
+			    "UNIQUE (package_name, timestamp));";
+		if (!pk_transaction_db_execute (tdb, statement, error))
+			return FALSE;
+		if (!pk_transaction_db_migrate_package_history (tdb, error))
+			return FALSE;
+	}
+
 	/* try to set correct permissions */
 	g_chmod (PK_DB_DIR "/transactions.db", 0644);
 
@@ -981,6 +1217,7 @@ static void
 pk_transaction_db_init (PkTransactionDb *tdb)
 {
 	tdb->priv = PK_TRANSACTION_DB_GET_PRIVATE (tdb);
+	tdb->priv->metrics = pk_metrics_new ();
 }
 
 static void
@@ -999,6 +1236,7 @@ pk_transaction_db_finalize (GObject *object)
 
 	/* close the database */
 	sqlite3_close (tdb->priv->db);
+	g_object_unref (tdb->priv->metrics);
 
 	G_OBJECT_CLASS (pk_transaction_db_parent_class)->finalize (object);
 }
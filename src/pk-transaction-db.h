@@ -77,6 +77,13 @@ gboolean	 pk_transaction_db_set_data		(PkTransactionDb	*tdb,
 							 const gchar		*data);
 GList		*pk_transaction_db_get_list		(PkTransactionDb	*tdb,
 							 guint			 limit);
+gboolean	 pk_transaction_db_add_package_history	(PkTransactionDb	*tdb,
+							 const gchar		*tid,
+							 guint			 uid,
+							 GPtrArray		*packages);
+GVariant	*pk_transaction_db_get_package_history	(PkTransactionDb	*tdb,
+							 const gchar		*package_name,
+							 guint			 limit);
 gboolean	 pk_transaction_db_action_time_reset	(PkTransactionDb	*tdb,
 							 PkRoleEnum		 role);
 guint		 pk_transaction_db_action_time_since	(PkTransactionDb	*tdb,
@@ -27,6 +27,16 @@
 
 G_BEGIN_DECLS
 
+typedef struct {
+	gint64		 last_time;
+	guint		 last_percentage;
+	guint64		 last_size_remaining;
+	gdouble		 percentage_rate;
+	gdouble		 byte_rate;
+	guint		 samples;
+	guint		 remaining;
+} PkTransactionEta;
+
 /* only here for the self test program to use */
 void	pk_transaction_get_updates	(PkTransaction	*transaction,
 					 GVariant	*params,
@@ -48,6 +58,11 @@ gboolean	 pk_transaction_strvalidate			(const gchar	*textr,
 								 GError		**error);
 gboolean	 pk_transaction_set_tid				(PkTransaction	*transaction,
 								 const gchar	*tid);
+guint		 pk_transaction_eta_update			(PkTransactionEta *eta,
+								 gint64		 now,
+								 guint		 percentage,
+								 guint64	 size_remaining,
+								 guint		 speed);
 
 
 G_END_DECLS
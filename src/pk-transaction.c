@@ -51,6 +51,7 @@
 
 #include "pk-backend.h"
 #include "pk-dbus.h"
+#include "pk-metrics.h"
 #include "pk-shared.h"
 #include "pk-transaction-db.h"
 #include "pk-transaction.h"
@@ -79,6 +80,12 @@ static gboolean pk_transaction_is_supported_content_type (PkTransaction *transac
 /* maximum number of items that can be resolved in one go */
 #define PK_TRANSACTION_MAX_ITEMS_TO_RESOLVE	10000
 
+/* progress updates per second, unless set with ProgressUpdateRate */
+#define PK_TRANSACTION_PROGRESS_UPDATE_RATE	10
+
+/* weight of the newest sample in the smoothed rates used for the ETA */
+#define PK_TRANSACTION_ETA_SMOOTHING		0.3
+
 struct PkTransactionPrivate
 {
 	PkRoleEnum		 role;
@@ -110,10 +117,15 @@ struct PkTransactionPrivate
 	GCancellable		*cancellable;
 	gboolean		 skip_auth_check;
 	gboolean		 client_supports_plural_signals;
+	gboolean		 client_supports_list_signals;
+	gboolean		 client_supports_compact_signals;
 
 	/* Rate limiting of progress reporting */
 	gboolean		 progress_changed;
+	guint			 progress_interval;  /* ms, 0 to emit immediately */
 	GSource			*progress_timeout_source;  /* (nullable) (owned) */
+	GPtrArray		*pending_item_progress;  /* (element-type PkItemProgress) */
+	PkTransactionEta	 eta;
 
 	/* needed for gui coldplugging */
 	gchar			*last_package_id;
@@ -122,6 +134,8 @@ struct PkTransactionPrivate
 	gchar			*cmdline;
 	PkResults		*results;
 	PkTransactionDb		*transaction_db;
+	PkMetrics		*metrics;
+	PkMetricsTransaction	 metrics_item;
 
 	/* cached */
 	gboolean		 cached_force;
@@ -306,6 +320,48 @@ out:
 	return TRUE;
 }
 
+/*
+ * pk_transaction_emit_signal:
+ *
+ * Emits a signal on the transaction object and counts it for the metrics.
+ * Like g_dbus_connection_emit_signal() this consumes a floating
+ * @parameters and returns %FALSE if the message could not be sent.
+ **/
+static gboolean
+pk_transaction_emit_signal (PkTransaction *transaction,
+			    const gchar *interface_name,
+			    const gchar *signal_name,
+			    GVariant *parameters)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	gboolean ret;
+
+	/* signals like Destroy have no parameters */
+	if (parameters != NULL)
+		g_variant_ref_sink (parameters);
+	ret = g_dbus_connection_emit_signal (priv->connection,
+					     NULL,
+					     priv->tid,
+					     interface_name,
+					     signal_name,
+					     parameters,
+					     NULL);
+	if (ret) {
+		priv->metrics_item.signals++;
+		if (parameters != NULL)
+			priv->metrics_item.bytes += g_variant_get_size (parameters);
+
+		/* property updates start as soon as it runs, results do not */
+		if (priv->metrics_item.started != 0 &&
+		    priv->metrics_item.first_emission == 0 &&
+		    g_strcmp0 (interface_name, PK_DBUS_INTERFACE_TRANSACTION) == 0)
+			priv->metrics_item.first_emission = g_get_monotonic_time ();
+	}
+	if (parameters != NULL)
+		g_variant_unref (parameters);
+	return ret;
+}
+
 static void pk_transaction_emit_properties_changed (PkTransaction *transaction,
                                                     const gchar   *first_property_name,
                                                     GVariant      *first_property_value,
@@ -340,16 +396,13 @@ pk_transaction_emit_properties_changed (PkTransaction *transaction,
 
 	va_end (args);
 
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       "org.freedesktop.DBus.Properties",
-				       "PropertiesChanged",
-				       g_variant_new ("(sa{sv}as)",
-						      PK_DBUS_INTERFACE_TRANSACTION,
-						      &builder,
-						      &invalidated_builder),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    "org.freedesktop.DBus.Properties",
+				    "PropertiesChanged",
+				    g_variant_new ("(sa{sv}as)",
+						   PK_DBUS_INTERFACE_TRANSACTION,
+						   &builder,
+						   &invalidated_builder));
 }
 
 static void
@@ -373,9 +426,34 @@ flush_progress_changed (PkTransaction *transaction)
 {
 	PkTransactionPrivate *priv = transaction->priv;
 
+	/* Only the latest ItemProgress of each package and status is kept. */
+	for (guint i = 0; i < priv->pending_item_progress->len; i++) {
+		PkItemProgress *item = g_ptr_array_index (priv->pending_item_progress, i);
+		pk_transaction_emit_signal (transaction,
+					    PK_DBUS_INTERFACE_TRANSACTION,
+					    "ItemProgress",
+					    g_variant_new ("(suu)",
+							   pk_item_progress_get_package_id (item),
+							   pk_item_progress_get_status (item),
+							   pk_item_progress_get_percentage (item)));
+	}
+	g_ptr_array_set_size (priv->pending_item_progress, 0);
+
 	if (!priv->progress_changed)
 		return;
 
+	/* The ETA is sampled at the emission rate rather than on every
+	 * backend update, which keeps the smoothing independent of how
+	 * chatty the backend is. */
+	if (priv->state == PK_TRANSACTION_STATE_RUNNING) {
+		priv->elapsed_time = pk_backend_job_get_runtime (priv->job) / 1000;
+		priv->remaining_time = pk_transaction_eta_update (&priv->eta,
+								  g_get_monotonic_time (),
+								  priv->percentage,
+								  priv->download_size_remaining,
+								  priv->speed);
+	}
+
 	/* Emit a D-Bus signal to notify of the progress changes. */
 	pk_transaction_emit_properties_changed (transaction,
 						"Percentage", g_variant_new_uint32 (priv->percentage),
@@ -402,8 +480,10 @@ progress_timeout_cb (gpointer user_data)
  * doesn’t emit multiple D-Bus signals every millisecond for fast-progressing
  * operations (which are quite common).
  *
- * Instead, emit signals on a timer, set to 100ms (which should be fast enough
- * for users to not notice the quantisation).
+ * Instead, emit signals on a timer, by default every 100ms (which should be
+ * fast enough for users to not notice the quantisation). The rate can be
+ * changed with ProgressUpdateRate in the daemon config, where 0 disables
+ * the aggregation.
  *
  * This significantly reduces the context switching overhead between
  * packagekitd, dbus-daemon, and the PackageKit clients.
@@ -414,14 +494,17 @@ progress_timeout_cb (gpointer user_data)
  * flush_progress_changed().
  */
 static void
-schedule_progress_changed (PkTransaction *transaction)
+schedule_progress_flush (PkTransaction *transaction)
 {
-	transaction->priv->progress_changed = TRUE;
+	if (transaction->priv->progress_interval == 0) {
+		flush_progress_changed (transaction);
+		return;
+	}
 
 	if (transaction->priv->progress_timeout_source == NULL) {
 		g_autoptr(GSource) source = NULL;
 
-		source = g_timeout_source_new (100  /* ms */);
+		source = g_timeout_source_new (transaction->priv->progress_interval);
 		g_source_set_callback (source, G_SOURCE_FUNC (progress_timeout_cb), transaction, NULL);
 
 #if GLIB_CHECK_VERSION(2, 70, 0)
@@ -433,6 +516,92 @@ schedule_progress_changed (PkTransaction *transaction)
 	}
 }
 
+static void
+schedule_progress_changed (PkTransaction *transaction)
+{
+	transaction->priv->progress_changed = TRUE;
+	schedule_progress_flush (transaction);
+}
+
+static gdouble
+pk_transaction_eta_smooth (gdouble rate, gdouble sample, gboolean first)
+{
+	if (first)
+		return sample;
+	return PK_TRANSACTION_ETA_SMOOTHING * sample +
+	       (1 - PK_TRANSACTION_ETA_SMOOTHING) * rate;
+}
+
+/*
+ * pk_transaction_eta_update:
+ * @eta: the estimator state, zeroed before the first call
+ * @now: the monotonic time in µs
+ * @percentage: the transaction percentage, or %PK_BACKEND_PERCENTAGE_INVALID
+ * @size_remaining: the number of bytes left to download
+ * @speed: the speed reported by the backend in bits per second, or 0
+ *
+ * Feeds one progress sample into an exponentially smoothed rate and
+ * returns the estimated number of seconds remaining, or 0 if unknown.
+ *
+ * While downloading, the estimate is based on the bytes remaining, as
+ * the percentage of a download usually covers very different file sizes.
+ **/
+guint
+pk_transaction_eta_update (PkTransactionEta *eta,
+			   gint64 now,
+			   guint percentage,
+			   guint64 size_remaining,
+			   guint speed)
+{
+	gdouble elapsed;
+	gdouble remaining = 0;
+
+	/* nothing to extrapolate from, or a new phase started */
+	if (percentage > 100 ||
+	    eta->last_time == 0 ||
+	    percentage < eta->last_percentage) {
+		memset (eta, 0, sizeof (PkTransactionEta));
+		if (percentage <= 100) {
+			eta->last_time = now;
+			eta->last_percentage = percentage;
+			eta->last_size_remaining = size_remaining;
+		}
+		return 0;
+	}
+
+	elapsed = (gdouble) (now - eta->last_time) / G_USEC_PER_SEC;
+	if (elapsed <= 0)
+		return eta->remaining;
+
+	/* percent per second */
+	eta->percentage_rate = pk_transaction_eta_smooth (eta->percentage_rate,
+							  (percentage - eta->last_percentage) / elapsed,
+							  eta->samples == 0);
+
+	/* bytes per second, preferring what the backend measured */
+	if (speed > 0) {
+		eta->byte_rate = pk_transaction_eta_smooth (eta->byte_rate,
+							    speed / 8.0,
+							    eta->samples == 0);
+	} else if (size_remaining <= eta->last_size_remaining) {
+		eta->byte_rate = pk_transaction_eta_smooth (eta->byte_rate,
+							    (eta->last_size_remaining - size_remaining) / elapsed,
+							    eta->samples == 0);
+	}
+	eta->samples++;
+
+	eta->last_time = now;
+	eta->last_percentage = percentage;
+	eta->last_size_remaining = size_remaining;
+
+	if (size_remaining > 0 && eta->byte_rate > 1)
+		remaining = size_remaining / eta->byte_rate;
+	else if (eta->percentage_rate > 0.001)
+		remaining = (100 - percentage) / eta->percentage_rate;
+	eta->remaining = (guint) MIN (remaining + 0.5, (gdouble) G_MAXUINT32);
+	return eta->remaining;
+}
+
 /* Remove the @progress_timeout_source, if set. */
 static void
 unschedule_progress_changed (PkTransaction *transaction)
@@ -506,26 +675,38 @@ pk_transaction_status_changed_emit (PkTransaction *transaction, PkStatusEnum sta
 					      g_variant_new_uint32 (status));
 }
 
+/* tells the client, but keeps our place in the queue */
 static void
-pk_transaction_finished_emit (PkTransaction *transaction,
-			      PkExitEnum exit_enum,
-			      guint time_ms)
+pk_transaction_finished_emit_client (PkTransaction *transaction,
+				     PkExitEnum exit_enum,
+				     guint time_ms)
 {
 	g_assert (!transaction->priv->emitted_finished);
 	transaction->priv->emitted_finished = TRUE;
 
+	transaction->priv->metrics_item.finished = g_get_monotonic_time ();
+	pk_metrics_add_transaction (transaction->priv->metrics,
+				    transaction->priv->role,
+				    exit_enum,
+				    &transaction->priv->metrics_item);
+
 	g_debug ("emitting finished '%s', %i",
 		 pk_exit_enum_to_string (exit_enum),
 		 time_ms);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "Finished",
-				       g_variant_new ("(uu)",
-						      exit_enum,
-						      time_ms),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "Finished",
+				    g_variant_new ("(uu)",
+						   exit_enum,
+						   time_ms));
+}
+
+static void
+pk_transaction_finished_emit (PkTransaction *transaction,
+			      PkExitEnum exit_enum,
+			      guint time_ms)
+{
+	pk_transaction_finished_emit_client (transaction, exit_enum, time_ms);
 
 	/* For the transaction list */
 	g_signal_emit (transaction, signals[SIGNAL_FINISHED], 0);
@@ -539,15 +720,12 @@ pk_transaction_error_code_emit (PkTransaction *transaction,
 	g_debug ("emitting error-code %s, '%s'",
 		 pk_error_enum_to_string (error_enum),
 		 details);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "ErrorCode",
-				       g_variant_new ("(us)",
-						      error_enum,
-						      details),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "ErrorCode",
+				    g_variant_new ("(us)",
+						   error_enum,
+						   details));
 }
 
 static void
@@ -577,24 +755,56 @@ pk_transaction_locked_changed_cb (PkBackendJob *job,
 		pk_transaction_make_exclusive (transaction);
 }
 
+/*
+ * pk_transaction_emit_list:
+ *
+ * Emits @items as @list_signal if the client has said it understands it,
+ * and otherwise as one @item_signal per element. Grouping the items into
+ * a single signal saves a round of context switches between packagekitd,
+ * dbus-daemon and the client for every item.
+ **/
 static void
-pk_transaction_details_cb (PkBackendJob *job,
-			   PkDetails *item,
-			   PkTransaction *transaction)
+pk_transaction_emit_list (PkTransaction *transaction,
+			  const gchar *list_signal,
+			  const gchar *item_signal,
+			  GVariant *items)
+{
+	GVariantIter iter;
+	g_autoptr(GVariant) list = g_variant_ref_sink (items);
+	g_autoptr(GVariant) child = NULL;
+
+	if (g_variant_n_children (list) == 0)
+		return;
+
+	/* this falls back below if the D-Bus message limits are hit */
+	if (transaction->priv->client_supports_list_signals &&
+	    pk_transaction_emit_signal (transaction,
+					PK_DBUS_INTERFACE_TRANSACTION,
+					list_signal,
+					g_variant_new_tuple (&list, 1)))
+		return;
+
+	g_variant_iter_init (&iter, list);
+	while ((child = g_variant_iter_next_value (&iter))) {
+		GVariant *params = child;
+		if (!g_variant_is_of_type (child, G_VARIANT_TYPE_TUPLE))
+			params = g_variant_new_tuple (&child, 1);
+		pk_transaction_emit_signal (transaction,
+					    PK_DBUS_INTERFACE_TRANSACTION,
+					    item_signal,
+					    params);
+		g_clear_pointer (&child, g_variant_unref);
+	}
+}
+
+static GVariant *
+pk_transaction_details_to_variant (PkDetails *item)
 {
 	GVariantBuilder builder;
 	PkGroupEnum group;
 	const gchar *tmp;
 	guint64 size;
 
-	g_return_if_fail (PK_IS_TRANSACTION (transaction));
-	g_return_if_fail (transaction->priv->tid != NULL);
-
-	/* add to results */
-	pk_results_add_details (transaction->priv->results, item);
-
-	/* emit */
-	g_debug ("emitting details");
 	g_variant_builder_init (&builder, G_VARIANT_TYPE("a{sv}"));
 	g_variant_builder_add (&builder, "{sv}", "package-id",
 			       g_variant_new_string (pk_details_get_package_id (item)));
@@ -626,14 +836,53 @@ pk_transaction_details_cb (PkBackendJob *job,
 	if (size != G_MAXUINT64)
 		g_variant_builder_add (&builder, "{sv}", "download-size",
 				       g_variant_new_uint64 (size));
+	return g_variant_builder_end (&builder);
+}
+
+static void
+pk_transaction_details_cb (PkBackendJob *job,
+			   PkDetails *item,
+			   PkTransaction *transaction)
+{
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+	g_return_if_fail (transaction->priv->tid != NULL);
 
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "Details",
-				       g_variant_new ("(a{sv})", &builder),
-				       NULL);
+	/* add to results */
+	pk_results_add_details (transaction->priv->results, item);
+
+	/* emit */
+	g_debug ("emitting details");
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "Details",
+				    g_variant_new ("(@a{sv})",
+						   pk_transaction_details_to_variant (item)));
+}
+
+static void
+pk_transaction_details_list_cb (PkBackendJob *job,
+				GPtrArray *details,
+				PkTransaction *transaction)
+{
+	GVariantBuilder builder;
+
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+	g_return_if_fail (transaction->priv->tid != NULL);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
+	for (guint i = 0; i < details->len; i++) {
+		PkDetails *item = g_ptr_array_index (details, i);
+
+		/* add to results */
+		pk_results_add_details (transaction->priv->results, item);
+		g_variant_builder_add_value (&builder,
+					     pk_transaction_details_to_variant (item));
+	}
+
+	/* emit */
+	g_debug ("emitting details for %u packages", details->len);
+	pk_transaction_emit_list (transaction, "DetailsList", "Details",
+				  g_variant_builder_end (&builder));
 }
 
 static void
@@ -671,12 +920,27 @@ pk_transaction_error_code_cb (PkBackendJob *job,
 	}
 }
 
+static void
+pk_transaction_files_check_prefix (PkTransaction *transaction, gchar **files)
+{
+	/* ensure the files have the correct prefix */
+	if (transaction->priv->role != PK_ROLE_ENUM_DOWNLOAD_PACKAGES ||
+	    transaction->priv->cached_directory == NULL)
+		return;
+	for (guint i = 0; files[i] != NULL; i++) {
+		if (!g_str_has_prefix (files[i], transaction->priv->cached_directory)) {
+			g_warning ("%s does not have the correct prefix (%s)",
+				   files[i],
+				   transaction->priv->cached_directory);
+		}
+	}
+}
+
 static void
 pk_transaction_files_cb (PkBackendJob *job,
 			 PkFiles *item,
 			 PkTransaction *transaction)
 {
-	guint i;
 	g_autofree gchar *package_id = NULL;
 	g_auto(GStrv) files = NULL;
 
@@ -688,33 +952,50 @@ pk_transaction_files_cb (PkBackendJob *job,
 		      "package-id", &package_id,
 		      "files", &files,
 		      NULL);
-
-	/* ensure the files have the correct prefix */
-	if (transaction->priv->role == PK_ROLE_ENUM_DOWNLOAD_PACKAGES &&
-	    transaction->priv->cached_directory != NULL) {
-		for (i = 0; files[i] != NULL; i++) {
-			if (!g_str_has_prefix (files[i], transaction->priv->cached_directory)) {
-				g_warning ("%s does not have the correct prefix (%s)",
-					   files[i],
-					   transaction->priv->cached_directory);
-			}
-		}
-	}
+	pk_transaction_files_check_prefix (transaction, files);
 
 	/* add to results */
 	pk_results_add_files (transaction->priv->results, item);
 
 	/* emit */
 	g_debug ("emitting files %s", package_id);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "Files",
-				       g_variant_new ("(s^as)",
-						      package_id != NULL ? package_id : "",
-						      files),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "Files",
+				    g_variant_new ("(s^as)",
+						   package_id != NULL ? package_id : "",
+						   files));
+}
+
+static void
+pk_transaction_files_list_cb (PkBackendJob *job,
+			      GPtrArray *files_list,
+			      PkTransaction *transaction)
+{
+	GVariantBuilder builder;
+
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+	g_return_if_fail (transaction->priv->tid != NULL);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sas)"));
+	for (guint i = 0; i < files_list->len; i++) {
+		PkFiles *item = g_ptr_array_index (files_list, i);
+		const gchar *package_id = pk_files_get_package_id (item);
+		gchar **files = pk_files_get_files (item);
+
+		pk_transaction_files_check_prefix (transaction, files);
+
+		/* add to results */
+		pk_results_add_files (transaction->priv->results, item);
+		g_variant_builder_add (&builder, "(s^as)",
+				       package_id != NULL ? package_id : "",
+				       files);
+	}
+
+	/* emit */
+	g_debug ("emitting files for %u packages", files_list->len);
+	pk_transaction_emit_list (transaction, "FilesList", "Files",
+				  g_variant_builder_end (&builder));
 }
 
 static void
@@ -745,18 +1026,15 @@ pk_transaction_category_cb (PkBackendJob *job,
 
 	/* emit */
 	g_debug ("emitting category %s, %s, %s, %s, %s ", parent_id, cat_id, name, summary, icon);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "Category",
-				       g_variant_new ("(sssss)",
-						      parent_id != NULL ? parent_id : "",
-						      cat_id,
-						      name,
-						      summary,
-						      icon != NULL ? icon : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "Category",
+				    g_variant_new ("(sssss)",
+						   parent_id != NULL ? parent_id : "",
+						   cat_id,
+						   name,
+						   summary,
+						   icon != NULL ? icon : ""));
 }
 
 static void
@@ -764,24 +1042,31 @@ pk_transaction_item_progress_cb (PkBackendJob *job,
 				 PkItemProgress *item_progress,
 				 PkTransaction *transaction)
 {
+	GPtrArray *pending;
+
 	g_return_if_fail (PK_IS_TRANSACTION (transaction));
 	g_return_if_fail (transaction->priv->tid != NULL);
 
-	/* emit */
-	g_debug ("emitting item-progress %s, %s: %u",
+	g_debug ("queueing item-progress %s, %s: %u",
 		 pk_item_progress_get_package_id (item_progress),
 		 pk_status_enum_to_string (pk_item_progress_get_status (item_progress)),
 		 pk_item_progress_get_percentage (item_progress));
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "ItemProgress",
-				       g_variant_new ("(suu)",
-						      pk_item_progress_get_package_id (item_progress),
-						      pk_item_progress_get_status (item_progress),
-						      pk_item_progress_get_percentage (item_progress)),
-				       NULL);
+
+	/* replace an older update for the same package and status */
+	pending = transaction->priv->pending_item_progress;
+	for (guint i = 0; i < pending->len; i++) {
+		PkItemProgress *item = g_ptr_array_index (pending, i);
+		if (pk_item_progress_get_status (item) != pk_item_progress_get_status (item_progress))
+			continue;
+		if (g_strcmp0 (pk_item_progress_get_package_id (item),
+			       pk_item_progress_get_package_id (item_progress)) != 0)
+			continue;
+		g_object_unref (item);
+		pending->pdata[i] = g_object_ref (item_progress);
+		return;
+	}
+	g_ptr_array_add (pending, g_object_ref (item_progress));
+	schedule_progress_flush (transaction);
 }
 
 static void
@@ -810,16 +1095,13 @@ pk_transaction_distro_upgrade_cb (PkBackendJob *job,
 	g_debug ("emitting distro-upgrade %s, %s, %s",
 		 pk_update_state_enum_to_string (state),
 		 name, summary);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "DistroUpgrade",
-				       g_variant_new ("(uss)",
-						      state,
-						      name,
-						      summary != NULL ? summary : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "DistroUpgrade",
+				    g_variant_new ("(uss)",
+						   state,
+						   name,
+						   summary != NULL ? summary : ""));
 }
 
 static gchar *
@@ -898,6 +1180,10 @@ pk_transaction_set_state (PkTransaction *transaction, PkTransactionState state)
 
 	g_debug ("transaction now %s", pk_transaction_state_to_string (state));
 	priv->state = state;
+
+	/* the scheduler queues the transaction as soon as it is ready */
+	if (state == PK_TRANSACTION_STATE_READY)
+		priv->metrics_item.queued = g_get_monotonic_time ();
 	g_signal_emit (transaction, signals[SIGNAL_STATE_CHANGED], 0, state);
 
 	/* only get cmdline when it's going to be saved into the database */
@@ -1148,6 +1434,174 @@ pk_transaction_offline_finished (PkTransaction *transaction)
 	}
 }
 
+static gboolean
+pk_transaction_search_index_needs_refresh (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+
+	if (pk_backend_get_search_index (priv->backend) == NULL)
+		return FALSE;
+	if (pk_bitfield_contain (priv->cached_transaction_flags,
+				 PK_TRANSACTION_FLAG_ENUM_SIMULATE))
+		return FALSE;
+	if (pk_bitfield_contain (priv->cached_transaction_flags,
+				 PK_TRANSACTION_FLAG_ENUM_ONLY_DOWNLOAD))
+		return FALSE;
+	switch (priv->role) {
+	case PK_ROLE_ENUM_REFRESH_CACHE:
+	case PK_ROLE_ENUM_REPO_ENABLE:
+	case PK_ROLE_ENUM_REPO_REMOVE:
+	case PK_ROLE_ENUM_REPO_SET_DATA:
+	case PK_ROLE_ENUM_INSTALL_PACKAGES:
+	case PK_ROLE_ENUM_INSTALL_FILES:
+	case PK_ROLE_ENUM_REMOVE_PACKAGES:
+	case PK_ROLE_ENUM_UPDATE_PACKAGES:
+	case PK_ROLE_ENUM_UPGRADE_SYSTEM:
+	case PK_ROLE_ENUM_REPAIR_SYSTEM:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static gboolean
+pk_transaction_desktop_changes_packages (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+
+	if (pk_bitfield_contain (priv->cached_transaction_flags,
+				 PK_TRANSACTION_FLAG_ENUM_SIMULATE))
+		return FALSE;
+	if (pk_bitfield_contain (priv->cached_transaction_flags,
+				 PK_TRANSACTION_FLAG_ENUM_ONLY_DOWNLOAD))
+		return FALSE;
+	switch (priv->role) {
+	case PK_ROLE_ENUM_INSTALL_PACKAGES:
+	case PK_ROLE_ENUM_INSTALL_FILES:
+	case PK_ROLE_ENUM_REMOVE_PACKAGES:
+	case PK_ROLE_ENUM_UPDATE_PACKAGES:
+	case PK_ROLE_ENUM_UPGRADE_SYSTEM:
+	case PK_ROLE_ENUM_REPAIR_SYSTEM:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static gboolean
+pk_transaction_desktop_needs_refresh (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+
+	if (pk_backend_get_desktop_database (priv->backend) == NULL)
+		return FALSE;
+
+	/* or packages changed outside of our transactions */
+	return pk_transaction_desktop_changes_packages (transaction) ||
+	       pk_backend_desktop_needs_refresh (priv->backend);
+}
+
+static void
+pk_transaction_desktop_refresh_cb (GObject *source,
+				   GAsyncResult *res,
+				   gpointer user_data)
+{
+	g_autoptr(GError) error = NULL;
+
+	/* backends look at the file lists until the next change */
+	if (!pk_backend_desktop_refresh_finish (PK_BACKEND (source), res, &error))
+		g_warning ("failed to refresh the desktop file database: %s", error->message);
+
+	/* let the scheduler run the next transaction */
+	if (user_data != NULL) {
+		g_autoptr(PkTransaction) transaction = PK_TRANSACTION (user_data);
+		g_signal_emit (transaction, signals[SIGNAL_FINISHED], 0);
+	}
+}
+
+static void
+pk_transaction_desktop_refresh (PkTransaction *transaction, guint time_ms)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+	g_autofree gchar **names = NULL;
+	g_autoptr(GHashTable) changed = NULL;
+	g_autoptr(GPtrArray) packages = NULL;
+
+	/* the client doesn't wait for the database */
+	pk_transaction_finished_emit_client (transaction, PK_EXIT_ENUM_SUCCESS, time_ms);
+
+	/* everything the backend said it installed, updated or removed,
+	 * the backend adds what changed outside of transactions */
+	changed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	if (pk_transaction_desktop_changes_packages (transaction)) {
+		packages = pk_results_get_package_array (priv->results);
+		for (guint i = 0; i < packages->len; i++) {
+			PkPackage *item = g_ptr_array_index (packages, i);
+			g_hash_table_add (changed, g_strdup (pk_package_get_name (item)));
+		}
+		for (guint i = 0; priv->cached_package_ids != NULL && priv->cached_package_ids[i] != NULL; i++) {
+			g_auto(GStrv) split = pk_package_id_split (priv->cached_package_ids[i]);
+			if (split != NULL)
+				g_hash_table_add (changed, g_strdup (split[PK_PACKAGE_ID_NAME]));
+		}
+	}
+	names = (gchar **) g_hash_table_get_keys_as_array (changed, NULL);
+
+	/* backends that can't run our jobs next to the following
+	 * transaction keep them waiting until the database is written */
+	if (pk_backend_supports_parallelization (priv->backend)) {
+		pk_backend_desktop_refresh_async (priv->backend, names,
+						  pk_transaction_desktop_refresh_cb,
+						  NULL);
+		g_signal_emit (transaction, signals[SIGNAL_FINISHED], 0);
+		return;
+	}
+	pk_backend_desktop_refresh_async (priv->backend, names,
+					  pk_transaction_desktop_refresh_cb,
+					  g_object_ref (transaction));
+}
+
+static gboolean
+pk_transaction_command_index_needs_refresh (PkTransaction *transaction)
+{
+	PkTransactionPrivate *priv = transaction->priv;
+
+	if (pk_backend_get_command_index (priv->backend) == NULL)
+		return FALSE;
+	switch (priv->role) {
+	case PK_ROLE_ENUM_REFRESH_CACHE:
+	case PK_ROLE_ENUM_REPO_ENABLE:
+	case PK_ROLE_ENUM_REPO_REMOVE:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static void
+pk_transaction_command_index_refresh_cb (GObject *source,
+					 GAsyncResult *res,
+					 gpointer user_data)
+{
+	g_autoptr(GError) error = NULL;
+
+	/* command-not-found searches the backend until the next refresh */
+	if (!pk_backend_command_index_refresh_finish (PK_BACKEND (source), res, &error))
+		g_warning ("failed to refresh the command index: %s", error->message);
+}
+
+static void
+pk_transaction_search_index_refresh_cb (GObject *source,
+					GAsyncResult *res,
+					gpointer user_data)
+{
+	g_autoptr(GError) error = NULL;
+
+	/* searches fall back to the backend until the next refresh */
+	if (!pk_backend_search_index_refresh_finish (PK_BACKEND (source), res, &error))
+		g_warning ("failed to refresh the search index: %s", error->message);
+}
+
 static void
 pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransaction *transaction)
 {
@@ -1221,6 +1675,14 @@ pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransacti
 		if (!pk_strzero (packages))
 			pk_transaction_db_set_data (transaction->priv->transaction_db, transaction->priv->tid, packages);
 
+		/* index what happened to each package for GetPackageHistory */
+		if (exit_enum == PK_EXIT_ENUM_SUCCESS) {
+			pk_transaction_db_add_package_history (transaction->priv->transaction_db,
+							       transaction->priv->tid,
+							       transaction->priv->client_uid,
+							       array);
+		}
+
 		/* report to syslog */
 		for (i = 0; i < array->len; i++) {
 			item = g_ptr_array_index (array, i);
@@ -1283,6 +1745,27 @@ pk_transaction_finished_cb (PkBackendJob *job, PkExitEnum exit_enum, PkTransacti
 	/* destroy the job */
 	pk_backend_stop_job (transaction->priv->backend, transaction->priv->job);
 
+	/* the index is rebuilt next to the transactions that run after us,
+	 * searches go to the backend while it is stale */
+	if (exit_enum == PK_EXIT_ENUM_SUCCESS &&
+	    pk_transaction_search_index_needs_refresh (transaction)) {
+		pk_search_index_invalidate (pk_backend_get_search_index (transaction->priv->backend));
+		pk_backend_search_index_refresh_async (transaction->priv->backend,
+						       pk_transaction_search_index_refresh_cb,
+						       NULL);
+	}
+	if (exit_enum == PK_EXIT_ENUM_SUCCESS &&
+	    pk_transaction_command_index_needs_refresh (transaction)) {
+		pk_backend_command_index_refresh_async (transaction->priv->backend,
+							pk_transaction_command_index_refresh_cb,
+							NULL);
+	}
+	if (exit_enum == PK_EXIT_ENUM_SUCCESS &&
+	    pk_transaction_desktop_needs_refresh (transaction)) {
+		pk_transaction_desktop_refresh (transaction, time_ms);
+		return;
+	}
+
 	/* we emit last, as other backends will be running very soon after us, and we don't want to be notified */
 	pk_transaction_finished_emit (transaction, exit_enum, time_ms);
 }
@@ -1364,16 +1847,58 @@ pk_transaction_package_cb (PkBackend *backend,
 	update_severity = pk_package_get_update_severity (item);
 	encoded_value = info | (((guint32) update_severity) << 16);
 
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "Package",
-				       g_variant_new ("(uss)",
-						      encoded_value,
-						      package_id,
-						      summary ? summary : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "Package",
+				    g_variant_new ("(uss)",
+						   encoded_value,
+						   package_id,
+						   summary ? summary : ""));
+}
+
+/*
+ * pk_transaction_packages_to_compact_variant:
+ *
+ * Builds the (asa(uuuuss)) parameters of PackagesCompact. The arch, data
+ * and summary of each package are indexes into a string table which is
+ * shared by the whole signal, as they repeat across most rows.
+ **/
+static GVariant *
+pk_transaction_packages_to_compact_variant (GPtrArray *packages)
+{
+	GVariantBuilder rows;
+	g_autoptr(GHashTable) index = g_hash_table_new (g_str_hash, g_str_equal);
+	g_autoptr(GPtrArray) strings = g_ptr_array_new ();
+
+	g_variant_builder_init (&rows, G_VARIANT_TYPE ("a(uuuuss)"));
+	for (guint i = 0; i < packages->len; i++) {
+		PkPackage *item = g_ptr_array_index (packages, i);
+		const gchar *summary = pk_package_get_summary (item);
+		const gchar *fields[] = { pk_package_get_arch (item),
+					  pk_package_get_data (item),
+					  summary != NULL ? summary : "" };
+		guint idx[G_N_ELEMENTS (fields)];
+
+		for (guint j = 0; j < G_N_ELEMENTS (fields); j++) {
+			gpointer value;
+			if (!g_hash_table_lookup_extended (index, fields[j], NULL, &value)) {
+				value = GUINT_TO_POINTER (strings->len);
+				g_hash_table_insert (index, (gpointer) fields[j], value);
+				g_ptr_array_add (strings, (gpointer) fields[j]);
+			}
+			idx[j] = GPOINTER_TO_UINT (value);
+		}
+		g_variant_builder_add (&rows, "(uuuuss)",
+				       pk_package_get_info (item) |
+				       (((guint32) pk_package_get_update_severity (item)) << 16),
+				       idx[0], idx[1], idx[2],
+				       pk_package_get_name (item),
+				       pk_package_get_version (item));
+	}
+	return g_variant_new ("(@as@a(uuuuss))",
+			      g_variant_new_strv ((const gchar * const *) strings->pdata,
+						  strings->len),
+			      g_variant_builder_end (&rows));
 }
 
 static void
@@ -1383,7 +1908,7 @@ pk_transaction_packages_cb (PkBackend *backend,
 {
 	g_auto(GVariantBuilder) builder = G_VARIANT_BUILDER_INIT (G_VARIANT_TYPE ("a(uss)"));
 	g_autoptr(GVariant) package_array_variant = NULL;
-	guint n_added_packages = 0;
+	g_autoptr(GPtrArray) emitted_packages = NULL;
 	gboolean emitted = FALSE;
 
 	g_return_if_fail (PK_IS_TRANSACTION (transaction));
@@ -1395,15 +1920,14 @@ pk_transaction_packages_cb (PkBackend *backend,
 		return;
 	}
 
-	/* Loop through the packages and build a signal emission. */
+	/* Loop through the packages and pick the ones to emit. */
+	emitted_packages = g_ptr_array_sized_new (package_array->len);
 	for (guint i = 0; i < package_array->len; i++) {
 		PkPackage *item = g_ptr_array_index (package_array, i);
 		const gchar *role_text;
 		PkInfoEnum info;
-		PkInfoEnum update_severity;
 		const gchar *package_id;
 		const gchar *summary = NULL;
-		guint encoded_value;
 
 		/* check the backend is doing the right thing */
 		info = pk_package_get_info (item);
@@ -1455,23 +1979,40 @@ pk_transaction_packages_cb (PkBackend *backend,
 				 summary);
 		}
 
-		/* Safety checks, that the two values do not interleave, neither overflow */
-		g_assert ((PK_INFO_ENUM_LAST & (~0xFFFF)) == 0);
+		g_ptr_array_add (emitted_packages, item);
+	}
+
+	if (emitted_packages->len == 0) {
+		g_debug ("Empty package array");
+		return;
+	}
+
+	/* Safety checks, that the two values do not interleave, neither overflow */
+	g_assert ((PK_INFO_ENUM_LAST & (~0xFFFF)) == 0);
+
+	/* The compact form sends each repeated string once per signal, which
+	 * makes the message much smaller when most packages come from the
+	 * same repository. Like Packages, it falls back if it is too big. */
+	if (transaction->priv->client_supports_plural_signals &&
+	    transaction->priv->client_supports_compact_signals &&
+	    pk_transaction_emit_signal (transaction,
+					PK_DBUS_INTERFACE_TRANSACTION,
+					"PackagesCompact",
+					pk_transaction_packages_to_compact_variant (emitted_packages)))
+		return;
 
-		update_severity = pk_package_get_update_severity (item);
-		encoded_value = info | (((guint32) update_severity) << 16);
+	for (guint i = 0; i < emitted_packages->len; i++) {
+		PkPackage *item = g_ptr_array_index (emitted_packages, i);
+		const gchar *summary = pk_package_get_summary (item);
+		guint encoded_value;
 
+		encoded_value = pk_package_get_info (item) |
+				(((guint32) pk_package_get_update_severity (item)) << 16);
 		g_variant_builder_add (&builder,
 				       "(uss)",
 				       encoded_value,
-				       package_id,
+				       pk_package_get_id (item),
 				       summary ? summary : "");
-		n_added_packages++;
-	}
-
-	if (n_added_packages == 0) {
-		g_debug ("Empty package array");
-		return;
 	}
 
 	package_array_variant = g_variant_ref_sink (g_variant_builder_end (&builder));
@@ -1486,14 +2027,11 @@ pk_transaction_packages_cb (PkBackend *backend,
 	 * maximum message size of 128MB) until it’s listing on the order of
 	 * 100000 packages. If it does, we fall back below. */
 	if (transaction->priv->client_supports_plural_signals &&
-	    g_dbus_connection_emit_signal (transaction->priv->connection,
-					   NULL,
-					   transaction->priv->tid,
-					   PK_DBUS_INTERFACE_TRANSACTION,
-					   "Packages",
-					   g_variant_new ("(@a(uss))",
-					                  package_array_variant),
-					   NULL))
+	    pk_transaction_emit_signal (transaction,
+					PK_DBUS_INTERFACE_TRANSACTION,
+					"Packages",
+					g_variant_new ("(@a(uss))",
+						       package_array_variant)))
 		emitted = TRUE;
 
 	if (!emitted) {
@@ -1504,13 +2042,10 @@ pk_transaction_packages_cb (PkBackend *backend,
 		g_variant_iter_init (&iter, package_array_variant);
 
 		while ((child = g_variant_iter_next_value (&iter))) {
-			g_dbus_connection_emit_signal (transaction->priv->connection,
-						       NULL,
-						       transaction->priv->tid,
-						       PK_DBUS_INTERFACE_TRANSACTION,
-						       "Package",
-						       child,
-						       NULL);
+			pk_transaction_emit_signal (transaction,
+						    PK_DBUS_INTERFACE_TRANSACTION,
+						    "Package",
+						    child);
 			g_clear_pointer (&child, g_variant_unref);
 		}
 	}
@@ -1536,16 +2071,42 @@ pk_transaction_repo_detail_cb (PkBackend *backend,
 	description = pk_repo_detail_get_description (item);
 	enabled = pk_repo_detail_get_enabled (item);
 	g_debug ("emitting repo-detail %s, %s, %i", repo_id, description, enabled);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "RepoDetail",
-				       g_variant_new ("(ssb)",
-						      repo_id,
-						      description != NULL ? description : "",
-						      enabled),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "RepoDetail",
+				    g_variant_new ("(ssb)",
+						   repo_id,
+						   description != NULL ? description : "",
+						   enabled));
+}
+
+static void
+pk_transaction_repo_details_cb (PkBackend *backend,
+				GPtrArray *repo_details,
+				PkTransaction *transaction)
+{
+	GVariantBuilder builder;
+
+	g_return_if_fail (PK_IS_TRANSACTION (transaction));
+	g_return_if_fail (transaction->priv->tid != NULL);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssb)"));
+	for (guint i = 0; i < repo_details->len; i++) {
+		PkRepoDetail *item = g_ptr_array_index (repo_details, i);
+		const gchar *description = pk_repo_detail_get_description (item);
+
+		/* add to results */
+		pk_results_add_repo_detail (transaction->priv->results, item);
+		g_variant_builder_add (&builder, "(ssb)",
+				       pk_repo_detail_get_id (item),
+				       description != NULL ? description : "",
+				       pk_repo_detail_get_enabled (item));
+	}
+
+	/* emit */
+	g_debug ("emitting %u repo-details", repo_details->len);
+	pk_transaction_emit_list (transaction, "RepoDetails", "RepoDetail",
+				  g_variant_builder_end (&builder));
 }
 
 static void
@@ -1585,21 +2146,18 @@ pk_transaction_repo_signature_required_cb (PkBackend *backend,
 		 package_id, repository_name, key_url, key_userid, key_id,
 		 key_fingerprint, key_timestamp,
 		 pk_sig_type_enum_to_string (type));
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "RepoSignatureRequired",
-				       g_variant_new ("(sssssssu)",
-						      package_id,
-						      repository_name,
-						      key_url != NULL ? key_url : "",
-						      key_userid != NULL ? key_userid : "",
-						      key_id != NULL ? key_id : "",
-						      key_fingerprint != NULL ? key_fingerprint : "",
-						      key_timestamp != NULL ? key_timestamp : "",
-						      type),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "RepoSignatureRequired",
+				    g_variant_new ("(sssssssu)",
+						   package_id,
+						   repository_name,
+						   key_url != NULL ? key_url : "",
+						   key_userid != NULL ? key_userid : "",
+						   key_id != NULL ? key_id : "",
+						   key_fingerprint != NULL ? key_fingerprint : "",
+						   key_timestamp != NULL ? key_timestamp : "",
+						   type));
 
 	/* we should mark this transaction so that we finish with a special code */
 	transaction->priv->emit_signature_required = TRUE;
@@ -1630,17 +2188,14 @@ pk_transaction_eula_required_cb (PkBackend *backend,
 	/* emit */
 	g_debug ("emitting eula-required %s, %s, %s, %s",
 		   eula_id, package_id, vendor_name, license_agreement);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "EulaRequired",
-				       g_variant_new ("(ssss)",
-						      eula_id,
-						      package_id,
-						      vendor_name != NULL ? vendor_name : "",
-						      license_agreement != NULL ? license_agreement : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "EulaRequired",
+				    g_variant_new ("(ssss)",
+						   eula_id,
+						   package_id,
+						   vendor_name != NULL ? vendor_name : "",
+						   license_agreement != NULL ? license_agreement : ""));
 
 	/* we should mark this transaction so that we finish with a special code */
 	transaction->priv->emit_eula_required = TRUE;
@@ -1673,16 +2228,13 @@ pk_transaction_media_change_required_cb (PkBackend *backend,
 		 pk_media_type_enum_to_string (media_type),
 		 media_id,
 		 media_text);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "MediaChangeRequired",
-				       g_variant_new ("(uss)",
-						      media_type,
-						      media_id,
-						      media_text != NULL ? media_text : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "MediaChangeRequired",
+				    g_variant_new ("(uss)",
+						   media_type,
+						   media_id,
+						   media_text != NULL ? media_text : ""));
 
 	/* we should mark this transaction so that we finish with a special code */
 	transaction->priv->emit_media_change_required = TRUE;
@@ -1738,15 +2290,12 @@ pk_transaction_require_restart_cb (PkBackend *backend,
 	g_debug ("emitting require-restart %s, '%s'",
 		 pk_restart_enum_to_string (restart),
 		 package_id);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "RequireRestart",
-				       g_variant_new ("(us)",
-						      restart,
-						      package_id),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "RequireRestart",
+				    g_variant_new ("(us)",
+						   restart,
+						   package_id));
 }
 
 static void
@@ -1806,25 +2355,22 @@ pk_transaction_update_detail_cb (PkBackend *backend,
 	issued = pk_update_detail_get_issued (item);
 	updated = pk_update_detail_get_updated (item);
 	g_debug ("emitting update-detail for %s", package_id);
-	g_dbus_connection_emit_signal (transaction->priv->connection,
-				       NULL,
-				       transaction->priv->tid,
-				       PK_DBUS_INTERFACE_TRANSACTION,
-				       "UpdateDetail",
-				       g_variant_new ("(s^as^as^as^as^asussuss)",
-						      package_id,
-						      updates != NULL ? updates : empty,
-						      obsoletes != NULL ? obsoletes : empty,
-						      vendor_urls != NULL ? vendor_urls : empty,
-						      bugzilla_urls != NULL ? bugzilla_urls : empty,
-						      cve_urls != NULL ? cve_urls : empty,
-						      pk_update_detail_get_restart (item),
-						      update_text != NULL ? update_text : "",
-						      changelog != NULL ? changelog : "",
-						      pk_update_detail_get_state (item),
-						      issued != NULL ? issued : "",
-						      updated != NULL ? updated : ""),
-				       NULL);
+	pk_transaction_emit_signal (transaction,
+				    PK_DBUS_INTERFACE_TRANSACTION,
+				    "UpdateDetail",
+				    g_variant_new ("(s^as^as^as^as^asussuss)",
+						   package_id,
+						   updates != NULL ? updates : empty,
+						   obsoletes != NULL ? obsoletes : empty,
+						   vendor_urls != NULL ? vendor_urls : empty,
+						   bugzilla_urls != NULL ? bugzilla_urls : empty,
+						   cve_urls != NULL ? cve_urls : empty,
+						   pk_update_detail_get_restart (item),
+						   update_text != NULL ? update_text : "",
+						   changelog != NULL ? changelog : "",
+						   pk_update_detail_get_state (item),
+						   issued != NULL ? issued : "",
+						   updated != NULL ? updated : ""));
 }
 
 static void
@@ -1906,14 +2452,11 @@ pk_transaction_update_details_cb (PkBackend *backend,
 	 * 6400 updates, if we assume 10KB of changelog/details per update.
 	 * If it does hit the limits, we fall back to the old code below. */
 	if (transaction->priv->client_supports_plural_signals &&
-	    g_dbus_connection_emit_signal (transaction->priv->connection,
-					   NULL,
-					   transaction->priv->tid,
-					   PK_DBUS_INTERFACE_TRANSACTION,
-					   "UpdateDetails",
-					   g_variant_new ("(@a(sasasasasasussuss))",
-					                  update_details_array_variant),
-					   NULL))
+	    pk_transaction_emit_signal (transaction,
+					PK_DBUS_INTERFACE_TRANSACTION,
+					"UpdateDetails",
+					g_variant_new ("(@a(sasasasasasussuss))",
+						       update_details_array_variant)))
 		emitted = TRUE;
 
 	if (!emitted) {
@@ -1924,13 +2467,10 @@ pk_transaction_update_details_cb (PkBackend *backend,
 		g_variant_iter_init (&iter, update_details_array_variant);
 
 		while ((child = g_variant_iter_next_value (&iter))) {
-			g_dbus_connection_emit_signal (transaction->priv->connection,
-						       NULL,
-						       transaction->priv->tid,
-						       PK_DBUS_INTERFACE_TRANSACTION,
-						       "UpdateDetail",
-						       child,
-						       NULL);
+			pk_transaction_emit_signal (transaction,
+						    PK_DBUS_INTERFACE_TRANSACTION,
+						    "UpdateDetail",
+						    child);
 			g_clear_pointer (&child, g_variant_unref);
 		}
 	}
@@ -2043,6 +2583,8 @@ pk_transaction_run (PkTransaction *transaction)
 	g_return_val_if_fail (priv->tid != NULL, FALSE);
 	g_return_val_if_fail (transaction->priv->backend != NULL, FALSE);
 
+	priv->metrics_item.started = g_get_monotonic_time ();
+
 	/* we are no longer waiting, we are setting up */
 	pk_transaction_status_changed_emit (transaction, PK_STATUS_ENUM_SETUP);
 
@@ -2098,6 +2640,10 @@ pk_transaction_run (PkTransaction *transaction)
 				  PK_BACKEND_SIGNAL_DETAILS,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_details_cb),
 				  transaction);
+	pk_backend_job_set_vfunc (priv->job,
+				  PK_BACKEND_SIGNAL_DETAILS_LIST,
+				  PK_BACKEND_JOB_VFUNC (pk_transaction_details_list_cb),
+				  transaction);
 	pk_backend_job_set_vfunc (priv->job,
 				  PK_BACKEND_SIGNAL_ERROR_CODE,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_error_code_cb),
@@ -2106,6 +2652,10 @@ pk_transaction_run (PkTransaction *transaction)
 				  PK_BACKEND_SIGNAL_FILES,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_files_cb),
 				  transaction);
+	pk_backend_job_set_vfunc (priv->job,
+				  PK_BACKEND_SIGNAL_FILES_LIST,
+				  PK_BACKEND_JOB_VFUNC (pk_transaction_files_list_cb),
+				  transaction);
 	pk_backend_job_set_vfunc (priv->job,
 				  PK_BACKEND_SIGNAL_DISTRO_UPGRADE,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_distro_upgrade_cb),
@@ -2142,6 +2692,10 @@ pk_transaction_run (PkTransaction *transaction)
 				  PK_BACKEND_SIGNAL_REPO_DETAIL,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_repo_detail_cb),
 				  transaction);
+	pk_backend_job_set_vfunc (priv->job,
+				  PK_BACKEND_SIGNAL_REPO_DETAILS,
+				  PK_BACKEND_JOB_VFUNC (pk_transaction_repo_details_cb),
+				  transaction);
 	pk_backend_job_set_vfunc (priv->job,
 				  PK_BACKEND_SIGNAL_REPO_SIGNATURE_REQUIRED,
 				  PK_BACKEND_JOB_VFUNC (pk_transaction_repo_signature_required_cb),
@@ -3729,21 +4283,18 @@ pk_transaction_get_old_transactions (PkTransaction *transaction,
 			 tid, modified, succeeded,
 			 pk_role_enum_to_string (role),
 			 duration, data, uid, cmdline);
-		g_dbus_connection_emit_signal (transaction->priv->connection,
-					       NULL,
-					       transaction->priv->tid,
-					       PK_DBUS_INTERFACE_TRANSACTION,
-					       "Transaction",
-					       g_variant_new ("(osbuusus)",
-							      tid,
-							      modified,
-							      succeeded,
-							      role,
-							      duration,
-							      data != NULL ? data : "",
-							      uid,
-							      cmdline != NULL ? cmdline : ""),
-					       NULL);
+		pk_transaction_emit_signal (transaction,
+					    PK_DBUS_INTERFACE_TRANSACTION,
+					    "Transaction",
+					    g_variant_new ("(osbuusus)",
+							   tid,
+							   modified,
+							   succeeded,
+							   role,
+							   duration,
+							   data != NULL ? data : "",
+							   uid,
+							   cmdline != NULL ? cmdline : ""));
 	}
 	g_list_free_full (transactions, (GDestroyNotify) g_object_unref);
 
@@ -4914,6 +5465,36 @@ pk_transaction_set_hint (PkTransaction *transaction,
 		return TRUE;
 	}
 
+	/* Are the DetailsList, FilesList and RepoDetails signals supported? */
+	if (g_strcmp0 (key, "supports-list-signals") == 0) {
+		if (g_strcmp0 (value, "true") != 0) {
+			g_set_error (error,
+				     PK_TRANSACTION_ERROR,
+				     PK_TRANSACTION_ERROR_NOT_SUPPORTED,
+				      "supports-list-signals hint expects true only, not %s", value);
+			return FALSE;
+		}
+
+		g_debug ("Client has set supports-list-signals=true");
+		priv->client_supports_list_signals = TRUE;
+		return TRUE;
+	}
+
+	/* Is the PackagesCompact signal supported? */
+	if (g_strcmp0 (key, "supports-compact-signals") == 0) {
+		if (g_strcmp0 (value, "true") != 0) {
+			g_set_error (error,
+				     PK_TRANSACTION_ERROR,
+				     PK_TRANSACTION_ERROR_NOT_SUPPORTED,
+				      "supports-compact-signals hint expects true only, not %s", value);
+			return FALSE;
+		}
+
+		g_debug ("Client has set supports-compact-signals=true");
+		priv->client_supports_compact_signals = TRUE;
+		return TRUE;
+	}
+
 	/* to preserve forwards and backwards compatibility, we ignore
 	 * extra options here */
 	g_warning ("unknown option: %s with value %s", key, value);
@@ -5496,8 +6077,11 @@ pk_transaction_init (PkTransaction *transaction)
 	transaction->priv->percentage = PK_BACKEND_PERCENTAGE_INVALID;
 	transaction->priv->state = PK_TRANSACTION_STATE_UNKNOWN;
 	transaction->priv->dbus = pk_dbus_new ();
+	transaction->priv->metrics = pk_metrics_new ();
 	transaction->priv->results = pk_results_new ();
 	transaction->priv->supported_content_types = g_ptr_array_new_with_free_func (g_free);
+	transaction->priv->pending_item_progress = g_ptr_array_new_with_free_func (g_object_unref);
+	transaction->priv->progress_interval = 1000 / PK_TRANSACTION_PROGRESS_UPDATE_RATE;
 	transaction->priv->cancellable = g_cancellable_new ();
 
 	transaction->priv->transaction_db = pk_transaction_db_new ();
@@ -5540,13 +6124,10 @@ pk_transaction_dispose (GObject *object)
 	/* send signal to clients that we are about to be destroyed */
 	if (transaction->priv->connection != NULL) {
 		g_debug ("emitting destroy %s", transaction->priv->tid);
-		g_dbus_connection_emit_signal (transaction->priv->connection,
-					       NULL,
-					       transaction->priv->tid,
-					       PK_DBUS_INTERFACE_TRANSACTION,
-					       "Destroy",
-					       NULL,
-					       NULL);
+		pk_transaction_emit_signal (transaction,
+					    PK_DBUS_INTERFACE_TRANSACTION,
+					    "Destroy",
+					    NULL);
 	}
 
 	G_OBJECT_CLASS (pk_transaction_parent_class)->dispose (object);
@@ -5579,6 +6160,7 @@ pk_transaction_finalize (GObject *object)
 	g_free (transaction->priv->sender);
 	g_free (transaction->priv->cmdline);
 	g_ptr_array_unref (transaction->priv->supported_content_types);
+	g_ptr_array_unref (transaction->priv->pending_item_progress);
 
 	if (transaction->priv->connection != NULL)
 		g_object_unref (transaction->priv->connection);
@@ -5587,6 +6169,7 @@ pk_transaction_finalize (GObject *object)
 
 	g_key_file_unref (transaction->priv->conf);
 	g_object_unref (transaction->priv->dbus);
+	g_object_unref (transaction->priv->metrics);
 	if (transaction->priv->backend != NULL)
 		g_object_unref (transaction->priv->backend);
 	g_object_unref (transaction->priv->job);
@@ -5606,6 +6189,10 @@ pk_transaction_new (GKeyFile *conf, GDBusNodeInfo *introspection)
 	transaction = g_object_new (PK_TYPE_TRANSACTION, NULL);
 	transaction->priv->conf = g_key_file_ref (conf);
 	transaction->priv->job = pk_backend_job_new (conf);
+	if (g_key_file_has_key (conf, "Daemon", "ProgressUpdateRate", NULL)) {
+		gint rate = g_key_file_get_integer (conf, "Daemon", "ProgressUpdateRate", NULL);
+		transaction->priv->progress_interval = rate > 0 ? 1000 / MIN (rate, 1000) : 0;
+	}
 	transaction->priv->introspection = g_dbus_node_info_ref (introspection);
 	return PK_TRANSACTION (transaction);
 }